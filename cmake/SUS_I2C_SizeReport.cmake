@@ -0,0 +1,92 @@
+# SUS I2C size report: what the library costs in flash and RAM, and what each feature adds to that.
+# Runs in script mode from the "sus_i2c_size_report" target (see CMakeLists.txt), which compiles main/SUS_I2Cmaster_FULL.c once per variant:
+#     full                  every feature
+#     minimal               SUS_I2C_PROFILE_MINIMAL (core only, no log messages)
+#     without_<FEATURE>     every feature except that one (and the features that need it)
+# A feature's cost = full - without_<FEATURE>.
+# Numbers are from the object files BEFORE linking: section sizes as the compiler produced them. On the ESP32 they are the real thing
+# (minus what the linker throws away); on the host (x86/ARM code, simulator shims) only compare them with each other.
+#
+# Sections:  flash = code + constants + initial values of variables (+ IRAM code, it is copied from flash at boot)
+#            IRAM  = code placed in IRAM (SUS_I2C_HOT_PATH_IN_IRAM, IRAM_ATTR functions)
+#            DRAM  = variables (initialized and zeroed)
+cmake_minimum_required(VERSION 3.16)
+
+include("${SUS_I2C_INPUT}")
+
+function(sus_i2c_measure variant)
+    set(flash 0)
+    set(iram 0)
+    set(dram 0)
+    foreach(object ${SUS_I2C_OBJECTS_${variant}})
+        execute_process(COMMAND "${SUS_I2C_SIZE_TOOL}" -A "${object}" OUTPUT_VARIABLE table RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "SUS I2C size report: '${SUS_I2C_SIZE_TOOL} -A ${object}' failed.")
+        endif()
+        string(REPLACE "\n" ";" table "${table}")
+        foreach(line ${table})
+            if(NOT line MATCHES "^([.A-Za-z0-9_$]+)[ \t]+([0-9]+)")
+                continue()
+            endif()
+            set(section "${CMAKE_MATCH_1}")
+            set(size "${CMAKE_MATCH_2}")
+            if(section MATCHES "^\\.iram")
+                math(EXPR iram "${iram} + ${size}")
+                math(EXPR flash "${flash} + ${size}")
+            elseif(section MATCHES "^\\.(data|sdata|dram)")
+                math(EXPR dram "${dram} + ${size}")
+                math(EXPR flash "${flash} + ${size}")
+            elseif(section MATCHES "^\\.(bss|sbss)" OR section STREQUAL "COMMON")
+                math(EXPR dram "${dram} + ${size}")
+            elseif(section MATCHES "^\\.(text|literal|rodata|flash)")
+                math(EXPR flash "${flash} + ${size}")
+            endif()
+        endforeach()
+    endforeach()
+    set(flash_${variant} ${flash} PARENT_SCOPE)
+    set(iram_${variant} ${iram} PARENT_SCOPE)
+    set(dram_${variant} ${dram} PARENT_SCOPE)
+endfunction()
+
+function(sus_i2c_row name flash iram dram)       # Anything after dram is printed as a note at the end of the row.
+    set(row "${name}")
+    string(LENGTH "${name}" length)
+    if(length LESS 30)
+        math(EXPR padding "30 - ${length}")
+        string(REPEAT " " ${padding} spaces)
+        string(APPEND row "${spaces}")
+    endif()
+    foreach(value ${flash} ${iram} ${dram})
+        string(LENGTH "${value}" length)
+        math(EXPR padding "10 - ${length}")
+        string(REPEAT " " ${padding} spaces)
+        string(APPEND row "${spaces}${value}")
+    endforeach()
+    message("${row}${ARGN}")
+endfunction()
+
+foreach(variant ${SUS_I2C_VARIANTS})
+    sus_i2c_measure(${variant})
+endforeach()
+
+message("SUS I2C size report, bytes (${SUS_I2C_SIZE_TOOL}, object files before linking)")
+sus_i2c_row("build" "flash" "IRAM" "DRAM")
+sus_i2c_row("full" ${flash_full} ${iram_full} ${dram_full})
+sus_i2c_row("minimal" ${flash_minimal} ${iram_minimal} ${dram_minimal})
+message("")
+sus_i2c_row("feature cost (full - without)" "flash" "IRAM" "DRAM")
+foreach(variant ${SUS_I2C_VARIANTS})
+    if(NOT variant MATCHES "^without_(.+)$")
+        continue()
+    endif()
+    set(feature "${CMAKE_MATCH_1}")
+    math(EXPR flash "${flash_full} - ${flash_${variant}}")
+    math(EXPR iram "${iram_full} - ${iram_${variant}}")
+    math(EXPR dram "${dram_full} - ${dram_${variant}}")
+    set(note "")
+    if(SUS_I2C_NEEDS_${feature})
+        string(REPLACE ";" ", " dependents "${SUS_I2C_NEEDS_${feature}}")
+        set(note "    (together with ${dependents})")
+    endif()
+    sus_i2c_row("${feature}" ${flash} ${iram} ${dram} "${note}")
+endforeach()
@@ -28,7 +28,8 @@
  *    Description: 
  *              Yet another I2C bus library, BUT created with MAXIMUM readability, clarity, ease of use, integration and modification in mind.
  *              All functions are COMPLETELY STANDALONE and do not depend on any 3rd party #defines, typedefs or abstractions - copy/paste with impunity!
- *              All it takes to add this library to your project is to #include this one .h file.
+ *              All it takes to add this library to your project is to #include this one .h file - from ONE .c file only: the functions are
+ *              defined right here in the header, a second .c file including it gets "multiple definition" linker errors.
  *              
  *              "BAREBONES" version - for when you just want to copy-paste.
  *              See the "FULL" version for the extras and complete Doxygen documentation.
@@ -264,7 +265,7 @@ uint8_t SUS_I2C_ReadRegister_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t
     uint8_t read_value = 0xf1;          // This variable will store the value read from the slave device's register.    
 
     //ESP_LOGW(I2C_READ_TAG,"Attempting to read the value from register %#04x of the device %#04x",registerAddress,I2CdeviceAddressHex);
-    outcome = i2c_master_write_read_device(0,I2CdeviceAddress,&registerAddress,1,&read_value,1,5/portTICK_PERIOD_MS);
+    outcome = i2c_master_write_read_device(I2CportNumber,I2CdeviceAddress,&registerAddress,1,&read_value,1,5/portTICK_PERIOD_MS);
         if (outcome==ESP_OK) 
             {
                 ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
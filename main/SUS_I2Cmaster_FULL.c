@@ -0,0 +1,34 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2Cmaster_FULL.c
+ *
+ *    Brief:    The one translation unit of the compiled SUS I2C component.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   ESP32 (ESP-IDF component) or Linux host (sim/, see CMakeLists.txt)
+ *    Language: C
+ *
+ *    Description:
+ *              SUS_I2Cmaster_FULL.h defines all of its functions in the header, so it is compiled exactly once - here.
+ *              Everybody else includes the generated "SUS_I2Cmaster.h" (declarations only) and links against the component.
+ *              The feature switches (SUS_I2C_FEATURE_*, SUS_I2C_PROFILE_MINIMAL, SUS_I2C_HOT_PATH_IN_IRAM) come from the build system,
+ *              so this file and every user of SUS_I2Cmaster.h see the same ones.
+ *
+*/
+#if defined(SUS_I2C_PROFILE_MINIMAL) && SUS_I2C_PROFILE_MINIMAL && !defined(LOG_LOCAL_LEVEL)
+#define LOG_LOCAL_LEVEL 0       // ESP_LOG_NONE. Minimal profile: the library's log messages and their format strings are not even compiled in. Must come before esp_log.h.
+#endif
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#ifdef ESP_PLATFORM
+#include "nvs.h"               // WARM BOOT: the NVS store.
+#endif
+#include "SUS_I2Cmaster_FULL.h"
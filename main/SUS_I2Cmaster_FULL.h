@@ -33,7 +33,7 @@
  *              Yet another I2C bus library created with MAXIMUM readability, clarity, ease of use, integration and modification in mind.
  *              The code, documentation layout are optimized for ease or reading and comprehension, even by those who are completely new to I2C.
  *              All functions are COMPLETELY STANDALONE and do not depend on any 3rd party #defines, typedefs or abstractions - copy-paste with impunity!
- *              All it takes to add this library to your project is to #include this one .h file.
+ *              All it takes to add this library to your project is to #include this one .h file. Bigger projects: use it as a compiled component, see CONFIG section.
  *              
  *              If you feel like you can make the code run faster, feel free to fork - the lib is specifically designed for this ;) 
  *              Commented LOOOOOOOOONG version - full Doxygen documentation included.
@@ -49,12 +49,39 @@
  *                  8. Writing a byte of data to a register of an I2C slave device
  *                  9. Writing a sequence/stream/array of data bytes to I2C slave device
  *                  10. Resetting a stuck I2C bus
+ *                  11. Recording a trace of every transaction for offline replay and debugging (see tools/SUS_I2C_TraceReplay.c)
+ *                  12. Reading a block of consecutive registers in one transaction (burst read)
+ *                  13. Sampling many devices periodically with a deadline-ordered (EDF) scheduler per I2C port
+ *                  14. Running both I2C ports in parallel on both CPU cores, with one merged stream of timestamped samples (see tools/SUS_I2C_DualPortBenchmark.c)
+ *                  15. Tracking which devices are present in the background and detecting hot-plugging, with a bounded share of bus time
+ *                  16. SMBus commands (quick, byte, word, block, process call) with optional Packet Error Checking (PEC)
+ *                  17. Describing a device's registers once (register maps) and getting typed accessors, caching and merged burst reads from it
+ *                  18. Transfer priorities: splitting large reads/writes into chunks so that more urgent transactions can get onto the bus in between
+ *                  19. Changing the bus speed at runtime, and measuring the highest speed a bus handles reliably (speed calibration)
+ *                  20. Starting reads/writes from interrupts (ISR-safe, lock-free submission of preallocated requests, see tools/SUS_I2C_IsrLatencyBenchmark.c)
+ *                  21. Bandwidth budgets: giving devices a weighted share of the bus time, and seeing which driver uses how much of it
+ *                  22. Synchronized snapshots: triggering several sensors back-to-back (or with one general call) and reading them in one pass, with the skew measured
+ *                  23. Building it as a compiled component (ESP-IDF or host CMake) with a footprint-minimal profile, IRAM hot paths and a per-feature size report (see CONFIG section)
+ *                  24. Driving SSD1306/SH1106 OLED displays from a framebuffer, sending only the regions that changed (see tools/SUS_I2C_DisplayBenchmark.c)
+ *                  25. Bringing all devices up in parallel at boot: per-device steps, delays and dependencies, with the critical path reported (see tools/SUS_I2C_BootBenchmark.c)
+ *                  26. Status-returning reads/writes (_STATUS): esp_err_t for every call, values through pointers, plus batches with a result per item (see STATUS section)
+ *                  27. Decoding whole blocks of raw sample frames into engineering units: fixed-point for the ESP32, SIMD on a PC (see tools/SUS_I2C_DecodeBenchmark.c)
+ *                  28. Write combining: buffering runs of small writes to a device and sending them as one transaction, reads and other writes kept in order (see tools/SUS_I2C_CombineBenchmark.c)
+ *                  29. Read-ahead prefetching: learning the register sequences a driver reads one by one and fetching them in one burst, never touching read-sensitive registers (see tools/SUS_I2C_PrefetchBenchmark.c)
+ *                  30. Coroutines: multi-step device drivers (trigger, wait, poll, read) with awaitable I2C operations and delays, dozens of them on one executor task per port (see tools/SUS_I2C_CoroutineBenchmark.c)
+ *                  31. Warm boot: keeping the bus topology and device configuration state (NVS or a file) and only verifying the devices on the next boot, full set-up just for the ones that changed (see tools/SUS_I2C_WarmBootBenchmark.c)
+ *                  32. Sample frames: reads straight into timestamped frames from a fixed pool, passed to several consumer tasks by pointer with reference counting (see tools/SUS_I2C_FrameBenchmark.c)
  *              
  *              Required bare-minimum #includes:
  *                  #include <stdio.h>
+ *                  #include <stdlib.h>
+ *                  #include <string.h>
  *                  #include "esp_log.h"
+ *                  #include "esp_timer.h"
  *                  #include "driver/i2c.h"
  *                  #include "freertos/task.h"
+ *                  #include "freertos/queue.h"
+ *                  #include "freertos/semphr.h"
  * 
  *              Example of general workflow with this library's functions:
  *                  0. #include the bare minimum official libraries. You will need those for ESP32 to function anyway.
@@ -67,27 +94,151 @@
  *                  7. Run any of the read and/or write functions
  * 
 */
+#ifndef SUS_I2CMASTER_FULL_H
+#define SUS_I2CMASTER_FULL_H
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌      ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌░▌     ▐░▌▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌       ▐░▌▐░▌▐░▌    ▐░▌▐░▌               ▐░▌     ▐░▌
+▐░▌          ▐░▌       ▐░▌▐░▌ ▐░▌   ▐░▌▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     ▐░▌ ▄▄▄▄▄▄▄▄
+▐░▌          ▐░▌       ▐░▌▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░▌▐░░░░░░░░▌
+▐░▌          ▐░▌       ▐░▌▐░▌   ▐░▌ ▐░▌▐░█▀▀▀▀▀▀▀▀▀      ▐░▌     ▐░▌ ▀▀▀▀▀▀█░▌
+▐░▌          ▐░▌       ▐░▌▐░▌    ▐░▌▐░▌▐░▌               ▐░▌     ▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌     ▐░▐░▌▐░▌           ▄▄▄▄█░█▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌      ▐░░▌▐░▌          ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀            ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* BUILD CONFIGURATION: what goes into the library, and where it goes.
+ * Two ways to use the library:
+ *      - HEADER ONLY (the classic way): #include this file in ONE .c file and call the functions from there. Nothing to set up.
+ *        Including it from two .c files gives "multiple definition" linker errors - every function is defined right here in the header.
+ *      - COMPILED COMPONENT: add the repository as an ESP-IDF component (or add_subdirectory() it in a host CMake project, target "sus_i2c").
+ *        The library is compiled ONCE (main/SUS_I2Cmaster_FULL.c) and every .c file that needs it includes "SUS_I2Cmaster.h" instead:
+ *        this same file with declarations only, generated from it during the build (tools/SUS_I2C_MakeApiHeader.py). Include it from as many files as you like.
+ *        The settings below then come from menuconfig ("SUS I2C library") or from the CMake options of the same names.
+ * Header only: #define the settings BEFORE including this file (or pass them with -D). All of them are 0 or 1.
+ *      SUS_I2C_PROFILE_MINIMAL     1 = the footprint-minimal build: just the core (init, scan/ping, read, write, bus reset). Every SUS_I2C_FEATURE_* defaults to 0,
+ *                                  the plain printf() progress lines of scan/ping/write are left out, and the compiled component also drops ALL library
+ *                                  log messages at compile time (LOG_LOCAL_LEVEL), format strings included.
+ *                                  Switch single features back on as needed.
+ *      SUS_I2C_FEATURE_*           one switch per optional section. A section that is switched off costs no flash and no RAM. Its hooks in the read/write
+ *                                  functions (trace, presence, budget) become empty inline functions that the compiler throws away.
+ *      SUS_I2C_HOT_PATH_IN_IRAM    1 = the functions EVERY transaction goes through (marked SUS_I2C_IRAM) are placed in IRAM: register burst reads/writes,
+ *                                  the bus arbiter, the trace/presence/budget hooks and the ISR worker's queue. No flash cache misses on the hot path = steadier
+ *                                  timing at high sample rates, for a few KB of IRAM. They still call the ESP-IDF driver, so this does NOT make them usable
+ *                                  while the flash cache is off (flash writes) - only SUS_I2C_SubmitFromISR is always in IRAM.
+ * The size report prints what every feature costs in flash and RAM: "cmake --build <build dir> --target sus_i2c_size_report" (host),
+ * "idf.py sus_i2c_size_report" (ESP-IDF, real ESP32 numbers).
+ */
+#ifndef SUS_I2C_PROFILE_MINIMAL
+#define SUS_I2C_PROFILE_MINIMAL         0
+#endif
+#define SUS_I2C_FEATURE_DEFAULT         (!SUS_I2C_PROFILE_MINIMAL)
+
+#ifndef SUS_I2C_FEATURE_TRACE
+#define SUS_I2C_FEATURE_TRACE           SUS_I2C_FEATURE_DEFAULT     // TRACE: transaction recorder.
+#endif
+#ifndef SUS_I2C_FEATURE_PRESENCE
+#define SUS_I2C_FEATURE_PRESENCE        SUS_I2C_FEATURE_DEFAULT     // PRESENCE: background presence monitor.
+#endif
+#ifndef SUS_I2C_FEATURE_BUDGET
+#define SUS_I2C_FEATURE_BUDGET          SUS_I2C_FEATURE_DEFAULT     // BUDGET: bandwidth budgets and bus usage accounting.
+#endif
+#ifndef SUS_I2C_FEATURE_PRIORITY
+#define SUS_I2C_FEATURE_PRIORITY        SUS_I2C_FEATURE_DEFAULT     // PRIORITY: bus arbiter and chunked transfers.
+#endif
+#ifndef SUS_I2C_FEATURE_SCHEDULER
+#define SUS_I2C_FEATURE_SCHEDULER       SUS_I2C_FEATURE_DEFAULT     // SCHEDULE: periodic sampling scheduler. Needs PRIORITY.
+#endif
+#ifndef SUS_I2C_FEATURE_DUAL_PORT
+#define SUS_I2C_FEATURE_DUAL_PORT       SUS_I2C_FEATURE_DEFAULT     // DUAL PORT: acquisition engine on both ports. Needs SCHEDULER.
+#endif
+#ifndef SUS_I2C_FEATURE_SMBUS
+#define SUS_I2C_FEATURE_SMBUS           SUS_I2C_FEATURE_DEFAULT     // SMBUS: SMBus commands with PEC.
+#endif
+#ifndef SUS_I2C_FEATURE_REGISTER_MAP
+#define SUS_I2C_FEATURE_REGISTER_MAP    SUS_I2C_FEATURE_DEFAULT     // REGISTER MAP: declarative register maps.
+#endif
+#ifndef SUS_I2C_FEATURE_SPEED
+#define SUS_I2C_FEATURE_SPEED           SUS_I2C_FEATURE_DEFAULT     // SPEED: runtime bus speed change and calibration. Needs PRIORITY.
+#endif
+#ifndef SUS_I2C_FEATURE_ISR
+#define SUS_I2C_FEATURE_ISR             SUS_I2C_FEATURE_DEFAULT     // ISR: submitting requests from interrupts. Needs PRIORITY.
+#endif
+#ifndef SUS_I2C_FEATURE_SNAPSHOT
+#define SUS_I2C_FEATURE_SNAPSHOT        SUS_I2C_FEATURE_DEFAULT     // SNAPSHOT: synchronized multi-device snapshots. Needs PRIORITY.
+#endif
+#ifndef SUS_I2C_FEATURE_DISPLAY
+#define SUS_I2C_FEATURE_DISPLAY         SUS_I2C_FEATURE_DEFAULT     // DISPLAY: SSD1306/SH1106 framebuffer with dirty-region flushing. Needs PRIORITY.
+#endif
+#ifndef SUS_I2C_FEATURE_BOOT
+#define SUS_I2C_FEATURE_BOOT            SUS_I2C_FEATURE_DEFAULT     // BOOT: parallel device bring-up with dependencies.
+#endif
+#ifndef SUS_I2C_FEATURE_DECODE
+#define SUS_I2C_FEATURE_DECODE          SUS_I2C_FEATURE_DEFAULT     // DECODE: block decoding of raw sample frames.
+#endif
+#ifndef SUS_I2C_FEATURE_COMBINE
+#define SUS_I2C_FEATURE_COMBINE         SUS_I2C_FEATURE_DEFAULT     // COMBINE: write-combining buffers for command streams.
+#endif
+#ifndef SUS_I2C_FEATURE_PREFETCH
+#define SUS_I2C_FEATURE_PREFETCH        SUS_I2C_FEATURE_DEFAULT     // PREFETCH: adaptive read-ahead of register sequences.
+#endif
+#ifndef SUS_I2C_FEATURE_COROUTINE
+#define SUS_I2C_FEATURE_COROUTINE       SUS_I2C_FEATURE_DEFAULT     // COROUTINE: device state machines as coroutines, one executor task per port.
+#endif
+#ifndef SUS_I2C_FEATURE_WARMBOOT
+#define SUS_I2C_FEATURE_WARMBOOT        SUS_I2C_FEATURE_DEFAULT     // WARM BOOT: persisted bus topology, verification probe instead of full set-up.
+#endif
+#ifndef SUS_I2C_FEATURE_FRAMES
+#define SUS_I2C_FEATURE_FRAMES          SUS_I2C_FEATURE_DEFAULT     // FRAMES: pooled, reference-counted sample frames passed by pointer.
+#endif
+
+#if (SUS_I2C_FEATURE_SCHEDULER || SUS_I2C_FEATURE_SPEED || SUS_I2C_FEATURE_ISR || SUS_I2C_FEATURE_SNAPSHOT || SUS_I2C_FEATURE_DISPLAY) && !SUS_I2C_FEATURE_PRIORITY
+#error "SUS I2C: the scheduler, bus speed, ISR, snapshot and display features take the bus through the arbiter - they need SUS_I2C_FEATURE_PRIORITY 1."
+#endif
+#if SUS_I2C_FEATURE_DUAL_PORT && !SUS_I2C_FEATURE_SCHEDULER
+#error "SUS I2C: the dual port engine runs on the periodic scheduler - it needs SUS_I2C_FEATURE_SCHEDULER 1."
+#endif
+
+#ifndef SUS_I2C_HOT_PATH_IN_IRAM
+#define SUS_I2C_HOT_PATH_IN_IRAM        0
+#endif
+#if SUS_I2C_HOT_PATH_IN_IRAM
+#define SUS_I2C_IRAM                    IRAM_ATTR
+#else
+#define SUS_I2C_IRAM
+#endif
+
+#define SUS_I2C_ERR_BASE                0x12C00     // Error codes of this library. Far away from the ESP-IDF ranges - esp_err_to_name() just says "UNKNOWN ERROR" for them.
+#define SUS_I2C_ERR_OVER_BUDGET         (SUS_I2C_ERR_BASE + 1)      // The device used up its share of bus time and was not allowed to wait for more (BUDGET section).
+
 /*==========================================================================================================================
  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄ 
 ▐░░░░░░░░░░░▌▐░░▌      ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
- ▀▀▀▀█░█▀▀▀▀ ▐░▌░▌     ▐░▌ ▀▀▀▀█░█▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ 
-     ▐░▌     ▐░▌▐░▌    ▐░▌     ▐░▌          ▐░▌     
-     ▐░▌     ▐░▌ ▐░▌   ▐░▌     ▐░▌          ▐░▌     
-     ▐░▌     ▐░▌  ▐░▌  ▐░▌     ▐░▌          ▐░▌           DONT FORGET THE HEADER FILES!
-     ▐░▌     ▐░▌   ▐░▌ ▐░▌     ▐░▌          ▐░▌                 #include <stdio.h>
-     ▐░▌     ▐░▌    ▐░▌▐░▌     ▐░▌          ▐░▌                 #include "esp_log.h"
+ ▀▀▀▀█░█▀▀▀▀ ▐░▌░▌     ▐░▌ ▀▀▀▀█░█▀▀▀▀  ▀▀▀▀█░█▀▀▀▀       DONT FORGET THE HEADER FILES!
+     ▐░▌     ▐░▌▐░▌    ▐░▌     ▐░▌          ▐░▌                 #include <stdio.h>
+     ▐░▌     ▐░▌ ▐░▌   ▐░▌     ▐░▌          ▐░▌                 #include <stdlib.h>
+     ▐░▌     ▐░▌  ▐░▌  ▐░▌     ▐░▌          ▐░▌                 #include <string.h>
+     ▐░▌     ▐░▌   ▐░▌ ▐░▌     ▐░▌          ▐░▌                 #include "esp_log.h"
+     ▐░▌     ▐░▌    ▐░▌▐░▌     ▐░▌          ▐░▌                 #include "esp_timer.h"
  ▄▄▄▄█░█▄▄▄▄ ▐░▌     ▐░▐░▌ ▄▄▄▄█░█▄▄▄▄      ▐░▌                 #include "driver/i2c.h"
 ▐░░░░░░░░░░░▌▐░▌      ▐░░▌▐░░░░░░░░░░░▌     ▐░▌                 #include "freertos/task.h"
- ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀                                                     
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀                  #include "freertos/queue.h"
+                                                                #include "freertos/semphr.h"
 
 */
 
+static int SUS_I2C_PortSpeedHz[2] = {0, 0};   //Bus speed (Hz) each port was initialized with by SUS_I2C_Master_Init. 0 = port not initialized. Used to work out how long transactions take on the wire.
+
 /**SUS_I2C_Master_Init: Initializes I2C peripheral of ESP32 as a master. Run BEFORE any other I2C-related functions.
  * 1. Parameter "I2C_master_port" is just an integer number 1 or 0, corresponding to two ports of ESP32 (there are two of these with indexes of 0 and 1).
  * 2. Parameter "SCL_pin_number" is an integer number (0-40) of the ESP32 Pin that you want to use for the CLOCK (SCL) line of I2C. ESP32's I2C peripheral is not hardwired to any particular pins - you can assign any GPIO WHICH IS NOT MARKED AS "INPUT ONLY" for this in software.
  * 3. Parameter "SDA_pin_number" is an integer number (0-40) of the ESP32 Pin that you want to use for the DATA (SDA) line of I2C. ESP32's I2C peripheral is not hardwired to any particular pins - you can assign any GPIO WHICH IS NOT MARKED AS "INPUT ONLY" for this in software.
  * IMPORTANT: "Pin numbers" in this scope refer to the pin numbers of the ESP32 CHIP ITSELF, and NOT of whatever devKit board you may have. Account for that when consulting pinouts off the internet. Your devKit's pinout should have this information.
  * 4. Parameter "speed" is an integer number (0-400000) that represents the frequency (or "speed", duh) of I2C communication bus in Hz (or "clocks per second"). Common values are: 100000 (100kHz) and 400000(400kHz).
+ * NOTE: to change the speed later, use SUS_I2C_SetSpeed - no need to uninstall anything. SUS_I2C_CalibrateSpeed finds out how fast your bus can go.
  * EXAMPLE USE: SUS_I2C_Master_Init(0,18,19,100000); Initialize ESP32's I2C at I2C port 0, pin 18 as clock, pin 19 as data pin, 100kHz speed.
 */
 esp_err_t SUS_I2C_Master_Init(uint8_t I2CportNumber, uint8_t SCL_pin_number, uint8_t SDA_pin_number, int speed)
@@ -135,6 +286,7 @@ esp_err_t SUS_I2C_Master_Init(uint8_t I2CportNumber, uint8_t SCL_pin_number, uin
         //Handle the success case
         else if (executionOutcome == ESP_OK) {
             ESP_LOGI(I2C_STATUS_TAG,"I2C driver installed successfully. Code %d",executionOutcome);
+            SUS_I2C_PortSpeedHz[I2CportNumber & 1] = speed;    //Remember the bus speed of this port.
             return executionOutcome; //On success, exit the function immediately.
         };
 
@@ -144,6 +296,23 @@ esp_err_t SUS_I2C_Master_Init(uint8_t I2CportNumber, uint8_t SCL_pin_number, uin
     }
 
 
+#define SUS_I2C_TRANSACTION_OVERHEAD_US     40      // Average driver setup/teardown time per transaction on ESP32 @ 240MHz (command link build + interrupt handling). Measure yours if it matters.
+
+/**SUS_I2C_BusTime_us: Estimates how long (in microseconds) a transaction occupies the bus at the speed the port was initialized with.
+ * Every byte on the wire (address bytes included) takes 9 clock pulses: 8 data bits + 1 ACK bit. Every START/REPEATED START and the STOP take roughly one more pulse each.
+ * On top of that the ESP-IDF driver needs some time to set up and finish each transaction - SUS_I2C_TRANSACTION_OVERHEAD_US accounts for that.
+ * PARAMETER "bytesOnWire" is the total amount of bytes in the transaction, INCLUDING address bytes. Example: reading 1 register = 4 bytes (address+W, register number, address+R, data).
+ * PARAMETER "startConditions" is the amount of START + REPEATED START conditions (1 for a plain write, 2 for a register read).
+ * RETURNS estimated bus time in microseconds. If the port was never initialized, 100kHz is assumed.
+ * EXAMPLE USE: uint32_t t = SUS_I2C_BusTime_us(0, 4, 2); //How long does a single register read take on port 0?
+*/
+uint32_t SUS_I2C_IRAM SUS_I2C_BusTime_us(uint8_t I2CportNumber, size_t bytesOnWire, size_t startConditions)
+{
+    uint32_t speed = SUS_I2C_PortSpeedHz[I2CportNumber & 1] > 0 ? (uint32_t)SUS_I2C_PortSpeedHz[I2CportNumber & 1] : 100000;
+    uint32_t clockPulses = (uint32_t)bytesOnWire * 9 + (uint32_t)startConditions + 1;     // +1 for the STOP.
+    return (uint32_t)(((uint64_t)clockPulses * 1000000 + speed - 1) / speed) + SUS_I2C_TRANSACTION_OVERHEAD_US;   // Rounded up - better to overestimate.
+}
+
 /*==========================================================================================================================
  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄ 
 ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌      ▐░▌
@@ -175,12 +344,14 @@ void SUS_I2C_ScanForDevices(int I2CportNumber)
         outcome = i2c_master_write_to_device(I2CportNumber,i,write_buf,sizeof(write_buf),10/portTICK_PERIOD_MS);
         if (outcome==ESP_OK) 
             {
-                ESP_LOGI(I2C_SCAN_TAG,"Device found at address %d (%#04x).",i,i);
+                ESP_LOGI(I2C_SCAN_TAG,"Device found at address %d (%#04x).",(int)i,(int)i);
             }
+#if !SUS_I2C_PROFILE_MINIMAL
         else if (outcome!=ESP_OK) 
             {
-                printf("No device found at address %d (%#04x).\n\r",i,i);
+                printf("No device found at address %d (%#04x).\n\r",(int)i,(int)i);
             };
+#endif
     } //End of for loop  
 
 }
@@ -188,6 +359,7 @@ void SUS_I2C_ScanForDevices(int I2CportNumber)
 /**Checks whether there is a device at a given I2C address by performing an I2C write of 0 (zero) to the register 0x0 of the device at that address.
  * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
  * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * NOTE: this WRITES into the device and prints a lot - for regular "is it still there?" checks use the presence monitor (SUS_I2C_PresenceStart) instead.
  * EXAMPLE USE: SUS_I2C_PingAddress(0,0x4A); Pings device (MAX44009) at I2C port 0 and address 0x4A.
 */
 void SUS_I2C_PingAddress(int I2CportNumber, uint8_t I2CdeviceAddress)
@@ -196,7 +368,9 @@ void SUS_I2C_PingAddress(int I2CportNumber, uint8_t I2CdeviceAddress)
     char *I2C_PING_TAG = "I2C PING";       //Tag for debug messages
     uint8_t write_buf[2] = {0x00, 0};                   //Initialize array of 2 values to be written to the I2C device. First value is a register address. Second value will be written to that register.
     
+#if !SUS_I2C_PROFILE_MINIMAL
     printf("Pinging the device at the address %d...\n\r",I2CdeviceAddress);
+#endif
     outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,write_buf,sizeof(write_buf),10/portTICK_PERIOD_MS);
         if (outcome==ESP_OK) 
             {
@@ -208,468 +382,6272 @@ void SUS_I2C_PingAddress(int I2CportNumber, uint8_t I2CdeviceAddress)
                 //printf("write failed. Error code %d.\n\r", outcome);
                 ESP_LOGI(I2C_PING_TAG,"Failed to write to address %#04x. Code %d(%#04x). Device is either not connected properly or not responding.\n\r Check the I2C address value, physical contacts and/or pullup resistor values.\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! \n\r",I2CdeviceAddress, outcome,outcome);
             };
+#if !SUS_I2C_PROFILE_MINIMAL
     printf("Pinging finished.\n\r");
+#endif
 }
 
 
-/*
- ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄  
-▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ 
-▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌
-▐░▌       ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌
-▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌
-▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌
-▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌
-▐░▌     ▐░▌  ▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌
-▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌
-▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░▌ 
- ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀  
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀
+     ▐░▌     ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌
+     ▐░▌     ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌          ▐░█▄▄▄▄▄▄▄▄▄
+     ▐░▌     ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌
+     ▐░▌     ▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌          ▐░█▀▀▀▀▀▀▀▀▀
+     ▐░▌     ▐░▌     ▐░▌  ▐░▌       ▐░▌▐░▌          ▐░▌
+     ▐░▌     ▐░▌      ▐░▌ ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄
+     ▐░▌     ▐░▌       ▐░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+      ▀       ▀         ▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
 */
 
-/**SUS_I2C_ReadRegister: Reads the slave's register by WRITING that register's 8-bit address to the I2C bus followed by a REPEATED START condition and then a READ request. Uses ESP-IDF's "I2C link queue" API method. Simplifies register operation of I2C slave devices that support this method.
- * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t)  from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * PARAMETER "registerAddress" is an integer number (uint8_t) containing 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
- * RETURNS uint8_t value read from the slave device's register.
- * EXAMPLE USE: uint8_t data = SUS_I2C_ReadRegister(0,0x4A,0x01); //Reads data value from device 0x04's register 0x01.
-*/
-uint8_t SUS_I2C_ReadRegister(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress)
+/* TRACE RECORDER: a "black box" for the I2C bus.
+ * Every transaction issued through the read/write functions of this library is written into a fixed-size ring in RAM:
+ * when it started, which port and device, which direction, the first few payload bytes, the result code and how long it took.
+ * When the ring is full, the oldest records get overwritten, so you always have the most recent history of the bus.
+ * The ring can be dumped as a compact binary blob (or printed as hex lines over the console) and replayed on a PC with tools/SUS_I2C_TraceReplay.c.
+ * Recording is OFF until you call SUS_I2C_TraceStart(). When it is off, the cost is one "if" per transaction.
+ * Transactions a bandwidth budget refused (SUS_I2C_ERR_OVER_BUDGET) never reached the bus and are not recorded.
+ */
+#define SUS_I2C_TRACE_RING_SIZE         256     // How many transactions the ring remembers. Each one takes 36 bytes of RAM (9 KB total by default).
+#define SUS_I2C_TRACE_PAYLOAD_SIZE      12      // How many payload bytes are kept per transaction. Longer transfers are cut short, but their full length is still recorded.
+
+#define SUS_I2C_TRACE_WRITE             0       // Direction: master wrote to the slave.
+#define SUS_I2C_TRACE_READ              1       // Direction: master read from the slave.
+#define SUS_I2C_TRACE_WRITE_READ        2       // Direction: master wrote (e.g. register address), then read after a REPEATED START.
+#define SUS_I2C_TRACE_NO_ADDRESS        0xFF    // "Address" used for RAW bus writes that do not address any particular device.
+
+/* One transaction as stored in the ring and in the binary dump. Packed, little-endian, 36 bytes. The layout is the file format - don't reorder! */
+struct __attribute__((packed)) SUS_I2C_TraceRecord
 {
-    char *I2C_READ_TAG = "I2C READ"; //Tag (essentially a text label) for debug messages.
-    uint8_t read_value =0xf1;       // This variable will store the value read from the slave device's register.
-    //uint8_t ACK_VAL = 0;            // ACKnowledge 
-    uint8_t NACK_VAL = 1;           // NOT ACKnowledge 
-    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus
-    uint8_t READ_MODE = 1;          // Read mode - HIGH bus
-    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    int64_t  timestamp_us;                          // esp_timer_get_time() when the transaction started (microseconds since boot).
+    uint32_t duration_us;                           // How long the transaction took, including driver overhead.
+    int32_t  result;                                // esp_err_t outcome code. 0 = OK, -1 = NACK/fail, 0x107 = timeout.
+    uint8_t  port;                                  // I2C port (0 or 1).
+    uint8_t  address;                               // 7-bit device address.
+    uint8_t  direction;                             // SUS_I2C_TRACE_WRITE / _READ / _WRITE_READ.
+    uint8_t  payloadStored;                         // How many bytes of "payload" below are valid.
+    uint16_t writeLength;                           // Total amount of bytes written (after the address byte).
+    uint16_t readLength;                            // Total amount of bytes read.
+    uint8_t  payload[SUS_I2C_TRACE_PAYLOAD_SIZE];   // Written bytes first, read bytes after them.
+};
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();			            // Creates the I2C command sequence list. This list will contain your I2C sequence. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
-        i2c_master_start(cmdSeq); 												    // START condition.
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true); 	    // Select I2C address and WRITE mode, check ACK from slave.
-        i2c_master_write_byte(cmdSeq,registerAddress,true); 						// Select the register address of the slave by writing register address value to the slave. Check ACK from slave.
-        i2c_master_start(cmdSeq); 	                                                // REPEATED START condition.
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|READ_MODE,true); 		// Select I2C address and READ mode, check ACK from slave.
-        i2c_master_read_byte(cmdSeq,&read_value,NACK_VAL); 						    // Read the register and write its value into the variable. Since this is the final byte we request from the slave, send Master NACK as per I2C protocol standard.
-        i2c_master_stop(cmdSeq);                                                    // STOP condition. IMPORTANT! Physically releases the I2C line so it is no longer pulled down. If you dont add this command, your I2C SCL bus may get locked up at LOW level!
-                                                       
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);   // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS. Yes, this command makes the GPIOs go beep-boop, high-low, 3v3-0v... you get the idea. This is the "execute I2C commands" line.
-        if (outcome==ESP_OK) 
-            {
-                ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
-            }
-        else if (outcome!=ESP_OK) 
-            {
-                //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
-                ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,outcome);
-                return 0;
-            };
+/* Header in front of the records in the binary dump. Packed, little-endian, 24 bytes. */
+struct __attribute__((packed)) SUS_I2C_TraceHeader
+{
+    char     magic[4];                              // Always "SUSt".
+    uint16_t version;                               // Format version, currently 1.
+    uint16_t recordSize;                            // sizeof(struct SUS_I2C_TraceRecord), so the reader can detect a mismatch.
+    uint32_t recordCount;                           // Amount of records following the header (oldest first).
+    uint32_t overwrittenCount;                      // How many older records were lost because the ring was full.
+    uint32_t busClockHz[2];                         // Bus speed of port 0 and port 1 at the time of the dump (0 = not initialized).
+};
 
-    i2c_cmd_link_delete(cmdSeq);            //Deletes the I2C command sequence to free the RAM.
- 
-    return read_value;                      //Return value received from the slave's register.
-}
+#if SUS_I2C_FEATURE_TRACE
+static struct SUS_I2C_TraceRecord SUS_I2C_TraceRing[SUS_I2C_TRACE_RING_SIZE]; // The ring itself.
+static uint32_t SUS_I2C_TraceTotal = 0;                                     // Amount of transactions recorded since the last clear. Next record goes to [Total % RING_SIZE].
+static bool SUS_I2C_TraceEnabled = false;                                   // Recording on/off switch.
+static portMUX_TYPE SUS_I2C_TraceLock = portMUX_INITIALIZER_UNLOCKED;       // Both CPU cores may record at the same time, so writing a record is a (very short) critical section.
 
-/**SUS_I2C_ReadRegister_EZ: Uses ESP-IDF's "Write-Read" wrapper function to read the register the "EASY WAY"(tm). However, underlying principle is the same as regular SUS_I2C_ReadRegister. Simplifies register operation of I2C slave devices that support this method.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
- * EXAMPLE USE: uint8_t data = SUS_I2C_ReadRegister_EZ(0,0x4A,0x01); //Reads data value from device 0x04's register 0x01.
+/**SUS_I2C_TraceStart: Starts recording every transaction into the trace ring. Records already in the ring are kept.
+ * EXAMPLE USE: SUS_I2C_TraceStart();
 */
-uint8_t SUS_I2C_ReadRegister_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t registerAddress)
+void SUS_I2C_TraceStart(void)
 {
-    char *I2C_READ_TAG = "I2C READ";    //Tag (essentially a text label) for debug messages.
-    esp_err_t outcome;                  // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    SUS_I2C_TraceEnabled = true;
+}
 
-    uint8_t read_value = 0xf1;          // This variable will store the value read from the slave device's register.    
+/**SUS_I2C_TraceStop: Stops recording. The ring keeps its contents, so you can dump it afterwards without new transactions sneaking in.
+ * EXAMPLE USE: SUS_I2C_TraceStop();
+*/
+void SUS_I2C_TraceStop(void)
+{
+    SUS_I2C_TraceEnabled = false;
+}
 
-    //ESP_LOGW(I2C_READ_TAG,"Attempting to read the value from register %#04x of the device %#04x",registerAddress,I2CdeviceAddressHex);
-    outcome = i2c_master_write_read_device(0,I2CdeviceAddress,&registerAddress,1,&read_value,1,5/portTICK_PERIOD_MS);
-        if (outcome==ESP_OK) 
-            {
-                ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
-            }
-        else if (outcome!=ESP_OK) 
-            {
-                //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
-                ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,outcome);
-                return 0;
-            };
-    return read_value;
+/**SUS_I2C_TraceClear: Throws away every record in the ring.
+ * EXAMPLE USE: SUS_I2C_TraceClear();
+*/
+void SUS_I2C_TraceClear(void)
+{
+    portENTER_CRITICAL(&SUS_I2C_TraceLock);
+    SUS_I2C_TraceTotal = 0;
+    portEXIT_CRITICAL(&SUS_I2C_TraceLock);
 }
 
-/**SUS_I2C_ReadByte: Reads the byte of data from a given I2C slave device followed by a full STOP condition. Uses ESP-IDF's "I2C link queue" API method.
- * NOTE: When interfacing with I2C sensors, this function generally is not very useful if you are trying to read from the sensor's register(s). 
- * Most sensors require a WRITE-read sequence of I2C operations WITHOUT a STOP inbetween to first SELECT the register of the sensor, and only then READ - not just a simple READ. Consult your sensor device's datasheet.
- * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t)  from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * RETURNS uint8_t value read from the slave device's register.
- * EXAMPLE USE: uint8_t data = SUS_I2C_ReadByte(0,0x4A);
+/**SUS_I2C_TraceRecord: Adds one transaction to the trace ring. The read/write functions of this library call it for you, 
+ * but you can also call it from your own I2C code so it shows up in the trace too.
+ * PARAMETER "writeData"/"writeLength" are the bytes written after the address byte (NULL/0 if none).
+ * PARAMETER "readData"/"readLength" are the bytes read (NULL/0 if none).
+ * PARAMETER "result" is the outcome code of the transaction.
+ * PARAMETER "startTime_us" is the value of esp_timer_get_time() right before the transaction was started. Duration is measured from it.
+ * EXAMPLE USE: int64_t start = esp_timer_get_time(); outcome = i2c_master_cmd_begin(...); SUS_I2C_TraceRecord(0,0x4A,SUS_I2C_TRACE_READ,NULL,0,&value,1,outcome,start);
 */
-uint8_t SUS_I2C_ReadByteFromSlave(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+void SUS_I2C_IRAM SUS_I2C_TraceRecord(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t direction, const uint8_t *writeData, size_t writeLength, const uint8_t *readData, size_t readLength, esp_err_t result, int64_t startTime_us)
 {
-    char *I2C_READ_TAG = "I2C READ"; //Tag (essentially a text label) for debug messages.
-    uint8_t read_value =0xf1;        // This variable will store the value read from the slave device's register. 0xf1 is just a random value to initiate the variable with.
-    //uint8_t ACK_VAL = 0;           // ACKnowledge 
-    uint8_t NACK_VAL = 1;            // NOT ACKnowledge 
-    //uint8_t WRITE_MODE = 0;        // Write mode - LOW bus
-    uint8_t READ_MODE = 1;           // Read mode - HIGH bus
-    esp_err_t outcome;               // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    if (!SUS_I2C_TraceEnabled || result == SUS_I2C_ERR_OVER_BUDGET) return;     //Recording is off, or the budget refused it and nothing went on the wire.
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();			            // Creates the I2C command sequence list. This list will contain your I2C sequence. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
-        i2c_master_start(cmdSeq); 	                                                // START condition.
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|READ_MODE,true); 		// Select I2C device and put it into the READ mode. Check ACK from slave.
-        i2c_master_read_byte(cmdSeq,&read_value,NACK_VAL); 						    // Read the register and write its value into the variable. Since this is the final byte we request from the slave, send Master NACK as per I2C protocol standard.
-        i2c_master_stop(cmdSeq);                                                    // STOP condition. IMPORTANT! Physically releases the I2C line so it is no longer pulled down. If you dont add this command, your I2C SCL bus may get locked up at LOW level!
-                                                       
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);   // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS.
-        if (outcome==ESP_OK) 
-            {
-                ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,read_value,outcome);
-            }
-        else if (outcome!=ESP_OK) 
-            {
-                //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
-                ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,outcome);
-                return 0;
-            };
+    int64_t now = esp_timer_get_time();
+    struct SUS_I2C_TraceRecord *record;
+    size_t stored = 0;
 
-    i2c_cmd_link_delete(cmdSeq);            //Deletes the I2C command sequence to free the RAM.
- 
-    return read_value;                      //Return value received from the slave's register.
+    portENTER_CRITICAL(&SUS_I2C_TraceLock);
+    record = &SUS_I2C_TraceRing[SUS_I2C_TraceTotal % SUS_I2C_TRACE_RING_SIZE];
+    SUS_I2C_TraceTotal++;
+    record->timestamp_us = startTime_us;
+    record->duration_us = (uint32_t)(now - startTime_us);
+    record->result = result;
+    record->port = I2CportNumber;
+    record->address = I2CdeviceAddress;
+    record->direction = direction;
+    record->writeLength = (uint16_t)writeLength;
+    record->readLength = (uint16_t)readLength;
+    for (size_t i = 0; i < writeLength && stored < SUS_I2C_TRACE_PAYLOAD_SIZE; i++) record->payload[stored++] = writeData[i];
+    for (size_t i = 0; i < readLength && stored < SUS_I2C_TRACE_PAYLOAD_SIZE; i++) record->payload[stored++] = readData[i];
+    record->payloadStored = (uint8_t)stored;
+    portEXIT_CRITICAL(&SUS_I2C_TraceLock);
 }
 
-/**SUS_I2C_ReadByte: Reads the byte of data from a given I2C slave device followed by a full STOP condition. Uses ESP-IDF's "Read" wrapper function to do so the "EASY WAY"(tm). However, underlying principle is the same as regular SUS_I2C_ReadByte. 
- * NOTE: When interfacing with I2C sensors, this function generally is not very useful if you are trying to read from the sensor's register(s). 
- * Most sensors require a WRITE-read sequence of I2C operations WITHOUT a STOP inbetween to first SELECT the register of the sensor, and only then READ - not just a simple READ. Consult your sensor device's datasheet.
- * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t)  from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * RETURNS uint8_t value read from the slave device's register.
- * EXAMPLE USE: uint8_t data = SUS_I2C_ReadByte(0,0x4A);
+/**SUS_I2C_TraceDumpSize: Returns how many bytes a full dump of the ring needs right now (header + all records). Use it to size the buffer for SUS_I2C_TraceDump.
+ * EXAMPLE USE: uint8_t *blob = malloc(SUS_I2C_TraceDumpSize());
 */
-void SUS_I2C_ReadByteFromSlave_EZ(int I2CportNumber,int I2CdeviceAddress)
+size_t SUS_I2C_TraceDumpSize(void)
 {
-    char *I2C_READ_TAG = "I2C READ";    //Tag (essentially a text label) for debug messages.
-    esp_err_t outcome;                  // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    uint32_t count = SUS_I2C_TraceTotal < SUS_I2C_TRACE_RING_SIZE ? SUS_I2C_TraceTotal : SUS_I2C_TRACE_RING_SIZE;
+    return sizeof(struct SUS_I2C_TraceHeader) + count * sizeof(struct SUS_I2C_TraceRecord);
+}
 
-    uint8_t read_value = 0xf1;          // This variable will store the value read from the slave device's register. 0xf1 is just a random value to initiate the variable with.
-    
-    outcome = i2c_master_read_from_device(I2CportNumber, I2CdeviceAddress, &read_value, 1, 10/portTICK_PERIOD_MS);
+/**SUS_I2C_TraceDump: Copies the ring into "buffer" as a binary blob: a SUS_I2C_TraceHeader followed by the records, oldest first.
+ * If the buffer is too small for everything, only the NEWEST records that fit are dumped.
+ * Save the blob to a file, send it over the network, whatever - then feed it to tools/SUS_I2C_TraceReplay on a PC.
+ * RETURNS the amount of bytes written into the buffer (0 if it can't even fit the header).
+ * EXAMPLE USE: size_t blobSize = SUS_I2C_TraceDump(blob, SUS_I2C_TraceDumpSize());
+*/
+size_t SUS_I2C_TraceDump(uint8_t *buffer, size_t bufferSize)
+{
+    struct SUS_I2C_TraceHeader header = { .magic = {'S','U','S','t'}, .version = 1, .recordSize = sizeof(struct SUS_I2C_TraceRecord) };
+    uint32_t available, count, first;
 
-        if (outcome==ESP_OK) 
-        {
-            ESP_LOGI(I2C_READ_TAG,"Read from the device  %#04x completed successfully, Code %d(%#04x).\n\r", I2CdeviceAddress, outcome,outcome);
-        }
-    else if (outcome!=ESP_OK) 
-        {
+    if (buffer == NULL || bufferSize < sizeof(header)) return 0;
 
-            ESP_LOGE(I2C_READ_TAG,"Failed to read from device  %#04x. Code %d(%#04x).",I2CdeviceAddress, outcome,outcome);
-        };
+    portENTER_CRITICAL(&SUS_I2C_TraceLock);
+    available = SUS_I2C_TraceTotal < SUS_I2C_TRACE_RING_SIZE ? SUS_I2C_TraceTotal : SUS_I2C_TRACE_RING_SIZE;
+    count = (bufferSize - sizeof(header)) / sizeof(struct SUS_I2C_TraceRecord);
+    if (count > available) count = available;
+    first = SUS_I2C_TraceTotal - count;                                 //Index of the oldest record we are going to dump.
+    for (uint32_t i = 0; i < count; i++)
+        memcpy(buffer + sizeof(header) + i * sizeof(struct SUS_I2C_TraceRecord), &SUS_I2C_TraceRing[(first + i) % SUS_I2C_TRACE_RING_SIZE], sizeof(struct SUS_I2C_TraceRecord));
+    header.recordCount = count;
+    header.overwrittenCount = SUS_I2C_TraceTotal - count;
+    portEXIT_CRITICAL(&SUS_I2C_TraceLock);
 
+    header.busClockHz[0] = SUS_I2C_PortSpeedHz[0];
+    header.busClockHz[1] = SUS_I2C_PortSpeedHz[1];
+    memcpy(buffer, &header, sizeof(header));
+    return sizeof(header) + count * sizeof(struct SUS_I2C_TraceRecord);
 }
 
-/*
- ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄ 
-▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
-▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ 
-▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌          
-▐░▌   ▄   ▐░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌          ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ 
-▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌     ▐░▌          ▐░▌     ▐░░░░░░░░░░░▌
-▐░▌ ▐░▌░▌ ▐░▌▐░█▀▀▀▀█░█▀▀      ▐░▌          ▐░▌     ▐░█▀▀▀▀▀▀▀▀▀ 
-▐░▌▐░▌ ▐░▌▐░▌▐░▌     ▐░▌       ▐░▌          ▐░▌     ▐░▌          
-▐░▌░▌   ▐░▐░▌▐░▌      ▐░▌  ▄▄▄▄█░█▄▄▄▄      ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ 
-▐░░▌     ▐░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌
- ▀▀       ▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀       ▀▀▀▀▀▀▀▀▀▀▀ 
+/**SUS_I2C_TracePrint: Prints the whole ring to the console as hex text lines starting with "SUSTRACE:". 
+ * Handy when the serial console is all you've got: copy the console log into a file and give it to tools/SUS_I2C_TraceReplay, it picks out the SUSTRACE lines by itself.
+ * Stop the recording first (SUS_I2C_TraceStop) if you don't want the print itself to race with new transactions.
+ * EXAMPLE USE: SUS_I2C_TraceStop(); SUS_I2C_TracePrint();
 */
+void SUS_I2C_TracePrint(void)
+{
+    uint8_t chunk[sizeof(struct SUS_I2C_TraceRecord)];
+    size_t blobSize = SUS_I2C_TraceDumpSize();
+    uint8_t *blob = malloc(blobSize);
 
-/**SUS_I2C_WriteToRegister: Writes to the slave's register by WRITING two 8-bit values to the I2C bus without STOP condition inbetween. Simplifies register operation of I2C devices that support this method.
- * NOTE: This is the function you should use to write to I2C sensor's registers.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
- * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
- * PARAMETER "recheckWrittenDataYN" is a boolean (true/false) that determines whether an additional check will be performed to verify the written value.
- * EXAMPLE USE: SUS_I2C_WriteToSlave_Register(0,0x4A,0x01,1); Writes the value 1 (0x01) to the register 0x01 of the device at I2C address 0x04A.
+    if (blob == NULL) {
+        ESP_LOGE("I2C TRACE","Not enough RAM to print the trace (%d bytes needed).",(int)blobSize);
+        return;
+    }
+    blobSize = SUS_I2C_TraceDump(blob, blobSize);
+    for (size_t offset = 0; offset < blobSize; offset += sizeof(chunk))  //One line per record-sized chunk keeps the lines short enough for any terminal.
+    {
+        size_t length = (blobSize - offset) < sizeof(chunk) ? (blobSize - offset) : sizeof(chunk);
+        printf("SUSTRACE:");
+        for (size_t i = 0; i < length; i++) printf("%02x", blob[offset + i]);
+        printf("\n");
+    }
+    free(blob);
+}
+#else
+static inline void SUS_I2C_TraceRecord(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t direction, const uint8_t *writeData, size_t writeLength,
+                                       const uint8_t *readData, size_t readLength, esp_err_t result, int64_t startTime_us) {}    //Trace recorder left out of this build: the hook is optimized away.
+#endif //SUS_I2C_FEATURE_TRACE
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌      ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░▌░▌     ▐░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌          ▐░▌▐░▌    ▐░▌▐░▌          ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌ ▐░▌   ▐░▌▐░▌          ▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌  ▐░▌  ▐░▌▐░▌          ▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░▌   ▐░▌ ▐░▌▐░▌          ▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌     ▐░▌  ▐░▌                    ▐░▌▐░▌          ▐░▌    ▐░▌▐░▌▐░▌          ▐░▌
+▐░▌          ▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░▌     ▐░▐░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄
+▐░▌          ▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌      ▐░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀            ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
 */
-void SUS_I2C_WriteToRegister(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+
+/* PRESENCE MONITOR: keeps a table of which devices are on each I2C port, and tells you when one gets plugged in or falls off.
+ * SUS_I2C_PingAddress is fine for a one-off check, but it blocks, prints, and WRITES 0 into register 0 of the device - not something to do every second.
+ * The monitor is much lazier:
+ *      - every normal read/write of this library already tells whether the device answered, so those results are noted for free.
+ *        A device you talk to regularly is never probed at all.
+ *      - only devices that have been quiet for "idleTime_us" get probed, and the probe is address-only (START, address, STOP - like i2cdetect).
+ *        No register is touched, no data is written.
+ *      - probes are spaced out so that they never take more than "busShare" of the bus time (e.g. 0.01 = at most 1% of the bus).
+ *      - optionally, the free addresses get probed one by one too (same budget), so new devices are found without knowing their address.
+ *      - a device counts as gone after "missesToDetach" NACKs in a row. A timeout doesn't count - that's the bus in trouble, not the device.
+ *        Careful: a device that NACKs a DATA byte (e.g. a write to a read-only register) counts as a miss too. The next probe brings it back.
+ *      - your "onChange" function is called on every attach/detach, from whatever task noticed it (the monitor task, or yours doing a read). Keep it short!
+ * Worst-case time to notice a change: idleTime_us + (number of quiet devices x probe spacing), probe spacing being roughly (probe time / busShare) rounded up to a FreeRTOS tick.
+ *
+ * Workflow:
+ *      1. SUS_I2C_Master_Init(...)
+ *      2. SUS_I2C_PresenceWatch() the addresses you expect (devices you talk to get added automatically).
+ *      3. SUS_I2C_PresenceStart(0, &config, 0, 5);
+ *      4. SUS_I2C_IsPresent() anywhere, or wait for onChange. SUS_I2C_PresencePrintTable() to see the whole table.
+ */
+#define SUS_I2C_PRESENCE_UNKNOWN        0       // Never heard from it.
+#define SUS_I2C_PRESENCE_PRESENT        1       // Answered last time.
+#define SUS_I2C_PRESENCE_ABSENT         2       // Stopped answering.
+
+struct SUS_I2C_PresenceConfig
 {
-    const char *I2C_WRITE_TAG = "I2C WRITE"; //Tag (essentially a text label) for debug messages.
-    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    float    busShare;                          // Maximum share of the bus time the probes may use. 0.01 = 1%. Must be >0 and <=1.
+    uint32_t idleTime_us;                       // Probe a device only after it has been quiet this long. 0 = 1 second.
+    uint8_t  missesToDetach;                    // NACKs in a row before a device counts as gone. 0 = 2.
+    bool     scanUnknownAddresses;              // true = also probe all other addresses (0x08-0x77), to find new devices.
+    void (*onChange)(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, bool present);     // Called on every attach (present=true) and detach. Can be NULL.
+};
 
-    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus
+struct SUS_I2C_PresenceEntry
+{
+    uint8_t  state;                             // SUS_I2C_PRESENCE_UNKNOWN / _PRESENT / _ABSENT.
+    bool     watched;                           // Whether the monitor keeps checking on it.
+    uint8_t  misses;                            // NACKs in a row.
+    int64_t  lastSeen_us;                       // Last time it answered (esp_timer_get_time() time base).
+    int64_t  lastChecked_us;                    // Last time anything (a transaction or a probe) tried to talk to it.
+    uint32_t attaches;                          // Times it appeared.
+    uint32_t detaches;                          // Times it disappeared.
+    uint32_t probes;                            // Probes spent on it.
+};
 
+struct SUS_I2C_PresenceMonitor
+{
+    struct SUS_I2C_PresenceEntry device[128];
+    struct SUS_I2C_PresenceConfig config;
+    volatile bool running;
+    volatile bool taskFinished;
+    TaskHandle_t task;
+    uint8_t scanCursor;                         // Next unknown address to probe (0 = 0x08).
+    int64_t start_us;
+    uint64_t probeTime_us;                      // Bus time spent on probes, for the measured bus share.
+};
+#if SUS_I2C_FEATURE_PRESENCE
+static struct SUS_I2C_PresenceMonitor SUS_I2C_PresencePort[2];
+static portMUX_TYPE SUS_I2C_PresenceLock = portMUX_INITIALIZER_UNLOCKED;   // Tasks on both cores may note results of the same port at once.
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
-        i2c_master_start(cmdSeq);                                          //START condition. "Hey everyone on I2C bus! I'M GOING TO TALK TO ONE OF YOU!!1"
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);  //Select the slave with the given address and put it in the "WRITE TO" mode.
-        i2c_master_write_byte(cmdSeq,registerAddress,true);                   //Select the register address of the device.
-        i2c_master_write_byte(cmdSeq,valueToWrite,true);                      //Write the value 1 to the register on the device
-        i2c_master_stop(cmdSeq);                                           //STOP condition. "I'm done talking. Dismissed!"
+/**SUS_I2C_PresenceNote: Tells the presence monitor how a transaction with a device went. Called by every read/write function of this library,
+ * so you only need it for transactions you do yourself with the ESP-IDF functions. Does nothing while the monitor of that port is stopped.
+ * EXAMPLE USE: int64_t start = esp_timer_get_time(); outcome = i2c_master_cmd_begin(...); SUS_I2C_PresenceNote(0,0x4A,outcome,start);
+*/
+void SUS_I2C_IRAM SUS_I2C_PresenceNote(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, esp_err_t outcome, int64_t time_us)
+{
+    struct SUS_I2C_PresenceMonitor *monitor = &SUS_I2C_PresencePort[I2CportNumber & 1];
+    struct SUS_I2C_PresenceEntry *entry = &monitor->device[I2CdeviceAddress & 0x7F];
+    int change = 0;         //+1 = attached, -1 = detached.
 
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);      //EXECUTE THE I2C COMMANDS!
-    if (outcome==ESP_OK)
-        {
-            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+    if (!monitor->running || I2CdeviceAddress > 0x7F) return;
+    if (outcome != ESP_OK && outcome != ESP_FAIL) return;      //ESP_FAIL is a NACK. Anything else (timeout, bad state) says nothing about the device.
+
+    portENTER_CRITICAL(&SUS_I2C_PresenceLock);
+    entry->lastChecked_us = time_us;
+    if (outcome == ESP_OK) {
+        entry->lastSeen_us = time_us;
+        entry->misses = 0;
+        entry->watched = true;
+        if (entry->state != SUS_I2C_PRESENCE_PRESENT) {
+            entry->state = SUS_I2C_PRESENCE_PRESENT;
+            entry->attaches++;
+            change = 1;
         }
-    else if (outcome!=ESP_OK) 
-        {
-            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
-        };
+    }
+    else if (entry->watched && entry->state != SUS_I2C_PRESENCE_ABSENT && ++entry->misses >= monitor->config.missesToDetach) {
+        if (entry->state == SUS_I2C_PRESENCE_PRESENT) {     //Watched but never seen goes to ABSENT quietly - it never attached, so it can't detach.
+            entry->detaches++;
+            change = -1;
+        }
+        entry->state = SUS_I2C_PRESENCE_ABSENT;
+    }
+    portEXIT_CRITICAL(&SUS_I2C_PresenceLock);
 
-    i2c_cmd_link_delete(cmdSeq);
+    if (change != 0 && monitor->config.onChange) monitor->config.onChange(I2CportNumber & 1, I2CdeviceAddress, change > 0);
 }
 
-/**SUS_I2C_WriteToRegister_EX: Writes to the slave's register by WRITING two 8-bit values to the I2C bus without STOP condition inbetween. Performs an extra data integrity check by reading the written value from slave's memory address and comparing it to the original.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
- * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
- * EXAMPLE USE: SUS_I2C_WriteToSlave_Register(0,0x4A,0x01,1); Writes the value 1 (0x01) to the register 0x01 of the device at I2C address 0x04A.
-*/
-void SUS_I2C_WriteToRegister_EX(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+//Address-only probe: START, address + WRITE, STOP. The device only has to ACK its address - nothing gets written into it.
+static esp_err_t SUS_I2C_PresenceProbe(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
 {
-    const char *I2C_WRITE_TAG = "I2C WRITE"; //Tag (essentially a text label) for debug messages.
-    const char *I2C_WRITE_CHECK = "I2C WRITE CHECK"; //Tag (essentially a text label) for debug messages.
-    uint8_t read_value =0xf1;       // This variable will store the value read from the slave device's register. 0xf1 is just a random default value.
-    //uint8_t ACK_VAL = 0;            // ACKnowledge 
-    uint8_t NACK_VAL = 1;           // NOT ACKnowledge 
-    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus
-    uint8_t READ_MODE = 1;          // Read mode - HIGH bus
-    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    esp_err_t outcome;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (I2CdeviceAddress << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_stop(cmd);
+    outcome = i2c_master_cmd_begin(I2CportNumber, cmd, 10/portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return outcome;
+}
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
-        i2c_master_start(cmdSeq);                                              //START condition. "Hey everyone on I2C bus! I'M GOING TO TALK TO ONE OF YOU!!1"
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);       //Select the slave with the given address and put it in the "WRITE TO" mode.
-        i2c_master_write_byte(cmdSeq,registerAddress,true);                        //Select the register address of the device.
-        i2c_master_write_byte(cmdSeq,valueToWrite,true);                           //Write the value 1 to the register on the device
-        
-    //Write checking code - reads the newly written value to confirm it has been correctly received.
-    //Confirms the written data by reading the contents of the register we just wrote to.
-        i2c_master_start(cmdSeq);                                              //REPEATED START condition.
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);       //Broadcast the slave's I2C address on the bus, write mode.
-        i2c_master_write_byte(cmdSeq,registerAddress,true);                        //Select the register of the device.
-        i2c_master_start(cmdSeq);//REPEATED START condition.
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|READ_MODE,true);        //Select the device address and say "Imma read from you".
-        i2c_master_read_byte(cmdSeq,&read_value,NACK_VAL);                         //Read the value from the register into the variable. Since this is the final byte we request from the slave, send Master NACK as per I2C protocol standard.
+//Microseconds to FreeRTOS ticks, rounded UP (so the bus share is never exceeded) and at least 1 tick.
+static TickType_t SUS_I2C_PresenceTicks(int64_t time_us)
+{
+    int64_t tick_us = 1000 * portTICK_PERIOD_MS;
+    int64_t ticks = (time_us + tick_us - 1) / tick_us;
+    return (TickType_t)(ticks < 1 ? 1 : ticks);
+}
 
-        i2c_master_stop(cmdSeq);                                               //STOP condition. "I'm done talking. Dismissed!"
+//The monitor task: one per I2C port. Probes the device that has been quiet the longest, then stays off the bus long enough to respect the bus share.
+static void SUS_I2C_PresenceTask(void *parameter)
+{
+    uint8_t I2CportNumber = (uint8_t)(uintptr_t)parameter;
+    struct SUS_I2C_PresenceMonitor *monitor = &SUS_I2C_PresencePort[I2CportNumber];
+    int64_t idleTime = monitor->config.idleTime_us;
 
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);          //EXECUTE THE I2C COMMANDS!
-    if (outcome==ESP_OK) //Outcome is OK ;)
-        {
-            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
-            if (read_value == valueToWrite)
-            {
-                ESP_LOGW(I2C_WRITE_CHECK," Value %#04x of the register %#04x matches the input value %#04x. Write success confirmed.",read_value, registerAddress,valueToWrite);
+    while (monitor->running)
+    {
+        int64_t now = esp_timer_get_time();
+        int64_t oldest = INT64_MAX;
+        int candidate = -1;
 
-            }
-            else if (read_value != valueToWrite)
-            {
-                ESP_LOGE(I2C_WRITE_CHECK," Data mismatch: register %#04x contains %#04x, input value was: %#04x. Something went wrong during the data transfer.",registerAddress,read_value, valueToWrite);
+        for (int address = 0x08; address <= 0x77; address++)      //0x00-0x07 and 0x78-0x7F are reserved addresses.
+        {
+            struct SUS_I2C_PresenceEntry *entry = &monitor->device[address];
+            if (entry->watched && now - entry->lastChecked_us >= idleTime && entry->lastChecked_us < oldest) {
+                oldest = entry->lastChecked_us;
+                candidate = address;
             }
         }
-    else if (outcome!=ESP_OK) //Outcome is NOT OK :(
+        for (int tries = 0; candidate < 0 && monitor->config.scanUnknownAddresses && tries < 0x70; tries++)    //Nothing due? Look for newcomers.
         {
-            //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
-            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
-        };
+            int address = 0x08 + monitor->scanCursor;
+            monitor->scanCursor = (monitor->scanCursor + 1) % 0x70;
+            if (!monitor->device[address].watched && now - monitor->device[address].lastChecked_us >= idleTime) candidate = address;
+        }
+        if (candidate < 0) {
+            ulTaskNotifyTake(pdTRUE, SUS_I2C_PresenceTicks(idleTime / 4));     //Nothing to do for a while.
+            continue;
+        }
 
-    i2c_cmd_link_delete(cmdSeq);
+        int64_t start = esp_timer_get_time();
+        esp_err_t outcome = SUS_I2C_PresenceProbe(I2CportNumber, candidate);
+        int64_t busTime = esp_timer_get_time() - start;
+        if (busTime < SUS_I2C_BusTime_us(I2CportNumber, 1, 1)) busTime = SUS_I2C_BusTime_us(I2CportNumber, 1, 1);
+        monitor->probeTime_us += busTime;
+        monitor->device[candidate].probes++;
+        if (outcome == ESP_OK || outcome == ESP_FAIL) SUS_I2C_PresenceNote(I2CportNumber, candidate, outcome, start);
+        else monitor->device[candidate].lastChecked_us = start;     //Bus trouble: don't hammer this address, try again after idleTime.
 
+        //We used the bus for busTime. Stay away for busTime x (1 - share) / share, so that probes are at most "busShare" of the time.
+        ulTaskNotifyTake(pdTRUE, SUS_I2C_PresenceTicks((int64_t)(busTime * (1.0f - monitor->config.busShare) / monitor->config.busShare)));
+    }
+    monitor->taskFinished = true;
+    vTaskDelete(NULL);
 }
 
+/**SUS_I2C_PresenceWatch: Adds an address to the presence table of the given port, so it gets checked even before you ever talk to it.
+ * (Addresses you successfully read/write are added automatically.) Can be called any time.
+ * EXAMPLE USE: SUS_I2C_PresenceWatch(0, 0x4A);
+*/
+void SUS_I2C_PresenceWatch(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+{
+    SUS_I2C_PresencePort[I2CportNumber & 1].device[I2CdeviceAddress & 0x7F].watched = true;
+}
 
-/**SUS_I2C_WriteToRegister_EZ: Writes to the slave's register by WRITING two 8-bit values to the I2C bus without STOP condition inbetween.
- * Uses "write_to_device" wrapper function to write to the slave's register the "EASY WAY"(tm). However, underlying principle is the same as regular SUS_I2C_WriteToRegister.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
- * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
- * EXAMPLE USE: SUS_I2C_WriteToRegister_EZ(0,0x4A,0x01,1); Writes the value 1 (0x01) to the register 0x01 of the device at I2C address 0x04A.
+/**SUS_I2C_IsPresent: RETURNS true if the device answered the last time the monitor (or a transaction) checked. Does NOT touch the bus - it's just a table lookup.
+ * EXAMPLE USE: if (SUS_I2C_IsPresent(0, 0x4A)) lux = ...;
 */
-void SUS_I2C_WriteToRegister_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+bool SUS_I2C_IsPresent(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
 {
-    const char *I2C_WRITE_TAG = "I2C WRITE";
-    uint8_t write_buffer[2] = {registerAddress,valueToWrite};
-    esp_err_t outcome;
+    return SUS_I2C_PresencePort[I2CportNumber & 1].device[I2CdeviceAddress & 0x7F].state == SUS_I2C_PRESENCE_PRESENT;
+}
 
-    outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,write_buffer,2,10/portTICK_PERIOD_MS);
-    if (outcome==ESP_OK)
-        {
-            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
-        }
-    else if (outcome!=ESP_OK) 
-        {
-            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
-        };
+/**SUS_I2C_PresenceStart: Starts the presence monitor task of the given I2C port. The table (watched addresses, states) is kept from any previous run.
+ * PARAMETER "config" - see struct SUS_I2C_PresenceConfig. Copied, so it can be a local variable.
+ * PARAMETER "coreNumber" is the CPU core for the monitor task (0, 1 or tskNO_AFFINITY). "taskPriority" should be LOW - the monitor is never in a hurry.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG if busShare is not within (0, 1], ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM if the task could not be created.
+ * EXAMPLE USE: struct SUS_I2C_PresenceConfig config = {.busShare=0.01, .idleTime_us=500000, .scanUnknownAddresses=true, .onChange=myHotplugHandler};
+ *              SUS_I2C_PresenceStart(0, &config, 0, 2); //At most 1% of port 0's bus time, check quiet devices twice a second, look for new ones too.
+*/
+esp_err_t SUS_I2C_PresenceStart(uint8_t I2CportNumber, const struct SUS_I2C_PresenceConfig *config, int coreNumber, int taskPriority)
+{
+    const char *I2C_PRESENCE_TAG = "I2C PRESENCE";
+    struct SUS_I2C_PresenceMonitor *monitor = &SUS_I2C_PresencePort[I2CportNumber & 1];
 
+    if (config == NULL || !(config->busShare > 0.0f && config->busShare <= 1.0f)) return ESP_ERR_INVALID_ARG;
+    if (monitor->running) return ESP_ERR_INVALID_STATE;
+
+    monitor->config = *config;
+    if (monitor->config.idleTime_us == 0) monitor->config.idleTime_us = 1000000;
+    if (monitor->config.missesToDetach == 0) monitor->config.missesToDetach = 2;
+    monitor->start_us = esp_timer_get_time();
+    monitor->probeTime_us = 0;
+    monitor->running = true;
+    monitor->taskFinished = false;
+    if (xTaskCreatePinnedToCore(SUS_I2C_PresenceTask, "sus_i2c_presence", 3072, (void *)(uintptr_t)(I2CportNumber & 1), taskPriority, &monitor->task, coreNumber) != pdPASS) {
+        monitor->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(I2C_PRESENCE_TAG,"[I2C PORT %d] : presence monitor started, at most %.1f%% of the bus, quiet devices checked every %lu ms.",
+             I2CportNumber,100.0*monitor->config.busShare,(unsigned long)(monitor->config.idleTime_us/1000));
+    return ESP_OK;
 }
 
-/**SUS_I2C_WriteByte: Writes one 8-bit value to the device at a given I2C address and issues full STOP condition afterwards (i.e. releases the physical bus). Uses ESP-IDF's "I2C link queue" API method. 
- * NOTE: When interfacing with I2C sensors, this function generally will not be very useful if you are trying to write to the registers. 
- * Most sensors require a WRITE-WRITE sequence of I2C operations WITHOUT a STOP inbetween to first SELECT the register of the sensor, and only then WRITE - not just a simple WRITE. Consult your sensor device's datasheet.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "value" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
- * EXAMPLE USE: SUS_I2C_WriteByteToSlave(0,0x4A,0b00000001); Writes the value 0b00000001 (0x01 or 1) to the device at address 0x04A.
+/**SUS_I2C_PresenceStop: Stops the presence monitor of the given I2C port and waits until its task is gone. The table is kept.
+ * EXAMPLE USE: SUS_I2C_PresenceStop(0);
 */
-void SUS_I2C_WriteByteToSlave(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t valueToWrite)
+void SUS_I2C_PresenceStop(uint8_t I2CportNumber)
 {
-    char *I2C_WRITE_TAG = "I2C WRITE"; //Tag (essentially a text label) for debug messages.
-    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    struct SUS_I2C_PresenceMonitor *monitor = &SUS_I2C_PresencePort[I2CportNumber & 1];
+    if (!monitor->running) return;
+    monitor->running = false;
+    xTaskNotifyGive(monitor->task);
+    while (!monitor->taskFinished) vTaskDelay(1);
+}
 
-    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus, hence 0.
+/**SUS_I2C_PresencePrintTable: Prints every address the monitor knows about on the given port, and how much bus time the probes really took.
+ * EXAMPLE USE: SUS_I2C_PresencePrintTable(0);
+*/
+void SUS_I2C_PresencePrintTable(uint8_t I2CportNumber)
+{
+    const char *I2C_PRESENCE_TAG = "I2C PRESENCE";
+    const char *stateName[3] = {"unknown", "PRESENT", "ABSENT"};
+    struct SUS_I2C_PresenceMonitor *monitor = &SUS_I2C_PresencePort[I2CportNumber & 1];
+    int64_t now = esp_timer_get_time();
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();                   // Creates the I2C command sequence list. This list will contain your I2C commands. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
-        i2c_master_start(cmdSeq);                                              //START condition command.
-        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);   //Select the slave with the given address and put it in the "WRITE TO" mode.
-        i2c_master_write_byte(cmdSeq,valueToWrite,true);                       //Write a byte (8bits) to the slave device. 
-                                                                            //WARNING:  This will NOT write to the registers of I2C sensor "as is". 
-                                                                            //          At most it might select the register address of the slave for subsequent writing. 
-                                                                            //          If you need to access registers, use the  "WriteToRegister" function. Also, consult the I2C slave's DATASHEET.
-        i2c_master_stop(cmdSeq);                                               //          STOP condition command. 
+    for (int address = 0; address < 128; address++)
+    {
+        struct SUS_I2C_PresenceEntry *entry = &monitor->device[address];
+        char lastSeen[32] = "never";     //Fits "%lld ms ago" for any int64_t.
+        if (!entry->watched) continue;
+        if (entry->lastSeen_us != 0) snprintf(lastSeen, sizeof(lastSeen), "%lld ms ago", (long long)((now - entry->lastSeen_us) / 1000));
+        ESP_LOGI(I2C_PRESENCE_TAG,"[I2C PORT %d], [Device %#04x] : %s, last seen %s, %lu attaches, %lu detaches, %lu probes.",
+                 I2CportNumber,address,stateName[entry->state],lastSeen,(unsigned long)entry->attaches,(unsigned long)entry->detaches,(unsigned long)entry->probes);
+    }
+    if (now > monitor->start_us)
+        ESP_LOGI(I2C_PRESENCE_TAG,"[I2C PORT %d] : probes used %.3f%% of the bus (limit %.1f%%).",I2CportNumber,100.0*monitor->probeTime_us/(now-monitor->start_us),100.0*monitor->config.busShare);
+}
+#else
+static inline void SUS_I2C_PresenceNote(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, esp_err_t outcome, int64_t time_us) {}    //Presence monitor left out of this build: the hook is optimized away.
+#endif //SUS_I2C_FEATURE_PRESENCE
 
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);      //EXECUTE THE ABOVE I2C COMMANDS!
-    if (outcome==ESP_OK)
-        {
-            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : [Value %#04x] write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
-        }
-    else if (outcome!=ESP_OK) 
-        {
-            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : [Value %#04x] write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
-        };
 
-    i2c_cmd_link_delete(cmdSeq);
+
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄   ▄         ▄  ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌               ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌ ▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄      ▐░▌
+▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌▐░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌ ▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀      ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌               ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄      ▐░▌
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌
+ ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀
+*/
+
+/* BANDWIDTH BUDGETS: stop one chatty driver from eating the whole bus.
+ * One badly written driver polling its sensor in a tight loop can take 90% of a 100kHz bus, and every other device on it starves.
+ * Priorities (PRIORITY section) don't help here - they decide who goes FIRST, not how MUCH everyone gets.
+ * A budget gives a device a share of the bus time and holds it to that share:
+ *      - every device you put on a budget ("client") gets a bucket of bus time, measured in microseconds of bus occupancy - not bytes, not transactions.
+ *        Before each transaction the library works out how long it will keep the bus busy (SUS_I2C_BusTime_us: bytes, STARTs, bus speed) and takes that out of the bucket.
+ *      - the buckets fill up steadily. All budgeted devices of a port split "share" of the bus time (SUS_I2C_BudgetSetShare), by weight:
+ *        share 0.6 with weights 1, 1 and 4 = 10%, 10% and 40% of the bus. Change a weight and the split follows right away.
+ *      - an empty bucket means: wait until it refilled (SUS_I2C_BUDGET_DEFER, the calling task sleeps), or fail with SUS_I2C_ERR_OVER_BUDGET (SUS_I2C_BUDGET_REJECT).
+ *        A full bucket always lets the next transaction through, even one longer than the bucket - the overdraft is paid back before the next one.
+ *      - devices WITHOUT a budget are not slowed down, but their bus time is counted too. SUS_I2C_BudgetPrintReport() lists every device by how much of the bus it used,
+ *        so finding the bus hog is the first step, not a guessing game.
+ * Budgets are caps, not reservations: bus time a device doesn't use is free for everyone else, it is not handed to the other budgeted devices.
+ * Scans, pings, the presence monitor's own probes, bus resets and speed calibration are not charged - they are the library's housekeeping, not a driver's traffic.
+ * IMPORTANT: a task that holds the bus (SUS_I2C_BusAcquire, PRIORITY section - the periodic scheduler and the ISR worker do) is never put to sleep by a budget, it would stall the whole port.
+ * Its over-budget transactions fail with SUS_I2C_ERR_OVER_BUDGET instead, whatever the policy. Chunked transfers wait for their budget BEFORE they take the bus, so they can defer.
+ * The hook: every read/write function of this library calls SUS_I2C_BudgetCharge right before its transaction (it may sleep there, or refuse), and sends the
+ * transaction only when the charge said ESP_OK. Then SUS_I2C_TraceRecord and SUS_I2C_PresenceNote (TRACE, PRESENCE sections) see the outcome.
+ * A refused transaction was never sent: it is not traced, says nothing about the device, and the caller gets SUS_I2C_ERR_OVER_BUDGET.
+ * Locks, in the only order they are ever taken: the bus (SUS_I2C_BusAcquire), a combiner's lock (WRITE COMBINING), a prefetcher's lock (PREFETCH), the ESP-IDF driver's own.
+ * The hooks take the combiner and prefetcher locks. A combiner sends its buffer with its lock held, hooks included - that is why it comes first. A prefetcher
+ * never calls SUS_I2C_BudgetCharge with its lock held: it sends the device's combined writes BEFORE it locks, and charges its own reads without the hooks.
+ */
+#define SUS_I2C_BUDGET_MAX_CLIENTS      16          // Devices with a budget, per port.
+#define SUS_I2C_BUDGET_DEFAULT_BURST_US 100000      // Bucket size when SUS_I2C_BudgetSetClient gets burst_us = 0: 100 ms worth of the device's share.
+#define SUS_I2C_BUDGET_DEFER            0           // Over budget: the calling task sleeps until the bucket refilled, then the transaction goes ahead.
+#define SUS_I2C_BUDGET_REJECT           1           // Over budget: the transaction is not sent, the call fails with SUS_I2C_ERR_OVER_BUDGET.
+
+struct SUS_I2C_BudgetClient
+{
+    uint8_t  I2CdeviceAddress;
+    uint8_t  policy;                            // SUS_I2C_BUDGET_DEFER or SUS_I2C_BUDGET_REJECT.
+    uint16_t weight;                            // Relative share: weight 2 gets twice the bus time of weight 1.
+    uint32_t burst_us;                          // Bucket size - the most bus time the device can use in one go after being quiet. 0 = SUS_I2C_BUDGET_DEFAULT_BURST_US worth.
+    float    tokens_us;                         // Bus time left in the bucket. Negative = overdraft.
+    int64_t  lastRefill_us;
+    uint32_t deferred;                          // Transactions that had to wait for their budget...
+    uint64_t totalDeferral_us;                  // ...and for how long in total.
+    uint32_t rejected;                          // Transactions refused with SUS_I2C_ERR_OVER_BUDGET.
+};
+
+struct SUS_I2C_BudgetPort
+{
+    portMUX_TYPE lock;
+    float    share;                             // Fraction of the bus time split among the clients. 0 = budgets off (usage is still counted).
+    uint32_t totalWeight;
+    uint8_t  clientCount;
+    uint8_t  clientSlot[128];                   // Per device address: index in client[] + 1. 0 = no budget.
+    struct SUS_I2C_BudgetClient client[SUS_I2C_BUDGET_MAX_CLIENTS];
+    uint64_t used_us[128];                      // Bus time used per device address since usageSince_us, budget or not.
+    uint32_t transactions[128];
+    int64_t  usageSince_us;
+    TaskHandle_t busOwner;                      // Task holding the bus through SUS_I2C_BusAcquire (PRIORITY section), NULL if none.
+};
+
+#if SUS_I2C_FEATURE_COMBINE
+void SUS_I2C_CombineOrder(uint8_t I2CportNumber, uint8_t I2CdeviceAddress);    //WRITE COMBINING section: sends the writes still waiting for the device first.
+#else
+static inline void SUS_I2C_CombineOrder(uint8_t I2CportNumber, uint8_t I2CdeviceAddress) {}    //Write combining left out of this build: the hook is optimized away.
+#endif
+#if SUS_I2C_FEATURE_PREFETCH
+bool SUS_I2C_PrefetchRead(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t *value, esp_err_t *outcome);    //PREFETCH section: answers single register reads read ahead of time.
+void SUS_I2C_PrefetchForget(uint8_t I2CportNumber, uint8_t I2CdeviceAddress);     //PREFETCH section: any other transaction makes what was read ahead stale.
+#else
+static inline bool SUS_I2C_PrefetchRead(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t *value, esp_err_t *outcome) { return false; }    //Prefetching left out of this build: every read goes to the bus.
+static inline void SUS_I2C_PrefetchForget(uint8_t I2CportNumber, uint8_t I2CdeviceAddress) {}    //Prefetching left out of this build: the hook is optimized away.
+#endif
+
+#if SUS_I2C_FEATURE_BUDGET
+static struct SUS_I2C_BudgetPort SUS_I2C_Budget[2] = {{.lock = portMUX_INITIALIZER_UNLOCKED}, {.lock = portMUX_INITIALIZER_UNLOCKED}};
+
+struct SUS_I2C_BudgetUsage
+{
+    uint64_t busTime_us;                        // Bus time the device used since the last SUS_I2C_BudgetResetUsage.
+    uint32_t transactions;
+    float    busShare;                          // busTime_us as a fraction of the time that passed. 0.25 = a quarter of the bus.
+    bool     budgeted;                          // Everything below is only filled in for devices with a budget.
+    float    allowedShare;                      // share * weight / total weight of the port.
+    float    tokens_us;                         // Bus time left in the bucket right now.
+    uint32_t deferred;
+    uint32_t averageDeferral_us;
+    uint32_t rejected;
+};
+
+/**SUS_I2C_BudgetSetShare: Sets how much of the bus time of the given I2C port is split among the devices with a budget. Turns the budgets on (share > 0) or off (0).
+ * Devices without a budget are never slowed down, so leave room for them: 1.0 would hand the whole bus to the budgeted devices.
+ * PARAMETER "share" is a fraction from 0.0 to 1.0.
+ * RETURNS ESP_OK, or ESP_ERR_INVALID_ARG if the share is out of range.
+ * EXAMPLE USE: SUS_I2C_BudgetSetShare(0, 0.6);    //60% of port 0's bus time goes to the budgeted devices, split by their weights.
+*/
+esp_err_t SUS_I2C_BudgetSetShare(uint8_t I2CportNumber, float share)
+{
+    struct SUS_I2C_BudgetPort *budget = &SUS_I2C_Budget[I2CportNumber & 1];
+    if (!(share >= 0.0f && share <= 1.0f)) return ESP_ERR_INVALID_ARG;
+    portENTER_CRITICAL(&budget->lock);
+    budget->share = share;
+    portEXIT_CRITICAL(&budget->lock);
+    return ESP_OK;
 }
 
-/**SUS_I2C_WriteByte_EZ: Writes one 8-bit value to the device at a given I2C address and issues full STOP condition afterwards (i.e. releases the physical bus). Uses ESP-IDF's "write_to_device" "EASY WAY"(tm) wrapper function.
- * NOTE: When interfacing with I2C sensors, this function generally will not be very useful if you are trying to write to the registers. 
- * Most sensors require a WRITE-WRITE sequence of I2C operations WITHOUT a STOP inbetween, and not just a simple WRITE. Consult your sensor device's datasheet.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "value" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
- * EXAMPLE USE: SUS_I2C_WriteByteToSlave_EZ(0,0x4A,0b00000001); Writes the value 0b00000001 (0x01 or 1) to the device at address 0x04A.
+/**SUS_I2C_BudgetSetClient: Puts a device on a budget, changes its budget, or (weight 0) takes it off its budget again.
+ * The device's bucket starts full. Every library read/write to this address on this port is charged from then on.
+ * PARAMETER "weight" is the device's relative share of the port's budget share. 0 = no budget.
+ * PARAMETER "burst_us" is the bucket size in microseconds of bus time. Bigger = the device can use a quiet moment for a longer burst. 0 = 100 ms worth of its share.
+ * PARAMETER "policy" is SUS_I2C_BUDGET_DEFER (wait) or SUS_I2C_BUDGET_REJECT (fail with SUS_I2C_ERR_OVER_BUDGET) for transactions over budget.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG on a bad address or policy, ESP_ERR_NO_MEM if SUS_I2C_BUDGET_MAX_CLIENTS devices already have a budget.
+ * EXAMPLE USE: SUS_I2C_BudgetSetClient(0, 0x68, 4, 0, SUS_I2C_BUDGET_DEFER);    //IMU: 4 parts of the budget, waits when over.
+ *              SUS_I2C_BudgetSetClient(0, 0x3C, 1, 0, SUS_I2C_BUDGET_REJECT);   //Display: 1 part, drops frames when over.
 */
-void SUS_I2C_WriteByteToSlave_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t valueToWrite)
+esp_err_t SUS_I2C_BudgetSetClient(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint16_t weight, uint32_t burst_us, uint8_t policy)
 {
-    char *I2C_WRITE_TAG = "I2C WRITE";
-    esp_err_t outcome;
-    outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,&valueToWrite,1,5/portTICK_PERIOD_MS);
-            if (outcome==ESP_OK) 
-            {
-                ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x]: [Value %#04x] write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
+    struct SUS_I2C_BudgetPort *budget = &SUS_I2C_Budget[I2CportNumber & 1];
+    esp_err_t outcome = ESP_OK;
+
+    if (I2CdeviceAddress > 0x7F || policy > SUS_I2C_BUDGET_REJECT) return ESP_ERR_INVALID_ARG;
+    portENTER_CRITICAL(&budget->lock);
+    uint8_t slot = budget->clientSlot[I2CdeviceAddress];
+    if (slot > 0) budget->totalWeight -= budget->client[slot - 1].weight;
+    if (weight == 0) {
+        if (slot > 0) {         //Remove: move the last client into the freed spot.
+            budget->clientCount--;
+            budget->client[slot - 1] = budget->client[budget->clientCount];
+            budget->clientSlot[budget->client[slot - 1].I2CdeviceAddress] = slot;
+            budget->clientSlot[I2CdeviceAddress] = 0;
+        }
+    }
+    else {
+        if (slot == 0 && budget->clientCount < SUS_I2C_BUDGET_MAX_CLIENTS) {
+            slot = ++budget->clientCount;
+            memset(&budget->client[slot - 1], 0, sizeof(budget->client[0]));
+            budget->client[slot - 1].I2CdeviceAddress = I2CdeviceAddress;
+            budget->client[slot - 1].tokens_us = 1e30f;     //Starts full - clipped to the bucket size on the first charge.
+            budget->client[slot - 1].lastRefill_us = esp_timer_get_time();
+            budget->clientSlot[I2CdeviceAddress] = slot;
+        }
+        if (slot == 0) outcome = ESP_ERR_NO_MEM;
+        else {
+            budget->client[slot - 1].weight = weight;
+            budget->client[slot - 1].burst_us = burst_us;
+            budget->client[slot - 1].policy = policy;
+            budget->totalWeight += weight;
+        }
+    }
+    portEXIT_CRITICAL(&budget->lock);
+    return outcome;
+}
+
+//SUS_I2C_BudgetCharge without the hooks: counts the transaction and waits for (or refuses on) the budget. For the prefetcher's own reads, see above.
+static esp_err_t SUS_I2C_IRAM SUS_I2C_BudgetTake(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, size_t bytesOnWire, size_t startConditions)
+{
+    struct SUS_I2C_BudgetPort *budget = &SUS_I2C_Budget[I2CportNumber & 1];
+    uint32_t cost = SUS_I2C_BusTime_us(I2CportNumber, bytesOnWire, startConditions);
+    uint8_t address = I2CdeviceAddress & 0x7F;
+    bool holdsBus = (budget->busOwner != NULL && budget->busOwner == xTaskGetCurrentTaskHandle());   //Only the owner itself can clear it, so no lock needed.
+    int64_t firstTry = 0;
+
+    while (true)
+    {
+        int64_t now = esp_timer_get_time();
+        int64_t wait_us = 0;            //0 = go, -1 = refused, >0 = sleep this long and check again.
+
+        portENTER_CRITICAL(&budget->lock);
+        uint8_t slot = budget->share > 0.0f ? budget->clientSlot[address] : 0;
+        if (slot > 0) {
+            struct SUS_I2C_BudgetClient *client = &budget->client[slot - 1];
+            float rate = budget->share * client->weight / budget->totalWeight;      //Microseconds of bus time earned per microsecond.
+            float burst = client->burst_us > 0 ? (float)client->burst_us : rate * SUS_I2C_BUDGET_DEFAULT_BURST_US;
+            client->tokens_us += rate * (float)(now - client->lastRefill_us);
+            client->lastRefill_us = now;
+            if (client->tokens_us > burst) client->tokens_us = burst;
+            if (client->tokens_us >= cost || client->tokens_us >= burst) {
+                client->tokens_us -= cost;
+                if (firstTry != 0) client->totalDeferral_us += now - firstTry;
             }
-        else if (outcome!=ESP_OK) 
-            {
-                ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : [Value %#04x] write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
-            };
+            else if (client->policy == SUS_I2C_BUDGET_REJECT || holdsBus) {
+                client->rejected++;
+                wait_us = -1;
+            }
+            else {
+                wait_us = (int64_t)(((cost < burst ? cost : burst) - client->tokens_us) / rate) + 1;
+                if (firstTry == 0) client->deferred++;
+            }
+        }
+        if (wait_us == 0) {
+            budget->used_us[address] += cost;
+            budget->transactions[address]++;
+        }
+        portEXIT_CRITICAL(&budget->lock);
 
+        if (wait_us == 0) return ESP_OK;
+        if (wait_us < 0) return SUS_I2C_ERR_OVER_BUDGET;
+        if (firstTry == 0) firstTry = now;
+        vTaskDelay(wait_us / 1000 / portTICK_PERIOD_MS + 1);   //Rounded up to the next tick - the bucket keeps filling meanwhile.
+    }
 }
 
-/**Writes multiple 8-bit values to the device at a given I2C address one after the other, without STOP conditions inbetween.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "I2CdeviceAddress" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
- * Parameter "arrayOfValuesToWrite" is the array of 8-bit values you want to write to the device. Yes, simple as uint8_t myArray[2];
- * Paramwtwe "amountOfValuesToWrite" is the amount of values from the array you want to write. Set to array size if you want to write the entire array.
- * EXAMPLE USE: uint8_t writeList[5] = {1,2,3,4,5};
- *              SUS_I2C_WriteByteArrayToSlave_EZ(0,0x4A,writeList,2); //Writes first two values from the writeList array to the device with address 0x4A.
+/**SUS_I2C_BudgetCharge: Called by the library before every read/write: counts the transaction's bus time for the device and, if it has a budget, takes it out of its bucket.
+ * It also sends the device's combined writes that are still waiting (WRITE COMBINING section), so the transaction can't overtake them.
+ * You only need it yourself for transactions you build with the ESP-IDF driver directly, so that they count too.
+ * PARAMETER "bytesOnWire" and "startConditions" describe the transaction, same as for SUS_I2C_BusTime_us.
+ * RETURNS ESP_OK when the transaction may go ahead (after waiting for the budget, with SUS_I2C_BUDGET_DEFER), SUS_I2C_ERR_OVER_BUDGET when it must not be sent.
+ * EXAMPLE USE: if (SUS_I2C_BudgetCharge(0, 0x50, 3 + 64, 1) == ESP_OK) outcome = i2c_master_cmd_begin(0, cmdSeq, 20/portTICK_PERIOD_MS);
 */
-void SUS_I2C_WriteByteArrayToSlave_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t *arrayOfValuesToWrite, uint8_t amountOfValuesToWrite)
+esp_err_t SUS_I2C_IRAM SUS_I2C_BudgetCharge(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, size_t bytesOnWire, size_t startConditions)
 {
-    char *I2C_WRITE_TAG = "I2C WRITE";
-    esp_err_t outcome;
+    SUS_I2C_CombineOrder(I2CportNumber, I2CdeviceAddress);     //Write combining: waiting writes to this device go first.
+    SUS_I2C_PrefetchForget(I2CportNumber, I2CdeviceAddress);   //Prefetch: this transaction may change what was read ahead.
+    return SUS_I2C_BudgetTake(I2CportNumber, I2CdeviceAddress, bytesOnWire, startConditions);
+}
 
-    outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,arrayOfValuesToWrite,amountOfValuesToWrite,10/portTICK_PERIOD_MS);//i2c_master_write_to_device(I2CportNumber,I2CdeviceAddressHex,I2CwriteArray,sizeof(I2CwriteArray),10/portTICK_PERIOD_MS);
-            if (outcome==ESP_OK) 
-            {
-                printf("Successfully wrote: ");
-                for (size_t i = 0; i < amountOfValuesToWrite; i++)
-                {
-                    printf("%#04x ",arrayOfValuesToWrite[i]);
-                    
-                }
-                printf("to device at address %#04x. Code %d(%#04x).\n\r",I2CdeviceAddress, outcome,outcome);
-            }
-        else if (outcome!=ESP_OK) 
-            {
-                ESP_LOGI(I2C_WRITE_TAG,"Failed to write to device at address %#04x. Code %d(%#04x).\n",I2CdeviceAddress, outcome,outcome);
-            };
+/**SUS_I2C_BudgetGetUsage: Live bus time consumption of one device, budget or not. Use it to show per-driver load on a status page or to decide who gets throttled.
+ * RETURNS ESP_OK, or ESP_ERR_NOT_FOUND if the device had no transactions since the last SUS_I2C_BudgetResetUsage and has no budget.
+ * EXAMPLE USE: struct SUS_I2C_BudgetUsage usage;
+ *              if (SUS_I2C_BudgetGetUsage(0, 0x68, &usage) == ESP_OK) printf("IMU uses %.1f%% of the bus\n", 100 * usage.busShare);
+*/
+esp_err_t SUS_I2C_BudgetGetUsage(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, struct SUS_I2C_BudgetUsage *usage)
+{
+    struct SUS_I2C_BudgetPort *budget = &SUS_I2C_Budget[I2CportNumber & 1];
+    uint8_t address = I2CdeviceAddress & 0x7F;
+    int64_t elapsed = esp_timer_get_time() - budget->usageSince_us;
 
+    memset(usage, 0, sizeof(*usage));
+    portENTER_CRITICAL(&budget->lock);
+    uint8_t slot = budget->clientSlot[address];
+    usage->busTime_us = budget->used_us[address];
+    usage->transactions = budget->transactions[address];
+    if (slot > 0) {
+        struct SUS_I2C_BudgetClient *client = &budget->client[slot - 1];
+        usage->budgeted = true;
+        usage->allowedShare = budget->share * client->weight / budget->totalWeight;
+        usage->tokens_us = client->tokens_us;
+        usage->deferred = client->deferred;
+        usage->averageDeferral_us = client->deferred > 0 ? (uint32_t)(client->totalDeferral_us / client->deferred) : 0;
+        usage->rejected = client->rejected;
+    }
+    portEXIT_CRITICAL(&budget->lock);
+    if (elapsed > 0) usage->busShare = (float)usage->busTime_us / (float)elapsed;
+    return (usage->transactions > 0 || usage->budgeted) ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
+/**SUS_I2C_BudgetResetUsage: Starts counting bus time (and deferred/rejected transactions) of the given I2C port from zero. Budgets and buckets stay as they are.
+ * EXAMPLE USE: SUS_I2C_BudgetResetUsage(0);   //After start-up, so that the one-off initialization traffic doesn't count.
+*/
+void SUS_I2C_BudgetResetUsage(uint8_t I2CportNumber)
+{
+    struct SUS_I2C_BudgetPort *budget = &SUS_I2C_Budget[I2CportNumber & 1];
+    int64_t now = esp_timer_get_time();
 
-/**SUS_I2C_WriteByte: Directly control the I2C GPIO to send custom data pulses. Pushes one 8-bit value to the I2C bus followed by a full STOP.
- * WARNING: ADVANCED USERS ONLY. You will need to construct and supply your own 8-bit data packet! 
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
- * EXAMPLE USE: SUS_I2C_WriteByteToBus_RAW(0,0b00000001); //Pushes a value of 0x01 onto the I2C bus.
+    portENTER_CRITICAL(&budget->lock);
+    memset(budget->used_us, 0, sizeof(budget->used_us));
+    memset(budget->transactions, 0, sizeof(budget->transactions));
+    for (int i = 0; i < budget->clientCount; i++) {
+        budget->client[i].deferred = 0;
+        budget->client[i].totalDeferral_us = 0;
+        budget->client[i].rejected = 0;
+    }
+    budget->usageSince_us = now;
+    portEXIT_CRITICAL(&budget->lock);
+}
+
+/**SUS_I2C_BudgetPrintReport: Lists every device of the given I2C port that used the bus, biggest consumer first: its share of the bus time and, for budgeted devices,
+ * the share it is allowed, how often it had to wait (and how long on average) and how often it was refused.
+ * EXAMPLE USE: SUS_I2C_BudgetPrintReport(0);
 */
-void SUS_I2C_WriteByteToBus_RAW(uint8_t I2CportNumber, uint8_t valueToWrite)
+void SUS_I2C_BudgetPrintReport(uint8_t I2CportNumber)
 {
-    char *I2C_WRITE_TAG = "I2C RAW WRITE"; //Tag (essentially a text label) for debug messages.
-    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    const char *I2C_BUDGET_TAG = "I2C BUDGET";
+    struct SUS_I2C_BudgetPort *budget = &SUS_I2C_Budget[I2CportNumber & 1];
+    uint8_t order[128];
+    int count = 0;
+    float total = 0.0f;
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();                   // Creates the I2C command sequence list. This list will contain your I2C commands. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
-        i2c_master_start(cmdSeq);                                           //START condition command.
-        i2c_master_write_byte(cmdSeq,valueToWrite,true);                    //Pushes the byte onto the I2C bus
-        i2c_master_stop(cmdSeq); 
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);      // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS.
-    if (outcome==ESP_OK)
-        {
-            ESP_LOGW(I2C_WRITE_TAG,"[I2C PORT %d] : [Value %#04x] RAW write OK. Code %d(%#04x).",I2CportNumber,valueToWrite,outcome,outcome);
+    for (int address = 0; address < 128; address++)
+    {
+        if (budget->transactions[address] == 0) continue;
+        int i = count++;
+        while (i > 0 && budget->used_us[order[i - 1]] < budget->used_us[address]) { order[i] = order[i - 1]; i--; }    //Insertion sort, biggest first.
+        order[i] = (uint8_t)address;
+    }
+    ESP_LOGI(I2C_BUDGET_TAG,"[I2C PORT %d] : %d devices used the bus, budgets %s (share %.0f%%, %d devices).",
+             I2CportNumber,count,budget->share > 0.0f ? "ON" : "OFF",100.0f * budget->share,budget->clientCount);
+    for (int i = 0; i < count; i++)
+    {
+        struct SUS_I2C_BudgetUsage usage;
+        SUS_I2C_BudgetGetUsage(I2CportNumber, order[i], &usage);
+        total += usage.busShare;
+        if (!usage.budgeted)
+            ESP_LOGI(I2C_BUDGET_TAG,"[I2C PORT %d], [Device %#04x] : %5.1f%% of the bus, %lu transactions. No budget.",
+                     I2CportNumber,order[i],100.0f * usage.busShare,(unsigned long)usage.transactions);
+        else
+            ESP_LOGI(I2C_BUDGET_TAG,"[I2C PORT %d], [Device %#04x] : %5.1f%% of the bus, %lu transactions. Budget %.1f%%: %lu deferred (avg %lu us), %lu rejected.",
+                     I2CportNumber,order[i],100.0f * usage.busShare,(unsigned long)usage.transactions,100.0f * usage.allowedShare,
+                     (unsigned long)usage.deferred,(unsigned long)usage.averageDeferral_us,(unsigned long)usage.rejected);
+    }
+    ESP_LOGI(I2C_BUDGET_TAG,"[I2C PORT %d] : %.1f%% of the bus time used in total.",I2CportNumber,100.0f * total);
+}
+#else
+static inline esp_err_t SUS_I2C_BudgetTake(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, size_t bytesOnWire, size_t startConditions) { return ESP_OK; }    //Budgets left out of this build: everything may go.
+static inline esp_err_t SUS_I2C_BudgetCharge(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, size_t bytesOnWire, size_t startConditions)
+{ SUS_I2C_CombineOrder(I2CportNumber, I2CdeviceAddress); SUS_I2C_PrefetchForget(I2CportNumber, I2CdeviceAddress); return ESP_OK; }    //Budgets left out of this build: everything may go (after the device's combined writes, dropping what was read ahead).
+#endif //SUS_I2C_FEATURE_BUDGET
+
+
+
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░▌       ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌     ▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌     ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌          ▐░▌     ▐░█▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░▌       ▐░▌▐░░░░░░░░░░░▌     ▐░▌          ▐░▌     ▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀█░█▀▀      ▐░▌     ▐░▌       ▐░▌▐░█▀▀▀▀█░█▀▀      ▐░▌          ▐░▌      ▀▀▀▀█░█▀▀▀▀
+▐░▌          ▐░▌     ▐░▌       ▐░▌     ▐░▌       ▐░▌▐░▌     ▐░▌       ▐░▌          ▐░▌          ▐░▌
+▐░▌          ▐░▌      ▐░▌  ▄▄▄▄█░█▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌      ▐░▌  ▄▄▄▄█░█▄▄▄▄      ▐░▌          ▐░▌
+▐░▌          ▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌     ▐░▌          ▐░▌
+ ▀            ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀            ▀
+*/
+
+/* TRANSFER PRIORITIES: stop a big, boring transfer from holding up the urgent ones.
+ * SUS_I2C_WriteByteArrayToSlave_EZ sends everything in ONE transaction. Pushing a 1 KB display frame at 100kHz keeps the bus busy for ~92 ms,
+ * and the 1kHz IMU read that wanted the bus 1 ms in has to sit and wait for all of it. Nothing can cut in - I2C has no way to pause a transaction.
+ * What CAN be done is to not make the transaction that long in the first place:
+ *      - SUS_I2C_TransferChunked() cuts a large read/write into small transactions ("chunks"), each one complete on its own:
+ *        every chunk starts with your prefix bytes (e.g. SSD1306 "data follows" control byte) and the memory address it belongs to (EEPROMs),
+ *        and never crosses an EEPROM page boundary (the EEPROM would wrap around inside the page and overwrite the start of it).
+ *      - between two chunks, the bus goes to whoever is waiting with the HIGHEST priority (SUS_I2C_PRIORITY_*). Same priority = first come, first served.
+ *        So the longest an urgent read waits is ONE chunk, not the whole transfer.
+ *      - the arbiter measures, per priority level, how long requests had to wait for the bus (worst + average) and how long each level held it.
+ *        SUS_I2C_BusPrintPriorityReport() shows it - that's your real worst-case blocking time, not a guess.
+ * Use SUS_I2C_BusAcquire()/SUS_I2C_BusRelease() around your own urgent transactions. The periodic scheduler (SCHEDULE section) does this for you at SUS_I2C_PRIORITY_HIGH.
+ * Transactions that do NOT go through the arbiter (plain library calls) still work - they queue up on the ESP-IDF driver's own lock and get their turn between chunks too,
+ * just without any priority order.
+ * Chunk size: smaller = shorter blocking of everyone else, but every chunk costs a START, the address byte(s) and the prefix again. 16-32 bytes is a good start.
+ * IMPORTANT: a waiting urgent request still has to wait for the CURRENT chunk to finish. If the task sending the chunks has a low FreeRTOS priority and gets preempted
+ * in the middle of its turn, the urgent task waits for that too - give the bulk transfer task a decent priority and let the arbiter sort out the order.
+ */
+#define SUS_I2C_PRIORITY_BULK           0       // Big, patient transfers: display frames, EEPROM images.
+#define SUS_I2C_PRIORITY_NORMAL         1       // Everyday reads and writes.
+#define SUS_I2C_PRIORITY_HIGH           2       // Time-critical sensor reads. Used by the periodic scheduler.
+#define SUS_I2C_PRIORITY_CRITICAL       3       // "Stop the motors NOW" kind of traffic.
+#define SUS_I2C_PRIORITY_LEVELS         4
+
+#define SUS_I2C_CHUNK_DEFAULT           32      // Chunk size used when SUS_I2C_ChunkedTransfer.chunkSize is 0.
+#define SUS_I2C_CHUNK_MAX_PREFIX        4       // Longest prefix that can be sent in front of every chunk.
+
+struct SUS_I2C_PriorityStats
+{
+    uint32_t acquisitions;                      // How many times this level got the bus.
+    uint32_t waited;                            // Of those: how many times the bus was busy and it had to wait.
+    uint64_t totalWait_us;                      // Sum of all waits, for the average.
+    uint32_t worstWait_us;                      // Longest wait for the bus = worst-case blocking time of this level.
+    uint32_t worstHold_us;                      // Longest time this level kept the bus = how long it can block the others.
+};
+
+struct SUS_I2C_BusArbiter
+{
+    portMUX_TYPE lock;
+    bool busy;                                  // Somebody owns the bus right now.
+    uint8_t ownerPriority;
+    int64_t ownerSince_us;
+    uint16_t waiting[SUS_I2C_PRIORITY_LEVELS];  // Tasks queued up per level.
+    SemaphoreHandle_t grant[SUS_I2C_PRIORITY_LEVELS];   // "Your turn" signal per level. Created the first time a level is used.
+    struct SUS_I2C_PriorityStats stats[SUS_I2C_PRIORITY_LEVELS];
+};
+#if SUS_I2C_FEATURE_PRIORITY
+static struct SUS_I2C_BusArbiter SUS_I2C_Arbiter[2] = {{.lock = portMUX_INITIALIZER_UNLOCKED}, {.lock = portMUX_INITIALIZER_UNLOCKED}};
+
+struct SUS_I2C_ChunkedTransfer
+{
+    uint8_t  I2CportNumber;
+    uint8_t  I2CdeviceAddress;
+    uint8_t  priority;                          // SUS_I2C_PRIORITY_*. Large transfers are usually SUS_I2C_PRIORITY_BULK.
+    bool     read;                              // false = write "data" to the device, true = read from the device into "data".
+    uint8_t  *data;                             // Bytes to write, or where to put the bytes read.
+    size_t   length;                            // Amount of bytes in "data".
+    uint16_t chunkSize;                         // Most data bytes per transaction. 0 = SUS_I2C_CHUNK_DEFAULT.
+    uint16_t pageSize;                          // No chunk crosses a multiple of this memory address (EEPROM page size: 32 for 24C32, 64 for 24C256...). 0 = no pages.
+    uint8_t  addressBytes;                      // Memory address sent in every chunk: 0 = none, 1 = 8-bit, 2 = 16-bit (most significant byte first).
+    uint32_t memoryAddress;                     // Memory address of data[0]. Goes up with every chunk.
+    const uint8_t *prefix;                      // Fixed bytes sent first in every chunk (e.g. 0x40 for SSD1306 display data). NULL if none.
+    uint8_t  prefixLength;                      // 0 - SUS_I2C_CHUNK_MAX_PREFIX.
+    uint32_t busyTimeout_us;                    // EEPROMs ignore their address for ~5 ms while they save a page. If a chunk is NACKed, keep retrying (bus released in between) for this long. 0 = don't retry.
+};
+
+/**SUS_I2C_BusAcquire: Waits until it is this task's turn to use the bus of the given I2C port. Higher priority goes first, equal priority in order of arrival.
+ * Does NOT interrupt a transaction that's already on the wire - it gets the bus the moment the current owner calls SUS_I2C_BusRelease.
+ * Call SUS_I2C_BusRelease as soon as your transaction is done! Don't nest: one task, one Acquire at a time per port.
+ * PARAMETER "priority" is one of SUS_I2C_PRIORITY_*.
+ * RETURNS ESP_OK when the bus is yours. ESP_ERR_NO_MEM if the arbiter could not create its semaphore - do your transaction anyway, but do NOT call SUS_I2C_BusRelease.
+ * EXAMPLE USE: SUS_I2C_BusAcquire(0, SUS_I2C_PRIORITY_CRITICAL);
+ *              SUS_I2C_WriteRegisters(0, 0x40, 0xFA, allOff, 4);     //Switch all PCA9685 outputs off, even if a display frame is being pushed on the same bus.
+ *              SUS_I2C_BusRelease(0);
+*/
+esp_err_t SUS_I2C_IRAM SUS_I2C_BusAcquire(uint8_t I2CportNumber, uint8_t priority)
+{
+    struct SUS_I2C_BusArbiter *arbiter = &SUS_I2C_Arbiter[I2CportNumber & 1];
+    int64_t requested = esp_timer_get_time();
+    uint32_t wait;
+    bool mustWait;
+
+    if (priority >= SUS_I2C_PRIORITY_LEVELS) priority = SUS_I2C_PRIORITY_LEVELS - 1;
+    if (arbiter->grant[priority] == NULL) {                 //First use of this level: make its semaphore. Can't allocate inside a critical section, so create first, then install.
+        SemaphoreHandle_t fresh = xSemaphoreCreateCounting(0xFFFF, 0);
+        portENTER_CRITICAL(&arbiter->lock);
+        if (arbiter->grant[priority] == NULL) {
+            arbiter->grant[priority] = fresh;
+            fresh = NULL;
         }
-    else if (outcome!=ESP_OK) 
-        {
-            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d]: [Value %#04x] RAW write FAILED. Code %d(%#04x).",I2CportNumber,valueToWrite,outcome,outcome);
-        };
+        portEXIT_CRITICAL(&arbiter->lock);
+        if (fresh != NULL) vSemaphoreDelete(fresh);         //Another task was faster - use theirs.
+        if (arbiter->grant[priority] == NULL) return ESP_ERR_NO_MEM;
+    }
 
-    i2c_cmd_link_delete(cmdSeq);
+    portENTER_CRITICAL(&arbiter->lock);
+    mustWait = arbiter->busy;
+    if (mustWait) arbiter->waiting[priority]++;
+    else arbiter->busy = true;
+    portEXIT_CRITICAL(&arbiter->lock);
+    if (mustWait) xSemaphoreTake(arbiter->grant[priority], portMAX_DELAY);     //SUS_I2C_BusRelease hands the bus straight over - "busy" never drops in between.
+
+    int64_t granted = esp_timer_get_time();
+    wait = (uint32_t)(granted - requested);
+    portENTER_CRITICAL(&arbiter->lock);
+    arbiter->ownerPriority = priority;
+    arbiter->ownerSince_us = granted;
+#if SUS_I2C_FEATURE_BUDGET
+    SUS_I2C_Budget[I2CportNumber & 1].busOwner = xTaskGetCurrentTaskHandle();     //Bandwidth budgets must not put the bus owner to sleep.
+#endif
+    arbiter->stats[priority].acquisitions++;
+    if (mustWait) arbiter->stats[priority].waited++;
+    arbiter->stats[priority].totalWait_us += wait;
+    if (wait > arbiter->stats[priority].worstWait_us) arbiter->stats[priority].worstWait_us = wait;
+    portEXIT_CRITICAL(&arbiter->lock);
+    return ESP_OK;
 }
 
-/* 
- ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄ 
-▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
-▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ 
-▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌               ▐░▌     
-▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     
-▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     
-▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀      ▐░▌     
-▐░▌     ▐░▌  ▐░▌                    ▐░▌▐░▌               ▐░▌     
-▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     
-▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     
- ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀                                                                                                                    
- */
+/**SUS_I2C_BusRelease: Gives the bus of the given I2C port back. If anyone is waiting, the one with the highest priority gets it right away.
+ * EXAMPLE USE: see SUS_I2C_BusAcquire.
+*/
+void SUS_I2C_IRAM SUS_I2C_BusRelease(uint8_t I2CportNumber)
+{
+    struct SUS_I2C_BusArbiter *arbiter = &SUS_I2C_Arbiter[I2CportNumber & 1];
+    uint32_t hold = (uint32_t)(esp_timer_get_time() - arbiter->ownerSince_us);
+    int next = -1;
 
-/**Force-resets the I2C bus back to HIGH SCL and HIGH SDA by issuing stop-start-stop conditions. 
- * Use when either or both of your I2C bus SCL/SDA lines got physically locked down at LOW level for whatever reason. How to check? Use the LED and a resistor.
- * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
- * EXAMPLE USE: SUS_I2C_ResetBus(0); Resets SCL and SDA lines of I2C at port 0.
+    portENTER_CRITICAL(&arbiter->lock);
+    if (hold > arbiter->stats[arbiter->ownerPriority].worstHold_us) arbiter->stats[arbiter->ownerPriority].worstHold_us = hold;
+#if SUS_I2C_FEATURE_BUDGET
+    SUS_I2C_Budget[I2CportNumber & 1].busOwner = NULL;
+#endif
+    for (int level = SUS_I2C_PRIORITY_LEVELS - 1; level >= 0 && next < 0; level--)
+        if (arbiter->waiting[level] > 0) {
+            arbiter->waiting[level]--;
+            next = level;
+        }
+    if (next < 0) arbiter->busy = false;
+    portEXIT_CRITICAL(&arbiter->lock);
+    if (next >= 0) xSemaphoreGive(arbiter->grant[next]);
+}
+
+/**SUS_I2C_TransferChunked: Reads or writes a large block in small transactions, letting higher-priority traffic onto the bus between them.
+ * Every chunk is a complete transaction: START, address, prefix, memory address (if any), data, STOP (reads: REPEATED START and read after the prefix/address).
+ * Chunk length = chunkSize, shortened so that no chunk crosses a page boundary.
+ * Does NOT print anything on success, errors are still printed. Stops at the first chunk that fails.
+ * PARAMETER "transfer" describes the transfer - see struct SUS_I2C_ChunkedTransfer. It can be a local variable, nothing keeps a pointer to it.
+ * RETURNS ESP_OK if every chunk went through, ESP_ERR_INVALID_ARG if the description makes no sense, otherwise the ESP-IDF error code of the failed chunk.
+ * EXAMPLE USE: struct SUS_I2C_ChunkedTransfer image = {.I2CportNumber=0, .I2CdeviceAddress=0x50, .priority=SUS_I2C_PRIORITY_BULK, .data=blob, .length=4096,
+ *                                                      .chunkSize=32, .pageSize=32, .addressBytes=2, .memoryAddress=0x0000, .busyTimeout_us=10000};
+ *              SUS_I2C_TransferChunked(&image); //Writes 4 KB into a 24C32 EEPROM page by page, without hogging the bus.
+ *              uint8_t control = 0x40;
+ *              struct SUS_I2C_ChunkedTransfer frame = {.I2CportNumber=0, .I2CdeviceAddress=0x3C, .priority=SUS_I2C_PRIORITY_BULK, .data=frameBuffer, .length=1024,
+ *                                                      .chunkSize=16, .prefix=&control, .prefixLength=1};
+ *              SUS_I2C_TransferChunked(&frame); //Pushes a 128x64 SSD1306 frame, 16 bytes (16 columns of 8 pixels) at a time.
 */
-void SUS_I2C_ResetBus(uint8_t I2CportNumber)
+esp_err_t SUS_I2C_TransferChunked(const struct SUS_I2C_ChunkedTransfer *transfer)
 {
-    const char *I2C_RESET_TAG = "I2C RESET"; //Tag (essentially a text label) for debug messages.
-    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+    const char *I2C_CHUNK_TAG = "I2C CHUNK";
+    uint8_t I2CportNumber = transfer->I2CportNumber;
+    uint8_t I2CdeviceAddress = transfer->I2CdeviceAddress;
+    size_t chunkSize = transfer->chunkSize > 0 ? transfer->chunkSize : SUS_I2C_CHUNK_DEFAULT;
+    size_t done = 0;
+    esp_err_t outcome = ESP_OK;
 
-    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();	    // Creates the I2C command sequence list. This list will contain your I2C sequence. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
-        
-        i2c_master_stop(cmdSeq);                            // STOP condition.
-        i2c_master_start(cmdSeq); 		                    // START condition.										
-        i2c_master_stop(cmdSeq);                            // STOP condition.
-                                                       
-    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);       // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS.
-    if (outcome==ESP_OK) 
+    if (transfer->data == NULL || transfer->prefixLength > SUS_I2C_CHUNK_MAX_PREFIX || transfer->addressBytes > 2 || (transfer->prefixLength > 0 && transfer->prefix == NULL))
+        return ESP_ERR_INVALID_ARG;
+    uint8_t prefixLength = transfer->prefixLength;          //Checked above: a local copy lets the compiler see header[] can't overflow.
+
+    while (done < transfer->length)
+    {
+        uint32_t memoryAddress = transfer->memoryAddress + (uint32_t)done;
+        size_t chunk = transfer->length - done;
+        uint8_t header[SUS_I2C_CHUNK_MAX_PREFIX + 2];
+        uint8_t tracePayload[SUS_I2C_TRACE_PAYLOAD_SIZE];   //Trace recorder: header + first data bytes, same as on the wire.
+        size_t headerLength = 0;
+        bool restart;                                       //Reads with a prefix/memory address: write it, REPEATED START, then read.
+        int64_t firstTry = esp_timer_get_time();
+
+        if (chunk > chunkSize) chunk = chunkSize;
+        if (transfer->pageSize > 0 && chunk > transfer->pageSize - memoryAddress % transfer->pageSize)
+            chunk = transfer->pageSize - memoryAddress % transfer->pageSize;   //Stop at the end of the page.
+
+        for (int i = 0; i < prefixLength; i++) header[headerLength++] = transfer->prefix[i];
+        if (transfer->addressBytes == 2) header[headerLength++] = (uint8_t)(memoryAddress >> 8);
+        if (transfer->addressBytes >= 1) header[headerLength++] = (uint8_t)memoryAddress;
+        restart = transfer->read && headerLength > 0;
+        memcpy(tracePayload, header, headerLength);
+        if (!transfer->read)
+            memcpy(&tracePayload[headerLength], &transfer->data[done], chunk < sizeof(tracePayload) - headerLength ? chunk : sizeof(tracePayload) - headerLength);
+
+        //Wire time of this chunk decides the driver timeout - a 255 byte chunk at 100kHz takes longer than the usual 10ms.
+        TickType_t timeout = 10/portTICK_PERIOD_MS + SUS_I2C_BusTime_us(I2CportNumber, 2 + headerLength + chunk, 2) / 1000 / portTICK_PERIOD_MS;
+
+        while (true)
         {
-            ESP_LOGI(I2C_RESET_TAG,"Successfully reset the I2C bus at port %d. Code %#04x.\n\r",I2CportNumber, outcome);
+            outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 1 + headerLength + chunk + (restart ? 1 : 0), restart ? 2 : 1);  //Bandwidth budget: wait for it BEFORE taking the bus.
+            if (outcome != ESP_OK) break;
+            bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, transfer->priority) == ESP_OK);
+            i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+                i2c_master_start(cmdSeq);
+                if (!transfer->read || headerLength > 0) {
+                    i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_WRITE,true);
+                    if (headerLength > 0) i2c_master_write(cmdSeq,header,headerLength,true);
+                }
+                if (!transfer->read) i2c_master_write(cmdSeq,&transfer->data[done],chunk,true);
+                else {
+                    if (headerLength > 0) i2c_master_start(cmdSeq);        //REPEATED START
+                    i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_READ,true);
+                    i2c_master_read(cmdSeq,&transfer->data[done],chunk,I2C_MASTER_LAST_NACK);
+                }
+                i2c_master_stop(cmdSeq);
+            int64_t startTime = esp_timer_get_time();
+            outcome = i2c_master_cmd_begin(I2CportNumber,cmdSeq,timeout);
+            i2c_cmd_link_delete(cmdSeq);
+            if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);    //Chunk done - whoever is waiting with the highest priority goes now.
+            if (transfer->read) SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, headerLength > 0 ? SUS_I2C_TRACE_WRITE_READ : SUS_I2C_TRACE_READ, header, headerLength, &transfer->data[done], chunk, outcome, startTime);
+            else SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, tracePayload, headerLength + chunk, NULL, 0, outcome, startTime);
+            SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+
+            if (outcome != ESP_FAIL || esp_timer_get_time() - firstTry >= (int64_t)transfer->busyTimeout_us) break;
+            vTaskDelay(1);      //NACK: the EEPROM is probably still saving the previous page. Try again next tick, bus free for others meanwhile.
         }
-    else if (outcome!=ESP_OK) 
-        {
-            //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
-            ESP_LOGE(I2C_RESET_TAG,"Force reset I2C port %d. Code %#04x.\n\r",I2CportNumber, outcome);
-        };
+        if (outcome != ESP_OK) {
+            ESP_LOGE(I2C_CHUNK_TAG,"[I2C PORT %d], [Device %#04x] : chunked %s FAILED at byte %d of %d (memory address 0x%04lx). Code %#04x.",
+                     I2CportNumber,I2CdeviceAddress,transfer->read ? "read" : "write",(int)done,(int)transfer->length,(unsigned long)memoryAddress,outcome);
+            return outcome;
+        }
+        done += chunk;
+    }
+    return ESP_OK;
+}
+
+/**SUS_I2C_BusPrintPriorityReport: Prints the waiting/holding statistics of every priority level of the given I2C port.
+ * "worst wait" is the worst-case blocking time that level actually experienced. With chunked transfers it should stay around one chunk of the levels below.
+ * EXAMPLE USE: SUS_I2C_BusPrintPriorityReport(0);
+*/
+void SUS_I2C_BusPrintPriorityReport(uint8_t I2CportNumber)
+{
+    const char *I2C_PRIORITY_TAG = "I2C PRIORITY";
+    const char *levelName[SUS_I2C_PRIORITY_LEVELS] = {"BULK", "NORMAL", "HIGH", "CRITICAL"};
+    struct SUS_I2C_PriorityStats stats[SUS_I2C_PRIORITY_LEVELS];
+    struct SUS_I2C_BusArbiter *arbiter = &SUS_I2C_Arbiter[I2CportNumber & 1];
+
+    portENTER_CRITICAL(&arbiter->lock);
+    memcpy(stats, arbiter->stats, sizeof(stats));
+    portEXIT_CRITICAL(&arbiter->lock);
+    for (int level = SUS_I2C_PRIORITY_LEVELS - 1; level >= 0; level--)
+    {
+        if (stats[level].acquisitions == 0) continue;
+        ESP_LOGI(I2C_PRIORITY_TAG,"[I2C PORT %d] %-8s : %lu grants (%lu waited), wait avg %lu us / worst %lu us, longest hold %lu us.",
+                 I2CportNumber,levelName[level],(unsigned long)stats[level].acquisitions,(unsigned long)stats[level].waited,
+                 (unsigned long)(stats[level].totalWait_us / stats[level].acquisitions),(unsigned long)stats[level].worstWait_us,(unsigned long)stats[level].worstHold_us);
+    }
+}
+
+/**SUS_I2C_BusClearPriorityStats: Zeroes the statistics of the given I2C port, e.g. after start-up so that one-off initialization traffic doesn't count.
+ * EXAMPLE USE: SUS_I2C_BusClearPriorityStats(0);
+*/
+void SUS_I2C_BusClearPriorityStats(uint8_t I2CportNumber)
+{
+    struct SUS_I2C_BusArbiter *arbiter = &SUS_I2C_Arbiter[I2CportNumber & 1];
+    portENTER_CRITICAL(&arbiter->lock);
+    memset(arbiter->stats, 0, sizeof(arbiter->stats));
+    portEXIT_CRITICAL(&arbiter->lock);
+}
+#endif //SUS_I2C_FEATURE_PRIORITY
+
+
+
+
+
+/*
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄  
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ 
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌
+▐░▌       ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌
+▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌
+▐░▌     ▐░▌  ▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌
+▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌
+▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░▌ 
+ ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀  
+*/
+
+/**SUS_I2C_ReadRegister: Reads the slave's register by WRITING that register's 8-bit address to the I2C bus followed by a REPEATED START condition and then a READ request. Uses ESP-IDF's "I2C link queue" API method. Simplifies register operation of I2C slave devices that support this method.
+ * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t)  from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * PARAMETER "registerAddress" is an integer number (uint8_t) containing 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
+ * RETURNS uint8_t value read from the slave device's register.
+ * EXAMPLE USE: uint8_t data = SUS_I2C_ReadRegister(0,0x4A,0x01); //Reads data value from device 0x04's register 0x01.
+ * NOTE: if the read FAILS, this returns 0 - which looks exactly like a register holding 0. Use SUS_I2C_ReadRegister_STATUS (STATUS section) when you need to know.
+*/
+uint8_t SUS_I2C_ReadRegister(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress)
+{
+    char *I2C_READ_TAG = "I2C READ"; //Tag (essentially a text label) for debug messages.
+    uint8_t read_value =0xf1;       // This variable will store the value read from the slave device's register.
+    //uint8_t ACK_VAL = 0;            // ACKnowledge 
+    uint8_t NACK_VAL = 1;           // NOT ACKnowledge 
+    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus
+    uint8_t READ_MODE = 1;          // Read mode - HIGH bus
+    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    if (SUS_I2C_PrefetchRead(I2CportNumber, I2CdeviceAddress, registerAddress, &read_value, &outcome))  //Prefetch: the value was read ahead (or read now, with the rest of its sequence) - PREFETCH section.
+        {
+            if (outcome==ESP_OK) ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x (prefetched). Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
+            return outcome==ESP_OK ? read_value : 0;
+        }
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();			            // Creates the I2C command sequence list. This list will contain your I2C sequence. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
+        i2c_master_start(cmdSeq); 												    // START condition.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true); 	    // Select I2C address and WRITE mode, check ACK from slave.
+        i2c_master_write_byte(cmdSeq,registerAddress,true); 						// Select the register address of the slave by writing register address value to the slave. Check ACK from slave.
+        i2c_master_start(cmdSeq); 	                                                // REPEATED START condition.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|READ_MODE,true); 		// Select I2C address and READ mode, check ACK from slave.
+        i2c_master_read_byte(cmdSeq,&read_value,NACK_VAL); 						    // Read the register and write its value into the variable. Since this is the final byte we request from the slave, send Master NACK as per I2C protocol standard.
+        i2c_master_stop(cmdSeq);                                                    // STOP condition. IMPORTANT! Physically releases the I2C line so it is no longer pulled down. If you dont add this command, your I2C SCL bus may get locked up at LOW level!
+                                                       
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 4, 2);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);   // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS. Yes, this command makes the GPIOs go beep-boop, high-low, 3v3-0v... you get the idea. This is the "execute I2C commands" line.
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, &registerAddress, 1, &read_value, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+        if (outcome==ESP_OK) 
+            {
+                ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
+            }
+        else if (outcome!=ESP_OK) 
+            {
+                //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
+                ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,outcome);
+                i2c_cmd_link_delete(cmdSeq);    //The failure path must free the command sequence too, or every failed read leaks one.
+                return 0;
+            };
+
+    i2c_cmd_link_delete(cmdSeq);            //Deletes the I2C command sequence to free the RAM.
+ 
+    return read_value;                      //Return value received from the slave's register.
+}
+
+/**SUS_I2C_ReadRegister_EZ: Uses ESP-IDF's "Write-Read" wrapper function to read the register the "EASY WAY"(tm). However, underlying principle is the same as regular SUS_I2C_ReadRegister. Simplifies register operation of I2C slave devices that support this method.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
+ * EXAMPLE USE: uint8_t data = SUS_I2C_ReadRegister_EZ(0,0x4A,0x01); //Reads data value from device 0x04's register 0x01.
+ * NOTE: if the read FAILS, this returns 0, same as SUS_I2C_ReadRegister. Use SUS_I2C_ReadRegister_STATUS (STATUS section) when you need to know.
+*/
+uint8_t SUS_I2C_ReadRegister_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t registerAddress)
+{
+    char *I2C_READ_TAG = "I2C READ";    //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;                  // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    uint8_t read_value = 0xf1;          // This variable will store the value read from the slave device's register.    
+
+    //ESP_LOGW(I2C_READ_TAG,"Attempting to read the value from register %#04x of the device %#04x",registerAddress,I2CdeviceAddressHex);
+    if (SUS_I2C_PrefetchRead(I2CportNumber, I2CdeviceAddress, registerAddress, &read_value, &outcome))  //Prefetch: the value was read ahead (or read now, with the rest of its sequence) - PREFETCH section.
+        {
+            if (outcome==ESP_OK) ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x (prefetched). Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
+            return outcome==ESP_OK ? read_value : 0;
+        }
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 4, 2);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_read_device(I2CportNumber,I2CdeviceAddress,&registerAddress,1,&read_value,1,5/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, &registerAddress, 1, &read_value, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+        if (outcome==ESP_OK) 
+            {
+                ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,read_value,outcome);
+            }
+        else if (outcome!=ESP_OK) 
+            {
+                //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
+                ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,outcome);
+                return 0;
+            };
+    return read_value;
+}
+
+/**SUS_I2C_ReadByte: Reads the byte of data from a given I2C slave device followed by a full STOP condition. Uses ESP-IDF's "I2C link queue" API method.
+ * NOTE: When interfacing with I2C sensors, this function generally is not very useful if you are trying to read from the sensor's register(s). 
+ * Most sensors require a WRITE-read sequence of I2C operations WITHOUT a STOP inbetween to first SELECT the register of the sensor, and only then READ - not just a simple READ. Consult your sensor device's datasheet.
+ * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t)  from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * RETURNS uint8_t value read from the slave device's register.
+ * EXAMPLE USE: uint8_t data = SUS_I2C_ReadByte(0,0x4A);
+ * NOTE: a failed read can't be told apart from a real value here. Use SUS_I2C_ReadByteFromSlave_STATUS (STATUS section) when you need to know.
+*/
+uint8_t SUS_I2C_ReadByteFromSlave(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+{
+    char *I2C_READ_TAG = "I2C READ"; //Tag (essentially a text label) for debug messages.
+    uint8_t read_value =0xf1;        // This variable will store the value read from the slave device's register. 0xf1 is just a random value to initiate the variable with.
+    //uint8_t ACK_VAL = 0;           // ACKnowledge 
+    uint8_t NACK_VAL = 1;            // NOT ACKnowledge 
+    //uint8_t WRITE_MODE = 0;        // Write mode - LOW bus
+    uint8_t READ_MODE = 1;           // Read mode - HIGH bus
+    esp_err_t outcome;               // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();			            // Creates the I2C command sequence list. This list will contain your I2C sequence. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
+        i2c_master_start(cmdSeq); 	                                                // START condition.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|READ_MODE,true); 		// Select I2C device and put it into the READ mode. Check ACK from slave.
+        i2c_master_read_byte(cmdSeq,&read_value,NACK_VAL); 						    // Read the register and write its value into the variable. Since this is the final byte we request from the slave, send Master NACK as per I2C protocol standard.
+        i2c_master_stop(cmdSeq);                                                    // STOP condition. IMPORTANT! Physically releases the I2C line so it is no longer pulled down. If you dont add this command, your I2C SCL bus may get locked up at LOW level!
+                                                       
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 2, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);   // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS.
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_READ, NULL, 0, &read_value, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+        if (outcome==ESP_OK) 
+            {
+                ESP_LOGI(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x] : read value %#04x. Code %#04x.",I2CportNumber,I2CdeviceAddress,read_value,outcome);
+            }
+        else if (outcome!=ESP_OK) 
+            {
+                //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
+                ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,outcome);
+                i2c_cmd_link_delete(cmdSeq);    //The failure path must free the command sequence too, or every failed read leaks one.
+                return 0;
+            };
+
+    i2c_cmd_link_delete(cmdSeq);            //Deletes the I2C command sequence to free the RAM.
+ 
+    return read_value;                      //Return value received from the slave's register.
+}
+
+/**SUS_I2C_ReadByte: Reads the byte of data from a given I2C slave device followed by a full STOP condition. Uses ESP-IDF's "Read" wrapper function to do so the "EASY WAY"(tm). However, underlying principle is the same as regular SUS_I2C_ReadByte. 
+ * NOTE: When interfacing with I2C sensors, this function generally is not very useful if you are trying to read from the sensor's register(s). 
+ * Most sensors require a WRITE-read sequence of I2C operations WITHOUT a STOP inbetween to first SELECT the register of the sensor, and only then READ - not just a simple READ. Consult your sensor device's datasheet.
+ * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t)  from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * RETURNS uint8_t value read from the slave device's register.
+ * EXAMPLE USE: uint8_t data = SUS_I2C_ReadByte(0,0x4A);
+ * NOTE: this one only prints the byte, it doesn't give it back. Use SUS_I2C_ReadByteFromSlave_STATUS (STATUS section) to get the byte and the outcome.
+*/
+void SUS_I2C_ReadByteFromSlave_EZ(int I2CportNumber,int I2CdeviceAddress)
+{
+    char *I2C_READ_TAG = "I2C READ";    //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;                  // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    uint8_t read_value = 0xf1;          // This variable will store the value read from the slave device's register. 0xf1 is just a random value to initiate the variable with.
+    
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 2, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_read_from_device(I2CportNumber, I2CdeviceAddress, &read_value, 1, 10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_READ, NULL, 0, &read_value, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+
+        if (outcome==ESP_OK) 
+        {
+            ESP_LOGI(I2C_READ_TAG,"Read from the device  %#04x completed successfully, Code %d(%#04x).\n\r", I2CdeviceAddress, outcome,outcome);
+        }
+    else if (outcome!=ESP_OK) 
+        {
+
+            ESP_LOGE(I2C_READ_TAG,"Failed to read from device  %#04x. Code %d(%#04x).",I2CdeviceAddress, outcome,outcome);
+        };
+
+}
+
+/**SUS_I2C_ReadRegisters: Reads a block of CONSECUTIVE registers in one go ("burst read"): writes the first register's address, REPEATED START, then reads as many bytes as you ask for.
+ * Most sensors auto-increment their register pointer after every byte, so e.g. X/Y/Z data registers (6 bytes) come out in ONE transaction instead of six. Check your datasheet for "auto-increment" or "burst read".
+ * NOTE: Unlike the single-register functions above, this one does NOT print anything on success - it is meant to be called hundreds of times per second. Errors are still printed.
+ * PARAMETER "I2CportNumber" is just an integer number (uint8_t) 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * PARAMETER "I2CdeviceAddress" is an integer number (uint8_t) from 0 to 127 (as per I2C limit of 127 addresses).
+ * PARAMETER "startRegisterAddress" is the 8-bit address of the FIRST register to read.
+ * PARAMETER "readBuffer" is the array where the read bytes will be stored. Must have room for "amountOfBytesToRead" bytes.
+ * PARAMETER "amountOfBytesToRead" is how many consecutive registers to read.
+ * RETURNS esp_err_t outcome code: ESP_OK (0) = all good, anything else = the read failed and the buffer contents are not valid.
+ * EXAMPLE USE: uint8_t xyz[6]; if (SUS_I2C_ReadRegisters(0,0x68,0x3B,xyz,6) == ESP_OK) {...} //Reads 6 accelerometer registers 0x3B-0x40 of MPU6050.
+*/
+esp_err_t SUS_I2C_IRAM SUS_I2C_ReadRegisters(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t startRegisterAddress, uint8_t *readBuffer, size_t amountOfBytesToRead)
+{
+    const char *I2C_READ_TAG = "I2C READ";  //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;                      // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 3 + amountOfBytesToRead, 2);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_read_device(I2CportNumber,I2CdeviceAddress,&startRegisterAddress,1,readBuffer,amountOfBytesToRead,10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, &startRegisterAddress, 1, readBuffer, amountOfBytesToRead, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome!=ESP_OK)
+        {
+            ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x], [Registers %#04x+%d] : burst read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,startRegisterAddress,(int)amountOfBytesToRead,outcome);
+        };
+    return outcome;
+}
+
+/*
+ ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄ 
+▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ 
+▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌          
+▐░▌   ▄   ▐░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌          ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ 
+▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌     ▐░▌          ▐░▌     ▐░░░░░░░░░░░▌
+▐░▌ ▐░▌░▌ ▐░▌▐░█▀▀▀▀█░█▀▀      ▐░▌          ▐░▌     ▐░█▀▀▀▀▀▀▀▀▀ 
+▐░▌▐░▌ ▐░▌▐░▌▐░▌     ▐░▌       ▐░▌          ▐░▌     ▐░▌          
+▐░▌░▌   ▐░▐░▌▐░▌      ▐░▌  ▄▄▄▄█░█▄▄▄▄      ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ 
+▐░░▌     ▐░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌
+ ▀▀       ▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀       ▀▀▀▀▀▀▀▀▀▀▀ 
+*/
+
+/**SUS_I2C_WriteToRegister: Writes to the slave's register by WRITING two 8-bit values to the I2C bus without STOP condition inbetween. Simplifies register operation of I2C devices that support this method.
+ * NOTE: This is the function you should use to write to I2C sensor's registers.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
+ * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
+ * PARAMETER "recheckWrittenDataYN" is a boolean (true/false) that determines whether an additional check will be performed to verify the written value.
+ * EXAMPLE USE: SUS_I2C_WriteToSlave_Register(0,0x4A,0x01,1); Writes the value 1 (0x01) to the register 0x01 of the device at I2C address 0x04A.
+*/
+void SUS_I2C_WriteToRegister(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+{
+    const char *I2C_WRITE_TAG = "I2C WRITE"; //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus
+
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+        i2c_master_start(cmdSeq);                                          //START condition. "Hey everyone on I2C bus! I'M GOING TO TALK TO ONE OF YOU!!1"
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);  //Select the slave with the given address and put it in the "WRITE TO" mode.
+        i2c_master_write_byte(cmdSeq,registerAddress,true);                   //Select the register address of the device.
+        i2c_master_write_byte(cmdSeq,valueToWrite,true);                      //Write the value 1 to the register on the device
+        i2c_master_stop(cmdSeq);                                           //STOP condition. "I'm done talking. Dismissed!"
+
+    uint8_t tracePayload[2] = {registerAddress, valueToWrite};        // Bytes this transaction writes, for the trace recorder.
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 3, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);      //EXECUTE THE I2C COMMANDS!
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, tracePayload, 2, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome==ESP_OK)
+        {
+            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+        }
+    else if (outcome!=ESP_OK) 
+        {
+            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+        };
+
+    i2c_cmd_link_delete(cmdSeq);
+}
+
+/**SUS_I2C_WriteToRegister_EX: Writes to the slave's register by WRITING two 8-bit values to the I2C bus without STOP condition inbetween. Performs an extra data integrity check by reading the written value from slave's memory address and comparing it to the original.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
+ * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
+ * EXAMPLE USE: SUS_I2C_WriteToSlave_Register(0,0x4A,0x01,1); Writes the value 1 (0x01) to the register 0x01 of the device at I2C address 0x04A.
+*/
+void SUS_I2C_WriteToRegister_EX(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+{
+    const char *I2C_WRITE_TAG = "I2C WRITE"; //Tag (essentially a text label) for debug messages.
+    const char *I2C_WRITE_CHECK = "I2C WRITE CHECK"; //Tag (essentially a text label) for debug messages.
+    uint8_t read_value =0xf1;       // This variable will store the value read from the slave device's register. 0xf1 is just a random default value.
+    //uint8_t ACK_VAL = 0;            // ACKnowledge 
+    uint8_t NACK_VAL = 1;           // NOT ACKnowledge 
+    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus
+    uint8_t READ_MODE = 1;          // Read mode - HIGH bus
+    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+        i2c_master_start(cmdSeq);                                              //START condition. "Hey everyone on I2C bus! I'M GOING TO TALK TO ONE OF YOU!!1"
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);       //Select the slave with the given address and put it in the "WRITE TO" mode.
+        i2c_master_write_byte(cmdSeq,registerAddress,true);                        //Select the register address of the device.
+        i2c_master_write_byte(cmdSeq,valueToWrite,true);                           //Write the value 1 to the register on the device
+        
+    //Write checking code - reads the newly written value to confirm it has been correctly received.
+    //Confirms the written data by reading the contents of the register we just wrote to.
+        i2c_master_start(cmdSeq);                                              //REPEATED START condition.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);       //Broadcast the slave's I2C address on the bus, write mode.
+        i2c_master_write_byte(cmdSeq,registerAddress,true);                        //Select the register of the device.
+        i2c_master_start(cmdSeq);//REPEATED START condition.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|READ_MODE,true);        //Select the device address and say "Imma read from you".
+        i2c_master_read_byte(cmdSeq,&read_value,NACK_VAL);                         //Read the value from the register into the variable. Since this is the final byte we request from the slave, send Master NACK as per I2C protocol standard.
+
+        i2c_master_stop(cmdSeq);                                               //STOP condition. "I'm done talking. Dismissed!"
+
+    uint8_t tracePayload[3] = {registerAddress, valueToWrite, registerAddress}; // Bytes this transaction writes, for the trace recorder.
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 7, 3);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);          //EXECUTE THE I2C COMMANDS!
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, tracePayload, 3, &read_value, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome==ESP_OK) //Outcome is OK ;)
+        {
+            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+            if (read_value == valueToWrite)
+            {
+                ESP_LOGW(I2C_WRITE_CHECK," Value %#04x of the register %#04x matches the input value %#04x. Write success confirmed.",read_value, registerAddress,valueToWrite);
+
+            }
+            else if (read_value != valueToWrite)
+            {
+                ESP_LOGE(I2C_WRITE_CHECK," Data mismatch: register %#04x contains %#04x, input value was: %#04x. Something went wrong during the data transfer.",registerAddress,read_value, valueToWrite);
+            }
+        }
+    else if (outcome!=ESP_OK) //Outcome is NOT OK :(
+        {
+            //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
+            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+        };
+
+    i2c_cmd_link_delete(cmdSeq);
+
+}
+
+
+/**SUS_I2C_WriteToRegister_EZ: Writes to the slave's register by WRITING two 8-bit values to the I2C bus without STOP condition inbetween.
+ * Uses "write_to_device" wrapper function to write to the slave's register the "EASY WAY"(tm). However, underlying principle is the same as regular SUS_I2C_WriteToRegister.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "registerAddress" is the 8-bit address of the I2C slave device's register (look it up in the datasheet ;).
+ * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
+ * EXAMPLE USE: SUS_I2C_WriteToRegister_EZ(0,0x4A,0x01,1); Writes the value 1 (0x01) to the register 0x01 of the device at I2C address 0x04A.
+*/
+void SUS_I2C_WriteToRegister_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+{
+    const char *I2C_WRITE_TAG = "I2C WRITE";
+    uint8_t write_buffer[2] = {registerAddress,valueToWrite};
+    esp_err_t outcome;
+
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 3, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,write_buffer,2,10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, write_buffer, 2, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome==ESP_OK)
+        {
+            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+        }
+    else if (outcome!=ESP_OK) 
+        {
+            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+        };
+
+}
+
+/**SUS_I2C_WriteByte: Writes one 8-bit value to the device at a given I2C address and issues full STOP condition afterwards (i.e. releases the physical bus). Uses ESP-IDF's "I2C link queue" API method. 
+ * NOTE: When interfacing with I2C sensors, this function generally will not be very useful if you are trying to write to the registers. 
+ * Most sensors require a WRITE-WRITE sequence of I2C operations WITHOUT a STOP inbetween to first SELECT the register of the sensor, and only then WRITE - not just a simple WRITE. Consult your sensor device's datasheet.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "value" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
+ * EXAMPLE USE: SUS_I2C_WriteByteToSlave(0,0x4A,0b00000001); Writes the value 0b00000001 (0x01 or 1) to the device at address 0x04A.
+*/
+void SUS_I2C_WriteByteToSlave(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t valueToWrite)
+{
+    char *I2C_WRITE_TAG = "I2C WRITE"; //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    uint8_t WRITE_MODE = 0;         // Write mode - LOW bus, hence 0.
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();                   // Creates the I2C command sequence list. This list will contain your I2C commands. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
+        i2c_master_start(cmdSeq);                                              //START condition command.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|WRITE_MODE,true);   //Select the slave with the given address and put it in the "WRITE TO" mode.
+        i2c_master_write_byte(cmdSeq,valueToWrite,true);                       //Write a byte (8bits) to the slave device. 
+                                                                            //WARNING:  This will NOT write to the registers of I2C sensor "as is". 
+                                                                            //          At most it might select the register address of the slave for subsequent writing. 
+                                                                            //          If you need to access registers, use the  "WriteToRegister" function. Also, consult the I2C slave's DATASHEET.
+        i2c_master_stop(cmdSeq);                                               //          STOP condition command. 
+
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 2, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);      //EXECUTE THE ABOVE I2C COMMANDS!
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, &valueToWrite, 1, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome==ESP_OK)
+        {
+            ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : [Value %#04x] write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
+        }
+    else if (outcome!=ESP_OK) 
+        {
+            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : [Value %#04x] write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
+        };
+
+    i2c_cmd_link_delete(cmdSeq);
+}
+
+/**SUS_I2C_WriteByte_EZ: Writes one 8-bit value to the device at a given I2C address and issues full STOP condition afterwards (i.e. releases the physical bus). Uses ESP-IDF's "write_to_device" "EASY WAY"(tm) wrapper function.
+ * NOTE: When interfacing with I2C sensors, this function generally will not be very useful if you are trying to write to the registers. 
+ * Most sensors require a WRITE-WRITE sequence of I2C operations WITHOUT a STOP inbetween, and not just a simple WRITE. Consult your sensor device's datasheet.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddressHex" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "value" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
+ * EXAMPLE USE: SUS_I2C_WriteByteToSlave_EZ(0,0x4A,0b00000001); Writes the value 0b00000001 (0x01 or 1) to the device at address 0x04A.
+*/
+void SUS_I2C_WriteByteToSlave_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t valueToWrite)
+{
+    char *I2C_WRITE_TAG = "I2C WRITE";
+    esp_err_t outcome;
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 2, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,&valueToWrite,1,5/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, &valueToWrite, 1, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+            if (outcome==ESP_OK) 
+            {
+                ESP_LOGI(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x]: [Value %#04x] write OK. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
+            }
+        else if (outcome!=ESP_OK) 
+            {
+                ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : [Value %#04x] write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,valueToWrite,outcome);
+            };
+
+}
+
+/**Writes multiple 8-bit values to the device at a given I2C address one after the other, without STOP conditions inbetween.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "I2CdeviceAddress" is an integer number from 0 to 127 (as per I2C limit of 127 addresses). Preferrably should be written in a hex number format (0x) for clarity, but can be decimal too.
+ * Parameter "arrayOfValuesToWrite" is the array of 8-bit values you want to write to the device. Yes, simple as uint8_t myArray[2];
+ * Paramwtwe "amountOfValuesToWrite" is the amount of values from the array you want to write. Set to array size if you want to write the entire array.
+ * NOTE: the whole array goes out in ONE transaction and nothing else can use the bus until it's done. For big arrays (display frames, EEPROM images)
+ *       use SUS_I2C_TransferChunked (PRIORITY section) - it lets more urgent transactions in between.
+ * EXAMPLE USE: uint8_t writeList[5] = {1,2,3,4,5};
+ *              SUS_I2C_WriteByteArrayToSlave_EZ(0,0x4A,writeList,2); //Writes first two values from the writeList array to the device with address 0x4A.
+*/
+void SUS_I2C_WriteByteArrayToSlave_EZ(int I2CportNumber,int I2CdeviceAddress, uint8_t *arrayOfValuesToWrite, uint8_t amountOfValuesToWrite)
+{
+    char *I2C_WRITE_TAG = "I2C WRITE";
+    esp_err_t outcome;
+
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 1 + amountOfValuesToWrite, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_to_device(I2CportNumber,I2CdeviceAddress,arrayOfValuesToWrite,amountOfValuesToWrite,10/portTICK_PERIOD_MS);//i2c_master_write_to_device(I2CportNumber,I2CdeviceAddressHex,I2CwriteArray,sizeof(I2CwriteArray),10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, arrayOfValuesToWrite, amountOfValuesToWrite, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+            if (outcome==ESP_OK) 
+            {
+#if !SUS_I2C_PROFILE_MINIMAL
+                printf("Successfully wrote: ");
+                for (size_t i = 0; i < amountOfValuesToWrite; i++)
+                {
+                    printf("%#04x ",arrayOfValuesToWrite[i]);
+                    
+                }
+                printf("to device at address %#04x. Code %d(%#04x).\n\r",I2CdeviceAddress, outcome,outcome);
+#endif
+            }
+        else if (outcome!=ESP_OK) 
+            {
+                ESP_LOGI(I2C_WRITE_TAG,"Failed to write to device at address %#04x. Code %d(%#04x).\n",I2CdeviceAddress, outcome,outcome);
+            };
+
+}
+
+
+/**SUS_I2C_WriteRegisters: Writes a block of CONSECUTIVE registers in one go ("burst write"): the first register's address, then all the values, one transaction.
+ * The write twin of SUS_I2C_ReadRegisters - same auto-increment rules apply (check your datasheet). Does NOT print anything on success, errors are still printed.
+ * PARAMETER "startRegisterAddress" is the 8-bit address of the FIRST register to write.
+ * PARAMETER "valuesToWrite" are the values for startRegisterAddress, startRegisterAddress+1, ...
+ * RETURNS ESP_OK if the device ACKed everything, otherwise the ESP-IDF error code.
+ * EXAMPLE USE: uint8_t thresholds[2] = {0x10, 0x80};
+ *              SUS_I2C_WriteRegisters(0,0x4A,0x05,thresholds,2); //Writes 0x10 to register 0x05 and 0x80 to register 0x06.
+*/
+esp_err_t SUS_I2C_IRAM SUS_I2C_WriteRegisters(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t startRegisterAddress, const uint8_t *valuesToWrite, size_t amountOfBytesToWrite)
+{
+    const char *I2C_WRITE_TAG = "I2C WRITE";
+    esp_err_t outcome;
+    uint8_t tracePayload[SUS_I2C_TRACE_PAYLOAD_SIZE];       //Trace recorder: register address + as many values as fit, same as on the wire.
+
+    tracePayload[0] = startRegisterAddress;
+    memcpy(&tracePayload[1], valuesToWrite, amountOfBytesToWrite < sizeof(tracePayload) - 1 ? amountOfBytesToWrite : sizeof(tracePayload) - 1);
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();        //Command link instead of i2c_master_write_to_device: register address and values don't have to be copied into one array first.
+        i2c_master_start(cmdSeq);
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_WRITE,true);
+        i2c_master_write_byte(cmdSeq,startRegisterAddress,true);
+        i2c_master_write(cmdSeq,valuesToWrite,amountOfBytesToWrite,true);
+        i2c_master_stop(cmdSeq);
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 2 + amountOfBytesToWrite, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber,cmdSeq,10/portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmdSeq);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, tracePayload, 1 + amountOfBytesToWrite, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome!=ESP_OK)
+        {
+            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Registers %#04x+%d] : burst write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,startRegisterAddress,(int)amountOfBytesToWrite,outcome);
+        };
+    return outcome;
+}
+
+/**SUS_I2C_WriteByte: Directly control the I2C GPIO to send custom data pulses. Pushes one 8-bit value to the I2C bus followed by a full STOP.
+ * WARNING: ADVANCED USERS ONLY. You will need to construct and supply your own 8-bit data packet! 
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * Parameter "valueToWrite" is the 8-bit integer you want to write to the device. Can be written in decimal, hex or binary.
+ * EXAMPLE USE: SUS_I2C_WriteByteToBus_RAW(0,0b00000001); //Pushes a value of 0x01 onto the I2C bus.
+*/
+void SUS_I2C_WriteByteToBus_RAW(uint8_t I2CportNumber, uint8_t valueToWrite)
+{
+    char *I2C_WRITE_TAG = "I2C RAW WRITE"; //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();                   // Creates the I2C command sequence list. This list will contain your I2C commands. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
+        i2c_master_start(cmdSeq);                                           //START condition command.
+        i2c_master_write_byte(cmdSeq,valueToWrite,true);                    //Pushes the byte onto the I2C bus
+        i2c_master_stop(cmdSeq); 
+    int64_t startTime = esp_timer_get_time();
+    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);      // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS.
+    SUS_I2C_TraceRecord(I2CportNumber, SUS_I2C_TRACE_NO_ADDRESS, SUS_I2C_TRACE_WRITE, &valueToWrite, 1, NULL, 0, outcome, startTime);
+    if (outcome==ESP_OK)
+        {
+            ESP_LOGW(I2C_WRITE_TAG,"[I2C PORT %d] : [Value %#04x] RAW write OK. Code %d(%#04x).",I2CportNumber,valueToWrite,outcome,outcome);
+        }
+    else if (outcome!=ESP_OK) 
+        {
+            ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d]: [Value %#04x] RAW write FAILED. Code %d(%#04x).",I2CportNumber,valueToWrite,outcome,outcome);
+        };
+
+    i2c_cmd_link_delete(cmdSeq);
+}
+
+/* 
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄ 
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ 
+▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌               ▐░▌     
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     
+▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀      ▐░▌     
+▐░▌     ▐░▌  ▐░▌                    ▐░▌▐░▌               ▐░▌     
+▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     
+▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     
+ ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀                                                                                                                    
+ */
+
+/**Force-resets the I2C bus back to HIGH SCL and HIGH SDA by issuing stop-start-stop conditions. 
+ * Use when either or both of your I2C bus SCL/SDA lines got physically locked down at LOW level for whatever reason. How to check? Use the LED and a resistor.
+ * Parameter "I2CportNumber" is just an integer number 1 or 0, corresponding to two ports of ESP32 with indexes 1 and 0.
+ * EXAMPLE USE: SUS_I2C_ResetBus(0); Resets SCL and SDA lines of I2C at port 0.
+*/
+void SUS_I2C_ResetBus(uint8_t I2CportNumber)
+{
+    const char *I2C_RESET_TAG = "I2C RESET"; //Tag (essentially a text label) for debug messages.
+    esp_err_t outcome;              // Used to report error/success. If it is 0 = all good, -1 = something went wrong, 263 (0x107) = timeout.
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();	    // Creates the I2C command sequence list. This list will contain your I2C sequence. DOES NOT PERFORM ANY COMMANDS ON ITS OWN!
+        
+        i2c_master_stop(cmdSeq);                            // STOP condition.
+        i2c_master_start(cmdSeq); 		                    // START condition.										
+        i2c_master_stop(cmdSeq);                            // STOP condition.
+                                                       
+    outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);       // THIS LINE PERFORMS ALL THE ABOVE I2C COMMANDS ON THE PHYSICAL BUS.
+    if (outcome==ESP_OK) 
+        {
+            ESP_LOGI(I2C_RESET_TAG,"Successfully reset the I2C bus at port %d. Code %#04x.\n\r",I2CportNumber, outcome);
+        }
+    else if (outcome!=ESP_OK) 
+        {
+            //Check the I2C address value, physical contacts, pullup resistor values, I2C command sequence and/or bus signal rise rate (depends on overall capacitance).\n\r Also, make ABSOLUTELY sure that you've run the I2C initialization routine first! 
+            ESP_LOGE(I2C_RESET_TAG,"Force reset I2C port %d. Code %#04x.\n\r",I2CportNumber, outcome);
+        };
 
     i2c_cmd_link_delete(cmdSeq);                                                        //Deletes the I2C command sequence to free the RAM.
 }
 
 
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀ ▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌               ▐░▌     ▐░▌       ▐░▌     ▐░▌     ▐░▌       ▐░▌▐░▌
+▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     ▐░█▄▄▄▄▄▄▄█░▌     ▐░▌     ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌     ▐░▌     ▐░▌       ▐░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀█░▌     ▐░▌     ▐░█▀▀▀▀▀▀▀█░▌     ▐░▌     ▐░▌       ▐░▌ ▀▀▀▀▀▀▀▀▀█░▌
+          ▐░▌     ▐░▌     ▐░▌       ▐░▌     ▐░▌     ▐░▌       ▐░▌          ▐░▌
+ ▄▄▄▄▄▄▄▄▄█░▌     ▐░▌     ▐░▌       ▐░▌     ▐░▌     ▐░█▄▄▄▄▄▄▄█░▌ ▄▄▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌     ▐░▌     ▐░▌       ▐░▌     ▐░▌     ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀       ▀       ▀         ▀       ▀       ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* STATUS API: every read and write, returning what really happened.
+ * The classic functions above are made for trying things out: they print every transaction, the reads return the value itself, and the writes
+ * return nothing. That has a catch - SUS_I2C_ReadRegister returns 0 when the read FAILED, and 0 is also a perfectly normal register value.
+ * Reading twice and comparing doubles the bus traffic and still can't tell "failed twice" from "really 0".
+ * The _STATUS twins below do the same transactions, ONE transaction each, but:
+ *      - they return esp_err_t: ESP_OK = the device ACKed everything, anything else = it failed (ESP_FAIL = NACK, ESP_ERR_TIMEOUT = bus stuck...),
+ *      - values come out through a pointer, and ONLY on success: a failed read leaves your variable alone. A zero means zero.
+ *      - nothing is printed on success (they're meant for drivers that run all the time), errors are still printed.
+ * SUS_I2C_Batch_STATUS() runs a list of register reads/writes - many devices, many registers - in one call, with an outcome per item,
+ * so one device that's gone doesn't hide whether the others worked.
+ * Burst reads/writes (SUS_I2C_ReadRegisters, SUS_I2C_WriteRegisters) have returned esp_err_t all along - use them for several registers at once.
+ */
+#define SUS_I2C_BATCH_READ              0
+#define SUS_I2C_BATCH_WRITE             1
+
+struct SUS_I2C_BatchItem
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   I2CdeviceAddress;
+    uint8_t   direction;                        // SUS_I2C_BATCH_READ or SUS_I2C_BATCH_WRITE.
+    uint8_t   registerAddress;                  // First register (burst, same auto-increment rules as SUS_I2C_ReadRegisters).
+    uint8_t   *data;                            // READ: where the values go. WRITE: the values to write.
+    size_t    length;                           // How many registers.
+    /*----- Filled in by SUS_I2C_Batch_STATUS -----*/
+    esp_err_t outcome;                          // ESP_OK, or the error of this item's transaction. READ: data is only valid if ESP_OK.
+};
+
+/**SUS_I2C_ReadRegister_STATUS: Reads one register, like SUS_I2C_ReadRegister, but tells you whether it worked. One transaction.
+ * PARAMETER "value" is where the register's value goes. It is ONLY written if the read worked.
+ * RETURNS ESP_OK, or the ESP-IDF error code of the failed read (the error is also printed).
+ * EXAMPLE USE: uint8_t status;
+ *              if (SUS_I2C_ReadRegister_STATUS(0,0x68,0x3A,&status) == ESP_OK && status == 0) {...}   //0 really is 0 here.
+*/
+esp_err_t SUS_I2C_IRAM SUS_I2C_ReadRegister_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t *value)
+{
+    uint8_t readValue;
+    esp_err_t outcome;
+    if (!SUS_I2C_PrefetchRead(I2CportNumber, I2CdeviceAddress, registerAddress, &readValue, &outcome))  //Prefetch: maybe it was read ahead (PREFETCH section).
+        outcome = SUS_I2C_ReadRegisters(I2CportNumber, I2CdeviceAddress, registerAddress, &readValue, 1);
+    if (outcome == ESP_OK) *value = readValue;
+    return outcome;
+}
+
+/**SUS_I2C_ReadByteFromSlave_STATUS: Reads one byte from the device without selecting a register (START, address + READ, byte, STOP), like SUS_I2C_ReadByteFromSlave.
+ * PARAMETER "value" is where the byte goes. It is ONLY written if the read worked.
+ * RETURNS ESP_OK, or the ESP-IDF error code of the failed read (the error is also printed).
+ * EXAMPLE USE: uint8_t byte; if (SUS_I2C_ReadByteFromSlave_STATUS(0,0x4A,&byte) == ESP_OK) {...}
+*/
+esp_err_t SUS_I2C_ReadByteFromSlave_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t *value)
+{
+    const char *I2C_READ_TAG = "I2C READ";
+    uint8_t readValue;
+    esp_err_t outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 2, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_read_from_device(I2CportNumber, I2CdeviceAddress, &readValue, 1, 10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_READ, NULL, 0, &readValue, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome == ESP_OK) *value = readValue;
+    else ESP_LOGE(I2C_READ_TAG,"[I2C PORT %d], [Device %#04x] : read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,outcome);
+    return outcome;
+}
+
+/**SUS_I2C_WriteToRegister_STATUS: Writes one register, like SUS_I2C_WriteToRegister, but tells you whether it worked. One transaction.
+ * RETURNS ESP_OK if the device ACKed the register address and the value, otherwise the ESP-IDF error code (the error is also printed).
+ * EXAMPLE USE: if (SUS_I2C_WriteToRegister_STATUS(0,0x68,0x6B,0x00) != ESP_OK) {...}   //Wake the MPU6050 up - or find out it didn't hear you.
+*/
+esp_err_t SUS_I2C_IRAM SUS_I2C_WriteToRegister_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite)
+{
+    return SUS_I2C_WriteRegisters(I2CportNumber, I2CdeviceAddress, registerAddress, &valueToWrite, 1);
+}
+
+/**SUS_I2C_WriteToRegister_EX_STATUS: Writes one register and reads it back in the SAME transaction, like SUS_I2C_WriteToRegister_EX, but tells you the result.
+ * PARAMETER "readBack" gets the value read back from the register. Can be NULL. Only written if the transaction worked.
+ * RETURNS ESP_OK if the write worked and the register holds the value, ESP_ERR_INVALID_RESPONSE if the transaction worked but the register holds
+ * something else (read-only bits, a register that changes by itself, a garbled write), or the ESP-IDF error code of the failed transaction.
+ * EXAMPLE USE: uint8_t actual;
+ *              if (SUS_I2C_WriteToRegister_EX_STATUS(0,0x68,0x1B,0x18,&actual) == ESP_ERR_INVALID_RESPONSE) printf("Gyro range register holds %#04x\n", actual);
+*/
+esp_err_t SUS_I2C_WriteToRegister_EX_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t valueToWrite, uint8_t *readBack)
+{
+    const char *I2C_WRITE_TAG = "I2C WRITE";
+    uint8_t readValue = 0;
+    esp_err_t outcome;
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+        i2c_master_start(cmdSeq);                                                   //Write the value...
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_WRITE,true);
+        i2c_master_write_byte(cmdSeq,registerAddress,true);
+        i2c_master_write_byte(cmdSeq,valueToWrite,true);
+        i2c_master_start(cmdSeq);                                                   //...REPEATED START, select the same register again...
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_WRITE,true);
+        i2c_master_write_byte(cmdSeq,registerAddress,true);
+        i2c_master_start(cmdSeq);                                                   //...and read it back.
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_READ,true);
+        i2c_master_read_byte(cmdSeq,&readValue,I2C_MASTER_NACK);
+        i2c_master_stop(cmdSeq);
+
+    uint8_t tracePayload[3] = {registerAddress, valueToWrite, registerAddress};  // Bytes this transaction writes, for the trace recorder.
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 7, 3);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmdSeq);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, tracePayload, 3, &readValue, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome != ESP_OK) {
+        ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %#04x write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,valueToWrite,outcome);
+        return outcome;
+    }
+    if (readBack) *readBack = readValue;
+    return readValue == valueToWrite ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+/**SUS_I2C_WriteByteArrayToSlave_STATUS: Writes an array of bytes to the device in one transaction, like SUS_I2C_WriteByteArrayToSlave_EZ - without printing every byte, and not limited to 255.
+ * RETURNS ESP_OK if the device ACKed every byte, otherwise the ESP-IDF error code (the error is also printed).
+ * EXAMPLE USE: uint8_t writeList[3] = {0x20, 0x70, 0x00};
+ *              if (SUS_I2C_WriteByteArrayToSlave_STATUS(0,0x1E,writeList,3) == ESP_OK) {...}
+*/
+esp_err_t SUS_I2C_WriteByteArrayToSlave_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, const uint8_t *arrayOfValuesToWrite, size_t amountOfValuesToWrite)
+{
+    const char *I2C_WRITE_TAG = "I2C WRITE";
+    esp_err_t outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 1 + amountOfValuesToWrite, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_to_device(I2CportNumber, I2CdeviceAddress, arrayOfValuesToWrite, amountOfValuesToWrite, 10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, arrayOfValuesToWrite, amountOfValuesToWrite, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome != ESP_OK) ESP_LOGE(I2C_WRITE_TAG,"[I2C PORT %d], [Device %#04x] : %d byte write FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,(int)amountOfValuesToWrite,outcome);
+    return outcome;
+}
+
+/**SUS_I2C_WriteByteToSlave_STATUS: Writes one byte to the device without selecting a register (START, address + WRITE, byte, STOP), like SUS_I2C_WriteByteToSlave.
+ * RETURNS ESP_OK if the device ACKed, otherwise the ESP-IDF error code (the error is also printed).
+ * EXAMPLE USE: SUS_I2C_WriteByteToSlave_STATUS(0,0x70,0x04);   //Selects channel 2 of a TCA9548A mux.
+*/
+esp_err_t SUS_I2C_WriteByteToSlave_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t valueToWrite)
+{
+    return SUS_I2C_WriteByteArrayToSlave_STATUS(I2CportNumber, I2CdeviceAddress, &valueToWrite, 1);
+}
+
+/**SUS_I2C_PingAddress_STATUS: Checks whether a device ACKs its address. Unlike SUS_I2C_PingAddress it writes NOTHING into the device
+ * (START, address + WRITE, STOP) and prints nothing - a missing device is an answer here, not an error.
+ * RETURNS ESP_OK if the device answered, ESP_FAIL if nobody ACKed the address, ESP_ERR_TIMEOUT if the bus is stuck.
+ * EXAMPLE USE: if (SUS_I2C_PingAddress_STATUS(0,0x76) != ESP_OK) printf("No barometer on this board.\n");
+*/
+esp_err_t SUS_I2C_PingAddress_STATUS(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();      //Command link: i2c_master_write_to_device refuses to write nothing (NULL buffer) with ESP_ERR_INVALID_ARG.
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (I2CdeviceAddress << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_stop(cmd);
+    esp_err_t outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 1, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmd, 10/portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, NULL, 0, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    return outcome;
+}
+
+/**SUS_I2C_Batch_STATUS: Runs a list of register reads and writes on one port, one transaction per item, and tells you for EVERY item whether it worked.
+ * All items are tried, a failed one does not stop the others. Nothing is printed on success, errors are still printed.
+ * PARAMETER "item" is the list - see struct SUS_I2C_BatchItem. Each item's outcome is written back into it.
+ * PARAMETER "failedItems" gets how many items failed. Can be NULL.
+ * RETURNS ESP_OK if every item worked, ESP_ERR_INVALID_ARG if an item makes no sense (nothing was done), otherwise the outcome of the first item that failed.
+ * EXAMPLE USE: uint8_t accel[6], baro[3], range = 0x18;
+ *              struct SUS_I2C_BatchItem batch[3] = {{.I2CdeviceAddress=0x68, .direction=SUS_I2C_BATCH_READ,  .registerAddress=0x3B, .data=accel, .length=6},
+ *                                                   {.I2CdeviceAddress=0x76, .direction=SUS_I2C_BATCH_READ,  .registerAddress=0xF7, .data=baro,  .length=3},
+ *                                                   {.I2CdeviceAddress=0x68, .direction=SUS_I2C_BATCH_WRITE, .registerAddress=0x1B, .data=&range, .length=1}};
+ *              SUS_I2C_Batch_STATUS(0, batch, 3, NULL);
+ *              if (batch[1].outcome == ESP_OK) {...}   //Barometer data is good, whatever happened to the IMU.
+*/
+esp_err_t SUS_I2C_Batch_STATUS(uint8_t I2CportNumber, struct SUS_I2C_BatchItem *item, size_t amountOfItems, size_t *failedItems)
+{
+    esp_err_t outcome = ESP_OK;
+    size_t failed = 0;
+
+    if (item == NULL && amountOfItems > 0) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < amountOfItems; i++)
+        if (item[i].direction > SUS_I2C_BATCH_WRITE || item[i].length == 0 || item[i].data == NULL) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < amountOfItems; i++)
+    {
+        struct SUS_I2C_BatchItem *current = &item[i];
+        if (current->direction == SUS_I2C_BATCH_READ) current->outcome = SUS_I2C_ReadRegisters(I2CportNumber, current->I2CdeviceAddress, current->registerAddress, current->data, current->length);
+        else current->outcome = SUS_I2C_WriteRegisters(I2CportNumber, current->I2CdeviceAddress, current->registerAddress, current->data, current->length);
+        if (current->outcome != ESP_OK) {
+            failed++;
+            if (outcome == ESP_OK) outcome = current->outcome;
+        }
+    }
+    if (failedItems) *failedItems = failed;
+    return outcome;
+}
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄   ▄         ▄  ▄            ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░▌          ▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░▌          ▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌          ▐░▌       ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░▌          ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀█░▌▐░▌          ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░█▀▀▀▀▀▀▀▀▀
+          ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌
+ ▄▄▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* PERIODIC SAMPLING SCHEDULER: lets every device register a periodic burst read ("job") and lays them all out on the bus timeline for you.
+ * Instead of one vTaskDelay loop per sensor (that collide with each other and drift), one task per I2C port runs ALL the periodic reads of that port:
+ *      - every job has a period (how often), an offset (when the first read happens) and a deadline (how late a read may finish and still count as on time).
+ *      - whenever the bus is free, the job whose deadline is the closest goes first ("Earliest Deadline First", EDF). 
+ *        Fast sensors with tight deadlines naturally jump ahead of slow ones.
+ *      - the task sleeps between reads on a microsecond timer (esp_timer), not on the 1ms FreeRTOS tick, so 1kHz jobs are possible.
+ *      - every job counts its missed deadlines, worst lateness and start jitter (how much the actual read moments wobble around the planned ones).
+ *      - every read goes through the bus arbiter at SUS_I2C_PRIORITY_HIGH, so chunked bulk transfers on the same port (SUS_I2C_TransferChunked) step aside between chunks.
+ *      - a job with period 0 is a "continuous" job: it has no deadline and simply gets read again and again in whatever bus time the periodic jobs leave over.
+ *        Several continuous jobs take turns (the one that waited the longest goes next). Great for "read this as fast as the bus allows".
+ * SUS_I2C_SchedulerCheck() tells you BEFORE starting whether a set of jobs fits onto the bus at the speed given to SUS_I2C_Master_Init.
+ *
+ * Workflow:
+ *      1. SUS_I2C_Master_Init(...)
+ *      2. Fill in a "struct SUS_I2C_PeriodicJob" for every device (static or global variable - the scheduler keeps a pointer to it!) and SUS_I2C_SchedulerAddJob() it.
+ *      3. SUS_I2C_SchedulerCheck() - optional, but do it.
+ *      4. SUS_I2C_SchedulerStart(). Your "onSample" function gets called with the data after every read.
+ *      5. SUS_I2C_SchedulerPrintReport() whenever you want to see how it's going.
+ */
+#define SUS_I2C_SCHEDULER_MAX_JOBS      32      // Maximum amount of periodic jobs per I2C port.
+#define SUS_I2C_SCHEDULER_MAX_BURST     32      // Maximum amount of bytes one job may read in one go.
+
+struct SUS_I2C_PeriodicJob
+{
+    /*----- Filled in by YOU before SUS_I2C_SchedulerAddJob -----*/
+    uint8_t  I2CdeviceAddress;                  // Device to read from.
+    uint8_t  startRegisterAddress;              // First register of the burst read.
+    uint8_t  amountOfBytesToRead;               // How many consecutive registers to read (1 - SUS_I2C_SCHEDULER_MAX_BURST).
+    uint32_t period_us;                         // How often to read, in microseconds. 1000 = 1kHz, 1000000 = 1Hz. 0 = continuous: as often as the leftover bus time allows.
+    uint32_t offset_us;                         // Delay of the very first read after SUS_I2C_SchedulerStart, in microseconds. Spread jobs of the same period apart with it.
+    uint32_t deadline_us;                       // The read must be finished within this many microseconds after its planned moment. 0 = same as the period. Ignored for continuous jobs.
+    void (*onSample)(struct SUS_I2C_PeriodicJob *job, const uint8_t *data, esp_err_t outcome, int64_t timestamp_us); // Called after every read (from the scheduler task - keep it short!). Can be NULL.
+    void *userContext;                          // Anything you want to reach from onSample. The scheduler does not touch it.
+
+    /*----- Filled in by the SCHEDULER. Read them, don't write them. -----*/
+    uint8_t  data[SUS_I2C_SCHEDULER_MAX_BURST]; // Result of the latest read.
+    uint32_t cost_us;                           // Estimated bus time of one read at the configured bus speed.
+    int64_t  nextRelease_us;                    // When the next read is planned (esp_timer_get_time() time base).
+    int64_t  absoluteDeadline_us;               // When the next read must be finished.
+    uint32_t releases;                          // Reads performed.
+    uint32_t errors;                            // Reads that failed on the bus.
+    uint32_t missedDeadlines;                   // Reads that finished too late, plus reads that had to be skipped entirely because the job fell a whole period behind.
+    uint32_t skippedReleases;                   // Of those: reads skipped entirely.
+    uint32_t minStartDelay_us;                  // Smallest delay between the planned moment and the actual start of a read.
+    uint32_t maxStartDelay_us;                  // Largest delay. Jitter = max - min.
+    int32_t  maxLateness_us;                    // Worst (finish time - deadline). Negative = always finished early, which is what you want.
+    uint64_t totalResponse_us;                  // Sum of (finish - planned moment), for the average response time.
+};
+
+struct SUS_I2C_Scheduler
+{
+    struct SUS_I2C_PeriodicJob *job[SUS_I2C_SCHEDULER_MAX_JOBS];
+    int jobCount;
+    volatile bool running;                      // Set by Start, cleared by Stop.
+    volatile bool taskFinished;                 // Set by the task when it has really stopped.
+    TaskHandle_t task;
+    esp_timer_handle_t wakeTimer;               // Microsecond-precision alarm clock for the scheduler task.
+    int64_t start_us;
+    uint64_t busyTime_us;                       // Time spent in reads, for the measured bus load.
+};
+#if SUS_I2C_FEATURE_SCHEDULER
+static struct SUS_I2C_Scheduler SUS_I2C_SchedulerPort[2];
+
+/**SUS_I2C_SchedulerAddJob: Adds a periodic burst read to the scheduler of the given I2C port. Only possible while the scheduler is stopped.
+ * The scheduler stores a POINTER to your job struct, so it must stay alive (global or static variable, not a local one!).
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG if the job makes no sense, ESP_ERR_NO_MEM if the port already has SUS_I2C_SCHEDULER_MAX_JOBS jobs, ESP_ERR_INVALID_STATE if the scheduler is running.
+ * EXAMPLE USE: static struct SUS_I2C_PeriodicJob imu = {.I2CdeviceAddress=0x68, .startRegisterAddress=0x3B, .amountOfBytesToRead=6, .period_us=1000, .onSample=imuHandler};
+ *              SUS_I2C_SchedulerAddJob(0, &imu); //Read 6 bytes from MPU6050 at 1kHz.
+*/
+esp_err_t SUS_I2C_SchedulerAddJob(uint8_t I2CportNumber, struct SUS_I2C_PeriodicJob *job)
+{
+    const char *I2C_SCHEDULER_TAG = "I2C SCHEDULER";
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber & 1];
+
+    if (job == NULL || job->amountOfBytesToRead == 0 || job->amountOfBytesToRead > SUS_I2C_SCHEDULER_MAX_BURST) {
+        ESP_LOGE(I2C_SCHEDULER_TAG,"[I2C PORT %d] : job rejected - burst length must be 1-%d bytes.",I2CportNumber,SUS_I2C_SCHEDULER_MAX_BURST);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (scheduler->running) return ESP_ERR_INVALID_STATE;
+    if (scheduler->jobCount >= SUS_I2C_SCHEDULER_MAX_JOBS) return ESP_ERR_NO_MEM;
+
+    if (job->period_us == 0) job->deadline_us = 0;                                                      //Continuous jobs have no deadline.
+    else if (job->deadline_us == 0 || job->deadline_us > job->period_us) job->deadline_us = job->period_us; //A read can't be allowed to finish after the next one is due.
+    job->cost_us = SUS_I2C_BusTime_us(I2CportNumber, 3 + job->amountOfBytesToRead, 2);                  //Address+W, register, address+R, data bytes; START + REPEATED START.
+    scheduler->job[scheduler->jobCount++] = job;
+    return ESP_OK;
+}
+
+/**SUS_I2C_SchedulerRemoveJob: Takes a job back out of the scheduler of the given I2C port. Only possible while the scheduler is stopped.
+ * RETURNS ESP_OK, ESP_ERR_NOT_FOUND if the job was never added to this port, ESP_ERR_INVALID_STATE if the scheduler is running.
+ * EXAMPLE USE: SUS_I2C_SchedulerRemoveJob(0, &imu);
+*/
+esp_err_t SUS_I2C_SchedulerRemoveJob(uint8_t I2CportNumber, struct SUS_I2C_PeriodicJob *job)
+{
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber & 1];
+
+    if (scheduler->running) return ESP_ERR_INVALID_STATE;
+    for (int i = 0; i < scheduler->jobCount; i++)
+    {
+        if (scheduler->job[i] != job) continue;
+        for (int k = i + 1; k < scheduler->jobCount; k++) scheduler->job[k - 1] = scheduler->job[k];   //Keep the order of the other jobs.
+        scheduler->jobCount--;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**SUS_I2C_SchedulerCheck: Works out whether the jobs of the given port fit onto the bus at the configured bus speed, and prints the numbers.
+ * Two checks are done:
+ *      1. Bus load: the sum of (read time / period) over all jobs must stay below 100%. If not, no schedule in the world will work - lower the rates or raise the bus speed.
+ *      2. Deadlines: an I2C transaction can't be interrupted once it started, so a job with a tight deadline may have to wait for one longer read of another job first.
+ *         For every job: load of all jobs (relative to their deadlines) + worst such waiting time (relative to its own deadline) must stay below 100%.
+ *         If this passes, no deadline will ever be missed (as long as nobody else uses the same port). If it fails, deadlines MAY be missed.
+ * RETURNS ESP_OK if the job set is guaranteed to meet all deadlines, ESP_ERR_INVALID_STATE if it is not.
+ * EXAMPLE USE: if (SUS_I2C_SchedulerCheck(0) != ESP_OK) { ...lower some rates... }
+*/
+esp_err_t SUS_I2C_SchedulerCheck(uint8_t I2CportNumber)
+{
+    const char *I2C_SCHEDULER_TAG = "I2C SCHEDULER";
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber & 1];
+    double utilization = 0, density = 0;
+    bool deadlinesGuaranteed = true;
+    int continuousJobs = 0;
+
+    for (int i = 0; i < scheduler->jobCount; i++)
+    {
+        struct SUS_I2C_PeriodicJob *job = scheduler->job[i];
+        job->cost_us = SUS_I2C_BusTime_us(I2CportNumber, 3 + job->amountOfBytesToRead, 2);   //Recalculate in case the bus speed changed since AddJob.
+        if (job->period_us == 0) {
+            continuousJobs++;
+            ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x+%d] : continuous, costs %lu us per read, uses the leftover bus time.",
+                     I2CportNumber,job->I2CdeviceAddress,job->startRegisterAddress,job->amountOfBytesToRead,(unsigned long)job->cost_us);
+            continue;
+        }
+        utilization += (double)job->cost_us / job->period_us;
+        density += (double)job->cost_us / job->deadline_us;
+        ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x+%d] : every %lu us, deadline %lu us, costs %lu us = %.1f%% of the bus.",
+                 I2CportNumber,job->I2CdeviceAddress,job->startRegisterAddress,job->amountOfBytesToRead,(unsigned long)job->period_us,(unsigned long)job->deadline_us,(unsigned long)job->cost_us,100.0*job->cost_us/job->period_us);
+    }
+    for (int i = 0; i < scheduler->jobCount; i++)
+    {
+        uint32_t blocking = 0;      //Longest read of a job with a later deadline (continuous jobs count as "latest") that may have just started when this job is released.
+        if (scheduler->job[i]->period_us == 0) continue;
+        for (int k = 0; k < scheduler->jobCount; k++)
+            if ((scheduler->job[k]->period_us == 0 || scheduler->job[k]->deadline_us > scheduler->job[i]->deadline_us) && scheduler->job[k]->cost_us > blocking) blocking = scheduler->job[k]->cost_us;
+        if (density + (double)blocking / scheduler->job[i]->deadline_us > 1.0) deadlinesGuaranteed = false;
+    }
+
+    ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d] : %d jobs (%d continuous) at %d Hz. Periodic bus load %.1f%%, deadline load %.1f%%.",I2CportNumber,scheduler->jobCount,continuousJobs,SUS_I2C_PortSpeedHz[I2CportNumber & 1],100.0*utilization,100.0*density);
+    if (utilization > 1.0) {
+        ESP_LOGE(I2C_SCHEDULER_TAG,"[I2C PORT %d] : NOT schedulable - the bus would need to be %.0f%% busy. Lower the rates or raise the bus speed.",I2CportNumber,100.0*utilization);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!deadlinesGuaranteed) {
+        ESP_LOGW(I2C_SCHEDULER_TAG,"[I2C PORT %d] : bus load is fine, but some deadlines are too tight to be guaranteed. Expect occasional misses.",I2CportNumber);
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d] : schedulable - all deadlines will be met.",I2CportNumber);
+    return ESP_OK;
+}
+
+//esp_timer callback: wakes up the scheduler task when the next read is due.
+static void SUS_I2C_SchedulerWake(void *parameter)
+{
+    struct SUS_I2C_Scheduler *scheduler = (struct SUS_I2C_Scheduler *)parameter;
+    xTaskNotifyGive(scheduler->task);
+}
+
+//Executes one job right now and updates its statistics.
+static void SUS_I2C_SchedulerRunJob(uint8_t I2CportNumber, struct SUS_I2C_Scheduler *scheduler, struct SUS_I2C_PeriodicJob *job, int64_t now)
+{
+    uint32_t startDelay = (uint32_t)(now - job->nextRelease_us);
+    bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, SUS_I2C_PRIORITY_HIGH) == ESP_OK);    //Jump ahead of bulk transfers on this port (see PRIORITY section).
+    esp_err_t outcome = SUS_I2C_ReadRegisters(I2CportNumber, job->I2CdeviceAddress, job->startRegisterAddress, job->data, job->amountOfBytesToRead);
+    if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);
+    int64_t finish = esp_timer_get_time();
+    int32_t lateness = (job->period_us == 0) ? 0 : (int32_t)(finish - job->absoluteDeadline_us);
+
+    scheduler->busyTime_us += (uint64_t)(finish - now);
+    job->releases++;
+    if (outcome != ESP_OK) job->errors++;
+    if (lateness > 0) job->missedDeadlines++;
+    if (job->period_us != 0 && (job->releases == 1 || lateness > job->maxLateness_us)) job->maxLateness_us = lateness;
+    if (job->releases == 1 || startDelay < job->minStartDelay_us) job->minStartDelay_us = startDelay;
+    if (startDelay > job->maxStartDelay_us) job->maxStartDelay_us = startDelay;
+    job->totalResponse_us += (uint64_t)(finish - job->nextRelease_us);
+
+    if (job->onSample) job->onSample(job, job->data, outcome, now);
+
+    if (job->period_us == 0) {          //Continuous job: "released" again right away, but it goes to the back of the line of the other continuous jobs.
+        job->nextRelease_us = finish;
+        return;
+    }
+    //Plan the next read. If we fell so far behind that the next one is already hopeless, skip it rather than pile up.
+    job->nextRelease_us += job->period_us;
+    while (job->nextRelease_us + job->deadline_us <= finish) {
+        job->nextRelease_us += job->period_us;
+        job->skippedReleases++;
+        job->missedDeadlines++;
+    }
+    job->absoluteDeadline_us = job->nextRelease_us + job->deadline_us;
+}
+
+//The scheduler task: one per I2C port. Runs the released job with the earliest deadline, or sleeps until the next release.
+static void SUS_I2C_SchedulerTask(void *parameter)
+{
+    uint8_t I2CportNumber = (uint8_t)(uintptr_t)parameter;
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber];
+
+    while (scheduler->running)
+    {
+        int64_t now = esp_timer_get_time();
+        int64_t nextWake = INT64_MAX;
+        struct SUS_I2C_PeriodicJob *earliest = NULL;
+
+        for (int i = 0; i < scheduler->jobCount; i++)
+        {
+            struct SUS_I2C_PeriodicJob *job = scheduler->job[i];
+            if (job->nextRelease_us <= now) {
+                if (earliest == NULL || job->absoluteDeadline_us < earliest->absoluteDeadline_us ||
+                   (job->absoluteDeadline_us == earliest->absoluteDeadline_us && job->nextRelease_us < earliest->nextRelease_us)) earliest = job;   //Ties (continuous jobs): longest waiting first.
+            }
+            else if (job->nextRelease_us < nextWake) nextWake = job->nextRelease_us;
+        }
+
+        if (earliest != NULL) {
+            SUS_I2C_SchedulerRunJob(I2CportNumber, scheduler, earliest, now);
+            continue;
+        }
+        if (nextWake != INT64_MAX) esp_timer_start_once(scheduler->wakeTimer, (uint64_t)(nextWake - now));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);    //Sleep until the timer (or SUS_I2C_SchedulerStop) wakes us up.
+    }
+    esp_timer_stop(scheduler->wakeTimer);
+    scheduler->taskFinished = true;
+    vTaskDelete(NULL);
+}
+
+/**SUS_I2C_SchedulerStart: Starts the scheduler task of the given I2C port. All jobs get their first read "offset_us" microseconds from now.
+ * PARAMETER "coreNumber" is the CPU core to run the scheduler task on: 0 or 1 (or tskNO_AFFINITY to let FreeRTOS decide).
+ * PARAMETER "taskPriority" is the FreeRTOS priority of the scheduler task. Should be higher than the tasks that process the data.
+ * RETURNS ESP_OK, or ESP_ERR_INVALID_STATE if it is already running, ESP_ERR_NO_MEM if the task/timer could not be created.
+ * EXAMPLE USE: SUS_I2C_SchedulerStart(0, 1, 10); //Run the scheduler of I2C port 0 on CPU core 1 at priority 10.
+*/
+esp_err_t SUS_I2C_SchedulerStart(uint8_t I2CportNumber, int coreNumber, int taskPriority)
+{
+    const char *I2C_SCHEDULER_TAG = "I2C SCHEDULER";
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber & 1];
+    esp_timer_create_args_t timerConfig = { .callback = SUS_I2C_SchedulerWake, .arg = scheduler, .name = "sus_i2c_sched" };
+
+    if (scheduler->running) return ESP_ERR_INVALID_STATE;
+    if (scheduler->wakeTimer == NULL && esp_timer_create(&timerConfig, &scheduler->wakeTimer) != ESP_OK) return ESP_ERR_NO_MEM;
+
+    scheduler->start_us = esp_timer_get_time();
+    scheduler->busyTime_us = 0;
+    for (int i = 0; i < scheduler->jobCount; i++)
+    {
+        struct SUS_I2C_PeriodicJob *job = scheduler->job[i];
+        job->nextRelease_us = scheduler->start_us + job->offset_us;
+        job->absoluteDeadline_us = (job->period_us == 0) ? INT64_MAX : job->nextRelease_us + job->deadline_us;   //Continuous jobs lose every tie against periodic ones.
+        job->releases = job->errors = job->missedDeadlines = job->skippedReleases = 0;
+        job->minStartDelay_us = job->maxStartDelay_us = 0;
+        job->maxLateness_us = 0;
+        job->totalResponse_us = 0;
+    }
+    scheduler->running = true;
+    scheduler->taskFinished = false;
+    if (xTaskCreatePinnedToCore(SUS_I2C_SchedulerTask, "sus_i2c_sched", 4096, (void *)(uintptr_t)(I2CportNumber & 1), taskPriority, &scheduler->task, coreNumber) != pdPASS) {
+        scheduler->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d] : scheduler started with %d jobs.",I2CportNumber,scheduler->jobCount);
+    return ESP_OK;
+}
+
+/**SUS_I2C_SchedulerStop: Stops the scheduler task of the given I2C port and waits until it's really gone. Jobs and their statistics are kept.
+ * EXAMPLE USE: SUS_I2C_SchedulerStop(0);
+*/
+void SUS_I2C_SchedulerStop(uint8_t I2CportNumber)
+{
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber & 1];
+    if (!scheduler->running) return;
+    scheduler->running = false;
+    xTaskNotifyGive(scheduler->task);
+    while (!scheduler->taskFinished) vTaskDelay(1);
+}
+
+/**SUS_I2C_SchedulerPrintReport: Prints the statistics of every job of the given port: reads, errors, missed deadlines, jitter, response times and the measured bus load.
+ * EXAMPLE USE: SUS_I2C_SchedulerPrintReport(0);
+*/
+void SUS_I2C_SchedulerPrintReport(uint8_t I2CportNumber)
+{
+    const char *I2C_SCHEDULER_TAG = "I2C SCHEDULER";
+    struct SUS_I2C_Scheduler *scheduler = &SUS_I2C_SchedulerPort[I2CportNumber & 1];
+    int64_t elapsed = esp_timer_get_time() - scheduler->start_us;
+
+    for (int i = 0; i < scheduler->jobCount; i++)
+    {
+        struct SUS_I2C_PeriodicJob *job = scheduler->job[i];
+        ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d], [Device %#04x] : %lu reads, %lu errors, %lu missed deadlines (%lu skipped), jitter %lu us, worst lateness %ld us, avg response %lu us.",
+                 I2CportNumber,job->I2CdeviceAddress,(unsigned long)job->releases,(unsigned long)job->errors,(unsigned long)job->missedDeadlines,(unsigned long)job->skippedReleases,
+                 (unsigned long)(job->maxStartDelay_us - job->minStartDelay_us),(long)job->maxLateness_us,(unsigned long)(job->releases ? job->totalResponse_us / job->releases : 0));
+    }
+    if (elapsed > 0)
+        ESP_LOGI(I2C_SCHEDULER_TAG,"[I2C PORT %d] : measured bus load %.1f%% over %.1f s.",I2CportNumber,100.0*scheduler->busyTime_us/elapsed,elapsed/1e6);
+}
+#endif //SUS_I2C_FEATURE_SCHEDULER
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄   ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄               ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌             ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌             ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌             ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌             ▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌             ▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌     ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌             ▐░█▀▀▀▀▀▀▀▀▀ ▐░▌       ▐░▌▐░█▀▀▀▀█░█▀▀      ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌             ▐░▌          ▐░▌       ▐░▌▐░▌     ▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄    ▐░▌          ▐░█▄▄▄▄▄▄▄█░▌▐░▌      ▐░▌      ▐░▌
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌   ▐░▌          ▐░░░░░░░░░░░▌▐░▌       ▐░▌     ▐░▌
+ ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀     ▀            ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀       ▀
+*/
+
+/* DUAL PORT ACQUISITION: uses BOTH I2C controllers and BOTH CPU cores of the ESP32 at the same time.
+ * The normal read functions block until the transaction is over, so one task can only keep one bus busy - and the other controller just sits there.
+ * This engine runs one scheduler task (see SCHEDULE section) per I2C port, each pinned to the CPU core of your choice, so two transactions are on two wires at once.
+ * All the data from both ports ends up in ONE queue of timestamped samples that you read from wherever you like.
+ *      - every device read is an "acquisition job": device address, first register, amount of bytes, and how often (or continuously, as fast as the bus allows).
+ *      - you either tell each job which port its device is on, or say SUS_I2C_ANY_PORT and the engine looks for the device on both ports.
+ *        If the device answers on both (e.g. the same sensor model on both buses, or a bus wired to both controllers), the job goes to the less busy port.
+ *      - timestamps come from esp_timer_get_time(), which is the same clock on both cores, so samples from different ports can be compared directly.
+ *      - samples are delivered when their read FINISHES, so two samples from different ports can arrive in the queue slightly out of timestamp order
+ *        (by at most one transaction time). Sort by timestamp_us if you need strict order.
+ *      - if you don't empty the queue fast enough, new samples are dropped (never waits - that would stall the bus). Every job counts its drops,
+ *        and the per-job sampleNumber has a gap where samples were lost.
+ *
+ * Workflow:
+ *      1. SUS_I2C_Master_Init(0, ...) and SUS_I2C_Master_Init(1, ...)
+ *      2. Fill in a "struct SUS_I2C_AcquisitionJob" for every device (static or global variable!) and SUS_I2C_DualPortAddJob() it.
+ *      3. SUS_I2C_DualPortStart(0, 1, 10, 64); //Port 0 worker on core 0, port 1 worker on core 1, priority 10, room for 64 samples in the queue.
+ *      4. In your own task: while (SUS_I2C_DualPortGetSample(&sample, portMAX_DELAY) == ESP_OK) { ...use sample... }
+ *      5. SUS_I2C_DualPortPrintReport() whenever you want to see how it's going, SUS_I2C_DualPortStop() when done.
+ */
+#define SUS_I2C_ANY_PORT                0xFF                                // "Find the device yourself" value for SUS_I2C_AcquisitionJob.I2CportNumber.
+#define SUS_I2C_DUALPORT_MAX_JOBS       (2 * SUS_I2C_SCHEDULER_MAX_JOBS)    // Maximum amount of acquisition jobs on both ports together.
+
+struct SUS_I2C_Sample
+{
+    int64_t   timestamp_us;                     // When the read started (esp_timer_get_time(), same clock on both cores).
+    uint32_t  sampleNumber;                     // Counts 0,1,2... per job. A gap means samples of this job were dropped because the queue was full.
+    esp_err_t outcome;                          // ESP_OK, or the error of the read (then "data" is garbage).
+    uint8_t   I2CportNumber;                    // Port the read was done on.
+    uint8_t   I2CdeviceAddress;
+    uint8_t   startRegisterAddress;
+    uint8_t   length;                           // Amount of valid bytes in "data".
+    uint8_t   data[SUS_I2C_SCHEDULER_MAX_BURST];
+};
+
+struct SUS_I2C_AcquisitionJob
+{
+    /*----- Filled in by YOU before SUS_I2C_DualPortAddJob -----*/
+    uint8_t  I2CportNumber;                     // 0, 1, or SUS_I2C_ANY_PORT to let the engine find the device (and pick the less busy port if it's on both).
+    uint8_t  I2CdeviceAddress;                  // Device to read from.
+    uint8_t  startRegisterAddress;              // First register of the burst read.
+    uint8_t  amountOfBytesToRead;               // 1 - SUS_I2C_SCHEDULER_MAX_BURST.
+    uint32_t period_us;                         // How often to read, in microseconds. 0 = continuously, as fast as the bus allows.
+    uint32_t deadline_us;                       // Same as in struct SUS_I2C_PeriodicJob. 0 = same as the period.
+
+    /*----- Filled in by the ENGINE. Read them, don't write them. -----*/
+    uint8_t  assignedPort;                      // Port the job runs on. SUS_I2C_ANY_PORT = device was not found, job is not running.
+    uint32_t samples;                           // Reads done.
+    uint32_t dropped;                           // Of those: samples that did not fit into the queue.
+    struct SUS_I2C_PeriodicJob periodic;        // The scheduler job doing the actual work (its statistics are in there too).
+};
+
+struct SUS_I2C_DualPortEngine
+{
+    struct SUS_I2C_AcquisitionJob *job[SUS_I2C_DUALPORT_MAX_JOBS];
+    int jobCount;
+    bool running;
+    QueueHandle_t sampleQueue;                  // The merged stream of samples from both ports.
+    int64_t start_us;
+};
+#if SUS_I2C_FEATURE_DUAL_PORT
+static struct SUS_I2C_DualPortEngine SUS_I2C_DualPort;
+
+/**SUS_I2C_DualPortAddJob: Adds a device read to the dual port engine. Only possible while the engine is stopped.
+ * The engine stores a POINTER to your job struct, so it must stay alive (global or static variable, not a local one!).
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG if the job makes no sense, ESP_ERR_NO_MEM if there are already SUS_I2C_DUALPORT_MAX_JOBS jobs, ESP_ERR_INVALID_STATE if the engine is running.
+ * EXAMPLE USE: static struct SUS_I2C_AcquisitionJob imu = {.I2CportNumber=SUS_I2C_ANY_PORT, .I2CdeviceAddress=0x68, .startRegisterAddress=0x3B, .amountOfBytesToRead=14, .period_us=0};
+ *              SUS_I2C_DualPortAddJob(&imu); //Read all 14 data bytes of an MPU6050 as fast as possible, from whichever port it's connected to.
+*/
+esp_err_t SUS_I2C_DualPortAddJob(struct SUS_I2C_AcquisitionJob *job)
+{
+    const char *I2C_DUALPORT_TAG = "I2C DUAL PORT";
+
+    if (job == NULL || job->amountOfBytesToRead == 0 || job->amountOfBytesToRead > SUS_I2C_SCHEDULER_MAX_BURST || (job->I2CportNumber > 1 && job->I2CportNumber != SUS_I2C_ANY_PORT)) {
+        ESP_LOGE(I2C_DUALPORT_TAG,"job rejected - port must be 0, 1 or SUS_I2C_ANY_PORT and burst length 1-%d bytes.",SUS_I2C_SCHEDULER_MAX_BURST);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (SUS_I2C_DualPort.running) return ESP_ERR_INVALID_STATE;
+    if (SUS_I2C_DualPort.jobCount >= SUS_I2C_DUALPORT_MAX_JOBS) return ESP_ERR_NO_MEM;
+    job->assignedPort = SUS_I2C_ANY_PORT;
+    SUS_I2C_DualPort.job[SUS_I2C_DualPort.jobCount++] = job;
+    return ESP_OK;
+}
+
+//Scheduler "onSample" callback of every acquisition job: packs the read into a sample and puts it into the merged queue. Runs in the scheduler task of the port.
+static void SUS_I2C_DualPortCollect(struct SUS_I2C_PeriodicJob *periodic, const uint8_t *data, esp_err_t outcome, int64_t timestamp_us)
+{
+    struct SUS_I2C_AcquisitionJob *job = (struct SUS_I2C_AcquisitionJob *)periodic->userContext;
+    struct SUS_I2C_Sample sample;
+
+    sample.timestamp_us = timestamp_us;
+    sample.sampleNumber = job->samples++;
+    sample.outcome = outcome;
+    sample.I2CportNumber = job->assignedPort;
+    sample.I2CdeviceAddress = job->I2CdeviceAddress;
+    sample.startRegisterAddress = job->startRegisterAddress;
+    sample.length = job->amountOfBytesToRead;
+    memcpy(sample.data, data, job->amountOfBytesToRead);
+    if (xQueueSend(SUS_I2C_DualPort.sampleQueue, &sample, 0) != pdTRUE) job->dropped++;     //Never wait here - the bus would stand still meanwhile.
+}
+
+//Is the job's device answering on this port? Reads one byte of its first register - harmless for register-based devices, and it's what the job will do anyway.
+//Goes straight to the driver, so a device that is NOT on this port doesn't spam the log with read errors.
+static bool SUS_I2C_DualPortProbe(uint8_t I2CportNumber, struct SUS_I2C_AcquisitionJob *job)
+{
+    uint8_t dummy;
+    if (SUS_I2C_PortSpeedHz[I2CportNumber] == 0) return false;     //Port was never initialized.
+    return i2c_master_write_read_device(I2CportNumber, job->I2CdeviceAddress, &job->startRegisterAddress, 1, &dummy, 1, 10/portTICK_PERIOD_MS) == ESP_OK;
+}
+
+/**SUS_I2C_DualPortStop: Stops both port tasks and takes the jobs back out of the port schedulers. Samples still in the queue can be read out afterwards.
+ * EXAMPLE USE: SUS_I2C_DualPortStop();
+*/
+void SUS_I2C_DualPortStop(void)
+{
+    struct SUS_I2C_DualPortEngine *engine = &SUS_I2C_DualPort;
+    if (!engine->running) return;
+    SUS_I2C_SchedulerStop(0);
+    SUS_I2C_SchedulerStop(1);
+    for (int i = 0; i < engine->jobCount; i++)
+        if (engine->job[i]->assignedPort != SUS_I2C_ANY_PORT) SUS_I2C_SchedulerRemoveJob(engine->job[i]->assignedPort, &engine->job[i]->periodic);
+    engine->running = false;
+}
+
+/**SUS_I2C_DualPortStart: Finds the devices of all SUS_I2C_ANY_PORT jobs, spreads the jobs over the two ports, and starts one scheduler task per port that has jobs.
+ * Jobs that could go on either port are placed so that both buses end up about equally busy:
+ *      - periodic jobs go to the port with the lower periodic bus load,
+ *      - continuous jobs go to the port where they would get read most often (least continuous traffic per leftover bus time).
+ * PARAMETER "coreForPort0" / "coreForPort1" are the CPU cores (0 or 1, or tskNO_AFFINITY) for the tasks of I2C port 0 and 1. Put them on different cores.
+ * PARAMETER "taskPriority" is the FreeRTOS priority of both tasks.
+ * PARAMETER "sampleQueueLength" is how many samples the merged queue can hold before new ones get dropped.
+ * RETURNS ESP_OK, ESP_ERR_NOT_FOUND if not a single job could be placed, ESP_ERR_NO_MEM if the queue/tasks could not be created, ESP_ERR_INVALID_STATE if already running.
+ * EXAMPLE USE: SUS_I2C_DualPortStart(0, 1, 10, 64);
+*/
+esp_err_t SUS_I2C_DualPortStart(int coreForPort0, int coreForPort1, int taskPriority, size_t sampleQueueLength)
+{
+    const char *I2C_DUALPORT_TAG = "I2C DUAL PORT";
+    struct SUS_I2C_DualPortEngine *engine = &SUS_I2C_DualPort;
+    double periodicLoad[2] = {0, 0};            //Sum of (read time / period) of the periodic jobs on each port.
+    double continuousRound_us[2] = {0, 0};      //Bus time needed to read every continuous job of each port once.
+    int placedJobs[2] = {0, 0};
+    int coreNumber[2] = {coreForPort0, coreForPort1};
+
+    if (engine->running) return ESP_ERR_INVALID_STATE;
+    if (engine->sampleQueue != NULL) vQueueDelete(engine->sampleQueue);     //Fresh queue, so old samples don't mix with the new run.
+    engine->sampleQueue = xQueueCreate(sampleQueueLength, sizeof(struct SUS_I2C_Sample));
+    if (engine->sampleQueue == NULL) return ESP_ERR_NO_MEM;
+
+    //Pass 1: jobs with a fixed port. Pass 2: periodic SUS_I2C_ANY_PORT jobs. Pass 3: continuous SUS_I2C_ANY_PORT jobs, which fill whatever is left.
+    for (int pass = 1; pass <= 3; pass++)
+    {
+        for (int i = 0; i < engine->jobCount; i++)
+        {
+            struct SUS_I2C_AcquisitionJob *job = engine->job[i];
+            bool anyPort = (job->I2CportNumber == SUS_I2C_ANY_PORT);
+            uint8_t port;
+
+            if ((pass == 1) == anyPort) continue;
+            if (pass == 2 && job->period_us == 0) continue;
+            if (pass == 3 && job->period_us != 0) continue;
+
+            if (!anyPort) port = job->I2CportNumber;
+            else {
+                bool onPort0 = SUS_I2C_DualPortProbe(0, job), onPort1 = SUS_I2C_DualPortProbe(1, job);
+                if (!onPort0 && !onPort1) {
+                    ESP_LOGE(I2C_DUALPORT_TAG,"[Device %#04x] : not found on any I2C port, job not started.",job->I2CdeviceAddress);
+                    job->assignedPort = SUS_I2C_ANY_PORT;
+                    continue;
+                }
+                if (onPort0 && onPort1) {
+                    double cost = SUS_I2C_BusTime_us(0, 3 + job->amountOfBytesToRead, 2);
+                    if (job->period_us != 0) port = (periodicLoad[1] < periodicLoad[0]) ? 1 : 0;
+                    else port = ((continuousRound_us[1] + cost) * (1.0 - periodicLoad[0]) < (continuousRound_us[0] + cost) * (1.0 - periodicLoad[1])) ? 1 : 0;
+                }
+                else port = onPort1 ? 1 : 0;
+            }
+
+            memset(&job->periodic, 0, sizeof(job->periodic));
+            job->periodic.I2CdeviceAddress = job->I2CdeviceAddress;
+            job->periodic.startRegisterAddress = job->startRegisterAddress;
+            job->periodic.amountOfBytesToRead = job->amountOfBytesToRead;
+            job->periodic.period_us = job->period_us;
+            job->periodic.deadline_us = job->deadline_us;
+            job->periodic.onSample = SUS_I2C_DualPortCollect;
+            job->periodic.userContext = job;
+            job->samples = job->dropped = 0;
+            if (SUS_I2C_SchedulerAddJob(port, &job->periodic) != ESP_OK) {
+                ESP_LOGE(I2C_DUALPORT_TAG,"[I2C PORT %d], [Device %#04x] : no room for the job on this port, job not started.",port,job->I2CdeviceAddress);
+                job->assignedPort = SUS_I2C_ANY_PORT;
+                continue;
+            }
+            job->assignedPort = port;
+            placedJobs[port]++;
+            if (job->period_us != 0) periodicLoad[port] += (double)job->periodic.cost_us / job->period_us;
+            else continuousRound_us[port] += job->periodic.cost_us;
+            ESP_LOGI(I2C_DUALPORT_TAG,"[I2C PORT %d], [Device %#04x] : job placed%s.",port,job->I2CdeviceAddress,anyPort ? " automatically" : "");
+        }
+    }
+    if (placedJobs[0] + placedJobs[1] == 0) return ESP_ERR_NOT_FOUND;
+
+    engine->start_us = esp_timer_get_time();
+    engine->running = true;
+    for (uint8_t port = 0; port < 2; port++)
+    {
+        if (placedJobs[port] == 0) continue;
+        SUS_I2C_SchedulerCheck(port);       //Only prints the numbers - the engine runs anyway.
+        if (SUS_I2C_SchedulerStart(port, coreNumber[port], taskPriority) != ESP_OK) {
+            SUS_I2C_DualPortStop();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ESP_LOGI(I2C_DUALPORT_TAG,"started: %d jobs on port 0 (core %d), %d jobs on port 1 (core %d).",placedJobs[0],coreForPort0,placedJobs[1],coreForPort1);
+    return ESP_OK;
+}
+
+/**SUS_I2C_DualPortGetSample: Takes the next sample out of the merged queue of both ports.
+ * PARAMETER "ticksToWait" is how long to wait for a sample if the queue is empty. 0 = don't wait, portMAX_DELAY = wait forever.
+ * RETURNS ESP_OK and fills in "sample", or ESP_ERR_TIMEOUT if no sample came in time, ESP_ERR_INVALID_STATE if the engine was never started.
+ * EXAMPLE USE: struct SUS_I2C_Sample sample;
+ *              if (SUS_I2C_DualPortGetSample(&sample, 100/portTICK_PERIOD_MS) == ESP_OK) printf("%#04x: %d\n", sample.I2CdeviceAddress, sample.data[0]);
+*/
+esp_err_t SUS_I2C_DualPortGetSample(struct SUS_I2C_Sample *sample, TickType_t ticksToWait)
+{
+    if (SUS_I2C_DualPort.sampleQueue == NULL) return ESP_ERR_INVALID_STATE;
+    if (xQueueReceive(SUS_I2C_DualPort.sampleQueue, sample, ticksToWait) != pdTRUE) return ESP_ERR_TIMEOUT;
+    return ESP_OK;
+}
+
+/**SUS_I2C_DualPortPrintReport: Prints samples/s and drops for every job and for each port, plus the scheduler reports of both ports.
+ * EXAMPLE USE: SUS_I2C_DualPortPrintReport();
+*/
+void SUS_I2C_DualPortPrintReport(void)
+{
+    const char *I2C_DUALPORT_TAG = "I2C DUAL PORT";
+    struct SUS_I2C_DualPortEngine *engine = &SUS_I2C_DualPort;
+    double elapsed = (esp_timer_get_time() - engine->start_us) / 1e6;
+    uint32_t portSamples[2] = {0, 0}, portDropped[2] = {0, 0};
+
+    if (elapsed <= 0) return;
+    for (int i = 0; i < engine->jobCount; i++)
+    {
+        struct SUS_I2C_AcquisitionJob *job = engine->job[i];
+        if (job->assignedPort == SUS_I2C_ANY_PORT) {
+            ESP_LOGI(I2C_DUALPORT_TAG,"[Device %#04x] : not running (device not found or no room).",job->I2CdeviceAddress);
+            continue;
+        }
+        portSamples[job->assignedPort] += job->samples;
+        portDropped[job->assignedPort] += job->dropped;
+        ESP_LOGI(I2C_DUALPORT_TAG,"[I2C PORT %d], [Device %#04x] : %lu samples (%.0f/s), %lu dropped, %lu errors.",
+                 job->assignedPort,job->I2CdeviceAddress,(unsigned long)job->samples,job->samples/elapsed,(unsigned long)job->dropped,(unsigned long)job->periodic.errors);
+    }
+    for (uint8_t port = 0; port < 2; port++)
+    {
+        if (portSamples[port] == 0) continue;
+        SUS_I2C_SchedulerPrintReport(port);
+        ESP_LOGI(I2C_DUALPORT_TAG,"[I2C PORT %d] : %.0f samples/s, %lu dropped.",port,portSamples[port]/elapsed,(unsigned long)portDropped[port]);
+    }
+    ESP_LOGI(I2C_DUALPORT_TAG,"both ports together: %.0f samples/s over %.1f s.",(portSamples[0]+portSamples[1])/elapsed,elapsed);
+}
+#endif //SUS_I2C_FEATURE_DUAL_PORT
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄       ▄▄  ▄▄▄▄▄▄▄▄▄▄   ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░▌     ▐░░▌▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░▌░▌   ▐░▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌▐░▌ ▐░▌▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░▌ ▐░▐░▌ ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀█░▌▐░▌   ▀   ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌ ▀▀▀▀▀▀▀▀▀█░▌
+          ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌          ▐░▌
+ ▄▄▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌ ▄▄▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* SMBUS: the "System Management Bus" protocol on top of I2C, spoken by batteries, fuel gauges, power supplies, fan controllers, PMICs...
+ * SMBus devices use a fixed set of transaction shapes ("commands"):
+ *      Quick           - just the address, the R/W bit IS the data (on/off style devices)
+ *      Send/Receive    - one byte, no command code
+ *      Write/Read Byte - command code + one byte
+ *      Write/Read Word - command code + two bytes, LOW byte first
+ *      Process Call    - command code + a word written, a word read back in the same transaction
+ *      Block Write/Read- command code + a COUNT byte + that many bytes (up to 32)
+ * Most of them can be protected by PEC ("Packet Error Checking"): one extra CRC-8 byte at the end, computed over EVERY byte of the transaction
+ * including the address bytes. It costs exactly one byte on the wire and replaces read-back checks (see SUS_I2C_WriteToRegister_EX) that double the bus time:
+ *      - writes: the device checks the PEC we append and NACKs it if it's wrong -> the write function returns ESP_FAIL. No read-back needed.
+ *      - reads: the device appends a PEC and we check it -> ESP_ERR_INVALID_CRC if the data got mangled on the way.
+ * The CRC is worked out with a 256-entry lookup table: one table look-up per byte, computed as the bytes are laid out (no second pass, no bit loops).
+ * Only use PEC with devices that support it (datasheet: "PEC" or "SMBus 1.1/2.0 with packet error checking") - others will NACK or ignore the extra byte.
+ */
+#define SUS_I2C_SMBUS_BLOCK_MAX         32      // Longest block allowed by SMBus 2.0.
+
+//CRC-8 lookup table for PEC: polynomial x^8 + x^2 + x + 1 (0x07), initial value 0. Entry i = CRC of the single byte i.
+#if SUS_I2C_FEATURE_SMBUS
+static const uint8_t SUS_I2C_PecTable[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+
+/**SUS_I2C_PecUpdate: Continues a PEC calculation over more bytes. Start with crc = 0, feed it every byte of the transaction in order (address bytes included).
+ * RETURNS the updated PEC.
+ * EXAMPLE USE: uint8_t pec = SUS_I2C_PecUpdate(0, &addressByte, 1); pec = SUS_I2C_PecUpdate(pec, data, length);
+*/
+uint8_t SUS_I2C_PecUpdate(uint8_t crc, const uint8_t *data, size_t length)
+{
+    while (length--) crc = SUS_I2C_PecTable[crc ^ *data++];
+    return crc;
+}
+
+/**SUS_I2C_SMBusTransfer: The one transaction behind all the SMBus commands below: writes "writeData" (command code + data), then - if readLength > 0 - a REPEATED START and reads "readLength" bytes.
+ * If writeLength is 0, the transaction starts straight with the read (SMBus "Receive Byte").
+ * PARAMETER "usePec": true = append PEC to the write part (if there is no read part) or check the PEC at the end of the read part.
+ * RETURNS ESP_OK, ESP_FAIL if the device NACKed (wrong address, or it rejected our PEC), ESP_ERR_INVALID_CRC if the PEC of the read data is wrong, other ESP-IDF errors on bus trouble.
+ * EXAMPLE USE: uint8_t command = 0x09, voltage[2]; SUS_I2C_SMBusTransfer(0, 0x0B, &command, 1, voltage, 2, true); //Same as SUS_I2C_SMBusReadWord.
+*/
+esp_err_t SUS_I2C_SMBusTransfer(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, const uint8_t *writeData, size_t writeLength, uint8_t *readData, size_t readLength, bool usePec)
+{
+    const char *I2C_SMBUS_TAG = "I2C SMBUS";
+    esp_err_t outcome;
+    uint8_t addressWrite = (I2CdeviceAddress << 1) | I2C_MASTER_WRITE;
+    uint8_t addressRead = (I2CdeviceAddress << 1) | I2C_MASTER_READ;
+    uint8_t readPlusPec[SUS_I2C_SMBUS_BLOCK_MAX + 3] = {0}; //Read data + PEC byte land here first; zeroed so a failed read traces zeros.
+    uint8_t pec = 0;
+
+    if (writeLength == 0 && readLength == 0) return ESP_ERR_INVALID_ARG;
+    if (readLength > sizeof(readPlusPec) - 1) return ESP_ERR_INVALID_SIZE;
+    size_t wireBytes = (writeLength > 0 ? 1 + writeLength + (readLength == 0 && usePec ? 1 : 0) : 0) + (readLength > 0 ? 1 + readLength + (usePec ? 1 : 0) : 0);
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    if (writeLength > 0) {
+        pec = SUS_I2C_PecUpdate(pec, &addressWrite, 1);
+        pec = SUS_I2C_PecUpdate(pec, writeData, writeLength);
+        i2c_master_write_byte(cmd, addressWrite, true);
+        i2c_master_write(cmd, writeData, writeLength, true);
+        if (readLength == 0) {
+            if (usePec) i2c_master_write_byte(cmd, pec, true);     //The device ACKs the PEC only if it matches - that's the whole verification.
+        }
+        else i2c_master_start(cmd);     //REPEATED START
+    }
+    if (readLength > 0) {
+        pec = SUS_I2C_PecUpdate(pec, &addressRead, 1);
+        i2c_master_write_byte(cmd, addressRead, true);
+        i2c_master_read(cmd, readPlusPec, readLength + (usePec ? 1 : 0), I2C_MASTER_LAST_NACK);
+    }
+    i2c_master_stop(cmd);
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, wireBytes, (writeLength > 0) + (readLength > 0));
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmd, 10/portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, readLength == 0 ? SUS_I2C_TRACE_WRITE : (writeLength == 0 ? SUS_I2C_TRACE_READ : SUS_I2C_TRACE_WRITE_READ),
+                        writeData, writeLength, readPlusPec, readLength, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+
+    if (outcome != ESP_OK) {
+        ESP_LOGE(I2C_SMBUS_TAG,"[I2C PORT %d], [Device %#04x] : SMBus transaction FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,outcome);
+        return outcome;
+    }
+    if (readLength > 0) {
+        if (usePec && SUS_I2C_PecUpdate(pec, readPlusPec, readLength) != readPlusPec[readLength]) {
+            ESP_LOGE(I2C_SMBUS_TAG,"[I2C PORT %d], [Device %#04x] : PEC mismatch - the data got corrupted on the bus.",I2CportNumber,I2CdeviceAddress);
+            return ESP_ERR_INVALID_CRC;
+        }
+        memcpy(readData, readPlusPec, readLength);
+    }
+    return ESP_OK;
+}
+
+/**SUS_I2C_SMBusQuick: SMBus Quick Command - just the address, the R/W bit is the "data" (e.g. turns a device on/off). No PEC possible.
+ * EXAMPLE USE: SUS_I2C_SMBusQuick(0, 0x2C, false); //Quick Write to device 0x2C.
+*/
+esp_err_t SUS_I2C_SMBusQuick(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, bool readBit)
+{
+    esp_err_t outcome;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (I2CdeviceAddress << 1) | (readBit ? I2C_MASTER_READ : I2C_MASTER_WRITE), true);
+    i2c_master_stop(cmd);
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 1, 1);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmd, 10/portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, readBit ? SUS_I2C_TRACE_READ : SUS_I2C_TRACE_WRITE, NULL, 0, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    return outcome;
+}
+
+/**SUS_I2C_SMBusSendByte / SUS_I2C_SMBusReceiveByte: one data byte, no command code.
+ * EXAMPLE USE: uint8_t status; SUS_I2C_SMBusReceiveByte(0, 0x0C, &status, true);
+*/
+esp_err_t SUS_I2C_SMBusSendByte(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t value, bool usePec)
+{
+    return SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, &value, 1, NULL, 0, usePec);
+}
+
+esp_err_t SUS_I2C_SMBusReceiveByte(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t *value, bool usePec)
+{
+    return SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, NULL, 0, value, 1, usePec);
+}
+
+/**SUS_I2C_SMBusWriteByte / SUS_I2C_SMBusReadByte: command code + one data byte.
+ * EXAMPLE USE: SUS_I2C_SMBusWriteByte(0, 0x2F, 0x01, 0x80, true); //Write 0x80 with command 0x01, PEC-protected.
+*/
+esp_err_t SUS_I2C_SMBusWriteByte(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, uint8_t value, bool usePec)
+{
+    uint8_t writeData[2] = {command, value};
+    return SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, writeData, 2, NULL, 0, usePec);
+}
+
+esp_err_t SUS_I2C_SMBusReadByte(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, uint8_t *value, bool usePec)
+{
+    return SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, &command, 1, value, 1, usePec);
+}
+
+/**SUS_I2C_SMBusWriteWord / SUS_I2C_SMBusReadWord: command code + a 16-bit word. SMBus sends the LOW byte first - handled here, you get a normal uint16_t.
+ * EXAMPLE USE: uint16_t millivolts; SUS_I2C_SMBusReadWord(0, 0x0B, 0x09, &millivolts, true); //Smart battery "Voltage()" command.
+*/
+esp_err_t SUS_I2C_SMBusWriteWord(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, uint16_t value, bool usePec)
+{
+    uint8_t writeData[3] = {command, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+    return SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, writeData, 3, NULL, 0, usePec);
+}
+
+esp_err_t SUS_I2C_SMBusReadWord(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, uint16_t *value, bool usePec)
+{
+    uint8_t readData[2];
+    esp_err_t outcome = SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, &command, 1, readData, 2, usePec);
+    if (outcome == ESP_OK) *value = (uint16_t)(readData[0] | (readData[1] << 8));
+    return outcome;
+}
+
+/**SUS_I2C_SMBusProcessCall: writes a word and reads the device's answer word back, in ONE transaction.
+ * EXAMPLE USE: uint16_t answer; SUS_I2C_SMBusProcessCall(0, 0x2F, 0x30, 0x1234, &answer, true);
+*/
+esp_err_t SUS_I2C_SMBusProcessCall(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, uint16_t value, uint16_t *answer, bool usePec)
+{
+    uint8_t writeData[3] = {command, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+    uint8_t readData[2];
+    esp_err_t outcome = SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, writeData, 3, readData, 2, usePec);
+    if (outcome == ESP_OK) *answer = (uint16_t)(readData[0] | (readData[1] << 8));
+    return outcome;
+}
+
+/**SUS_I2C_SMBusBlockWrite: command code + count byte + "length" bytes (1 - SUS_I2C_SMBUS_BLOCK_MAX).
+ * EXAMPLE USE: uint8_t name[4] = {'T','E','S','T'}; SUS_I2C_SMBusBlockWrite(0, 0x0B, 0x20, name, 4, true);
+*/
+esp_err_t SUS_I2C_SMBusBlockWrite(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, const uint8_t *data, uint8_t length, bool usePec)
+{
+    uint8_t writeData[SUS_I2C_SMBUS_BLOCK_MAX + 2];
+    if (length == 0 || length > SUS_I2C_SMBUS_BLOCK_MAX) return ESP_ERR_INVALID_SIZE;
+    writeData[0] = command;
+    writeData[1] = length;
+    memcpy(&writeData[2], data, length);
+    return SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, writeData, length + 2, NULL, 0, usePec);
+}
+
+/**SUS_I2C_SMBusBlockRead: command code, then the device answers with a count byte and that many bytes.
+ * The I2C driver has to know how many bytes to read BEFORE the transaction starts, but the count only arrives during it.
+ * So this reads count + "bufferSize" bytes (+ PEC) in one go and then uses the count: pass the size you EXPECT (datasheet), not a huge buffer, to keep it quick.
+ * Bytes the device sends after its block are simply ignored. The PEC is taken from right after the block, wherever that ends up.
+ * PARAMETER "length" receives the amount of bytes the device actually sent.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_SIZE if the device wants to send more than bufferSize, ESP_ERR_INVALID_CRC on a PEC mismatch, or the bus error.
+ * EXAMPLE USE: uint8_t name[21]; uint8_t nameLength; SUS_I2C_SMBusBlockRead(0, 0x0B, 0x20, name, sizeof(name), &nameLength, true); //Smart battery ManufacturerName().
+*/
+esp_err_t SUS_I2C_SMBusBlockRead(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t command, uint8_t *buffer, uint8_t bufferSize, uint8_t *length, bool usePec)
+{
+    const char *I2C_SMBUS_TAG = "I2C SMBUS";
+    uint8_t readData[SUS_I2C_SMBUS_BLOCK_MAX + 2];      //Count + block + PEC.
+    uint8_t header[3] = {(I2CdeviceAddress << 1) | I2C_MASTER_WRITE, command, (I2CdeviceAddress << 1) | I2C_MASTER_READ};
+    esp_err_t outcome;
+
+    if (bufferSize == 0 || bufferSize > SUS_I2C_SMBUS_BLOCK_MAX) return ESP_ERR_INVALID_SIZE;
+    outcome = SUS_I2C_SMBusTransfer(I2CportNumber, I2CdeviceAddress, &command, 1, readData, 1 + bufferSize + (usePec ? 1 : 0), false);  //PEC is checked below - its position depends on the count.
+    if (outcome != ESP_OK) return outcome;
+
+    uint8_t count = readData[0];
+    if (count == 0 || count > bufferSize) {
+        ESP_LOGE(I2C_SMBUS_TAG,"[I2C PORT %d], [Device %#04x] : block of %d bytes does not fit the %d byte buffer.",I2CportNumber,I2CdeviceAddress,count,bufferSize);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (usePec && SUS_I2C_PecUpdate(SUS_I2C_PecUpdate(0, header, 3), readData, 1 + count) != readData[1 + count]) {
+        ESP_LOGE(I2C_SMBUS_TAG,"[I2C PORT %d], [Device %#04x] : PEC mismatch - the data got corrupted on the bus.",I2CportNumber,I2CdeviceAddress);
+        return ESP_ERR_INVALID_CRC;
+    }
+    memcpy(buffer, &readData[1], count);
+    *length = count;
+    return ESP_OK;
+}
+#endif //SUS_I2C_FEATURE_SMBUS
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄     ▄▄       ▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌   ▐░░▌     ▐░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌   ▐░▌░▌   ▐░▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌
+▐░▌       ▐░▌▐░▌          ▐░▌               ▐░▌     ▐░▌               ▐░▌     ▐░▌          ▐░▌       ▐░▌   ▐░▌▐░▌ ▐░▌▐░▌▐░▌       ▐░▌▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░▌ ▄▄▄▄▄▄▄▄      ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌   ▐░▌ ▐░▐░▌ ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌▐░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌   ▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░▌ ▀▀▀▀▀▀█░▌     ▐░▌      ▀▀▀▀▀▀▀▀▀█░▌     ▐░▌     ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀█░█▀▀    ▐░▌   ▀   ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌     ▐░▌  ▐░▌          ▐░▌       ▐░▌     ▐░▌               ▐░▌     ▐░▌     ▐░▌          ▐░▌     ▐░▌     ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌
+▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌ ▄▄▄▄█░█▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌     ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌      ▐░▌    ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌
+▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌▐░▌       ▐░▌   ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌
+ ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀       ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀     ▀         ▀  ▀         ▀  ▀
+*/
+
+/* REGISTER MAPS: describe a device's registers ONCE, get typed read/write functions and bus-efficient reads for free.
+ * Instead of sprinkling magic numbers like SUS_I2C_ReadRegister(0,0x68,0x3B) all over a driver, you write a list of the device's registers:
+ * name, address, C type (uint8_t/int16_t/uint32_t... - the size of the type is the register width), and flags:
+ *      SUS_I2C_REG_READ / _WRITE   - what you may do with it (SUS_I2C_REG_RO / _RW / _WO for short). Writes to read-only registers are refused without touching the bus.
+ *      SUS_I2C_REG_VOLATILE        - the device changes it by itself (measurements, status). Everything else is CACHED: read once, then served from RAM.
+ *      SUS_I2C_REG_BIG_ENDIAN      - multi-byte register sends its most significant byte first (most sensors do). Without it: least significant byte first.
+ *      SUS_I2C_REG_READ_CLEARS     - reading it has a side effect (clears interrupt flags, pops a FIFO). Never read "by accident" as part of a bigger burst.
+ * Optionally also the bit-fields inside registers: name, register, lowest bit, amount of bits.
+ * One SUS_I2C_DEFINE_DEVICE_MAP line then generates (with the C preprocessor - nothing to install, nothing to run):
+ *      - an enum with one ID per register (MPU6050_ACCEL_XOUT...) and per field (MPU6050_FIELD_FS_SEL...)
+ *      - the constant tables describing them (live in flash, cost no RAM)
+ *      - typed functions: MPU6050_Read_ACCEL_XOUT(&imu, &int16Value), MPU6050_Write_SMPLRT_DIV(&imu, 9), MPU6050_Set_FS_SEL(&imu, 3)...
+ *      - MPU6050_Init(&imu, port, address) to bind the map to a real device.
+ * Reading SEVERAL registers with SUS_I2C_MapReadMany() is where the map pays off: the library works out an access plan -
+ * cached registers cost nothing, neighbouring registers are merged into one burst read (even across small gaps, if the bytes in the gap are safe to read),
+ * and only what's left goes on the bus. SUS_I2C_MapPrintPlan() shows you the plan.
+ *
+ * EXAMPLE (MPU6050):
+ *      #define MPU6050_REGISTERS(REG) \
+ *          REG(MPU6050, SMPLRT_DIV,   0x19, uint8_t, SUS_I2C_REG_RW) \
+ *          REG(MPU6050, GYRO_CONFIG,  0x1B, uint8_t, SUS_I2C_REG_RW) \
+ *          REG(MPU6050, ACCEL_CONFIG, 0x1C, uint8_t, SUS_I2C_REG_RW) \
+ *          REG(MPU6050, INT_STATUS,   0x3A, uint8_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_READ_CLEARS) \
+ *          REG(MPU6050, ACCEL_XOUT,   0x3B, int16_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_BIG_ENDIAN) \
+ *          REG(MPU6050, ACCEL_YOUT,   0x3D, int16_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_BIG_ENDIAN) \
+ *          REG(MPU6050, ACCEL_ZOUT,   0x3F, int16_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_BIG_ENDIAN) \
+ *          REG(MPU6050, TEMP_OUT,     0x41, int16_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_BIG_ENDIAN) \
+ *          REG(MPU6050, GYRO_XOUT,    0x43, int16_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_BIG_ENDIAN) \
+ *          REG(MPU6050, PWR_MGMT_1,   0x6B, uint8_t, SUS_I2C_REG_RW) \
+ *          REG(MPU6050, WHO_AM_I,     0x75, uint8_t, SUS_I2C_REG_RO)
+ *      #define MPU6050_FIELDS(FIELD) \
+ *          FIELD(MPU6050, FS_SEL,     GYRO_CONFIG,  3, 2) \
+ *          FIELD(MPU6050, AFS_SEL,    ACCEL_CONFIG, 3, 2) \
+ *          FIELD(MPU6050, SLEEP,      PWR_MGMT_1,   6, 1)
+ *      SUS_I2C_DEFINE_DEVICE_MAP(MPU6050, MPU6050_REGISTERS, MPU6050_FIELDS, 0x00)
+ *
+ *      struct SUS_I2C_Device imu;
+ *      MPU6050_Init(&imu, 0, 0x68);
+ *      MPU6050_Set_SLEEP(&imu, 0);                   //Read-modify-write of PWR_MGMT_1, only the SLEEP bit changes.
+ *      uint8_t ids[3] = {MPU6050_ACCEL_XOUT, MPU6050_ACCEL_ZOUT, MPU6050_GYRO_XOUT};
+ *      uint32_t raw[3];
+ *      SUS_I2C_MapReadMany(&imu, ids, 3, raw);       //ONE 10-byte burst from 0x3B (the gaps in between are plain data registers, safe to read).
+ */
+#define SUS_I2C_REG_READ                0x01    // Can be read.
+#define SUS_I2C_REG_WRITE               0x02    // Can be written.
+#define SUS_I2C_REG_VOLATILE            0x04    // Changed by the device itself - never served from the cache.
+#define SUS_I2C_REG_BIG_ENDIAN          0x08    // Most significant byte at the lowest address.
+#define SUS_I2C_REG_READ_CLEARS         0x10    // Reading it has side effects - only read when asked for.
+#define SUS_I2C_REG_RO                  (SUS_I2C_REG_READ)
+#define SUS_I2C_REG_WO                  (SUS_I2C_REG_WRITE)
+#define SUS_I2C_REG_RW                  (SUS_I2C_REG_READ | SUS_I2C_REG_WRITE)
+
+#define SUS_I2C_MAP_MAX_REGISTERS       64      // Maximum amount of registers in one device map.
+#define SUS_I2C_MAP_MAX_BURST           32      // Longest burst the access planner will build.
+#define SUS_I2C_MAP_MAX_GAP             3       // Merge two reads if at most this many unwanted bytes lie in between. A separate read costs ~3 bytes (address, register, address) + a START anyway.
+
+struct SUS_I2C_RegisterInfo
+{
+    const char *name;
+    uint8_t address;                            // Register address (of the lowest byte, for multi-byte registers).
+    uint8_t width;                              // 1 - 4 bytes.
+    uint8_t flags;                              // SUS_I2C_REG_... flags.
+};
+
+struct SUS_I2C_FieldInfo
+{
+    const char *name;
+    uint8_t registerId;                         // Register the field lives in.
+    uint8_t shift;                              // Lowest bit of the field.
+    uint8_t bits;                               // Amount of bits.
+};
+
+struct SUS_I2C_DeviceMap
+{
+    const char *name;
+    const struct SUS_I2C_RegisterInfo *reg;
+    uint8_t registerCount;
+    const struct SUS_I2C_FieldInfo *field;
+    uint8_t fieldCount;
+    uint8_t burstAddressFlag;                   // OR-ed into the register address of multi-byte accesses. 0 for most devices, 0x80 for many ST sensors (auto-increment bit).
+};
+
+struct SUS_I2C_Device
+{
+    const struct SUS_I2C_DeviceMap *map;
+    uint8_t I2CportNumber;
+    uint8_t I2CdeviceAddress;
+    uint64_t cacheValid;                        // Bit N = cache[N] holds the current value of register N.
+    uint32_t cache[SUS_I2C_MAP_MAX_REGISTERS];
+    uint32_t busReads;                          // Statistics: burst reads done.
+    uint32_t cacheHits;                         // Statistics: register reads answered from the cache.
+};
+
+struct SUS_I2C_MapBurst
+{
+    uint8_t startRegisterAddress;
+    uint8_t length;
+};
+
+#if SUS_I2C_FEATURE_REGISTER_MAP
+/*----- The generator: turns the REG(...) / FIELD(...) lists into enums, tables and typed functions. -----*/
+#define SUS_I2C_MAP_REGISTER_ID(DEVICE, NAME, ADDRESS, TYPE, FLAGS)         DEVICE##_##NAME,
+#define SUS_I2C_MAP_REGISTER_INFO(DEVICE, NAME, ADDRESS, TYPE, FLAGS)       { #NAME, ADDRESS, sizeof(TYPE), FLAGS },
+#define SUS_I2C_MAP_REGISTER_ACCESSORS(DEVICE, NAME, ADDRESS, TYPE, FLAGS) \
+    _Static_assert(sizeof(TYPE) <= 4, #DEVICE "_" #NAME ": registers wider than 4 bytes are not supported"); \
+    static inline esp_err_t DEVICE##_Read_##NAME(struct SUS_I2C_Device *device, TYPE *value) \
+    { uint32_t raw; esp_err_t outcome = SUS_I2C_MapRead(device, DEVICE##_##NAME, &raw); if (outcome == ESP_OK) *value = (TYPE)raw; return outcome; } \
+    static inline esp_err_t DEVICE##_Write_##NAME(struct SUS_I2C_Device *device, TYPE value) \
+    { return SUS_I2C_MapWrite(device, DEVICE##_##NAME, (uint32_t)value); }
+#define SUS_I2C_MAP_FIELD_ID(DEVICE, NAME, REGISTER, SHIFT, BITS)           DEVICE##_FIELD_##NAME,
+#define SUS_I2C_MAP_FIELD_INFO(DEVICE, NAME, REGISTER, SHIFT, BITS)         { #NAME, DEVICE##_##REGISTER, SHIFT, BITS },
+#define SUS_I2C_MAP_FIELD_ACCESSORS(DEVICE, NAME, REGISTER, SHIFT, BITS) \
+    static inline esp_err_t DEVICE##_Get_##NAME(struct SUS_I2C_Device *device, uint32_t *value) { return SUS_I2C_MapGetField(device, DEVICE##_FIELD_##NAME, value); } \
+    static inline esp_err_t DEVICE##_Set_##NAME(struct SUS_I2C_Device *device, uint32_t value) { return SUS_I2C_MapSetField(device, DEVICE##_FIELD_##NAME, value); }
+
+/**SUS_I2C_DEFINE_DEVICE_MAP: Generates everything for one device type from its REGISTERS and FIELDS lists (see the MPU6050 example above).
+ * PARAMETER "DEVICE" is the prefix of all generated names. "FIELDS" may be an empty list: #define MYDEVICE_FIELDS(FIELD)
+ * PARAMETER "BURST_ADDRESS_FLAG" is OR-ed into the register address of multi-byte reads/writes (0x00 for most devices, 0x80 for ST sensors like the LIS3DH).
+*/
+#define SUS_I2C_DEFINE_DEVICE_MAP(DEVICE, REGISTERS, FIELDS, BURST_ADDRESS_FLAG) \
+    enum { REGISTERS(SUS_I2C_MAP_REGISTER_ID) DEVICE##_REGISTER_COUNT }; \
+    enum { FIELDS(SUS_I2C_MAP_FIELD_ID) DEVICE##_FIELD_COUNT }; \
+    _Static_assert(DEVICE##_REGISTER_COUNT <= SUS_I2C_MAP_MAX_REGISTERS, #DEVICE ": too many registers for one map"); \
+    static const struct SUS_I2C_RegisterInfo DEVICE##_Registers[] = { REGISTERS(SUS_I2C_MAP_REGISTER_INFO) }; \
+    static const struct SUS_I2C_FieldInfo DEVICE##_Fields[] = { FIELDS(SUS_I2C_MAP_FIELD_INFO) { NULL, 0, 0, 0 } }; \
+    static const struct SUS_I2C_DeviceMap DEVICE##_Map = { #DEVICE, DEVICE##_Registers, DEVICE##_REGISTER_COUNT, DEVICE##_Fields, DEVICE##_FIELD_COUNT, BURST_ADDRESS_FLAG }; \
+    REGISTERS(SUS_I2C_MAP_REGISTER_ACCESSORS) \
+    FIELDS(SUS_I2C_MAP_FIELD_ACCESSORS) \
+    static inline void DEVICE##_Init(struct SUS_I2C_Device *device, uint8_t I2CportNumber, uint8_t I2CdeviceAddress) { SUS_I2C_MapInit(device, &DEVICE##_Map, I2CportNumber, I2CdeviceAddress); }
+
+/**SUS_I2C_MapInit: Binds a device map to a real device on a port/address and empties its cache. The generated DEVICE_Init() calls this for you.
+ * EXAMPLE USE: struct SUS_I2C_Device imu; SUS_I2C_MapInit(&imu, &MPU6050_Map, 0, 0x68);
+*/
+void SUS_I2C_MapInit(struct SUS_I2C_Device *device, const struct SUS_I2C_DeviceMap *map, uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+{
+    memset(device, 0, sizeof(*device));
+    device->map = map;
+    device->I2CportNumber = I2CportNumber;
+    device->I2CdeviceAddress = I2CdeviceAddress;
+}
+
+/**SUS_I2C_MapInvalidate: Forgets all cached register values, e.g. after resetting the device or when another program may have changed it.
+ * EXAMPLE USE: MPU6050_Write_PWR_MGMT_1(&imu, 0x80); SUS_I2C_MapInvalidate(&imu); //Device reset: everything is back to defaults.
+*/
+void SUS_I2C_MapInvalidate(struct SUS_I2C_Device *device)
+{
+    device->cacheValid = 0;
+}
+
+//Bytes of a register -> number, in the register's byte order.
+static uint32_t SUS_I2C_MapDecode(const struct SUS_I2C_RegisterInfo *reg, const uint8_t *bytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < reg->width; i++)
+    {
+        int index = (reg->flags & SUS_I2C_REG_BIG_ENDIAN) ? i : reg->width - 1 - i;
+        value = (value << 8) | bytes[index];
+    }
+    return value;
+}
+
+//Number -> bytes of a register, in the register's byte order.
+static void SUS_I2C_MapEncode(const struct SUS_I2C_RegisterInfo *reg, uint32_t value, uint8_t *bytes)
+{
+    for (int i = 0; i < reg->width; i++)
+    {
+        int index = (reg->flags & SUS_I2C_REG_BIG_ENDIAN) ? reg->width - 1 - i : i;
+        bytes[index] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+//Can this register address be read just to fill a gap between two wanted registers? Only if the map knows it, it's readable, and reading has no side effects.
+static bool SUS_I2C_MapSafeFiller(const struct SUS_I2C_DeviceMap *map, uint8_t address)
+{
+    for (int i = 0; i < map->registerCount; i++)
+    {
+        const struct SUS_I2C_RegisterInfo *reg = &map->reg[i];
+        if (address >= reg->address && address < reg->address + reg->width)
+            return (reg->flags & SUS_I2C_REG_READ) && !(reg->flags & SUS_I2C_REG_READ_CLEARS);
+    }
+    return false;       //Unknown address - could be anything, don't touch.
+}
+
+/**SUS_I2C_MapPlan: Works out which burst reads are needed to get the given registers: skips the ones that are in the cache,
+ * sorts the rest by address and merges neighbours into as few bursts as possible. Does not touch the bus.
+ * RETURNS the amount of bursts written into "bursts" (at most maxBursts), or -1 if a register can't be read (write-only and never written).
+ * EXAMPLE USE: struct SUS_I2C_MapBurst plan[8]; int n = SUS_I2C_MapPlan(&imu, ids, 3, plan, 8);
+*/
+int SUS_I2C_MapPlan(struct SUS_I2C_Device *device, const uint8_t *registerIds, size_t count, struct SUS_I2C_MapBurst *bursts, int maxBursts)
+{
+    const struct SUS_I2C_DeviceMap *map = device->map;
+    const struct SUS_I2C_RegisterInfo *pending[SUS_I2C_MAP_MAX_REGISTERS];
+    int pendingCount = 0, burstCount = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct SUS_I2C_RegisterInfo *reg = &map->reg[registerIds[i]];
+        bool cached = (device->cacheValid >> registerIds[i]) & 1;
+        if (cached && !(reg->flags & SUS_I2C_REG_VOLATILE)) continue;
+        if (!(reg->flags & SUS_I2C_REG_READ)) return -1;
+        bool duplicate = false;
+        for (int k = 0; k < pendingCount; k++) if (pending[k] == reg) duplicate = true;
+        if (duplicate || pendingCount >= SUS_I2C_MAP_MAX_REGISTERS) continue;
+        int k = pendingCount++;                 //Insertion sort by address - lists are short.
+        while (k > 0 && pending[k - 1]->address > reg->address) { pending[k] = pending[k - 1]; k--; }
+        pending[k] = reg;
+    }
+
+    for (int i = 0; i < pendingCount; i++)
+    {
+        const struct SUS_I2C_RegisterInfo *reg = pending[i];
+        if (burstCount > 0) {
+            struct SUS_I2C_MapBurst *last = &bursts[burstCount - 1];
+            int lastEnd = last->startRegisterAddress + last->length;
+            int newLength = reg->address + reg->width - last->startRegisterAddress;
+            bool gapIsSafe = (reg->address - lastEnd) <= SUS_I2C_MAP_MAX_GAP;
+            for (int address = lastEnd; gapIsSafe && address < reg->address; address++) gapIsSafe = SUS_I2C_MapSafeFiller(map, (uint8_t)address);
+            if (reg->address + reg->width <= lastEnd) continue;                             //Already inside the last burst.
+            if (gapIsSafe && newLength <= SUS_I2C_MAP_MAX_BURST) {
+                last->length = (uint8_t)newLength;
+                continue;
+            }
+        }
+        if (burstCount >= maxBursts) break;
+        bursts[burstCount].startRegisterAddress = reg->address;
+        bursts[burstCount].length = reg->width;
+        burstCount++;
+    }
+    return burstCount;
+}
+
+/**SUS_I2C_MapReadMany: Reads several registers of a mapped device with as few bus transactions as possible (see SUS_I2C_MapPlan), and returns their values in the same order.
+ * Non-volatile registers are remembered, so the next read of them costs nothing. Non-volatile registers that happened to be inside a burst get cached too.
+ * RETURNS ESP_OK, ESP_ERR_NOT_SUPPORTED if a register is write-only (and was never written), or the bus error of the failed burst.
+ * EXAMPLE USE: uint8_t ids[2] = {MPU6050_ACCEL_XOUT, MPU6050_WHO_AM_I}; uint32_t values[2]; SUS_I2C_MapReadMany(&imu, ids, 2, values);
+*/
+esp_err_t SUS_I2C_MapReadMany(struct SUS_I2C_Device *device, const uint8_t *registerIds, size_t count, uint32_t *values)
+{
+    const char *I2C_MAP_TAG = "I2C MAP";
+    const struct SUS_I2C_DeviceMap *map = device->map;
+    struct SUS_I2C_MapBurst plan[SUS_I2C_MAP_MAX_REGISTERS] = {0};
+    uint8_t data[SUS_I2C_MAP_MAX_BURST];
+    int burstCount = SUS_I2C_MapPlan(device, registerIds, count, plan, SUS_I2C_MAP_MAX_REGISTERS);
+
+    if (burstCount < 0) {
+        ESP_LOGE(I2C_MAP_TAG,"[I2C PORT %d], [Device %#04x] : %s has a write-only register in the list that was never written - nothing to read.",device->I2CportNumber,device->I2CdeviceAddress,map->name);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    for (int b = 0; b < burstCount; b++)
+    {
+        uint8_t startRegister = plan[b].startRegisterAddress | (plan[b].length > 1 ? map->burstAddressFlag : 0);
+        esp_err_t outcome = SUS_I2C_ReadRegisters(device->I2CportNumber, device->I2CdeviceAddress, startRegister, data, plan[b].length);
+        device->busReads++;
+        if (outcome != ESP_OK) return outcome;
+        for (int r = 0; r < map->registerCount; r++)       //Decode every register that came with this burst.
+        {
+            const struct SUS_I2C_RegisterInfo *reg = &map->reg[r];
+            if (reg->address < plan[b].startRegisterAddress || reg->address + reg->width > plan[b].startRegisterAddress + plan[b].length) continue;
+            device->cache[r] = SUS_I2C_MapDecode(reg, &data[reg->address - plan[b].startRegisterAddress]);
+            if (!(reg->flags & SUS_I2C_REG_VOLATILE)) device->cacheValid |= 1ull << r;
+        }
+        for (size_t i = 0; i < count; i++)                  //Volatile registers must come from THIS read, so hand them over right away.
+        {
+            const struct SUS_I2C_RegisterInfo *reg = &map->reg[registerIds[i]];
+            if (reg->address >= plan[b].startRegisterAddress && reg->address + reg->width <= plan[b].startRegisterAddress + plan[b].length) values[i] = device->cache[registerIds[i]];
+        }
+    }
+    for (size_t i = 0; i < count; i++)                      //Whatever the plan skipped is in the cache.
+    {
+        const struct SUS_I2C_RegisterInfo *reg = &map->reg[registerIds[i]];
+        if (((device->cacheValid >> registerIds[i]) & 1) && !(reg->flags & SUS_I2C_REG_VOLATILE)) {
+            bool readNow = false;
+            for (int b = 0; b < burstCount; b++)
+                if (reg->address >= plan[b].startRegisterAddress && reg->address + reg->width <= plan[b].startRegisterAddress + plan[b].length) readNow = true;
+            if (!readNow) device->cacheHits++;
+            values[i] = device->cache[registerIds[i]];
+        }
+    }
+    return ESP_OK;
+}
+
+/**SUS_I2C_MapRead: Reads one register of a mapped device (from the cache if it's not volatile and known already). The generated DEVICE_Read_NAME() functions call this.
+ * EXAMPLE USE: uint32_t id; SUS_I2C_MapRead(&imu, MPU6050_WHO_AM_I, &id);
+*/
+esp_err_t SUS_I2C_MapRead(struct SUS_I2C_Device *device, uint8_t registerId, uint32_t *value)
+{
+    return SUS_I2C_MapReadMany(device, &registerId, 1, value);
+}
+
+/**SUS_I2C_MapWrite: Writes one register of a mapped device, in its width and byte order. The generated DEVICE_Write_NAME() functions call this.
+ * RETURNS ESP_OK, ESP_ERR_NOT_SUPPORTED for read-only registers (the bus is not touched), or the bus error.
+ * EXAMPLE USE: SUS_I2C_MapWrite(&imu, MPU6050_SMPLRT_DIV, 9);
+*/
+esp_err_t SUS_I2C_MapWrite(struct SUS_I2C_Device *device, uint8_t registerId, uint32_t value)
+{
+    const char *I2C_MAP_TAG = "I2C MAP";
+    const struct SUS_I2C_RegisterInfo *reg = &device->map->reg[registerId];
+    uint8_t bytes[4];
+    esp_err_t outcome;
+
+    if (!(reg->flags & SUS_I2C_REG_WRITE)) {
+        ESP_LOGE(I2C_MAP_TAG,"[I2C PORT %d], [Device %#04x] : %s_%s is read-only - write skipped.",device->I2CportNumber,device->I2CdeviceAddress,device->map->name,reg->name);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    SUS_I2C_MapEncode(reg, value, bytes);
+    outcome = SUS_I2C_WriteRegisters(device->I2CportNumber, device->I2CdeviceAddress, reg->address | (reg->width > 1 ? device->map->burstAddressFlag : 0), bytes, reg->width);
+    if (outcome == ESP_OK && !(reg->flags & SUS_I2C_REG_VOLATILE)) {
+        device->cache[registerId] = (reg->width == 4) ? value : value & ((1u << (8 * reg->width)) - 1);
+        device->cacheValid |= 1ull << registerId;
+    }
+    else device->cacheValid &= ~(1ull << registerId);      //Failed write: we don't know what's in there anymore.
+    return outcome;
+}
+
+/**SUS_I2C_MapGetField: Reads a bit-field of a mapped device (from the cache if possible). The generated DEVICE_Get_NAME() functions call this.
+ * EXAMPLE USE: uint32_t range; SUS_I2C_MapGetField(&imu, MPU6050_FIELD_AFS_SEL, &range);
+*/
+esp_err_t SUS_I2C_MapGetField(struct SUS_I2C_Device *device, uint8_t fieldId, uint32_t *value)
+{
+    const struct SUS_I2C_FieldInfo *field = &device->map->field[fieldId];
+    uint32_t mask = (field->bits >= 32) ? 0xFFFFFFFFu : ((1u << field->bits) - 1);
+    uint32_t registerValue;
+    esp_err_t outcome = SUS_I2C_MapRead(device, field->registerId, &registerValue);
+    if (outcome == ESP_OK) *value = (registerValue >> field->shift) & mask;
+    return outcome;
+}
+
+/**SUS_I2C_MapSetField: Changes only one bit-field of a register (read-modify-write). If the register is cached, the "read" part costs no bus time at all.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG if the value does not fit the field, ESP_ERR_NOT_SUPPORTED if the register can't be read and was never written, or the bus error.
+ * EXAMPLE USE: SUS_I2C_MapSetField(&imu, MPU6050_FIELD_FS_SEL, 3); //Gyro to +-2000 deg/s, other GYRO_CONFIG bits untouched.
+*/
+esp_err_t SUS_I2C_MapSetField(struct SUS_I2C_Device *device, uint8_t fieldId, uint32_t value)
+{
+    const struct SUS_I2C_FieldInfo *field = &device->map->field[fieldId];
+    uint32_t mask = (field->bits >= 32) ? 0xFFFFFFFFu : ((1u << field->bits) - 1);
+    uint32_t registerValue;
+    esp_err_t outcome;
+
+    if (value & ~mask) return ESP_ERR_INVALID_ARG;
+    outcome = SUS_I2C_MapRead(device, field->registerId, &registerValue);
+    if (outcome != ESP_OK) return outcome;
+    registerValue = (registerValue & ~(mask << field->shift)) | (value << field->shift);
+    return SUS_I2C_MapWrite(device, field->registerId, registerValue);
+}
+
+/**SUS_I2C_MapPrintPlan: Prints which bus transactions SUS_I2C_MapReadMany would do for the given registers right now, and the device's cache statistics.
+ * EXAMPLE USE: SUS_I2C_MapPrintPlan(&imu, ids, 3);
+*/
+void SUS_I2C_MapPrintPlan(struct SUS_I2C_Device *device, const uint8_t *registerIds, size_t count)
+{
+    const char *I2C_MAP_TAG = "I2C MAP";
+    struct SUS_I2C_MapBurst plan[SUS_I2C_MAP_MAX_REGISTERS];
+    int burstCount = SUS_I2C_MapPlan(device, registerIds, count, plan, SUS_I2C_MAP_MAX_REGISTERS);
+
+    ESP_LOGI(I2C_MAP_TAG,"[I2C PORT %d], [Device %#04x] : %s, %d registers wanted -> %d burst read(s). So far %lu bus reads, %lu cache hits.",
+             device->I2CportNumber,device->I2CdeviceAddress,device->map->name,(int)count,burstCount,(unsigned long)device->busReads,(unsigned long)device->cacheHits);
+    for (int b = 0; b < burstCount; b++)
+        ESP_LOGI(I2C_MAP_TAG,"    burst %d: registers %#04x-%#04x (%d bytes, %lu us at the current bus speed)",b,plan[b].startRegisterAddress,plan[b].startRegisterAddress+plan[b].length-1,plan[b].length,
+                 (unsigned long)SUS_I2C_BusTime_us(device->I2CportNumber, 3 + plan[b].length, 2));
+}
+#endif //SUS_I2C_FEATURE_REGISTER_MAP
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌
+▐░▌          ▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌
+ ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░▌       ▐░▌
+          ▐░▌▐░▌          ▐░▌          ▐░▌          ▐░▌       ▐░▌
+ ▄▄▄▄▄▄▄▄▄█░▌▐░▌          ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀            ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* BUS SPEED: change the clock on the fly, and find out how fast your bus can really go.
+ * SUS_I2C_Master_Init sets the clock once. Changing it the official way means i2c_driver_delete + i2c_param_config + i2c_driver_install - slow,
+ * and every other task using the port falls flat on its face while the driver is gone.
+ * SUS_I2C_SetSpeed() only rewrites the timing registers of the I2C controller (SCL high/low period, START/STOP/data timing, timeout) -
+ * the same values ESP-IDF itself works out from "clk_speed" - and is done in microseconds. The driver stays installed.
+ *
+ * How fast can a bus go? "400kHz" on the datasheet is what the CHIP can do. What the BUS can do depends on pull-up resistors and wire capacitance:
+ * every rising edge is the pull-up charging the wires, which takes ~0.85 x R x C (4.7k and 200pF of long wires = ~800ns).
+ * Clock it so fast that the HIGH phase is shorter than that and the bits start going missing - first rarely, then all the time.
+ * SUS_I2C_CalibrateSpeed() measures it instead of guessing:
+ *      1. reads a block of registers that never changes by itself (ID, configuration) from every target at the CURRENT speed - that's the reference.
+ *      2. steps the clock up from "startSpeed" by "stepSpeed", and at each step reads the blocks again and again, comparing with the reference.
+ *         Wrong data counts as an error just like a NACK or a timeout.
+ *      3. stops at the first step with an error rate above "maxErrorRate". The step below it is the highest clean speed.
+ *      4. backs off by "safetyMargin" (temperature, aging, that one extra sensor someone plugs in next year...), checks that speed once more and applies it.
+ * Run it at start-up, before the scheduler/presence monitor/anything else is using the port - it holds the bus (SUS_I2C_PRIORITY_CRITICAL) the whole time.
+ * Its own transactions are NOT traced and NOT noted by the presence monitor: failures at silly speeds are the whole point, not a sign of unplugged devices.
+ * NOTE: jobs already added to the scheduler keep the bus time estimate of the old speed until SUS_I2C_SchedulerStart is called again.
+ */
+#define SUS_I2C_SOURCE_CLOCK_HZ         80000000    // ESP32 I2C controllers count their timings in cycles of the 80MHz APB clock.
+#define SUS_I2C_MAX_SPEED               1000000     // Fast-mode Plus. The ESP32 controller can't reliably go beyond this.
+#define SUS_I2C_MAX_TIMING_CYCLES       1023        // START/STOP setup/hold and SDA timing fields are 10 bits: the longest half SCL cycle they can hold...
+#define SUS_I2C_MIN_SPEED               (SUS_I2C_SOURCE_CLOCK_HZ / (2 * (SUS_I2C_MAX_TIMING_CYCLES + 1)) + 1)     // ...so 39063 Hz is the slowest clock they can be set to.
+#define SUS_I2C_CALIBRATION_MAX_STEPS   40          // Most speed steps one calibration run can record.
+#define SUS_I2C_CALIBRATION_MAX_TARGETS 16          // Most devices one calibration run can exercise.
+#define SUS_I2C_CALIBRATION_MAX_BLOCK   16          // Longest register block read per target.
+
+struct SUS_I2C_CalibrationTarget
+{
+    uint8_t I2CdeviceAddress;
+    uint8_t startRegisterAddress;               // First register of a block that does NOT change by itself: chip ID, configuration, factory calibration...
+    uint8_t length;                             // 1 - SUS_I2C_CALIBRATION_MAX_BLOCK. Longer blocks = more bits exercised per transaction.
+};
+
+struct SUS_I2C_CalibrationConfig
+{
+    const struct SUS_I2C_CalibrationTarget *target;    // Devices to exercise. Use ALL devices of the bus if you can - the slowest one decides.
+    uint8_t  targetCount;                       // 1 - SUS_I2C_CALIBRATION_MAX_TARGETS.
+    int      startSpeed;                        // First speed tested, Hz, SUS_I2C_MIN_SPEED or more. 0 = 100000.
+    int      maxSpeed;                          // Last speed tested, Hz. 0 = SUS_I2C_MAX_SPEED.
+    int      stepSpeed;                         // Speed step, Hz. 0 = 50000.
+    uint32_t transactionsPerStep;               // Reads per speed step, all targets together. 0 = 500. More = rare errors get caught.
+    float    maxErrorRate;                      // Error rate (0.0 - 1.0) a step may have and still count as clean. 0 = not a single error.
+    float    safetyMargin;                      // Run this much below the highest clean speed: 0.25 = 25% slower. 0 = no margin (not recommended).
+    bool     apply;                             // true = switch to the chosen speed at the end. false = only measure, go back to the old speed.
+};
+
+struct SUS_I2C_CalibrationStep
+{
+    int      speed;                             // Hz.
+    uint32_t transactions;
+    uint32_t errors;                            // NACKs, timeouts and wrong data together.
+};
+
+struct SUS_I2C_CalibrationResult
+{
+    int      highestCleanSpeed;                 // Highest speed (Hz) where all steps up to it were clean. 0 = not even startSpeed was.
+    int      firstFailedSpeed;                  // Speed (Hz) of the first step that failed. 0 = never failed up to maxSpeed.
+    int      chosenSpeed;                       // highestCleanSpeed minus the safety margin, rounded down to 10kHz and checked once more.
+    uint8_t  stepCount;
+    struct SUS_I2C_CalibrationStep step[SUS_I2C_CALIBRATION_MAX_STEPS];    // Every speed tested, in order. The last one is the check of chosenSpeed.
+};
+
+//Writes the timing registers of the I2C controller for the given speed. Same numbers ESP-IDF computes from i2c_config_t.master.clk_speed on the ESP32.
+#if SUS_I2C_FEATURE_SPEED
+static esp_err_t SUS_I2C_ApplySpeed(uint8_t I2CportNumber, int speed)
+{
+    if (speed < SUS_I2C_MIN_SPEED || speed > SUS_I2C_MAX_SPEED) return ESP_ERR_INVALID_ARG;     //Slower would overflow the timing fields, and the controller would run at some other speed.
+    int halfCycle = SUS_I2C_SOURCE_CLOCK_HZ / speed / 2;    //SCL HIGH and LOW phases, in APB clock cycles.
+    esp_err_t outcome = i2c_set_period(I2CportNumber, halfCycle, halfCycle);
+    if (outcome == ESP_OK) outcome = i2c_set_start_timing(I2CportNumber, halfCycle, halfCycle);
+    if (outcome == ESP_OK) outcome = i2c_set_stop_timing(I2CportNumber, halfCycle, halfCycle);
+    if (outcome == ESP_OK) outcome = i2c_set_data_timing(I2CportNumber, halfCycle / 2, halfCycle / 2);     //Sample and change SDA in the middle of the SCL phases.
+    if (outcome == ESP_OK) outcome = i2c_set_timeout(I2CportNumber, halfCycle * 20);
+    if (outcome == ESP_OK) SUS_I2C_PortSpeedHz[I2CportNumber & 1] = speed;     //Bus time estimates follow the new speed.
+    return outcome;
+}
+
+/**SUS_I2C_SetSpeed: Changes the clock of an already initialized I2C port, without reinstalling the driver.
+ * Waits for the current owner of the bus to finish (SUS_I2C_BusAcquire at SUS_I2C_PRIORITY_CRITICAL) so a chunked or scheduled transaction is never cut in half.
+ * Transactions that don't go through the arbiter aren't protected - don't change the speed while a plain read/write from another task may be running.
+ * PARAMETER "speed" is the new bus clock in Hz (SUS_I2C_MIN_SPEED - SUS_I2C_MAX_SPEED). Common values: 100000, 400000, 1000000.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG for an impossible speed, ESP_ERR_INVALID_STATE if the port was never initialized, or the ESP-IDF error code.
+ * EXAMPLE USE: SUS_I2C_SetSpeed(0, 400000); //Port 0 now runs at 400kHz.
+*/
+esp_err_t SUS_I2C_SetSpeed(uint8_t I2CportNumber, int speed)
+{
+    const char *I2C_SPEED_TAG = "I2C SPEED";
+    esp_err_t outcome;
+
+    if (speed < SUS_I2C_MIN_SPEED || speed > SUS_I2C_MAX_SPEED) return ESP_ERR_INVALID_ARG;
+    if (SUS_I2C_PortSpeedHz[I2CportNumber & 1] == 0) return ESP_ERR_INVALID_STATE;
+
+    bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, SUS_I2C_PRIORITY_CRITICAL) == ESP_OK);
+    outcome = SUS_I2C_ApplySpeed(I2CportNumber, speed);
+    if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);
+
+    if (outcome == ESP_OK) ESP_LOGI(I2C_SPEED_TAG,"[I2C PORT %d] : bus speed set to %d Hz.",I2CportNumber,speed);
+    else ESP_LOGE(I2C_SPEED_TAG,"[I2C PORT %d] : could not set bus speed to %d Hz. Code %#04x.",I2CportNumber,speed,outcome);
+    return outcome;
+}
+
+//Reads every target "transactions" times in turn at the current speed and counts everything that is not the reference data. Silent: no log, no trace.
+static void SUS_I2C_CalibrationRun(uint8_t I2CportNumber, const struct SUS_I2C_CalibrationConfig *config, uint8_t reference[][SUS_I2C_CALIBRATION_MAX_BLOCK],
+                                   uint32_t transactions, struct SUS_I2C_CalibrationStep *step, bool *sawTimeout)
+{
+    uint8_t readBuffer[SUS_I2C_CALIBRATION_MAX_BLOCK];
+
+    step->speed = SUS_I2C_PortSpeedHz[I2CportNumber & 1];
+    step->transactions = transactions;
+    step->errors = 0;
+    for (uint32_t i = 0; i < transactions; i++)
+    {
+        const struct SUS_I2C_CalibrationTarget *target = &config->target[i % config->targetCount];
+        esp_err_t outcome = i2c_master_write_read_device(I2CportNumber, target->I2CdeviceAddress, &target->startRegisterAddress, 1, readBuffer, target->length, 10/portTICK_PERIOD_MS);
+        if (outcome == ESP_ERR_TIMEOUT) *sawTimeout = true;
+        if (outcome != ESP_OK || memcmp(readBuffer, reference[i % config->targetCount], target->length) != 0) step->errors++;
+    }
+}
+
+/**SUS_I2C_CalibrateSpeed: Finds the highest bus speed the given I2C port handles reliably, and (optionally) switches to it minus a safety margin.
+ * See the comment at the top of this section for how it works. Takes a while: transactionsPerStep reads at every step.
+ * PARAMETER "config" describes the targets and the search - see struct SUS_I2C_CalibrationConfig.
+ * PARAMETER "result" receives every step measured and the speeds found. Can be NULL if you only want the speed applied.
+ * RETURNS ESP_OK if a clean speed was found, ESP_ERR_INVALID_ARG for a bad config, ESP_ERR_INVALID_STATE if a target didn't answer at the current speed
+ *         (reference read failed) or the port runs below SUS_I2C_MIN_SPEED (its speed could not be put back), ESP_FAIL if not even startSpeed was clean. The port is left at its old speed on any error.
+ * EXAMPLE USE: static const struct SUS_I2C_CalibrationTarget targets[] = {{0x68, 0x75, 1},  //MPU6050 WHO_AM_I
+ *                                                                         {0x77, 0xAA, 16}}; //BMP180 calibration constants
+ *              struct SUS_I2C_CalibrationConfig config = {.target=targets, .targetCount=2, .safetyMargin=0.25, .apply=true};
+ *              struct SUS_I2C_CalibrationResult result;
+ *              SUS_I2C_CalibrateSpeed(0, &config, &result); //e.g. clean up to 750kHz -> port 0 now runs at 560kHz.
+*/
+esp_err_t SUS_I2C_CalibrateSpeed(uint8_t I2CportNumber, const struct SUS_I2C_CalibrationConfig *config, struct SUS_I2C_CalibrationResult *result)
+{
+    const char *I2C_SPEED_TAG = "I2C SPEED";
+    struct SUS_I2C_CalibrationResult localResult;
+    uint8_t reference[SUS_I2C_CALIBRATION_MAX_TARGETS][SUS_I2C_CALIBRATION_MAX_BLOCK];     //Reference block of every target.
+    int originalSpeed = SUS_I2C_PortSpeedHz[I2CportNumber & 1];
+    int startSpeed = config->startSpeed > 0 ? config->startSpeed : 100000;
+    int maxSpeed = config->maxSpeed > 0 ? config->maxSpeed : SUS_I2C_MAX_SPEED;
+    int stepSpeed = config->stepSpeed > 0 ? config->stepSpeed : 50000;
+    uint32_t transactions = config->transactionsPerStep > 0 ? config->transactionsPerStep : 500;
+    bool sawTimeout = false;
+    esp_err_t outcome = ESP_OK;
+
+    if (result == NULL) result = &localResult;
+    memset(result, 0, sizeof(*result));
+    if (config->target == NULL || config->targetCount == 0 || config->targetCount > SUS_I2C_CALIBRATION_MAX_TARGETS || startSpeed < SUS_I2C_MIN_SPEED || maxSpeed > SUS_I2C_MAX_SPEED || startSpeed > maxSpeed ||
+        config->safetyMargin < 0.0f || config->safetyMargin >= 1.0f)
+        return ESP_ERR_INVALID_ARG;
+    for (int t = 0; t < config->targetCount; t++)
+        if (config->target[t].length == 0 || config->target[t].length > SUS_I2C_CALIBRATION_MAX_BLOCK) return ESP_ERR_INVALID_ARG;
+    if (originalSpeed < SUS_I2C_MIN_SPEED) return ESP_ERR_INVALID_STATE;      //Also: never initialized.
+
+    bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, SUS_I2C_PRIORITY_CRITICAL) == ESP_OK);    //Nobody else on the bus while the clock jumps around.
+
+    /*=== STEP 1. Reference data at the speed the port already runs at ===*/
+    for (int t = 0; t < config->targetCount && outcome == ESP_OK; t++)
+    {
+        const struct SUS_I2C_CalibrationTarget *target = &config->target[t];
+        outcome = i2c_master_write_read_device(I2CportNumber, target->I2CdeviceAddress, &target->startRegisterAddress, 1, reference[t], target->length, 10/portTICK_PERIOD_MS);
+        if (outcome != ESP_OK) {
+            ESP_LOGE(I2C_SPEED_TAG,"[I2C PORT %d], [Device %#04x] : no answer at %d Hz, can't calibrate against it. Code %#04x.",I2CportNumber,target->I2CdeviceAddress,originalSpeed,outcome);
+            outcome = ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    /*=== STEP 2. Climb until the first step that isn't clean ===*/
+    for (int speed = startSpeed; outcome == ESP_OK && speed <= maxSpeed && result->stepCount < SUS_I2C_CALIBRATION_MAX_STEPS - 1; speed += stepSpeed)
+    {
+        struct SUS_I2C_CalibrationStep *step = &result->step[result->stepCount++];
+        SUS_I2C_ApplySpeed(I2CportNumber, speed);
+        SUS_I2C_CalibrationRun(I2CportNumber, config, reference, transactions, step, &sawTimeout);
+        ESP_LOGI(I2C_SPEED_TAG,"[I2C PORT %d] %7d Hz : %lu errors in %lu reads.",I2CportNumber,speed,(unsigned long)step->errors,(unsigned long)step->transactions);
+        if (step->errors > config->maxErrorRate * step->transactions) {
+            result->firstFailedSpeed = speed;
+            break;
+        }
+        result->highestCleanSpeed = speed;
+    }
+
+    /*=== STEP 3. Back off by the safety margin and check that speed once more ===*/
+    if (outcome == ESP_OK && result->highestCleanSpeed == 0) outcome = ESP_FAIL;
+    if (outcome == ESP_OK && sawTimeout) {      //A slave may have lost track of the clock at the failed speed and still be holding SDA. Free it before the check.
+        SUS_I2C_ApplySpeed(I2CportNumber, originalSpeed);
+        SUS_I2C_ResetBus(I2CportNumber);
+        sawTimeout = false;
+    }
+    if (outcome == ESP_OK) {
+        struct SUS_I2C_CalibrationStep *check = &result->step[result->stepCount++];
+        result->chosenSpeed = (int)(result->highestCleanSpeed * (1.0f - config->safetyMargin)) / 10000 * 10000;
+        if (result->chosenSpeed < SUS_I2C_MIN_SPEED) result->chosenSpeed = result->highestCleanSpeed;
+        SUS_I2C_ApplySpeed(I2CportNumber, result->chosenSpeed);
+        SUS_I2C_CalibrationRun(I2CportNumber, config, reference, transactions, check, &sawTimeout);
+        if (check->errors > config->maxErrorRate * check->transactions) {
+            ESP_LOGE(I2C_SPEED_TAG,"[I2C PORT %d] : %d Hz failed the final check (%lu errors). Bus is unstable - check wiring and pull-ups.",I2CportNumber,result->chosenSpeed,(unsigned long)check->errors);
+            outcome = ESP_FAIL;
+        }
+    }
+
+    SUS_I2C_ApplySpeed(I2CportNumber, (outcome == ESP_OK && config->apply) ? result->chosenSpeed : originalSpeed);
+    if (sawTimeout) SUS_I2C_ResetBus(I2CportNumber);
+    if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);
+
+    if (outcome == ESP_OK)
+        ESP_LOGI(I2C_SPEED_TAG,"[I2C PORT %d] : clean up to %d Hz (first failure: %d Hz). Chosen: %d Hz, %s.",I2CportNumber,result->highestCleanSpeed,result->firstFailedSpeed,
+                 result->chosenSpeed,config->apply ? "applied" : "not applied");
+    return outcome;
+}
+#endif //SUS_I2C_FEATURE_SPEED
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌
+     ▐░▌     ▐░▌          ▐░▌       ▐░▌
+     ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌
+     ▐░▌     ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+     ▐░▌      ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀█░█▀▀
+     ▐░▌               ▐░▌▐░▌     ▐░▌
+ ▄▄▄▄█░█▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌▐░▌      ▐░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀
+*/
+
+/* SUBMITTING FROM AN INTERRUPT: start an I2C read/write from a timer or GPIO interrupt.
+ * None of the other functions here may be called from an interrupt (ISR): they allocate command links, log, and block in i2c_master_cmd_begin until
+ * the transaction is over. The usual workaround - ISR wakes up a task, task calls SUS_I2C_ReadRegister - works, but every ISR needs its own task.
+ * SUS_I2C_SubmitFromISR() is the ISR-safe way in:
+ *      - YOU preallocate a "struct SUS_I2C_IsrRequest" (static/global) that says what to do: read or write a block of registers of one device.
+ *      - the ISR submits a POINTER to it. No memory is allocated, nothing is logged, nothing blocks. It's a handful of atomic instructions
+ *        (a lock-free queue, so ISRs on both cores can submit at the same time without any spinlock) plus a task notification.
+ *      - one worker task per I2C port takes the requests in order and runs them through the bus arbiter at the request's priority
+ *        (SUS_I2C_PRIORITY_HIGH is a good choice: goes ahead of bulk transfers, see PRIORITY section).
+ *      - when done, the worker calls your "onComplete" function and/or notifies "notifyTask" (xTaskNotifyGive). Both happen in TASK context.
+ *      - every request remembers when it was submitted, when it hit the bus and when it finished. SUS_I2C_IsrPrintReport() shows the
+ *        ISR-to-bus-start latency (average and worst) per port. tools/SUS_I2C_IsrLatencyBenchmark.c measures it against the "ISR wakes a task" way.
+ * The transaction itself still runs in a task (the ESP-IDF driver can only be used from one) - the worker should have a high FreeRTOS priority so it runs right after the ISR.
+ * A request can be in the queue only ONCE: submitting it again before it completed returns ESP_ERR_INVALID_STATE. Need two in flight? Use two requests.
+ * IMPORTANT: "data" of a READ gets written by the worker. Don't touch it until the request is done.
+ *
+ * Workflow:
+ *      1. SUS_I2C_Master_Init(...)
+ *      2. SUS_I2C_IsrWorkerStart(0, 1, 20); //Worker for port 0 on core 1, priority 20.
+ *      3. static struct SUS_I2C_IsrRequest accelRead = {.I2CportNumber=0, .I2CdeviceAddress=0x68, .type=SUS_I2C_ISR_READ, .startRegisterAddress=0x3B,
+ *                                                        .data=accelData, .length=6, .priority=SUS_I2C_PRIORITY_HIGH, .onComplete=accelDone};
+ *      4. In the ISR (e.g. MPU6050 "data ready" GPIO interrupt):
+ *              BaseType_t woken = pdFALSE;
+ *              SUS_I2C_SubmitFromISR(&accelRead, &woken);
+ *              portYIELD_FROM_ISR(woken);
+ */
+#define SUS_I2C_ISR_QUEUE_SIZE          16      // Requests that can wait per port. MUST be a power of two.
+
+#define SUS_I2C_ISR_READ                0       // Burst read: "length" registers starting at startRegisterAddress into "data".
+#define SUS_I2C_ISR_WRITE               1       // Burst write: "length" bytes from "data" into the registers starting at startRegisterAddress.
+
+#define SUS_I2C_ISR_IDLE                0       // Never submitted.
+#define SUS_I2C_ISR_QUEUED              1       // Waiting for the worker.
+#define SUS_I2C_ISR_RUNNING             2       // On the bus / callbacks running.
+#define SUS_I2C_ISR_DONE                3       // Finished - outcome and timestamps are valid. Can be submitted again.
+
+struct SUS_I2C_IsrRequest
+{
+    /*----- Filled in by YOU, once -----*/
+    uint8_t  I2CportNumber;
+    uint8_t  I2CdeviceAddress;
+    uint8_t  type;                              // SUS_I2C_ISR_READ or SUS_I2C_ISR_WRITE.
+    uint8_t  startRegisterAddress;
+    uint8_t  *data;                             // READ: where the bytes go. WRITE: the bytes to write.
+    uint8_t  length;                            // Amount of bytes.
+    uint8_t  priority;                          // SUS_I2C_PRIORITY_* the worker uses on the bus arbiter.
+    void (*onComplete)(struct SUS_I2C_IsrRequest *request);    // Called by the worker TASK after the transaction. Keep it short. Can be NULL.
+    TaskHandle_t notifyTask;                    // Gets an xTaskNotifyGive after the transaction. NULL = nobody.
+    void *userContext;                          // Anything you want to reach from onComplete. The library does not touch it.
+
+    /*----- Filled in by the LIBRARY. Read them, don't write them. -----*/
+    volatile uint32_t state;                    // SUS_I2C_ISR_*.
+    esp_err_t outcome;                          // Result of the transaction.
+    int64_t  submitted_us;                      // esp_timer_get_time() in the ISR.
+    int64_t  started_us;                        // When the worker started the transaction (latency = started_us - submitted_us).
+    int64_t  finished_us;                       // When the transaction was over.
+};
+
+struct SUS_I2C_IsrSlot
+{
+    uint32_t sequence;                          // Tells producers and the consumer whose turn this slot is (bounded MPMC queue by D. Vyukov).
+    struct SUS_I2C_IsrRequest *request;
+};
+
+struct SUS_I2C_IsrQueue
+{
+    struct SUS_I2C_IsrSlot slot[SUS_I2C_ISR_QUEUE_SIZE];
+    uint32_t enqueuePosition;                   // Next slot a producer (ISR) claims. Moved with compare-and-swap.
+    uint32_t dequeuePosition;                   // Next slot the worker reads. Only the worker touches it.
+    TaskHandle_t worker;
+    volatile bool running;
+    volatile bool taskFinished;
+    uint32_t submitted;                         // Accepted submissions.
+    uint32_t rejected;                          // Submissions refused because the queue was full.
+    uint32_t completed;
+    uint32_t worstLatency_us;                   // Worst submit-to-bus-start time.
+    uint64_t totalLatency_us;
+};
+#if SUS_I2C_FEATURE_ISR
+static struct SUS_I2C_IsrQueue SUS_I2C_IsrPort[2];
+_Static_assert((SUS_I2C_ISR_QUEUE_SIZE & (SUS_I2C_ISR_QUEUE_SIZE - 1)) == 0, "SUS_I2C_ISR_QUEUE_SIZE must be a power of two");
+
+/**SUS_I2C_SubmitFromISR: Queues a preallocated request for the worker task of its I2C port. Safe to call from an interrupt (and from tasks).
+ * No allocation, no logging, no blocking, no spinlock. Lives in IRAM, so it works from IRAM-only interrupts too.
+ * PARAMETER "request" is your preallocated request. Only the POINTER is queued - it must stay alive until it's done.
+ * PARAMETER "higherPriorityTaskWoken" is set to pdTRUE if the worker should run right away - pass it to portYIELD_FROM_ISR. Can be NULL when called from a task.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_STATE if the worker isn't running or this request is still queued/running, ESP_ERR_NO_MEM if the queue is full.
+ * EXAMPLE USE: see the workflow at the top of this section.
+*/
+esp_err_t IRAM_ATTR SUS_I2C_SubmitFromISR(struct SUS_I2C_IsrRequest *request, BaseType_t *higherPriorityTaskWoken)
+{
+    struct SUS_I2C_IsrQueue *queue = &SUS_I2C_IsrPort[request->I2CportNumber & 1];
+    struct SUS_I2C_IsrSlot *slot;
+    uint32_t previousState = __atomic_load_n(&request->state, __ATOMIC_ACQUIRE);
+    uint32_t position;
+
+    if (!queue->running || previousState == SUS_I2C_ISR_QUEUED || previousState == SUS_I2C_ISR_RUNNING ||
+        !__atomic_compare_exchange_n(&request->state, &previousState, SUS_I2C_ISR_QUEUED, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return ESP_ERR_INVALID_STATE;   //Not running, or already on its way (maybe submitted by the other core a moment ago).
+    request->submitted_us = esp_timer_get_time();
+
+    //Claim a slot: the one at enqueuePosition is ours if its sequence says "free for this lap" and nobody moved enqueuePosition before us.
+    position = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);
+    while (true)
+    {
+        slot = &queue->slot[position % SUS_I2C_ISR_QUEUE_SIZE];
+        int32_t difference = (int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - position);
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueuePosition, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        }
+        else if (difference < 0) {      //The worker hasn't emptied this slot from the previous lap: queue full.
+            __atomic_store_n(&request->state, previousState, __ATOMIC_RELEASE);
+            __atomic_fetch_add(&queue->rejected, 1, __ATOMIC_RELAXED);
+            return ESP_ERR_NO_MEM;
+        }
+        else position = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);    //Another ISR took it - try the next one.
+    }
+    slot->request = request;
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);     //Publish: now the worker may take it.
+    __atomic_fetch_add(&queue->submitted, 1, __ATOMIC_RELAXED);
+    vTaskNotifyGiveFromISR(queue->worker, higherPriorityTaskWoken);
+    return ESP_OK;
+}
+
+//Takes the oldest published request off the queue, or returns NULL if there is none. Worker task only (single consumer).
+static struct SUS_I2C_IsrRequest SUS_I2C_IRAM *SUS_I2C_IsrDequeue(struct SUS_I2C_IsrQueue *queue)
+{
+    uint32_t position = queue->dequeuePosition;
+    struct SUS_I2C_IsrSlot *slot = &queue->slot[position % SUS_I2C_ISR_QUEUE_SIZE];
+    struct SUS_I2C_IsrRequest *request;
+
+    if ((int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (position + 1)) < 0) return NULL;  //Not published (yet).
+    request = slot->request;
+    __atomic_store_n(&slot->sequence, position + SUS_I2C_ISR_QUEUE_SIZE, __ATOMIC_RELEASE);    //Free for the producers' next lap.
+    queue->dequeuePosition = position + 1;
+    return request;
+}
+
+//Hands a finished request back to its owner.
+static void SUS_I2C_IRAM SUS_I2C_IsrComplete(struct SUS_I2C_IsrRequest *request, esp_err_t outcome)
+{
+    request->outcome = outcome;
+    request->finished_us = esp_timer_get_time();
+    if (request->onComplete) request->onComplete(request);
+    __atomic_store_n(&request->state, SUS_I2C_ISR_DONE, __ATOMIC_RELEASE);    //From here on it may be submitted again.
+    if (request->notifyTask) xTaskNotifyGive(request->notifyTask);
+}
+
+//The worker task: one per I2C port. Runs the submitted requests one after the other, sleeps when there are none.
+static void SUS_I2C_IsrWorkerTask(void *parameter)
+{
+    uint8_t I2CportNumber = (uint8_t)(uintptr_t)parameter;
+    struct SUS_I2C_IsrQueue *queue = &SUS_I2C_IsrPort[I2CportNumber];
+    struct SUS_I2C_IsrRequest *request;
+
+    while (queue->running)
+    {
+        while (queue->running && (request = SUS_I2C_IsrDequeue(queue)) != NULL)
+        {
+            esp_err_t outcome;
+            __atomic_store_n(&request->state, SUS_I2C_ISR_RUNNING, __ATOMIC_RELAXED);
+            bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, request->priority) == ESP_OK);
+            request->started_us = esp_timer_get_time();
+            if (request->type == SUS_I2C_ISR_WRITE) outcome = SUS_I2C_WriteRegisters(I2CportNumber, request->I2CdeviceAddress, request->startRegisterAddress, request->data, request->length);
+            else outcome = SUS_I2C_ReadRegisters(I2CportNumber, request->I2CdeviceAddress, request->startRegisterAddress, request->data, request->length);
+            if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);
+
+            uint32_t latency = (uint32_t)(request->started_us - request->submitted_us);
+            queue->completed++;
+            queue->totalLatency_us += latency;
+            if (latency > queue->worstLatency_us) queue->worstLatency_us = latency;
+            SUS_I2C_IsrComplete(request, outcome);
+        }
+        if (queue->running) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);      //Sleep until the next submission (or SUS_I2C_IsrWorkerStop).
+    }
+    while ((request = SUS_I2C_IsrDequeue(queue)) != NULL) SUS_I2C_IsrComplete(request, ESP_ERR_INVALID_STATE);     //Nobody is left waiting forever.
+    queue->taskFinished = true;
+    vTaskDelete(NULL);
+}
+
+/**SUS_I2C_IsrWorkerStart: Starts the worker task that executes the requests submitted for the given I2C port. Run it BEFORE enabling the interrupts that submit.
+ * PARAMETER "coreNumber" is the CPU core to run the worker on: 0 or 1 (or tskNO_AFFINITY). The core your ISR runs on is a good choice.
+ * PARAMETER "taskPriority" is the FreeRTOS priority of the worker. Make it high - latency is mostly "how soon does the worker get to run".
+ * RETURNS ESP_OK, ESP_ERR_INVALID_STATE if it is already running, ESP_ERR_NO_MEM if the task could not be created.
+ * EXAMPLE USE: SUS_I2C_IsrWorkerStart(0, 1, 20); //Worker for port 0 on core 1 at priority 20.
+*/
+esp_err_t SUS_I2C_IsrWorkerStart(uint8_t I2CportNumber, int coreNumber, int taskPriority)
+{
+    const char *I2C_ISR_TAG = "I2C ISR";
+    struct SUS_I2C_IsrQueue *queue = &SUS_I2C_IsrPort[I2CportNumber & 1];
+
+    if (queue->running) return ESP_ERR_INVALID_STATE;
+    memset(queue, 0, sizeof(*queue));
+    for (uint32_t i = 0; i < SUS_I2C_ISR_QUEUE_SIZE; i++) queue->slot[i].sequence = i;
+    queue->running = true;
+    if (xTaskCreatePinnedToCore(SUS_I2C_IsrWorkerTask, "sus_i2c_isr", 4096, (void *)(uintptr_t)(I2CportNumber & 1), taskPriority, &queue->worker, coreNumber) != pdPASS) {
+        queue->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(I2C_ISR_TAG,"[I2C PORT %d] : ISR request worker started.",I2CportNumber);
+    return ESP_OK;
+}
+
+/**SUS_I2C_IsrWorkerStop: Stops the worker task of the given I2C port and waits until it's really gone. Disable the submitting interrupts FIRST.
+ * Requests still in the queue are completed with outcome ESP_ERR_INVALID_STATE (callbacks and notifications still happen).
+ * EXAMPLE USE: SUS_I2C_IsrWorkerStop(0);
+*/
+void SUS_I2C_IsrWorkerStop(uint8_t I2CportNumber)
+{
+    struct SUS_I2C_IsrQueue *queue = &SUS_I2C_IsrPort[I2CportNumber & 1];
+    if (!queue->running) return;
+    queue->running = false;
+    xTaskNotifyGive(queue->worker);
+    while (!queue->taskFinished) vTaskDelay(1);
+}
+
+/**SUS_I2C_IsrPrintReport: Prints how many requests the given port got from interrupts, how many were refused, and the ISR-to-bus-start latency.
+ * EXAMPLE USE: SUS_I2C_IsrPrintReport(0);
+*/
+void SUS_I2C_IsrPrintReport(uint8_t I2CportNumber)
+{
+    const char *I2C_ISR_TAG = "I2C ISR";
+    struct SUS_I2C_IsrQueue *queue = &SUS_I2C_IsrPort[I2CportNumber & 1];
+
+    ESP_LOGI(I2C_ISR_TAG,"[I2C PORT %d] : %lu submitted, %lu refused (queue full), %lu completed. ISR to bus start: avg %lu us, worst %lu us.",
+             I2CportNumber,(unsigned long)queue->submitted,(unsigned long)queue->rejected,(unsigned long)queue->completed,
+             (unsigned long)(queue->completed ? queue->totalLatency_us / queue->completed : 0),(unsigned long)queue->worstLatency_us);
+}
+#endif //SUS_I2C_FEATURE_ISR
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░▌      ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░▌░▌     ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀
+▐░▌          ▐░▌▐░▌    ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░▌ ▐░▌   ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌     ▐░▌
+▐░░░░░░░░░░░▌▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌     ▐░▌
+ ▀▀▀▀▀▀▀▀▀█░▌▐░▌   ▐░▌ ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌     ▐░▌
+          ▐░▌▐░▌    ▐░▌▐░▌▐░▌       ▐░▌▐░▌                    ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+ ▄▄▄▄▄▄▄▄▄█░▌▐░▌     ▐░▐░▌▐░▌       ▐░▌▐░▌           ▄▄▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌
+▐░░░░░░░░░░░▌▐░▌      ▐░░▌▐░▌       ▐░▌▐░▌          ▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌     ▐░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀         ▀  ▀            ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀
+*/
+
+/* SYNCHRONIZED SNAPSHOTS: measure with several sensors at (almost) the same moment.
+ * Triggering 4 identical sensors with 4 separate SUS_I2C_WriteToRegister calls spreads their measurements over 4 full transactions:
+ * driver overhead, task switches and whatever else got onto the bus in between. That skew ends up in your data (think: 4 load cells under one platform).
+ * SUS_I2C_Snapshot() does it in two tight steps:
+ *      1. TRIGGER - all trigger writes go out back-to-back in ONE transaction (START, trigger of sensor 1, REPEATED START, trigger of sensor 2, ... STOP),
+ *         with the bus held through the arbiter so nothing can get in between. The skew between two sensors is then just the wire time of one trigger write.
+ *         Even better, if your sensors support it: one GENERAL CALL (address 0x00) that every device on the bus hears at the same moment - skew ~0.
+ *         Check the datasheet! Only some devices react to general calls, and the general call 0x06 means "reset" to all of them.
+ *      2. READ - after the conversion time, all results are collected as burst reads in one pass, again with the bus held.
+ * Every device's result carries the timestamp of ITS trigger and its skew (how much later than the first device it was triggered), so you know how
+ * coherent the snapshot really is. The trigger times come from the measured duration of the trigger transaction, split by where each trigger sits in it.
+ * Transactions other tasks make while the snapshot waits for the conversion are fine - only the trigger and the read pass are kept in one piece.
+ */
+#define SUS_I2C_SNAPSHOT_MAX_DEVICES    16
+#define SUS_I2C_SNAPSHOT_MAX_TRIGGER    4       // Longest trigger (bytes after the address), general call included.
+#define SUS_I2C_GENERAL_CALL_ADDRESS    0x00
+
+struct SUS_I2C_SnapshotDevice
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   I2CdeviceAddress;
+    uint8_t   trigger[SUS_I2C_SNAPSHOT_MAX_TRIGGER];    // Bytes that start a measurement, e.g. {register, value} or a command. Not used with a general call.
+    uint8_t   triggerLength;                    // 0 = this device is not triggered, only read (it is free-running, or the general call triggers it).
+    uint8_t   startRegisterAddress;             // Where the result is read from.
+    uint8_t   *readBuffer;
+    size_t    amountOfBytesToRead;
+    /*----- Filled in by SUS_I2C_Snapshot -----*/
+    esp_err_t outcome;                          // ESP_OK, or the error of the trigger or of this device's read.
+    int64_t   trigger_us;                       // When this device got its trigger (end of its trigger write). 0 if it had none.
+    uint32_t  skew_us;                          // trigger_us minus the earliest trigger_us of the snapshot.
+    int64_t   read_us;                          // When its read started.
+};
+
+struct SUS_I2C_Snapshot
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   I2CportNumber;
+    uint8_t   priority;                         // SUS_I2C_PRIORITY_* used for both steps. SUS_I2C_PRIORITY_HIGH or _CRITICAL keep the skew small.
+    const uint8_t *generalCall;                 // Bytes sent to address 0x00 as the trigger of ALL devices. NULL = per-device triggers.
+    uint8_t   generalCallLength;
+    uint32_t  conversionTime_us;                // Wait between the trigger and the reads (rounded up to whole RTOS ticks). See the sensor datasheet.
+    uint8_t   deviceCount;
+    struct SUS_I2C_SnapshotDevice *device;
+    /*----- Filled in by SUS_I2C_Snapshot -----*/
+    int64_t   trigger_us;                       // Trigger timestamp of the snapshot = earliest device trigger.
+    uint32_t  skew_us;                          // Largest skew between two devices.
+    uint32_t  readSpan_us;                      // From the start of the first read to the end of the last one.
+};
+
+#if SUS_I2C_FEATURE_SNAPSHOT
+/**SUS_I2C_Snapshot: Triggers all devices of a snapshot in one transaction (or with one general call), waits for the conversion and reads all results in one pass.
+ * Does NOT print anything on success, errors are still printed.
+ * PARAMETER "snapshot" describes the devices - see struct SUS_I2C_Snapshot. Results, timestamps and skews are written back into it. It can be reused for the next snapshot.
+ * RETURNS ESP_OK if the trigger and every read worked, ESP_ERR_INVALID_ARG if the description makes no sense, the error of the trigger transaction
+ * (then nothing was read), or the error of the first device whose read failed (the others are still read, check device[i].outcome).
+ * EXAMPLE USE: struct SUS_I2C_SnapshotDevice cell[4];
+ *              for (int i = 0; i < 4; i++) cell[i] = (struct SUS_I2C_SnapshotDevice){.I2CdeviceAddress=0x2A+i, .trigger={0x02, 0x01}, .triggerLength=2,
+ *                                                                                     .startRegisterAddress=0x12, .readBuffer=weight[i], .amountOfBytesToRead=3};
+ *              struct SUS_I2C_Snapshot platform = {.I2CportNumber=0, .priority=SUS_I2C_PRIORITY_HIGH, .conversionTime_us=10000, .deviceCount=4, .device=cell};
+ *              if (SUS_I2C_Snapshot(&platform) == ESP_OK) printf("4 load cells, triggered within %lu us\n", (unsigned long)platform.skew_us);
+*/
+esp_err_t SUS_I2C_Snapshot(struct SUS_I2C_Snapshot *snapshot)
+{
+    const char *I2C_SNAPSHOT_TAG = "I2C SNAPSHOT";
+    uint8_t I2CportNumber = snapshot->I2CportNumber;
+    bool generalCall = snapshot->generalCallLength > 0;
+    uint32_t position[SUS_I2C_SNAPSHOT_MAX_DEVICES];   //Clock pulses from the first START to the end of each device's trigger. 0 = not triggered.
+    uint32_t pulses = 0;
+    esp_err_t outcome = ESP_OK;
+    int64_t firstRead = 0;
+
+    if (snapshot->device == NULL || snapshot->deviceCount == 0 || snapshot->deviceCount > SUS_I2C_SNAPSHOT_MAX_DEVICES ||
+        snapshot->generalCallLength > SUS_I2C_SNAPSHOT_MAX_TRIGGER || (generalCall && snapshot->generalCall == NULL))
+        return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < snapshot->deviceCount; i++)
+        if (snapshot->device[i].triggerLength > SUS_I2C_SNAPSHOT_MAX_TRIGGER || (snapshot->device[i].amountOfBytesToRead > 0 && snapshot->device[i].readBuffer == NULL))
+            return ESP_ERR_INVALID_ARG;
+
+    //Step 1: TRIGGER. Everything in one command link, so there are no gaps between the triggers.
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+    if (generalCall) {
+        outcome = SUS_I2C_BudgetCharge(I2CportNumber, SUS_I2C_GENERAL_CALL_ADDRESS, 1 + snapshot->generalCallLength, 1);  //Bandwidth budget: charged before the bus is taken.
+        i2c_master_start(cmdSeq);
+        i2c_master_write_byte(cmdSeq,(SUS_I2C_GENERAL_CALL_ADDRESS<<1)|I2C_MASTER_WRITE,true);
+        i2c_master_write(cmdSeq,snapshot->generalCall,snapshot->generalCallLength,true);
+        pulses = 1 + 9 * (1 + snapshot->generalCallLength);
+    }
+    for (int i = 0; i < snapshot->deviceCount; i++)
+    {
+        struct SUS_I2C_SnapshotDevice *device = &snapshot->device[i];
+        position[i] = generalCall ? pulses : 0;
+        if (generalCall || device->triggerLength == 0) continue;
+        if (outcome == ESP_OK) outcome = SUS_I2C_BudgetCharge(I2CportNumber, device->I2CdeviceAddress, 1 + device->triggerLength, 1);
+        i2c_master_start(cmdSeq);                                                   //START for the first device, REPEATED START for the others.
+        i2c_master_write_byte(cmdSeq,(device->I2CdeviceAddress<<1)|I2C_MASTER_WRITE,true);
+        i2c_master_write(cmdSeq,device->trigger,device->triggerLength,true);
+        pulses += 1 + 9 * (1 + device->triggerLength);
+        position[i] = pulses;
+    }
+    i2c_master_stop(cmdSeq);
+    if (pulses == 0) {      //Nothing to trigger - that's not a snapshot.
+        i2c_cmd_link_delete(cmdSeq);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t startTime = 0, endTime = 0;
+    if (outcome == ESP_OK) {
+        TickType_t timeout = 10/portTICK_PERIOD_MS + SUS_I2C_BusTime_us(I2CportNumber, pulses / 9, 1) / 1000 / portTICK_PERIOD_MS;
+        bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, snapshot->priority) == ESP_OK);
+        startTime = esp_timer_get_time();
+        outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, timeout);
+        endTime = esp_timer_get_time();
+        if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);
+    }
+    i2c_cmd_link_delete(cmdSeq);
+    if (generalCall) SUS_I2C_TraceRecord(I2CportNumber, SUS_I2C_GENERAL_CALL_ADDRESS, SUS_I2C_TRACE_WRITE, snapshot->generalCall, snapshot->generalCallLength, NULL, 0, outcome, startTime);
+    else for (int i = 0; i < snapshot->deviceCount; i++)
+        if (position[i] > 0) SUS_I2C_TraceRecord(I2CportNumber, snapshot->device[i].I2CdeviceAddress, SUS_I2C_TRACE_WRITE, snapshot->device[i].trigger,
+                                                 snapshot->device[i].triggerLength, NULL, 0, outcome, startTime);  //Trace recorder: one entry per trigger, same outcome for all.
+
+    if (outcome != ESP_OK) {
+        ESP_LOGE(I2C_SNAPSHOT_TAG,"[I2C PORT %d] : snapshot trigger FAILED, nothing was read. Code %#04x.",I2CportNumber,outcome);
+        for (int i = 0; i < snapshot->deviceCount; i++) snapshot->device[i].outcome = outcome;
+        return outcome;
+    }
+
+    //Trigger timestamps: the measured transaction time, split by where each trigger ends in the sequence.
+    snapshot->trigger_us = 0;
+    snapshot->skew_us = 0;
+    for (int i = 0; i < snapshot->deviceCount; i++)
+    {
+        struct SUS_I2C_SnapshotDevice *device = &snapshot->device[i];
+        device->trigger_us = position[i] > 0 ? startTime + (endTime - startTime) * position[i] / pulses : 0;
+        if (device->trigger_us > 0 && (snapshot->trigger_us == 0 || device->trigger_us < snapshot->trigger_us)) snapshot->trigger_us = device->trigger_us;
+    }
+    for (int i = 0; i < snapshot->deviceCount; i++)
+    {
+        struct SUS_I2C_SnapshotDevice *device = &snapshot->device[i];
+        device->skew_us = device->trigger_us > 0 ? (uint32_t)(device->trigger_us - snapshot->trigger_us) : 0;
+        if (device->skew_us > snapshot->skew_us) snapshot->skew_us = device->skew_us;
+    }
+
+    //Step 2: READ, once the conversion is done. The bus is free for others while we wait.
+    int64_t remaining = endTime + snapshot->conversionTime_us - esp_timer_get_time();
+    if (remaining > 0) vTaskDelay(remaining / 1000 / portTICK_PERIOD_MS + 1);
+
+    bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, snapshot->priority) == ESP_OK);
+    for (int i = 0; i < snapshot->deviceCount; i++)
+    {
+        struct SUS_I2C_SnapshotDevice *device = &snapshot->device[i];
+        device->outcome = ESP_OK;
+        if (device->amountOfBytesToRead == 0) continue;
+        device->read_us = esp_timer_get_time();
+        if (firstRead == 0) firstRead = device->read_us;
+        device->outcome = SUS_I2C_ReadRegisters(I2CportNumber, device->I2CdeviceAddress, device->startRegisterAddress, device->readBuffer, device->amountOfBytesToRead);
+        if (device->outcome != ESP_OK && outcome == ESP_OK) outcome = device->outcome;
+    }
+    snapshot->readSpan_us = firstRead > 0 ? (uint32_t)(esp_timer_get_time() - firstRead) : 0;
+    if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);
+    return outcome;
+}
+#endif //SUS_I2C_FEATURE_SNAPSHOT
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄            ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌▐░▌       ▐░▌
+▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌          ▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌
+▐░▌       ▐░▌     ▐░▌     ▐░▌          ▐░▌       ▐░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌
+▐░▌       ▐░▌     ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌          ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌
+▐░▌       ▐░▌     ▐░▌     ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░▌       ▐░▌     ▐░▌      ▀▀▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░▌          ▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀
+▐░▌       ▐░▌     ▐░▌               ▐░▌▐░▌          ▐░▌          ▐░▌       ▐░▌     ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌ ▄▄▄▄█░█▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌▐░▌          ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌     ▐░▌
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌▐░▌       ▐░▌     ▐░▌
+ ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀            ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀       ▀
+*/
+
+/* DISPLAY FRAMEBUFFER: SSD1306 / SH1106 OLED displays (128x64, 128x32...), sending only the part of the picture that changed.
+ * A whole 128x64 frame is 1 KB on the wire - ~23 ms at 400kHz - every time, even if only the seconds of a clock changed. Pushing it with
+ * SUS_I2C_WriteByteArrayToSlave_EZ is worse: 255 bytes per call at most, and every byte gets printed.
+ * Here you draw into a framebuffer in RAM and call SUS_I2C_DisplayFlush(). The library remembers what the display shows, compares, and sends
+ * only the changed columns of each page (a page = 8 pixel rows, one byte per column):
+ *      - pages that did not change cost nothing (one memcmp),
+ *      - inside a page, every run of changed columns is ONE transaction: three addressing commands (page, column low, column high),
+ *        the data control byte, then the data - any length, nothing is logged on success.
+ *        Runs at most SUS_I2C_DISPLAY_MAX_GAP unchanged columns apart are merged: a few unchanged bytes are cheaper than a new transaction.
+ *      - every run goes through the bus arbiter at the display's priority. With SUS_I2C_PRIORITY_BULK, sensor reads get onto the bus
+ *        between two runs instead of waiting for the whole frame (see PRIORITY section).
+ * SUS_I2C_DisplayPrintReport() shows the bytes sent and saved per frame and the frame rate. tools/SUS_I2C_DisplayBenchmark.c measures typical screens.
+ * A run that fails marks its page as unknown: the next flush sends that whole page again. After anything that may have garbled the display
+ * (its reset pin, a brown-out), call SUS_I2C_DisplayInvalidate() and the next flush sends the whole picture.
+ * IMPORTANT: don't draw into the framebuffer from another task while a flush is running.
+ *
+ * How the controller is talked to (SSD1306 and SH1106 alike): every transaction starts with a CONTROL byte.
+ *      0x80 = one command byte follows, then another control byte      0x00 = commands until the STOP      0x40 = display data until the STOP
+ * Page addressing: command 0xB0+page selects the page, 0x00+low nibble and 0x10+high nibble the column. Data bytes fill consecutive columns.
+ *
+ * Workflow:
+ *      1. SUS_I2C_Master_Init(...)
+ *      2. static struct SUS_I2C_Display oled = {.I2CportNumber=0, .I2CdeviceAddress=0x3C, .controller=SUS_I2C_DISPLAY_SSD1306, .width=128, .height=64};
+ *         SUS_I2C_DisplayInit(&oled);     //Sets the controller up, clears the screen, switches it on.
+ *      3. Draw: SUS_I2C_DisplaySetPixel(&oled, x, y, true), or write bytes straight into oled.framebuffer[page][x] (fonts and bitmaps usually come in this layout).
+ *      4. SUS_I2C_DisplayFlush(&oled);    //Once per frame.
+ * The struct is ~2.2 KB (framebuffer + copy of what's shown): make it static or global, not a local variable of a task with a small stack.
+ */
+#define SUS_I2C_DISPLAY_SSD1306         0
+#define SUS_I2C_DISPLAY_SH1106          1
+
+#define SUS_I2C_DISPLAY_MAX_WIDTH       132     // SH1106 memory is 132 columns wide (a 128 wide panel shows columns 2-129).
+#define SUS_I2C_DISPLAY_MAX_PAGES       8       // 64 rows.
+#define SUS_I2C_DISPLAY_RUN_OVERHEAD    8       // Bytes a run costs on top of its data: address, 3x (control 0x80 + addressing command), data control byte 0x40.
+#define SUS_I2C_DISPLAY_MAX_GAP         10      // Unchanged columns sent anyway to merge two runs: the run overhead + the driver's time per transaction (~2 bytes at 400kHz).
+
+#define SUS_I2C_DISPLAY_CONTROL_COMMAND 0x80    // Co=1, D/C=0: one command byte, then another control byte.
+#define SUS_I2C_DISPLAY_CONTROL_STREAM  0x00    // Co=0, D/C=0: command bytes until the STOP.
+#define SUS_I2C_DISPLAY_CONTROL_DATA    0x40    // Co=0, D/C=1: display data until the STOP.
+
+struct SUS_I2C_Display
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t  I2CportNumber;
+    uint8_t  I2CdeviceAddress;                  // 0x3C, or 0x3D if the address jumper is set.
+    uint8_t  controller;                        // SUS_I2C_DISPLAY_SSD1306 or SUS_I2C_DISPLAY_SH1106.
+    uint8_t  width;                             // Visible columns. 0 = 128.
+    uint8_t  height;                            // Visible rows, a multiple of 8: 64, 32, 16. 0 = 64.
+    uint8_t  columnOffset;                      // Memory column of the leftmost pixel: 0 for SSD1306, 2 for most 128 wide SH1106 modules.
+    uint8_t  priority;                          // SUS_I2C_PRIORITY_* of the frame transfers. SUS_I2C_PRIORITY_BULK (0) suits most displays.
+    /*----- YOUR drawing area. Same layout as the display memory: pixel (x, y) is bit y % 8 of framebuffer[y / 8][x]. -----*/
+    uint8_t  framebuffer[SUS_I2C_DISPLAY_MAX_PAGES][SUS_I2C_DISPLAY_MAX_WIDTH];
+    /*----- Kept by the library -----*/
+    uint8_t  shown[SUS_I2C_DISPLAY_MAX_PAGES][SUS_I2C_DISPLAY_MAX_WIDTH];   // What the display shows, as far as the library knows.
+    uint8_t  knownPages;                        // Bit N = page N of "shown" is really on the display. Unknown pages are sent whole.
+    uint32_t frames;                            // Statistics: flushes since SUS_I2C_DisplayInit / SUS_I2C_DisplayResetStats.
+    uint32_t lastRuns;                          // Statistics: transactions of the latest flush.
+    uint32_t lastBytes;                         // Statistics: bytes on the wire of the latest flush, addresses/commands/control bytes included.
+    uint32_t lastSaved;                         // Statistics: bytes the latest flush did NOT send, compared to a full refresh (every page, whole width).
+    uint32_t lastFlush_us;                      // Statistics: how long the latest flush took.
+    uint64_t totalBytes;
+    uint64_t totalSaved;
+    uint64_t totalFlush_us;
+    int64_t  statsSince_us;                     // Frame rate = frames / time since this.
+};
+
+#if SUS_I2C_FEATURE_DISPLAY
+//One transaction to the display: header (control and addressing bytes), then the data. Goes through the budget, the arbiter and the trace/presence hooks like every other transfer.
+static esp_err_t SUS_I2C_DisplayTransfer(struct SUS_I2C_Display *display, const uint8_t *header, size_t headerLength, const uint8_t *data, size_t length)
+{
+    uint8_t I2CportNumber = display->I2CportNumber;
+    uint8_t I2CdeviceAddress = display->I2CdeviceAddress;
+    uint8_t tracePayload[SUS_I2C_TRACE_PAYLOAD_SIZE];       //Trace recorder: header + first data bytes, same as on the wire.
+    size_t traced = headerLength < sizeof(tracePayload) ? headerLength : sizeof(tracePayload);
+    esp_err_t outcome;
+
+    memcpy(tracePayload, header, traced);
+    if (length > 0) memcpy(&tracePayload[traced], data, length < sizeof(tracePayload) - traced ? length : sizeof(tracePayload) - traced);
+    //Wire time decides the driver timeout - a whole page at 100kHz takes longer than the usual 10ms.
+    TickType_t timeout = 10/portTICK_PERIOD_MS + SUS_I2C_BusTime_us(I2CportNumber, 1 + headerLength + length, 1) / 1000 / portTICK_PERIOD_MS;
+
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 1 + headerLength + length, 1);  //Bandwidth budget: wait for it BEFORE taking the bus.
+    if (outcome != ESP_OK) return outcome;
+    bool arbitrated = (SUS_I2C_BusAcquire(I2CportNumber, display->priority) == ESP_OK);
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+        i2c_master_start(cmdSeq);
+        i2c_master_write_byte(cmdSeq,(I2CdeviceAddress<<1)|I2C_MASTER_WRITE,true);
+        i2c_master_write(cmdSeq,header,headerLength,true);
+        if (length > 0) i2c_master_write(cmdSeq,data,length,true);
+        i2c_master_stop(cmdSeq);
+    int64_t startTime = esp_timer_get_time();
+    outcome = i2c_master_cmd_begin(I2CportNumber,cmdSeq,timeout);
+    i2c_cmd_link_delete(cmdSeq);
+    if (arbitrated) SUS_I2C_BusRelease(I2CportNumber);    //Run done - whoever is waiting with a higher priority goes now.
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, tracePayload, headerLength + length, NULL, 0, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    return outcome;
+}
+
+/**SUS_I2C_DisplayCommands: Sends controller commands (contrast, invert, display on/off, scrolling...) in one transaction. Does NOT print anything on success.
+ * PARAMETER "commands" are the command bytes with their parameters, as listed in the datasheet. Any amount.
+ * RETURNS ESP_OK if the display ACKed everything, otherwise the ESP-IDF error code.
+ * EXAMPLE USE: const uint8_t dim[] = {0x81, 0x10};
+ *              SUS_I2C_DisplayCommands(&oled, dim, sizeof(dim)); //Contrast down to 0x10.
+*/
+esp_err_t SUS_I2C_DisplayCommands(struct SUS_I2C_Display *display, const uint8_t *commands, size_t length)
+{
+    const uint8_t control = SUS_I2C_DISPLAY_CONTROL_STREAM;
+    esp_err_t outcome = SUS_I2C_DisplayTransfer(display, &control, 1, commands, length);
+    if (outcome != ESP_OK)
+        ESP_LOGE("I2C DISPLAY","[I2C PORT %d], [Device %#04x] : display commands FAILED. Code %#04x.",display->I2CportNumber,display->I2CdeviceAddress,outcome);
+    return outcome;
+}
+
+/**SUS_I2C_DisplayResetStats: Starts counting frames, bytes and time from zero (e.g. when a new screen of your UI opens).
+ * EXAMPLE USE: SUS_I2C_DisplayResetStats(&oled);
+*/
+void SUS_I2C_DisplayResetStats(struct SUS_I2C_Display *display)
+{
+    display->frames = 0;
+    display->lastRuns = display->lastBytes = display->lastSaved = display->lastFlush_us = 0;
+    display->totalBytes = display->totalSaved = display->totalFlush_us = 0;
+    display->statsSince_us = esp_timer_get_time();
+}
+
+/**SUS_I2C_DisplayInvalidate: Forgets what the display shows. The next SUS_I2C_DisplayFlush sends the whole picture.
+ * EXAMPLE USE: gpio_set_level(OLED_RESET, 0); ... SUS_I2C_DisplayInit(&oled); //Init invalidates for you. After a glitch without re-init: SUS_I2C_DisplayInvalidate(&oled);
+*/
+void SUS_I2C_DisplayInvalidate(struct SUS_I2C_Display *display)
+{
+    display->knownPages = 0;
+}
+
+/**SUS_I2C_DisplayClear: Clears the framebuffer (all pixels off). Like all drawing, it reaches the display with the next SUS_I2C_DisplayFlush.
+ * EXAMPLE USE: SUS_I2C_DisplayClear(&oled);
+*/
+void SUS_I2C_DisplayClear(struct SUS_I2C_Display *display)
+{
+    memset(display->framebuffer, 0, sizeof(display->framebuffer));
+}
+
+/**SUS_I2C_DisplaySetPixel: Switches one pixel of the framebuffer on or off. Pixels outside the display are ignored.
+ * PARAMETER "x" is the column (0 = left), "y" the row (0 = top).
+ * EXAMPLE USE: for (int x = 0; x < 128; x++) SUS_I2C_DisplaySetPixel(&oled, x, 63, true); //Line along the bottom edge.
+*/
+void SUS_I2C_DisplaySetPixel(struct SUS_I2C_Display *display, int x, int y, bool on)
+{
+    if (x < 0 || y < 0 || x >= display->width || y >= display->height) return;
+    if (on) display->framebuffer[y / 8][x] |= (uint8_t)(1u << (y % 8));
+    else display->framebuffer[y / 8][x] &= (uint8_t)~(1u << (y % 8));
+}
+
+/**SUS_I2C_DisplayFlush: Sends what changed in the framebuffer since the last flush - see the description of this section. Does NOT print anything on success.
+ * Stops at the first run that fails. That page is sent whole next time, pages not reached yet are compared again next time.
+ * RETURNS ESP_OK if everything that changed is on the display (also when nothing changed), otherwise the ESP-IDF error code of the failed run.
+ * EXAMPLE USE: SUS_I2C_DisplaySetPixel(&oled, 10, 10, true);
+ *              SUS_I2C_DisplayFlush(&oled); //One 9-byte transaction instead of a 1 KB frame.
+*/
+esp_err_t SUS_I2C_DisplayFlush(struct SUS_I2C_Display *display)
+{
+    int64_t startTime = esp_timer_get_time();
+    uint32_t runs = 0, bytes = 0;
+    uint32_t fullFrame = (uint32_t)(display->height / 8) * (SUS_I2C_DISPLAY_RUN_OVERHEAD + display->width);
+    esp_err_t outcome = ESP_OK;
+    int failedPage = -1;
+
+    for (int page = 0; page < display->height / 8 && outcome == ESP_OK; page++)
+    {
+        const uint8_t *now = display->framebuffer[page];
+        uint8_t *shown = display->shown[page];
+        bool known = display->knownPages & (1u << page);
+        if (known && memcmp(now, shown, display->width) == 0) continue;    //Dirty page check first - most pages of most frames did not change.
+
+        for (int x = 0; x < display->width && outcome == ESP_OK; )
+        {
+            if (known && now[x] == shown[x]) { x++; continue; }
+            int start = x, end = x + 1;                                 //Run of columns to send: start ... end-1.
+            for (int next = end; next < display->width && next - end <= SUS_I2C_DISPLAY_MAX_GAP; next++)
+                if (!known || now[next] != shown[next]) end = next + 1;  //Another change close enough - the run grows over the gap.
+            uint8_t column = (uint8_t)(start + display->columnOffset);
+            const uint8_t header[SUS_I2C_DISPLAY_RUN_OVERHEAD - 1] = {
+                SUS_I2C_DISPLAY_CONTROL_COMMAND, (uint8_t)(0xB0 | page),
+                SUS_I2C_DISPLAY_CONTROL_COMMAND, (uint8_t)(0x00 | (column & 0x0F)),
+                SUS_I2C_DISPLAY_CONTROL_COMMAND, (uint8_t)(0x10 | (column >> 4)),
+                SUS_I2C_DISPLAY_CONTROL_DATA};
+            outcome = SUS_I2C_DisplayTransfer(display, header, sizeof(header), &now[start], (size_t)(end - start));
+            runs++;
+            bytes += SUS_I2C_DISPLAY_RUN_OVERHEAD + (uint32_t)(end - start);
+            if (outcome == ESP_OK) memcpy(&shown[start], &now[start], (size_t)(end - start));
+            x = end;
+        }
+        if (outcome == ESP_OK) display->knownPages |= (uint8_t)(1u << page);
+        else {
+            display->knownPages &= (uint8_t)~(1u << page);            //Half-written run: no idea what the page shows now.
+            failedPage = page;
+        }
+    }
+
+    display->frames++;
+    display->lastRuns = runs;
+    display->lastBytes = bytes;
+    display->lastSaved = bytes < fullFrame ? fullFrame - bytes : 0;
+    display->lastFlush_us = (uint32_t)(esp_timer_get_time() - startTime);
+    display->totalBytes += bytes;
+    display->totalSaved += display->lastSaved;
+    display->totalFlush_us += display->lastFlush_us;
+    if (outcome != ESP_OK)
+        ESP_LOGE("I2C DISPLAY","[I2C PORT %d], [Device %#04x] : frame FAILED in page %d, it is sent again with the next flush. Code %#04x.",
+                 display->I2CportNumber,display->I2CdeviceAddress,failedPage,outcome);
+    return outcome;
+}
+
+/**SUS_I2C_DisplayInit: Sets up an SSD1306 or SH1106 controller (page addressing, charge pump, orientation, contrast), clears the screen and switches it on.
+ * Fill in the "YOU" part of the struct first - see struct SUS_I2C_Display. Also resets the statistics.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG if the size/controller make no sense, otherwise the ESP-IDF error code.
+ * EXAMPLE USE: static struct SUS_I2C_Display oled = {.I2CportNumber=0, .I2CdeviceAddress=0x3C, .controller=SUS_I2C_DISPLAY_SH1106, .columnOffset=2};
+ *              SUS_I2C_DisplayInit(&oled); //1.3" 128x64 SH1106 module.
+*/
+esp_err_t SUS_I2C_DisplayInit(struct SUS_I2C_Display *display)
+{
+    const char *I2C_DISPLAY_TAG = "I2C DISPLAY";
+    const uint8_t displayOn = 0xAF;
+    uint8_t setup[32];
+    size_t n = 0;
+    esp_err_t outcome;
+
+    if (display->width == 0) display->width = 128;
+    if (display->height == 0) display->height = 64;
+    if (display->controller > SUS_I2C_DISPLAY_SH1106 || display->height % 8 != 0 || display->height > 8 * SUS_I2C_DISPLAY_MAX_PAGES ||
+        display->width + display->columnOffset > SUS_I2C_DISPLAY_MAX_WIDTH)
+        return ESP_ERR_INVALID_ARG;
+    bool sh1106 = (display->controller == SUS_I2C_DISPLAY_SH1106);
+
+    setup[n++] = 0xAE;                                              //Display off while setting up.
+    setup[n++] = 0xD5; setup[n++] = 0x80;                           //Oscillator/clock divider: datasheet default.
+    setup[n++] = 0xA8; setup[n++] = (uint8_t)(display->height - 1); //Multiplex ratio = amount of rows.
+    setup[n++] = 0xD3; setup[n++] = 0x00;                           //No vertical shift.
+    setup[n++] = 0x40;                                              //Start line 0.
+    if (sh1106) { setup[n++] = 0xAD; setup[n++] = 0x8B; }           //SH1106: DC-DC converter on.
+    else {
+        setup[n++] = 0x8D; setup[n++] = 0x14;                       //SSD1306: charge pump on.
+        setup[n++] = 0x20; setup[n++] = 0x02;                       //SSD1306: page addressing (the reset default, but a warm restart keeps whatever was set). SH1106 only has page addressing.
+    }
+    setup[n++] = 0xA1;                                              //Column 0 on the left, ...
+    setup[n++] = 0xC8;                                              //... row 0 on top (how the usual modules are wired).
+    setup[n++] = 0xDA; setup[n++] = display->height > 32 ? 0x12 : 0x02;    //COM pin layout: alternative for 64 rows, sequential for 32 and less.
+    setup[n++] = 0x81; setup[n++] = 0xCF;                           //Contrast.
+    setup[n++] = 0xD9; setup[n++] = sh1106 ? 0x22 : 0xF1;           //Pre-charge period.
+    setup[n++] = 0xDB; setup[n++] = 0x40;                           //VCOMH deselect level.
+    setup[n++] = 0xA4;                                              //Show the memory contents...
+    setup[n++] = 0xA6;                                              //... not inverted.
+
+    outcome = SUS_I2C_DisplayCommands(display, setup, n);
+    if (outcome == ESP_OK) {                                        //Blank memory BEFORE switching on - no flash of random pixels.
+        SUS_I2C_DisplayClear(display);
+        SUS_I2C_DisplayInvalidate(display);
+        outcome = SUS_I2C_DisplayFlush(display);
+    }
+    if (outcome == ESP_OK) outcome = SUS_I2C_DisplayCommands(display, &displayOn, 1);
+    SUS_I2C_DisplayResetStats(display);
+    if (outcome != ESP_OK) {
+        ESP_LOGE(I2C_DISPLAY_TAG,"[I2C PORT %d], [Device %#04x] : display setup FAILED. Code %#04x.",display->I2CportNumber,display->I2CdeviceAddress,outcome);
+        return outcome;
+    }
+    ESP_LOGI(I2C_DISPLAY_TAG,"[I2C PORT %d], [Device %#04x] : %s %dx%d display ready.",display->I2CportNumber,display->I2CdeviceAddress,
+             sh1106 ? "SH1106" : "SSD1306",display->width,display->height);
+    return ESP_OK;
+}
+
+/**SUS_I2C_DisplayPrintReport: Prints the frame rate and how many bytes per frame were sent and saved (compared to sending every frame whole).
+ * EXAMPLE USE: SUS_I2C_DisplayPrintReport(&oled);
+*/
+void SUS_I2C_DisplayPrintReport(struct SUS_I2C_Display *display)
+{
+    const char *I2C_DISPLAY_TAG = "I2C DISPLAY";
+    uint32_t frames = display->frames ? display->frames : 1;
+    int64_t elapsed = esp_timer_get_time() - display->statsSince_us;
+    uint32_t fullFrame = (uint32_t)(display->height / 8) * (SUS_I2C_DISPLAY_RUN_OVERHEAD + display->width);
+
+    ESP_LOGI(I2C_DISPLAY_TAG,"[I2C PORT %d], [Device %#04x] : %lu frames, %.1f frames/s. Flush takes %lu us on average (bus-limited maximum %.0f frames/s).",
+             display->I2CportNumber,display->I2CdeviceAddress,(unsigned long)display->frames,elapsed > 0 ? display->frames * 1e6 / elapsed : 0.0,
+             (unsigned long)(display->totalFlush_us / frames),display->totalFlush_us ? 1e6 * frames / display->totalFlush_us : 0.0);
+    ESP_LOGI(I2C_DISPLAY_TAG,"[I2C PORT %d], [Device %#04x] : %lu bytes per frame on average, %lu saved per frame (full frame = %lu bytes). Latest frame: %lu bytes in %lu runs.",
+             display->I2CportNumber,display->I2CdeviceAddress,(unsigned long)(display->totalBytes / frames),(unsigned long)(display->totalSaved / frames),
+             (unsigned long)fullFrame,(unsigned long)display->lastBytes,(unsigned long)display->lastRuns);
+}
+#endif //SUS_I2C_FEATURE_DISPLAY
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌
+ ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀
+*/
+
+/* BOOT ORCHESTRATOR: bringing all devices up at the same time instead of one after another.
+ * A typical boot: switch the PMIC rails on, wait 5 ms, reset the IMU, wait 100 ms, reset the barometer, wait until it's ready, reset the touch
+ * controller, wait 300 ms... Written as one straight chain, the boot takes the SUM of every device's delays, and the CPU sleeps through most of it.
+ * Here every device describes its own bring-up: a list of steps, each with the time the device needs afterwards, plus which devices must be up
+ * before it can start (the PMIC that powers it, the mux that routes to it). SUS_I2C_Boot() then runs all of them at once: while one device waits
+ * out its delay, the steps of the others get done - on both I2C ports. The boot takes as long as its longest chain of dependent devices
+ * (the CRITICAL PATH), not the sum of all of them.
+ * Steps:
+ *      SUS_I2C_BOOT_WRITE  writes data[0..length-1] to the device in one transaction ({register, value, ...} or a command), then gives it delay_us.
+ *      SUS_I2C_BOOT_POLL   reads register data[0] until (value & data[1]) == data[2] - "wait for the ready bit". A device that NACKs while it
+ *                          starts up just isn't ready yet. Gives up with ESP_ERR_TIMEOUT after delay_us. Polls every SUS_I2C_BOOT_POLL_INTERVAL_US.
+ *      SUS_I2C_BOOT_CALL   calls function(argument) - a reset or enable GPIO, anything that is not an I2C transaction - then gives it delay_us.
+ * The delay of the last step belongs to the device: devices that depend on it start after it.
+ * A device whose step fails stops there, the devices that depend on it are not started. All the others carry on.
+ * Afterwards every device has its start and ready times, its bus time and its waiting time filled in. SUS_I2C_BootPrintReport() prints them,
+ * the critical path, and what the same boot would take one device after another.
+ * Good to know:
+ *      - Waits are rounded up to whole RTOS ticks, like vTaskDelay. The steps run one at a time from the calling task: transactions take
+ *        microseconds, the waits milliseconds - that's where the time is won.
+ *      - The orchestrator knows nothing about I2C muxes. Two devices behind DIFFERENT channels of one mux: let one depend on the other,
+ *        and give each a channel select as its first step.
+ *      - Run it after SUS_I2C_Master_Init of the ports it uses, before anything else (scheduler, presence monitor...) starts using the bus.
+ */
+#define SUS_I2C_BOOT_MAX_DEVICES        32
+#define SUS_I2C_BOOT_MAX_DEPENDENCIES   4
+#define SUS_I2C_BOOT_MAX_DATA           8       // Longest WRITE step in bytes, register address included.
+#define SUS_I2C_BOOT_POLL_INTERVAL_US   1000    // How often a POLL step asks again (rounded up to whole RTOS ticks).
+
+#define SUS_I2C_BOOT_WRITE              0
+#define SUS_I2C_BOOT_POLL               1
+#define SUS_I2C_BOOT_CALL               2
+
+struct SUS_I2C_BootStep
+{
+    uint8_t   action;                           // SUS_I2C_BOOT_WRITE, SUS_I2C_BOOT_POLL or SUS_I2C_BOOT_CALL.
+    uint8_t   length;                           // WRITE: how many bytes of data to write.
+    uint8_t   data[SUS_I2C_BOOT_MAX_DATA];      // WRITE: the bytes, e.g. {register, value}. POLL: {register, mask, expected value}.
+    esp_err_t (*function)(void *argument);      // CALL: your function. Return ESP_OK, or an error to fail this device.
+    void      *argument;
+    uint32_t  delay_us;                         // WRITE/CALL: time the device needs before its next step (see the datasheet). POLL: give up after this long.
+};
+
+struct SUS_I2C_BootDevice
+{
+    /*----- Filled in by YOU -----*/
+    const char *name;                           // For the report, e.g. "IMU". Can be NULL.
+    uint8_t   I2CportNumber;
+    uint8_t   I2CdeviceAddress;
+    const struct SUS_I2C_BootStep *step;
+    uint8_t   stepCount;
+    struct SUS_I2C_BootDevice *after[SUS_I2C_BOOT_MAX_DEPENDENCIES];   // Devices (of the same boot) that must be up before this one starts. Unused = NULL.
+    bool      optional;                         // true = the boot still counts as successful if this device fails (its dependents are still skipped).
+    /*----- Filled in by SUS_I2C_Boot -----*/
+    esp_err_t outcome;                          // ESP_OK, the error of the step that failed, or ESP_ERR_INVALID_STATE = not started, a device it depends on failed.
+    uint8_t   stepsDone;
+    uint32_t  start_us;                         // When its first step started, counted from the start of the boot.
+    uint32_t  ready_us;                         // When it was up (last step + its delay), or when it failed.
+    uint32_t  busy_us;                          // Time spent in its steps: transactions, your functions.
+    uint32_t  waited_us;                        // Time spent waiting for it: delays and polling.
+    struct SUS_I2C_BootDevice *gatedBy;         // The dependency that came up last, i.e. the one it waited for. NULL = started right away.
+};
+
+struct SUS_I2C_Boot
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   deviceCount;
+    struct SUS_I2C_BootDevice *device;
+    /*----- Filled in by SUS_I2C_Boot -----*/
+    uint32_t  total_us;                         // The whole bring-up.
+    uint32_t  serial_us;                        // What it would take one device after another: the sum of every device's ready_us - start_us.
+    uint32_t  criticalPath_us;                  // Own time (ready_us - start_us) of the devices on the critical path. The boot can't be faster than this.
+    struct SUS_I2C_BootDevice *last;            // The device that was up last = the end of the critical path. Follow gatedBy back to its start.
+};
+
+#if SUS_I2C_FEATURE_BOOT
+#define SUS_I2C_BOOT_BLOCKED            0       // Internal device states: waiting for its dependencies,
+#define SUS_I2C_BOOT_RUNNING            1       // doing its steps,
+#define SUS_I2C_BOOT_UP                 2       // done,
+#define SUS_I2C_BOOT_FAILED             3       // failed or skipped.
+
+//POLL step read: SUS_I2C_ReadRegisters without the error message - a device that NACKs while it starts up is expected here.
+static esp_err_t SUS_I2C_BootPollRead(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t *value)
+{
+    esp_err_t outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, 4, 2);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_read_device(I2CportNumber,I2CdeviceAddress,&registerAddress,1,value,1,10/portTICK_PERIOD_MS);
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, &registerAddress, 1, value, 1, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    return outcome;
+}
+
+//Index of a device in boot->device, -1 if it's not one of them.
+static int SUS_I2C_BootIndex(struct SUS_I2C_Boot *boot, struct SUS_I2C_BootDevice *device)
+{
+    for (int i = 0; i < boot->deviceCount; i++)
+        if (&boot->device[i] == device) return i;
+    return -1;
+}
+
+//Checks the steps and the dependencies. A dependency cycle (A after B, B after A) would wait forever: every device must be reachable from the ones without dependencies.
+static esp_err_t SUS_I2C_BootCheck(struct SUS_I2C_Boot *boot)
+{
+    bool placed[SUS_I2C_BOOT_MAX_DEVICES] = {false};
+    int placedCount = 0;
+    bool progress = true;
+
+    if (boot->device == NULL || boot->deviceCount == 0 || boot->deviceCount > SUS_I2C_BOOT_MAX_DEVICES) return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        struct SUS_I2C_BootDevice *device = &boot->device[i];
+        if (device->stepCount > 0 && device->step == NULL) return ESP_ERR_INVALID_ARG;
+        for (int s = 0; s < device->stepCount; s++)
+        {
+            const struct SUS_I2C_BootStep *step = &device->step[s];
+            if (step->action > SUS_I2C_BOOT_CALL || (step->action == SUS_I2C_BOOT_CALL && step->function == NULL) ||
+                (step->action == SUS_I2C_BOOT_WRITE && (step->length == 0 || step->length > SUS_I2C_BOOT_MAX_DATA))) return ESP_ERR_INVALID_ARG;
+        }
+        for (int k = 0; k < SUS_I2C_BOOT_MAX_DEPENDENCIES; k++)
+        {
+            if (device->after[k] == NULL) continue;
+            int dependency = SUS_I2C_BootIndex(boot, device->after[k]);
+            if (dependency < 0 || dependency == i) return ESP_ERR_INVALID_ARG;
+        }
+    }
+    while (progress)
+    {
+        progress = false;
+        for (int i = 0; i < boot->deviceCount; i++)
+        {
+            bool startable = !placed[i];
+            for (int k = 0; k < SUS_I2C_BOOT_MAX_DEPENDENCIES && startable; k++)
+                if (boot->device[i].after[k] && !placed[SUS_I2C_BootIndex(boot, boot->device[i].after[k])]) startable = false;
+            if (startable) {
+                placed[i] = true;
+                placedCount++;
+                progress = true;
+            }
+        }
+    }
+    return placedCount == boot->deviceCount ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/**SUS_I2C_Boot: Brings all devices of a boot description up, running the steps of independent devices during each other's waits (see BOOT ORCHESTRATOR above).
+ * Returns when every device is up, failed or was skipped. Does NOT print anything on success, errors are still printed.
+ * PARAMETER "boot" lists the devices - see struct SUS_I2C_Boot. Times, outcomes and the critical path are written back into it.
+ * RETURNS ESP_OK if every device that isn't optional came up, ESP_ERR_INVALID_ARG if the description makes no sense (bad step, a dependency that is not
+ * in the list, a dependency cycle) - then nothing was done, or the outcome of the first device that isn't optional and didn't come up.
+ * EXAMPLE USE: static const struct SUS_I2C_BootStep pmicSteps[] = {{.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x10, 0x0F}, .delay_us=5000}};      //Rails on, 5 ms to settle.
+ *              static const struct SUS_I2C_BootStep imuSteps[] = {{.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x6B, 0x80}, .delay_us=100000},       //Reset, 100 ms.
+ *                                                                 {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x6B, 0x01}}};                       //Wake up.
+ *              static struct SUS_I2C_BootDevice device[2] = {{.name="PMIC", .I2CportNumber=0, .I2CdeviceAddress=0x34, .step=pmicSteps, .stepCount=1},
+ *                                                            {.name="IMU", .I2CportNumber=0, .I2CdeviceAddress=0x68, .step=imuSteps, .stepCount=2, .after={&device[0]}}};
+ *              struct SUS_I2C_Boot boot = {.deviceCount=2, .device=device};
+ *              SUS_I2C_Boot(&boot);
+ *              SUS_I2C_BootPrintReport(&boot);
+*/
+esp_err_t SUS_I2C_Boot(struct SUS_I2C_Boot *boot)
+{
+    const char *I2C_BOOT_TAG = "I2C BOOT";
+    uint8_t state[SUS_I2C_BOOT_MAX_DEVICES];
+    int64_t next[SUS_I2C_BOOT_MAX_DEVICES];         //When the device's next step may run (or when it is up, after its last step).
+    int64_t pollSince[SUS_I2C_BOOT_MAX_DEVICES];    //When its current POLL step started, 0 = not polling.
+    esp_err_t outcome = ESP_OK;
+
+    if (SUS_I2C_BootCheck(boot) != ESP_OK) {
+        ESP_LOGE(I2C_BOOT_TAG,"Boot description is invalid (bad step, unknown dependency or a dependency cycle). Nothing was done.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    int pending = boot->deviceCount;
+    int64_t bootStart = esp_timer_get_time();
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        struct SUS_I2C_BootDevice *device = &boot->device[i];
+        state[i] = SUS_I2C_BOOT_BLOCKED;
+        next[i] = 0;
+        pollSince[i] = 0;
+        device->outcome = ESP_OK;
+        device->stepsDone = 0;
+        device->start_us = device->ready_us = device->busy_us = device->waited_us = 0;
+        device->gatedBy = NULL;
+    }
+
+    while (pending > 0)
+    {
+        bool progressed = false;
+        int64_t wake = INT64_MAX;
+        for (int i = 0; i < boot->deviceCount; i++)
+        {
+            struct SUS_I2C_BootDevice *device = &boot->device[i];
+            int64_t now = esp_timer_get_time();
+            if (state[i] == SUS_I2C_BOOT_BLOCKED) {         //Starts once everything it depends on is up.
+                bool ready = true, skipped = false;
+                for (int k = 0; k < SUS_I2C_BOOT_MAX_DEPENDENCIES; k++)
+                {
+                    struct SUS_I2C_BootDevice *dependency = device->after[k];
+                    if (dependency == NULL) continue;
+                    uint8_t dependencyState = state[SUS_I2C_BootIndex(boot, dependency)];
+                    if (dependencyState == SUS_I2C_BOOT_FAILED) skipped = true;
+                    else if (dependencyState != SUS_I2C_BOOT_UP) ready = false;
+                    else if (device->gatedBy == NULL || dependency->ready_us > device->gatedBy->ready_us) device->gatedBy = dependency;
+                }
+                if (skipped) {
+                    state[i] = SUS_I2C_BOOT_FAILED;
+                    device->outcome = ESP_ERR_INVALID_STATE;
+                    device->start_us = device->ready_us = (uint32_t)(now - bootStart);
+                    pending--;
+                    progressed = true;
+                    ESP_LOGE(I2C_BOOT_TAG,"[I2C PORT %d], [Device %#04x] %s : NOT started, a device it depends on failed.",device->I2CportNumber,device->I2CdeviceAddress,device->name ? device->name : "");
+                    continue;
+                }
+                if (!ready) continue;
+                state[i] = SUS_I2C_BOOT_RUNNING;
+                device->start_us = (uint32_t)(now - bootStart);
+                next[i] = now;
+            }
+            if (state[i] != SUS_I2C_BOOT_RUNNING) continue;
+            if (next[i] > now) {                            //Still waiting for its delay.
+                if (next[i] < wake) wake = next[i];
+                continue;
+            }
+            if (device->stepsDone == device->stepCount) {   //Last step done and its delay over: up.
+                state[i] = SUS_I2C_BOOT_UP;
+                device->ready_us = (uint32_t)(next[i] - bootStart);
+                pending--;
+                progressed = true;
+                continue;
+            }
+
+            const struct SUS_I2C_BootStep *step = &device->step[device->stepsDone];
+            esp_err_t stepOutcome = ESP_OK;
+            bool stepDone = true;
+            uint8_t value = 0;
+            switch (step->action)
+            {
+            case SUS_I2C_BOOT_WRITE:
+                stepOutcome = SUS_I2C_WriteRegisters(device->I2CportNumber, device->I2CdeviceAddress, step->data[0], &step->data[1], step->length - 1);
+                break;
+            case SUS_I2C_BOOT_POLL:
+                if (pollSince[i] == 0) pollSince[i] = now;
+                stepOutcome = SUS_I2C_BootPollRead(device->I2CportNumber, device->I2CdeviceAddress, step->data[0], &value);
+                stepDone = (stepOutcome == ESP_OK && (value & step->data[1]) == step->data[2]);
+                if (!stepDone && esp_timer_get_time() - pollSince[i] < step->delay_us) stepOutcome = ESP_OK;     //Not ready yet, ask again later.
+                else if (!stepDone && stepOutcome == ESP_OK) stepOutcome = ESP_ERR_TIMEOUT;                      //Answers, but never got ready.
+                break;
+            case SUS_I2C_BOOT_CALL:
+                stepOutcome = step->function(step->argument);
+                break;
+            }
+            int64_t end = esp_timer_get_time();
+            device->busy_us += (uint32_t)(end - now);
+            progressed = true;
+
+            if (stepOutcome != ESP_OK) {
+                state[i] = SUS_I2C_BOOT_FAILED;
+                device->outcome = stepOutcome;
+                device->ready_us = (uint32_t)(end - bootStart);
+                pending--;
+                ESP_LOGE(I2C_BOOT_TAG,"[I2C PORT %d], [Device %#04x] %s : step %d FAILED. Code %#04x.",device->I2CportNumber,device->I2CdeviceAddress,
+                         device->name ? device->name : "",device->stepsDone + 1,stepOutcome);
+            }
+            else if (!stepDone) next[i] = end + SUS_I2C_BOOT_POLL_INTERVAL_US;
+            else {
+                pollSince[i] = 0;
+                device->stepsDone++;
+                next[i] = end + (step->action == SUS_I2C_BOOT_POLL ? 0 : step->delay_us);
+            }
+        }
+        if (!progressed && pending > 0) {                   //Everybody is waiting: sleep until the first one is due.
+            int64_t remaining = wake == INT64_MAX ? 1 : wake - esp_timer_get_time();
+            if (remaining > 0) vTaskDelay((remaining + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+        }
+    }
+
+    boot->total_us = (uint32_t)(esp_timer_get_time() - bootStart);
+    boot->serial_us = 0;
+    boot->criticalPath_us = 0;
+    boot->last = NULL;
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        struct SUS_I2C_BootDevice *device = &boot->device[i];
+        uint32_t own = device->ready_us - device->start_us;
+        device->waited_us = own > device->busy_us ? own - device->busy_us : 0;
+        boot->serial_us += own;
+        if (boot->last == NULL || device->ready_us > boot->last->ready_us) boot->last = device;
+        if (device->outcome != ESP_OK && !device->optional && outcome == ESP_OK) outcome = device->outcome;
+    }
+    for (struct SUS_I2C_BootDevice *device = boot->last; device != NULL; device = device->gatedBy)
+        boot->criticalPath_us += device->ready_us - device->start_us;
+    return outcome;
+}
+
+/**SUS_I2C_BootPrintReport: Prints how long the boot took, every device's timeline, the critical path, and what the boot would take one device after another.
+ * EXAMPLE USE: SUS_I2C_BootPrintReport(&boot);
+*/
+void SUS_I2C_BootPrintReport(struct SUS_I2C_Boot *boot)
+{
+    const char *I2C_BOOT_TAG = "I2C BOOT";
+    struct SUS_I2C_BootDevice *path[SUS_I2C_BOOT_MAX_DEVICES];
+    int pathLength = 0;
+
+    ESP_LOGI(I2C_BOOT_TAG,"Bring-up of %d devices took %lu us. One device after another: %lu us (%.1fx longer).",boot->deviceCount,(unsigned long)boot->total_us,
+             (unsigned long)boot->serial_us,boot->total_us ? (double)boot->serial_us / boot->total_us : 0.0);
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        struct SUS_I2C_BootDevice *device = &boot->device[i];
+        ESP_LOGI(I2C_BOOT_TAG,"[I2C PORT %d], [Device %#04x] %-12s: start %7lu us, up %7lu us, %6lu us busy, %7lu us waiting. %s Code %#04x.",
+                 device->I2CportNumber,device->I2CdeviceAddress,device->name ? device->name : "",(unsigned long)device->start_us,(unsigned long)device->ready_us,
+                 (unsigned long)device->busy_us,(unsigned long)device->waited_us,
+                 device->outcome == ESP_OK ? "OK." : device->outcome == ESP_ERR_INVALID_STATE ? "NOT STARTED." : "FAILED.",device->outcome);
+    }
+    for (struct SUS_I2C_BootDevice *device = boot->last; device != NULL && pathLength < SUS_I2C_BOOT_MAX_DEVICES; device = device->gatedBy) path[pathLength++] = device;
+    ESP_LOGI(I2C_BOOT_TAG,"Critical path: %d devices, %lu us of their own steps and delays (+%lu us tick rounding and other devices' steps):",pathLength,
+             (unsigned long)boot->criticalPath_us,(unsigned long)(boot->total_us > boot->criticalPath_us ? boot->total_us - boot->criticalPath_us : 0));
+    for (int i = pathLength - 1; i >= 0; i--)
+        ESP_LOGI(I2C_BOOT_TAG,"    [I2C PORT %d], [Device %#04x] %-12s: %7lu -> %7lu us",path[i]->I2CportNumber,path[i]->I2CdeviceAddress,
+                 path[i]->name ? path[i]->name : "",(unsigned long)path[i]->start_us,(unsigned long)path[i]->ready_us);
+}
+#endif //SUS_I2C_FEATURE_BOOT
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌
+▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌
+▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* BLOCK DECODING: turning raw register bytes into numbers, a whole block of samples at a time.
+ * A burst read of an MPU6050 gives 14 bytes: accel X/Y/Z, temperature, gyro X/Y/Z - seven big-endian 16-bit values. Every driver then glues
+ * the bytes together, fixes the sign and multiplies by the sensitivity from the datasheet, one value at a time, with an "if" for the byte order
+ * and a function call per value. At a few hundred samples a second nobody notices. Draining a FIFO of 1000 frames, or decoding a recording of
+ * millions of frames on a PC, the conversion becomes the slow part.
+ * Here you describe the FRAME once - where the values are, their byte order, signed or not, and per value: engineering value = raw * scale + offset -
+ * and then convert whole blocks of frames in one call:
+ *      SUS_I2C_DecodeFixed()   integer results, fixed-point math, no floats and no branches in the loop. Made for the ESP32.
+ *      SUS_I2C_DecodeFloat()   float results. On a PC (SSE2 / NEON) it converts 8 values per step with vector instructions, on the ESP32 one at a time.
+ * Frames lie back to back in the raw block (frameLength bytes apart), every value is 16 bits, values of one frame follow each other from firstByte on.
+ * The results come out in the same order: value[frame * channelCount + channel].
+ * Good to know:
+ *      - Pick the scale for the INTEGER unit you want: mg instead of g, 0.01 degC instead of degC. DecodeFixed rounds to whole units,
+ *        DecodeFloat gives the same number with decimals. The two differ by at most 1 unit (the fixed-point scale has 16 fractional bits).
+ *      - 12-bit or 10-bit sensors that left-justify their values (LIS3DH...) are just 16-bit values with a 16x / 64x smaller scale.
+ *      - Call SUS_I2C_DecodePrepare() once after filling in the format (or after changing a scale, e.g. a new measuring range).
+ *
+ * EXAMPLE (MPU6050, +-2 g and +-250 deg/s, frame read with SUS_I2C_ReadRegisters(0,0x68,0x3B,frame,14)):
+ *      struct SUS_I2C_DecodeFormat mpu = {.name = "MPU6050", .frameLength = 14, .firstByte = 0, .channelCount = 7,
+ *                                         .flags = SUS_I2C_DECODE_BIG_ENDIAN | SUS_I2C_DECODE_SIGNED,
+ *                                         .scale  = {1000/16384.0f, 1000/16384.0f, 1000/16384.0f, 100/340.0f, 1000/131.0f, 1000/131.0f, 1000/131.0f},   //mg, 0.01 degC, mdps
+ *                                         .offset = {0, 0, 0, 3653, 0, 0, 0}};
+ *      SUS_I2C_DecodePrepare(&mpu);
+ *      int32_t values[64 * 7];
+ *      SUS_I2C_DecodeFixed(&mpu, frames, 64, values);          //64 frames -> 448 values. values[7*n + 3] = temperature of frame n in 0.01 degC.
+ */
+#define SUS_I2C_DECODE_MAX_CHANNELS     16      // Values per frame.
+
+#define SUS_I2C_DECODE_BIG_ENDIAN       0x01    // Most significant byte first (most sensors). Without it: least significant byte first.
+#define SUS_I2C_DECODE_SIGNED           0x02    // Two's complement values (-32768...32767). Without it: 0...65535.
+
+struct SUS_I2C_DecodeFormat
+{
+    /*----- Filled in by YOU -----*/
+    const char *name;                           // For error messages. Can be NULL.
+    uint8_t   frameLength;                      // Bytes from the start of one frame to the start of the next.
+    uint8_t   firstByte;                        // Where the first value starts inside the frame.
+    uint8_t   channelCount;                     // Values per frame, 16 bits each, back to back.
+    uint8_t   flags;                            // SUS_I2C_DECODE_... flags.
+    float     scale[SUS_I2C_DECODE_MAX_CHANNELS];   // Per value: engineering value = raw * scale + offset.
+    float     offset[SUS_I2C_DECODE_MAX_CHANNELS];
+    /*----- Filled in by SUS_I2C_DecodePrepare -----*/
+    bool      prepared;
+    uint8_t   highByte, lowByte;                // Where the high/low byte of a value is, relative to its first byte.
+    int32_t   signMask;                         // 0x8000 for signed values, 0 for unsigned: (raw ^ signMask) - signMask sign-extends without a branch.
+    int32_t   scaleQ16[SUS_I2C_DECODE_MAX_CHANNELS];    // scale * 65536, rounded.
+    int64_t   biasQ16[SUS_I2C_DECODE_MAX_CHANNELS];     // offset * 65536 + 0.5 (rounding), rounded.
+};
+
+#if SUS_I2C_FEATURE_DECODE
+#if (defined(__SSE2__) || defined(__ARM_NEON)) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SUS_I2C_DECODE_SIMD             1       // PC builds: 8 values per step with GCC/Clang vector types (SSE2 on x86-64, NEON on ARM).
+#define SUS_I2C_DECODE_TILE             8       // Frames per step: channelCount * 8 values is always a whole number of vectors.
+typedef uint16_t SUS_I2C_DecodeWords  __attribute__((vector_size(16)));    // 8 raw values, as they lie in memory.
+typedef int32_t  SUS_I2C_DecodeInts   __attribute__((vector_size(32)));    // The same 8, widened.
+typedef float    SUS_I2C_DecodeFloats __attribute__((vector_size(32)));
+#else
+#define SUS_I2C_DECODE_SIMD             0
+#endif
+
+/**SUS_I2C_DecodePrepare: Checks a frame format and works out the fixed-point constants the decoders use. Call it once after filling the format in.
+ * Does NOT print anything on success, errors are still printed.
+ * RETURNS ESP_OK, or ESP_ERR_INVALID_ARG if the values don't fit in the frame or a scale/offset would overflow the 32-bit integer results.
+ * EXAMPLE USE: see the MPU6050 example above.
+*/
+esp_err_t SUS_I2C_DecodePrepare(struct SUS_I2C_DecodeFormat *format)
+{
+    const char *I2C_DECODE_TAG = "I2C DECODE";
+    const char *name = format->name ? format->name : "";
+
+    format->prepared = false;
+    if (format->channelCount == 0 || format->channelCount > SUS_I2C_DECODE_MAX_CHANNELS || format->firstByte + 2 * format->channelCount > format->frameLength) {
+        ESP_LOGE(I2C_DECODE_TAG,"Format %s: %d values of 2 bytes from byte %d don't fit in a %d byte frame (or more than %d values).",name,
+                 format->channelCount,format->firstByte,format->frameLength,SUS_I2C_DECODE_MAX_CHANNELS);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int c = 0; c < format->channelCount; c++)
+    {
+        float scale = format->scale[c], offset = format->offset[c];
+        float largest = 65536.0f * (scale < 0 ? -scale : scale) + (offset < 0 ? -offset : offset);     //Biggest result any raw value can give.
+        if (!(largest < 2147483520.0f)) {               //Also catches NaN. 2^31 minus one float step.
+            ESP_LOGE(I2C_DECODE_TAG,"Format %s, value %d: scale %g and offset %g overflow a 32-bit result.",name,c,(double)scale,(double)offset);
+            return ESP_ERR_INVALID_ARG;
+        }
+        format->scaleQ16[c] = (int32_t)(scale * 65536.0f + (scale < 0 ? -0.5f : 0.5f));
+        format->biasQ16[c] = (int64_t)((double)offset * 65536.0 + (offset < 0 ? -0.5 : 0.5)) + 32768;
+    }
+    format->highByte = (format->flags & SUS_I2C_DECODE_BIG_ENDIAN) ? 0 : 1;
+    format->lowByte = 1 - format->highByte;
+    format->signMask = (format->flags & SUS_I2C_DECODE_SIGNED) ? 0x8000 : 0;
+    format->prepared = true;
+    return ESP_OK;
+}
+
+//Decoder argument check: a prepared format, and somewhere to read from and write to.
+static esp_err_t SUS_I2C_DecodeCheck(const struct SUS_I2C_DecodeFormat *format, const uint8_t *raw, size_t frames, const void *value)
+{
+    const char *I2C_DECODE_TAG = "I2C DECODE";
+    if (format == NULL || !format->prepared) {
+        ESP_LOGE(I2C_DECODE_TAG,"Format %s is not prepared - call SUS_I2C_DecodePrepare first.",format && format->name ? format->name : "");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (frames > 0 && (raw == NULL || value == NULL)) return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+/**SUS_I2C_DecodeFixed: Converts a block of raw frames into integers (engineering units, rounded), with fixed-point math only.
+ * Per value: two byte loads, a shift, a sign extension and one 32x32->64 bit multiply-add - the same instructions whatever the format, no branches.
+ * PARAMETER "raw" is frames * frameLength bytes, e.g. a FIFO burst. "value" must have room for frames * channelCount results.
+ * RETURNS ESP_OK, or ESP_ERR_INVALID_ARG if the format isn't prepared.
+ * EXAMPLE USE: int32_t values[64 * 7]; SUS_I2C_DecodeFixed(&mpu, fifo, 64, values);
+*/
+esp_err_t SUS_I2C_DecodeFixed(const struct SUS_I2C_DecodeFormat *format, const uint8_t *raw, size_t frames, int32_t *value)
+{
+    esp_err_t outcome = SUS_I2C_DecodeCheck(format, raw, frames, value);
+    if (outcome != ESP_OK) return outcome;
+
+    const uint8_t channels = format->channelCount, high = format->highByte, low = format->lowByte;
+    const int32_t signMask = format->signMask;
+    for (size_t f = 0; f < frames; f++)
+    {
+        const uint8_t *word = raw + f * format->frameLength + format->firstByte;
+        for (uint8_t c = 0; c < channels; c++, word += 2)
+        {
+            int32_t sample = ((int32_t)word[high] << 8) | word[low];
+            sample = (sample ^ signMask) - signMask;
+            *value++ = (int32_t)(((int64_t)sample * format->scaleQ16[c] + format->biasQ16[c]) >> 16);
+        }
+    }
+    return ESP_OK;
+}
+
+/**SUS_I2C_DecodeFloat: Converts a block of raw frames into floats (engineering units). On a PC it works on 8 values at once (SSE2 / NEON),
+ * on the ESP32 it's the plain loop - there, SUS_I2C_DecodeFixed is the faster one.
+ * PARAMETER "raw" is frames * frameLength bytes. "value" must have room for frames * channelCount results.
+ * RETURNS ESP_OK, or ESP_ERR_INVALID_ARG if the format isn't prepared.
+ * EXAMPLE USE: float values[1000 * 7]; SUS_I2C_DecodeFloat(&mpu, recording, 1000, values);
+*/
+esp_err_t SUS_I2C_DecodeFloat(const struct SUS_I2C_DecodeFormat *format, const uint8_t *raw, size_t frames, float *value)
+{
+    esp_err_t outcome = SUS_I2C_DecodeCheck(format, raw, frames, value);
+    if (outcome != ESP_OK) return outcome;
+
+    const uint8_t channels = format->channelCount, high = format->highByte, low = format->lowByte;
+    const int32_t signMask = format->signMask;
+    size_t f = 0;
+#if SUS_I2C_DECODE_SIMD
+    //Tiles of 8 frames: the scale/offset pattern repeats every tile, so it's laid out once, value by value, and read as whole vectors.
+    const size_t tileValues = (size_t)channels * SUS_I2C_DECODE_TILE, tileBytes = 2 * tileValues;
+    const uint16_t swap = (format->flags & SUS_I2C_DECODE_BIG_ENDIAN) ? 8 : 0;     //Big-endian: swap the bytes of every word, little-endian: shift by 0.
+    float scaleTile[SUS_I2C_DECODE_MAX_CHANNELS * SUS_I2C_DECODE_TILE], offsetTile[SUS_I2C_DECODE_MAX_CHANNELS * SUS_I2C_DECODE_TILE];
+    uint8_t packed[2 * SUS_I2C_DECODE_MAX_CHANNELS * SUS_I2C_DECODE_TILE];
+    for (size_t i = 0; i < tileValues; i++) {
+        scaleTile[i] = format->scale[i % channels];
+        offsetTile[i] = format->offset[i % channels];
+    }
+    for (; f + SUS_I2C_DECODE_TILE <= frames; f += SUS_I2C_DECODE_TILE, value += tileValues)
+    {
+        const uint8_t *tile = raw + f * format->frameLength + format->firstByte;
+        if (format->frameLength != 2 * channels) {      //Gaps between the frames' values (headers, status bytes): gather the values first.
+            for (int k = 0; k < SUS_I2C_DECODE_TILE; k++) memcpy(&packed[k * 2 * channels], tile + k * format->frameLength, 2 * channels);
+            tile = packed;
+        }
+        for (size_t i = 0; i < tileBytes; i += sizeof(SUS_I2C_DecodeWords))
+        {
+            SUS_I2C_DecodeWords words;
+            SUS_I2C_DecodeFloats scale, offset;
+            memcpy(&words, tile + i, sizeof(words));
+            memcpy(&scale, &scaleTile[i / 2], sizeof(scale));
+            memcpy(&offset, &offsetTile[i / 2], sizeof(offset));
+            words = (words << swap) | (words >> swap);
+            SUS_I2C_DecodeInts sample = __builtin_convertvector(words, SUS_I2C_DecodeInts);
+            sample = (sample ^ signMask) - signMask;
+            SUS_I2C_DecodeFloats result = __builtin_convertvector(sample, SUS_I2C_DecodeFloats) * scale + offset;
+            memcpy(&value[i / 2], &result, sizeof(result));
+        }
+    }
+#endif
+    for (; f < frames; f++)         //ESP32: everything, PC: the last frames that don't fill a tile.
+    {
+        const uint8_t *word = raw + f * format->frameLength + format->firstByte;
+        for (uint8_t c = 0; c < channels; c++, word += 2)
+        {
+            int32_t sample = ((int32_t)word[high] << 8) | word[low];
+            sample = (sample ^ signMask) - signMask;
+            *value++ = (float)sample * format->scale[c] + format->offset[c];
+        }
+    }
+    return ESP_OK;
+}
+#endif //SUS_I2C_FEATURE_DECODE
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄       ▄▄  ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌     ▐░░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░▌      ▐░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌░▌   ▐░▐░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀ ▐░▌░▌     ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌       ▐░▌▐░▌▐░▌ ▐░▌▐░▌▐░▌       ▐░▌     ▐░▌     ▐░▌▐░▌    ▐░▌▐░▌
+▐░▌          ▐░▌       ▐░▌▐░▌ ▐░▐░▌ ▐░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌     ▐░▌ ▐░▌   ▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░▌          ▐░▌       ▐░▌▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░▌      ▐░▌     ▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌
+▐░▌          ▐░▌       ▐░▌▐░▌   ▀   ▐░▌▐░█▀▀▀▀▀▀▀█░▌     ▐░▌     ▐░▌   ▐░▌ ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌     ▐░▌    ▐░▌▐░▌▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌ ▄▄▄▄█░█▄▄▄▄ ▐░▌     ▐░▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░▌      ▐░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* WRITE COMBINING: many small writes to one device, sent as one transaction.
+ * Display init sequences, LED drivers updating channel after channel, DACs getting a stream of values: lots of tiny writes, each one a transaction
+ * of its own - START, address, 1-2 bytes, STOP - and on the ESP32 each also pays SUS_I2C_TRANSACTION_OVERHEAD_US of driver time, more than the bytes themselves.
+ * A combiner is a small buffer in front of ONE device. Writes go into the buffer instead of onto the bus, and leave as ONE transaction:
+ *      - a write that continues the previous one is appended to it (see the flags below) - no register address, no START, no device address again,
+ *      - any other write becomes its own part of the transaction: REPEATED START, device address, its bytes. Still no STOP, no extra driver call.
+ * The buffer is sent ("flushed"):
+ *      - when it holds "threshold" bytes (or is full),
+ *      - when you call SUS_I2C_CombineFlush() for this device, or SUS_I2C_CombineBarrier() for all of them (before you toggle a latch/LDAC pin, go to sleep...),
+ *      - when its oldest write has waited "timeout_us" - by a small flush task of the combiner, woken by an esp_timer (the esp_timer task itself never waits for the bus),
+ *      - right before ANY other transaction to the same device - a read, a write without the combiner, a general call on its port. The library checks this
+ *        on every transaction (in SUS_I2C_BudgetCharge), so nothing can overtake the writes that are waiting, and a read always sees them.
+ * Flags:
+ *      SUS_I2C_COMBINE_AUTO_INCREMENT  the device moves to the next register after every byte: a write to the register right after the last one
+ *                                      is appended (PCA9685 LED drivers, most sensors, EEPROM pages...).
+ *      SUS_I2C_COMBINE_STREAM          the first byte selects a stream that takes any number of bytes: a write with the same first byte is appended
+ *                                      (SSD1306 control byte 0x00 = commands / 0x40 = data, FIFO registers, DACs with a fast-write register...).
+ *      Neither: writes are never merged, but still share one transaction.
+ * Good to know:
+ *      - A write that is buffered returns ESP_OK. If the device then NACKs, you hear it from the call that flushed: the write that filled the buffer,
+ *        SUS_I2C_CombineFlush(), or - for timeout and ordering flushes - the combiner's failed/lastError counters (and the error log).
+ *        A failed flush drops what was in the buffer: which parts the device got can't be known.
+ *      - Only combine writes to devices that accept a REPEATED START between writes (nearly all do), and set a flag only if the device really works that way.
+ *      - Several tasks may use one combiner. Their writes are combined in the order they come in.
+ * SUS_I2C_CombinePrintReport() prints the combine ratio (writes per transaction) and the bus time saved.
+ *
+ * EXAMPLE (PCA9685 LED driver, 16 channels x 4 registers from LED0_ON_L = 0x06):
+ *      struct SUS_I2C_Combiner leds = {.I2CportNumber = 0, .I2CdeviceAddress = 0x40, .flags = SUS_I2C_COMBINE_AUTO_INCREMENT, .timeout_us = 2000};
+ *      SUS_I2C_CombineInit(&leds);
+ *      for (int channel = 0; channel < 16; channel++) {
+ *          SUS_I2C_CombineWriteRegister(&leds, 0x08 + 4 * channel, brightness[channel] & 0xFF);     //LEDn_OFF_L
+ *          SUS_I2C_CombineWriteRegister(&leds, 0x09 + 4 * channel, brightness[channel] >> 8);       //LEDn_OFF_H - appended, same burst.
+ *      }
+ *      SUS_I2C_CombineFlush(&leds);        //16 transactions instead of 32, 64 bytes less on the wire.
+ */
+#define SUS_I2C_COMBINE_MAX_BYTES       64      // Buffer per device: all waiting writes, their register/first bytes included.
+#define SUS_I2C_COMBINE_MAX_PARTS       16      // Unmerged writes in one transaction (each costs a REPEATED START and the address byte).
+#define SUS_I2C_COMBINE_TASK_STACK      3072    // Flush task of a combiner with a timeout...
+#define SUS_I2C_COMBINE_TASK_PRIORITY   10      // ...and its priority. Above the tasks that write, so a timeout is not late.
+
+#define SUS_I2C_COMBINE_AUTO_INCREMENT  0x01    // A write to the next register continues the previous write.
+#define SUS_I2C_COMBINE_STREAM          0x02    // A write with the same first byte continues the previous write.
+
+#define SUS_I2C_COMBINE_BY_THRESHOLD    0       // Why a buffer was sent: it was full enough,
+#define SUS_I2C_COMBINE_BY_FLUSH        1       // SUS_I2C_CombineFlush / SUS_I2C_CombineBarrier / SUS_I2C_CombineRemove,
+#define SUS_I2C_COMBINE_BY_TIMEOUT      2       // the oldest write waited timeout_us,
+#define SUS_I2C_COMBINE_BY_ORDER        3       // another transaction to the device came along.
+
+struct SUS_I2C_Combiner
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   I2CportNumber;
+    uint8_t   I2CdeviceAddress;
+    uint8_t   flags;                            // SUS_I2C_COMBINE_AUTO_INCREMENT and/or SUS_I2C_COMBINE_STREAM, or 0.
+    uint8_t   threshold;                        // Send when this many bytes are waiting. 0 = only when the buffer is full.
+    uint32_t  timeout_us;                       // Send when the oldest waiting write is this old. 0 = no timeout.
+    /*----- Statistics, filled in by the library -----*/
+    uint32_t  writes;                           // Writes handed to the combiner.
+    uint32_t  transactions;                     // Transactions it sent for them.
+    uint32_t  flushes[4];                       // Transactions per reason: [SUS_I2C_COMBINE_BY_THRESHOLD] ...
+    uint32_t  failed;                           // Transactions that failed (their writes are lost).
+    esp_err_t lastError;
+    uint64_t  separate_us;                      // Bus time (SUS_I2C_BusTime_us, driver overhead included) the writes would have taken one by one...
+    uint64_t  combined_us;                      // ...and what the combined transactions took.
+    /*----- Internal -----*/
+    uint8_t   buffer[SUS_I2C_COMBINE_MAX_BYTES];
+    uint8_t   length;                           // Bytes waiting.
+    uint8_t   partStart[SUS_I2C_COMBINE_MAX_PARTS];
+    uint8_t   partCount;
+    TaskHandle_t volatile flushingTask;         // Task sending the buffer right now (NULL = none): its own transaction must not flush again, any other task waits for the lock.
+    SemaphoreHandle_t lock;
+    esp_timer_handle_t timer;                   // Timeout only: wakes "task" when the oldest write is due...
+    TaskHandle_t task;                          // ...which sends the buffer.
+    volatile bool running;
+    volatile bool taskFinished;
+    int64_t   firstWrite_us;                    // When the oldest waiting write came in.
+    struct SUS_I2C_Combiner *next;
+};
+
+#if SUS_I2C_FEATURE_COMBINE
+static struct SUS_I2C_Combiner *SUS_I2C_CombineList = NULL;     //Every active combiner. New ones are added at the front.
+static portMUX_TYPE SUS_I2C_CombineListLock = portMUX_INITIALIZER_UNLOCKED;
+
+//Sends everything in the buffer as one transaction. Call with combiner->lock taken.
+static esp_err_t SUS_I2C_CombineSend(struct SUS_I2C_Combiner *combiner, int reason)
+{
+    const char *I2C_COMBINE_TAG = "I2C COMBINE";
+    uint8_t I2CportNumber = combiner->I2CportNumber, I2CdeviceAddress = combiner->I2CdeviceAddress;
+    esp_err_t outcome;
+
+    if (combiner->partCount == 0) return ESP_OK;
+    if (combiner->timer != NULL) esp_timer_stop(combiner->timer);      //Not armed is fine too.
+
+    i2c_cmd_handle_t cmdSeq = i2c_cmd_link_create();
+    for (int part = 0; part < combiner->partCount; part++)
+    {
+        uint8_t end = part + 1 < combiner->partCount ? combiner->partStart[part + 1] : combiner->length;
+        i2c_master_start(cmdSeq);                                       //START, then a REPEATED START before every further part.
+        i2c_master_write_byte(cmdSeq, (I2CdeviceAddress<<1)|I2C_MASTER_WRITE, true);
+        i2c_master_write(cmdSeq, &combiner->buffer[combiner->partStart[part]], end - combiner->partStart[part], true);
+    }
+    i2c_master_stop(cmdSeq);
+
+    combiner->flushingTask = xTaskGetCurrentTaskHandle();
+    outcome = SUS_I2C_BudgetCharge(I2CportNumber, I2CdeviceAddress, combiner->length + combiner->partCount, combiner->partCount);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_cmd_begin(I2CportNumber, cmdSeq, 10/portTICK_PERIOD_MS);
+    combiner->flushingTask = NULL;
+    i2c_cmd_link_delete(cmdSeq);
+    for (int part = 0; part < combiner->partCount; part++)              //Trace: one record per part, so a replay sends the same writes.
+    {
+        uint8_t end = part + 1 < combiner->partCount ? combiner->partStart[part + 1] : combiner->length;
+        SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE, &combiner->buffer[combiner->partStart[part]], end - combiner->partStart[part], NULL, 0, outcome, startTime);
+    }
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+
+    combiner->transactions++;
+    combiner->flushes[reason]++;
+    combiner->combined_us += SUS_I2C_BusTime_us(I2CportNumber, combiner->length + combiner->partCount, combiner->partCount);
+    if (outcome != ESP_OK) {
+        combiner->failed++;
+        combiner->lastError = outcome;
+        ESP_LOGE(I2C_COMBINE_TAG,"[I2C PORT %d], [Device %#04x] : combined write of %d bytes in %d parts FAILED, the bytes are lost. Code %#04x.",
+                 I2CportNumber,I2CdeviceAddress,combiner->length,combiner->partCount,outcome);
+    }
+    combiner->length = 0;
+    combiner->partCount = 0;
+    return outcome;
+}
+
+//esp_timer callback: the oldest write waited long enough. Only wakes the flush task - a send here would hold up every other esp_timer callback for a whole transaction.
+static void SUS_I2C_CombineTimeout(void *argument)
+{
+    struct SUS_I2C_Combiner *combiner = (struct SUS_I2C_Combiner *)argument;
+    xTaskNotifyGive(combiner->task);
+}
+
+//The flush task of a combiner with a timeout. The buffer may have been sent (and refilled) since the timer fired: only a write that is really due goes out now,
+//a newer one re-armed the timer already.
+static void SUS_I2C_CombineTask(void *argument)
+{
+    struct SUS_I2C_Combiner *combiner = (struct SUS_I2C_Combiner *)argument;
+
+    while (combiner->running)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);    //Sleep until the timer (or SUS_I2C_CombineRemove) wakes us up.
+        xSemaphoreTake(combiner->lock, portMAX_DELAY);
+        if (combiner->length > 0 && esp_timer_get_time() - combiner->firstWrite_us >= (int64_t)combiner->timeout_us) SUS_I2C_CombineSend(combiner, SUS_I2C_COMBINE_BY_TIMEOUT);
+        xSemaphoreGive(combiner->lock);
+    }
+    combiner->taskFinished = true;
+    vTaskDelete(NULL);
+}
+
+/**SUS_I2C_CombineOrder: Called by the library before every transaction (from SUS_I2C_BudgetCharge): sends the writes still waiting for that device first,
+ * so nothing overtakes them. Address 0 (general call) flushes every combiner on the port. You never need to call it yourself.
+*/
+void SUS_I2C_IRAM SUS_I2C_CombineOrder(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (struct SUS_I2C_Combiner *combiner = SUS_I2C_CombineList; combiner != NULL; combiner = combiner->next)
+    {
+        if (combiner->I2CportNumber != I2CportNumber || (I2CdeviceAddress != 0 && combiner->I2CdeviceAddress != I2CdeviceAddress)) continue;
+        //Nothing waiting, or this IS the combiner's own transaction. Another task's flush in progress: the lock below waits until it is on the wire.
+        if (combiner->length == 0 || combiner->flushingTask == self) continue;
+        xSemaphoreTake(combiner->lock, portMAX_DELAY);
+        SUS_I2C_CombineSend(combiner, SUS_I2C_COMBINE_BY_ORDER);
+        xSemaphoreGive(combiner->lock);
+    }
+}
+
+/**SUS_I2C_CombineInit: Puts a combiner in front of a device. Fill in port, address, flags, threshold and timeout first.
+ * Does NOT print anything on success, errors are still printed.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_STATE if the device already has a combiner, ESP_ERR_INVALID_ARG for a threshold above SUS_I2C_COMBINE_MAX_BYTES,
+ * ESP_ERR_NO_MEM if the lock, the timer or the flush task can't be created.
+ * EXAMPLE USE: see the PCA9685 example above.
+*/
+esp_err_t SUS_I2C_CombineInit(struct SUS_I2C_Combiner *combiner)
+{
+    const char *I2C_COMBINE_TAG = "I2C COMBINE";
+    esp_timer_create_args_t timerConfig = { .callback = SUS_I2C_CombineTimeout, .arg = combiner, .name = "sus_i2c_combine" };
+
+    if (combiner->threshold > SUS_I2C_COMBINE_MAX_BYTES) return ESP_ERR_INVALID_ARG;
+    for (struct SUS_I2C_Combiner *other = SUS_I2C_CombineList; other != NULL; other = other->next)
+        if (other == combiner || (other->I2CportNumber == combiner->I2CportNumber && other->I2CdeviceAddress == combiner->I2CdeviceAddress)) {
+            ESP_LOGE(I2C_COMBINE_TAG,"[I2C PORT %d], [Device %#04x] : already has a combiner.",combiner->I2CportNumber,combiner->I2CdeviceAddress);
+            return ESP_ERR_INVALID_STATE;
+        }
+    combiner->length = combiner->partCount = 0;
+    combiner->flushingTask = NULL;
+    combiner->timer = NULL;
+    combiner->task = NULL;
+    combiner->running = combiner->timeout_us > 0;
+    combiner->taskFinished = false;
+    combiner->lock = xSemaphoreCreateMutex();
+    if (combiner->lock == NULL || (combiner->timeout_us > 0 && (esp_timer_create(&timerConfig, &combiner->timer) != ESP_OK ||
+        xTaskCreate(SUS_I2C_CombineTask, "sus_i2c_combine", SUS_I2C_COMBINE_TASK_STACK, combiner, SUS_I2C_COMBINE_TASK_PRIORITY, &combiner->task) != pdPASS))) {
+        if (combiner->timer != NULL) esp_timer_delete(combiner->timer);
+        if (combiner->lock != NULL) vSemaphoreDelete(combiner->lock);
+        combiner->timer = NULL;
+        combiner->running = false;
+        ESP_LOGE(I2C_COMBINE_TAG,"[I2C PORT %d], [Device %#04x] : not enough memory for the combiner.",combiner->I2CportNumber,combiner->I2CdeviceAddress);
+        return ESP_ERR_NO_MEM;
+    }
+    portENTER_CRITICAL(&SUS_I2C_CombineListLock);
+    combiner->next = SUS_I2C_CombineList;
+    SUS_I2C_CombineList = combiner;         //Published only now, fully set up.
+    portEXIT_CRITICAL(&SUS_I2C_CombineListLock);
+    return ESP_OK;
+}
+
+/**SUS_I2C_CombineWrite: Hands one write to the combiner - the bytes a SUS_I2C_WriteByteArrayToSlave would send ({register, values...}, a command...).
+ * It is appended to the previous write if the flags allow it, and the buffer is sent if it reached the threshold.
+ * RETURNS ESP_OK (buffered, or sent), ESP_ERR_INVALID_SIZE for an empty write or one longer than SUS_I2C_COMBINE_MAX_BYTES,
+ * or the error of a flush this write triggered.
+ * EXAMPLE USE: uint8_t init[] = {0x00, 0xAE, 0xD5, 0x80};     //SSD1306: control byte 0x00, then commands.
+ *              SUS_I2C_CombineWrite(&oled, init, sizeof(init));
+*/
+esp_err_t SUS_I2C_CombineWrite(struct SUS_I2C_Combiner *combiner, const uint8_t *bytes, size_t length)
+{
+    esp_err_t outcome = ESP_OK;
+
+    if (length == 0 || length > SUS_I2C_COMBINE_MAX_BYTES) return ESP_ERR_INVALID_SIZE;
+    SUS_I2C_PrefetchForget(combiner->I2CportNumber, combiner->I2CdeviceAddress);   //Prefetch: a read answered from the buffer would skip this write.
+    xSemaphoreTake(combiner->lock, portMAX_DELAY);
+    bool merge = false;
+    if (combiner->partCount > 0 && length > 1)
+    {
+        uint8_t first = combiner->buffer[combiner->partStart[combiner->partCount - 1]];        //Register / stream byte of the last part...
+        uint8_t values = combiner->length - combiner->partStart[combiner->partCount - 1] - 1;   //...and the bytes written after it.
+        merge = ((combiner->flags & SUS_I2C_COMBINE_AUTO_INCREMENT) && bytes[0] == (uint8_t)(first + values)) ||
+                ((combiner->flags & SUS_I2C_COMBINE_STREAM) && bytes[0] == first);
+    }
+    if (combiner->length + length - merge > SUS_I2C_COMBINE_MAX_BYTES || (!merge && combiner->partCount == SUS_I2C_COMBINE_MAX_PARTS)) {
+        outcome = SUS_I2C_CombineSend(combiner, SUS_I2C_COMBINE_BY_THRESHOLD);       //No room: send what's waiting, start over.
+        merge = false;
+    }
+    if (combiner->length == 0 && combiner->timer != NULL) {
+        combiner->firstWrite_us = esp_timer_get_time();
+        esp_timer_start_once(combiner->timer, combiner->timeout_us);
+    }
+    if (!merge) combiner->partStart[combiner->partCount++] = combiner->length;
+    memcpy(&combiner->buffer[combiner->length], bytes + merge, length - merge);
+    combiner->length += length - merge;
+    combiner->writes++;
+    combiner->separate_us += SUS_I2C_BusTime_us(combiner->I2CportNumber, 1 + length, 1);
+    if (combiner->threshold > 0 && combiner->length >= combiner->threshold) {
+        esp_err_t sent = SUS_I2C_CombineSend(combiner, SUS_I2C_COMBINE_BY_THRESHOLD);
+        if (outcome == ESP_OK) outcome = sent;
+    }
+    xSemaphoreGive(combiner->lock);
+    return outcome;
+}
+
+/**SUS_I2C_CombineWriteRegister: SUS_I2C_WriteToRegister through the combiner: {register, value}.
+ * RETURNS same as SUS_I2C_CombineWrite.
+ * EXAMPLE USE: SUS_I2C_CombineWriteRegister(&leds, 0x08, 0xFF);
+*/
+esp_err_t SUS_I2C_CombineWriteRegister(struct SUS_I2C_Combiner *combiner, uint8_t registerAddress, uint8_t valueToWrite)
+{
+    uint8_t bytes[2] = {registerAddress, valueToWrite};
+    return SUS_I2C_CombineWrite(combiner, bytes, 2);
+}
+
+/**SUS_I2C_CombineWriteByte: SUS_I2C_WriteByteToSlave through the combiner: one byte, e.g. a command. Never merged, but shares the transaction.
+ * RETURNS same as SUS_I2C_CombineWrite.
+ * EXAMPLE USE: SUS_I2C_CombineWriteByte(&ht16k33, 0x81);       //Display on, no blinking.
+*/
+esp_err_t SUS_I2C_CombineWriteByte(struct SUS_I2C_Combiner *combiner, uint8_t valueToWrite)
+{
+    return SUS_I2C_CombineWrite(combiner, &valueToWrite, 1);
+}
+
+/**SUS_I2C_CombineFlush: Sends the writes waiting in this combiner now.
+ * RETURNS ESP_OK (also if nothing was waiting), or the error of the transaction.
+ * EXAMPLE USE: SUS_I2C_CombineFlush(&leds);
+*/
+esp_err_t SUS_I2C_CombineFlush(struct SUS_I2C_Combiner *combiner)
+{
+    xSemaphoreTake(combiner->lock, portMAX_DELAY);
+    esp_err_t outcome = SUS_I2C_CombineSend(combiner, SUS_I2C_COMBINE_BY_FLUSH);
+    xSemaphoreGive(combiner->lock);
+    return outcome;
+}
+
+/**SUS_I2C_CombineBarrier: Sends the writes waiting in EVERY combiner. Everything written before the call is on the bus when it returns -
+ * call it before anything outside I2C that depends on the writes: a latch or LDAC pulse, a chip select, going to sleep.
+ * RETURNS ESP_OK, or the first error of the transactions.
+ * EXAMPLE USE: SUS_I2C_CombineBarrier(); gpio_set_level(LDAC_PIN, 0);
+*/
+esp_err_t SUS_I2C_CombineBarrier(void)
+{
+    esp_err_t outcome = ESP_OK;
+    for (struct SUS_I2C_Combiner *combiner = SUS_I2C_CombineList; combiner != NULL; combiner = combiner->next)
+    {
+        esp_err_t sent = SUS_I2C_CombineFlush(combiner);
+        if (outcome == ESP_OK) outcome = sent;
+    }
+    return outcome;
+}
+
+/**SUS_I2C_CombineRemove: Sends what is still waiting and takes the combiner away from its device. Don't use it from another task at the same time.
+ * RETURNS ESP_OK, ESP_ERR_NOT_FOUND if it wasn't set up, or the error of the last transaction (the combiner is removed anyway).
+ * EXAMPLE USE: SUS_I2C_CombineRemove(&leds);
+*/
+esp_err_t SUS_I2C_CombineRemove(struct SUS_I2C_Combiner *combiner)
+{
+    struct SUS_I2C_Combiner **link = &SUS_I2C_CombineList;
+    while (*link != NULL && *link != combiner) link = &(*link)->next;
+    if (*link == NULL) return ESP_ERR_NOT_FOUND;
+
+    if (combiner->timer != NULL) {
+        esp_timer_stop(combiner->timer);
+        esp_timer_delete(combiner->timer);
+        combiner->timer = NULL;
+        combiner->running = false;
+        xTaskNotifyGive(combiner->task);
+        while (!combiner->taskFinished) vTaskDelay(1);
+        combiner->task = NULL;
+    }
+    esp_err_t outcome = SUS_I2C_CombineFlush(combiner);
+    portENTER_CRITICAL(&SUS_I2C_CombineListLock);
+    *link = combiner->next;
+    portEXIT_CRITICAL(&SUS_I2C_CombineListLock);
+    vSemaphoreDelete(combiner->lock);
+    combiner->lock = NULL;
+    return outcome;
+}
+
+/**SUS_I2C_CombinePrintReport: Prints what a combiner saved: writes per transaction, why it sent, and the bus time one write at a time versus combined.
+ * EXAMPLE USE: SUS_I2C_CombinePrintReport(&leds);
+*/
+void SUS_I2C_CombinePrintReport(struct SUS_I2C_Combiner *combiner)
+{
+    const char *I2C_COMBINE_TAG = "I2C COMBINE";
+    ESP_LOGI(I2C_COMBINE_TAG,"[I2C PORT %d], [Device %#04x] : %lu writes in %lu transactions = %.2f writes per transaction (%lu failed).",
+             combiner->I2CportNumber,combiner->I2CdeviceAddress,(unsigned long)combiner->writes,(unsigned long)combiner->transactions,
+             combiner->transactions ? (double)combiner->writes / combiner->transactions : 0.0,(unsigned long)combiner->failed);
+    ESP_LOGI(I2C_COMBINE_TAG,"    Sent because: full %lu, flush %lu, timeout %lu, other transaction %lu.",(unsigned long)combiner->flushes[SUS_I2C_COMBINE_BY_THRESHOLD],
+             (unsigned long)combiner->flushes[SUS_I2C_COMBINE_BY_FLUSH],(unsigned long)combiner->flushes[SUS_I2C_COMBINE_BY_TIMEOUT],(unsigned long)combiner->flushes[SUS_I2C_COMBINE_BY_ORDER]);
+    ESP_LOGI(I2C_COMBINE_TAG,"    Bus time: %llu us one by one, %llu us combined - %llu us (%.1f%%) saved.",(unsigned long long)combiner->separate_us,
+             (unsigned long long)combiner->combined_us,(unsigned long long)(combiner->separate_us > combiner->combined_us ? combiner->separate_us - combiner->combined_us : 0),
+             combiner->separate_us ? 100.0 * ((double)combiner->separate_us - (double)combiner->combined_us) / combiner->separate_us : 0.0);
+}
+#endif //SUS_I2C_FEATURE_COMBINE
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌
+▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░▌       ▐░▌
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌          ▐░▌          ▐░▌               ▐░▌     ▐░▌          ▐░▌       ▐░▌
+▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     ▐░▌          ▐░█▄▄▄▄▄▄▄█░▌
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░▌          ▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀      ▐░▌     ▐░▌          ▐░█▀▀▀▀▀▀▀█░▌
+▐░▌          ▐░▌     ▐░▌  ▐░▌          ▐░▌          ▐░▌               ▐░▌     ▐░▌          ▐░▌       ▐░▌
+▐░▌          ▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌          ▐░█▄▄▄▄▄▄▄▄▄      ▐░▌     ▐░█▄▄▄▄▄▄▄▄▄ ▐░▌       ▐░▌
+▐░▌          ▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌          ▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌▐░▌       ▐░▌
+ ▀            ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀            ▀▀▀▀▀▀▀▀▀▀▀       ▀       ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀
+*/
+
+/* PREFETCH: faster register reads for drivers you can't rewrite.
+ * Lots of drivers read a device like this: status register, then data0, data1... data5 - every one a SUS_I2C_ReadRegister call, every one a transaction
+ * of its own (4 bytes on the wire plus the driver's SUS_I2C_TRANSACTION_OVERHEAD_US), again and again, always in the same order.
+ * A prefetcher watches the single register reads of ONE device (SUS_I2C_ReadRegister, _EZ and _STATUS) and learns the sequences that keep coming back.
+ * Once a sequence came twice in a row the same way, the first read of it fetches the whole register range in ONE burst read, and the reads that follow
+ * are answered from that buffer - no transaction at all. The driver doesn't change, it just gets its values sooner.
+ * The rules:
+ *      - A sequence is a run of reads with less than window_us between them, that doesn't read a register twice and has no other transaction to the
+ *        device in between. Its first register triggers the prefetch. Reads that are not answered from the buffer are done by the prefetcher too.
+ *      - Prefetched values are valid for window_us, and answer ONE read each: reading a register again goes to the bus, as it would without the prefetcher.
+ *      - Any other transaction to the device - a write, a burst read, a read outside the prefetched range, a combined write - throws the buffer away.
+ *      - Registers marked with SUS_I2C_PrefetchProtect() are NEVER read ahead: FIFOs, clear-on-read status or interrupt registers, anything where reading
+ *        has a side effect. If such a register triggers a sequence, it is read on its own first, then the rest in one burst. A burst never crosses one.
+ * The counters tell you whether it pays off: hit rate (reads answered from the buffer) and wasted bytes (read ahead, never asked for).
+ * SUS_I2C_PrefetchPrintReport() prints them with the sequences learned.
+ *
+ * EXAMPLE (an old MPU6050 driver reading INT_STATUS 0x3A, then ACCEL_XOUT_H 0x3B ... ACCEL_ZOUT_L 0x40 one by one):
+ *      struct SUS_I2C_Prefetcher imuPrefetch = {.I2CportNumber = 0, .I2CdeviceAddress = 0x68, .window_us = 2000};
+ *      SUS_I2C_PrefetchInit(&imuPrefetch);
+ *      SUS_I2C_PrefetchProtect(&imuPrefetch, 0x3A, 1);        //INT_STATUS clears when read.
+ *      SUS_I2C_PrefetchProtect(&imuPrefetch, 0x74, 1);        //FIFO_R_W.
+ *      ...the old driver runs unchanged: from its third round on, 2 transactions per round instead of 7.
+ */
+#define SUS_I2C_PREFETCH_MAX_BURST      32      // Longest burst read ahead.
+#define SUS_I2C_PREFETCH_MAX_SEQUENCES  4       // Sequences remembered per device.
+#define SUS_I2C_PREFETCH_DEFAULT_WINDOW_US  2000    // window_us if you leave it 0.
+#define SUS_I2C_PREFETCH_CONFIDENCE     2       // A sequence is prefetched after it came this many times in a row the same way.
+
+struct SUS_I2C_PrefetchSequence
+{
+    uint8_t   trigger;                          // First register read.
+    uint8_t   first, last;                      // Lowest and highest register read in the sequence.
+    uint8_t   confidence;                       // How many times in a row it came the same way. 0 = free slot.
+    uint32_t  lastSeen;                         // Read counter when it last came, to replace the oldest one.
+};
+
+struct SUS_I2C_Prefetcher
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   I2CportNumber;
+    uint8_t   I2CdeviceAddress;
+    uint8_t   burstAddressFlag;                 // OR-ed into the register address of burst reads: 0x00 for most devices, 0x80 for many ST sensors.
+    uint32_t  window_us;                        // Longest pause inside a sequence, and how long prefetched values stay valid. 0 = SUS_I2C_PREFETCH_DEFAULT_WINDOW_US.
+    /*----- Statistics, filled in by the library -----*/
+    uint32_t  reads;                            // Single register reads seen.
+    uint32_t  hits;                             // Reads answered from the buffer (no transaction).
+    uint32_t  prefetches;                       // Burst reads done ahead of time.
+    uint32_t  bytesPrefetched;
+    uint32_t  bytesWasted;                      // Prefetched, but never read.
+    /*----- Internal -----*/
+    uint8_t   sensitive[32];                    // Bit per register: never read ahead.
+    struct SUS_I2C_PrefetchSequence sequence[SUS_I2C_PREFETCH_MAX_SEQUENCES];
+    uint8_t   runTrigger, runFirst, runLast;    // The sequence being read right now...
+    uint8_t   runSeen[32];                      // ...the registers it read so far...
+    int64_t   runTime_us;                       // ...and when it read the last one. 0 = no sequence going on.
+    uint8_t   buffer[SUS_I2C_PREFETCH_MAX_BURST];
+    uint8_t   bufferStart, bufferLength;
+    uint32_t  bufferUnread;                     // Bit per buffer byte: not read yet.
+    int64_t   bufferTime_us;
+    TaskHandle_t volatile fetchingTask;         // Task doing the prefetcher's own read right now (NULL = none): a forget from any other task waits for the lock.
+    SemaphoreHandle_t lock;
+    struct SUS_I2C_Prefetcher *next;
+};
+
+#if SUS_I2C_FEATURE_PREFETCH
+static struct SUS_I2C_Prefetcher *SUS_I2C_PrefetchList = NULL;     //Every active prefetcher. New ones are added at the front.
+static portMUX_TYPE SUS_I2C_PrefetchListLock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline bool SUS_I2C_PrefetchIsSensitive(const struct SUS_I2C_Prefetcher *prefetcher, uint8_t registerAddress)
+{
+    return (prefetcher->sensitive[registerAddress >> 3] >> (registerAddress & 7)) & 1;
+}
+
+//Empties the buffer, counting what nobody read. Call with prefetcher->lock taken.
+static void SUS_I2C_PrefetchDrop(struct SUS_I2C_Prefetcher *prefetcher)
+{
+    prefetcher->bytesWasted += __builtin_popcount(prefetcher->bufferUnread);
+    prefetcher->bufferUnread = 0;
+    prefetcher->bufferLength = 0;
+}
+
+//The prefetcher's own read: a burst (or single register) read. No ordering hooks - SUS_I2C_PrefetchRead ran them before it locked (lock order: BUDGET section).
+static esp_err_t SUS_I2C_PrefetchFetch(struct SUS_I2C_Prefetcher *prefetcher, uint8_t registerAddress, uint8_t *data, size_t length)
+{
+    const char *I2C_PREFETCH_TAG = "I2C PREFETCH";
+    uint8_t I2CportNumber = prefetcher->I2CportNumber, I2CdeviceAddress = prefetcher->I2CdeviceAddress;
+    uint8_t selectedRegister = length > 1 ? (registerAddress | prefetcher->burstAddressFlag) : registerAddress;
+
+    prefetcher->fetchingTask = xTaskGetCurrentTaskHandle();
+    esp_err_t outcome = SUS_I2C_BudgetTake(I2CportNumber, I2CdeviceAddress, 3 + length, 2);
+    int64_t startTime = esp_timer_get_time();
+    if (outcome == ESP_OK) outcome = i2c_master_write_read_device(I2CportNumber, I2CdeviceAddress, &selectedRegister, 1, data, length, 10/portTICK_PERIOD_MS);
+    prefetcher->fetchingTask = NULL;
+    SUS_I2C_TraceRecord(I2CportNumber, I2CdeviceAddress, SUS_I2C_TRACE_WRITE_READ, &selectedRegister, 1, data, length, outcome, startTime);
+    SUS_I2C_PresenceNote(I2CportNumber, I2CdeviceAddress, outcome, startTime);
+    if (outcome != ESP_OK) ESP_LOGE(I2C_PREFETCH_TAG,"[I2C PORT %d], [Device %#04x], [Register %#04x] : %d byte read FAILED. Code %#04x.",I2CportNumber,I2CdeviceAddress,registerAddress,(int)length,outcome);
+    return outcome;
+}
+
+//The sequence that just ended: the same as last time makes it more certain, a different one starts over.
+static void SUS_I2C_PrefetchLearn(struct SUS_I2C_Prefetcher *prefetcher)
+{
+    struct SUS_I2C_PrefetchSequence *slot = NULL;
+    for (int s = 0; s < SUS_I2C_PREFETCH_MAX_SEQUENCES; s++)
+    {
+        struct SUS_I2C_PrefetchSequence *candidate = &prefetcher->sequence[s];
+        if (candidate->confidence > 0 && candidate->trigger == prefetcher->runTrigger) { slot = candidate; break; }
+        if (slot == NULL || candidate->confidence == 0 || (slot->confidence > 0 && candidate->lastSeen < slot->lastSeen)) slot = candidate;   //Free or oldest.
+    }
+    if (prefetcher->runFirst == prefetcher->runLast) {                  //A lone read is no sequence: forget what this register used to start.
+        if (slot->confidence > 0 && slot->trigger == prefetcher->runTrigger) slot->confidence = 0;
+        return;
+    }
+    if (slot->confidence > 0 && slot->trigger == prefetcher->runTrigger && slot->first == prefetcher->runFirst && slot->last == prefetcher->runLast) {
+        if (slot->confidence < 255) slot->confidence++;
+    }
+    else *slot = (struct SUS_I2C_PrefetchSequence){prefetcher->runTrigger, prefetcher->runFirst, prefetcher->runLast, 1, 0};    //New, or came another way: starts over.
+    slot->lastSeen = prefetcher->reads;
+}
+
+//The sequence being read is over: remember it. Call with prefetcher->lock taken.
+static void SUS_I2C_PrefetchEndRun(struct SUS_I2C_Prefetcher *prefetcher)
+{
+    if (prefetcher->runTime_us != 0) SUS_I2C_PrefetchLearn(prefetcher);
+    prefetcher->runTime_us = 0;
+    memset(prefetcher->runSeen, 0, sizeof(prefetcher->runSeen));
+}
+
+/**SUS_I2C_PrefetchRead: Called by the single register reads (SUS_I2C_ReadRegister, _EZ, _STATUS) before they go to the bus. You never need to call it yourself.
+ * If the device has a prefetcher, it does the read: from the buffer, with a burst read ahead, or on its own.
+ * RETURNS true if the device has a prefetcher - "value" (only if it worked) and "outcome" are filled in, the caller must not read again -,
+ * false if the caller does its normal read.
+*/
+bool SUS_I2C_PrefetchRead(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t registerAddress, uint8_t *value, esp_err_t *outcome)
+{
+    struct SUS_I2C_Prefetcher *prefetcher = SUS_I2C_PrefetchList;
+    while (prefetcher != NULL && (prefetcher->I2CportNumber != I2CportNumber || prefetcher->I2CdeviceAddress != I2CdeviceAddress)) prefetcher = prefetcher->next;
+    if (prefetcher == NULL) return false;
+
+    SUS_I2C_CombineOrder(I2CportNumber, I2CdeviceAddress);     //Combined writes go first - now, the prefetcher's lock must not be held for it.
+    xSemaphoreTake(prefetcher->lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    uint32_t window_us = prefetcher->window_us > 0 ? prefetcher->window_us : SUS_I2C_PREFETCH_DEFAULT_WINDOW_US;
+    bool sensitive = SUS_I2C_PrefetchIsSensitive(prefetcher, registerAddress);
+    prefetcher->reads++;
+
+    //1. Follow the sequence: this read continues it, or starts a new one.
+    bool newRun = prefetcher->runTime_us == 0 || now - prefetcher->runTime_us > window_us || ((prefetcher->runSeen[registerAddress >> 3] >> (registerAddress & 7)) & 1);
+    if (newRun) {
+        SUS_I2C_PrefetchEndRun(prefetcher);
+        prefetcher->runTrigger = prefetcher->runFirst = prefetcher->runLast = registerAddress;
+    }
+    if (registerAddress < prefetcher->runFirst) prefetcher->runFirst = registerAddress;
+    if (registerAddress > prefetcher->runLast) prefetcher->runLast = registerAddress;
+    prefetcher->runSeen[registerAddress >> 3] |= 1 << (registerAddress & 7);
+    prefetcher->runTime_us = now;
+
+    //2. Answer it from the buffer: prefetched, still fresh, not read yet.
+    uint8_t offset = (uint8_t)(registerAddress - prefetcher->bufferStart);
+    if (prefetcher->bufferLength > 0 && now - prefetcher->bufferTime_us > window_us) SUS_I2C_PrefetchDrop(prefetcher);
+    if (!sensitive && offset < prefetcher->bufferLength && (prefetcher->bufferUnread >> offset) & 1) {
+        *value = prefetcher->buffer[offset];
+        *outcome = ESP_OK;
+        prefetcher->bufferUnread &= ~(1u << offset);
+        prefetcher->hits++;
+        xSemaphoreGive(prefetcher->lock);
+        return true;
+    }
+
+    //3. A known sequence starts: read its registers in one burst, without the protected ones.
+    struct SUS_I2C_PrefetchSequence *known = NULL;
+    for (int s = 0; newRun && s < SUS_I2C_PREFETCH_MAX_SEQUENCES; s++)
+        if (prefetcher->sequence[s].confidence >= SUS_I2C_PREFETCH_CONFIDENCE && prefetcher->sequence[s].trigger == registerAddress) known = &prefetcher->sequence[s];
+    int first = registerAddress, last = registerAddress;
+    if (known != NULL)
+    {
+        first = sensitive ? registerAddress + 1 : known->first;     //A protected trigger is read on its own, the burst starts after it.
+        last = known->last;
+        for (int r = first; r <= last; r++)
+            if (SUS_I2C_PrefetchIsSensitive(prefetcher, r) || r - first == SUS_I2C_PREFETCH_MAX_BURST) { last = r - 1; break; }
+        if (!sensitive && (registerAddress < first || registerAddress > last)) last = first - 1;     //The burst would not even hold the trigger.
+    }
+
+    //4. Read. What is left of the buffer stays valid, unless a read-sensitive register is read (its side effects may change others).
+    bool burst = known != NULL && last >= first && (sensitive || last > first);     //Something to read ahead.
+    *outcome = ESP_OK;
+    if (sensitive || !burst) {
+        if (sensitive) SUS_I2C_PrefetchDrop(prefetcher);
+        *outcome = SUS_I2C_PrefetchFetch(prefetcher, registerAddress, value, 1);
+    }
+    if (*outcome == ESP_OK && burst)
+    {
+        SUS_I2C_PrefetchDrop(prefetcher);
+        known->lastSeen = prefetcher->reads;
+        esp_err_t fetched = SUS_I2C_PrefetchFetch(prefetcher, first, prefetcher->buffer, last - first + 1);
+        if (!sensitive) *outcome = fetched;     //A protected trigger was read already (its side effect happened): failed burst = nothing prefetched.
+        if (fetched == ESP_OK) {
+            prefetcher->bufferStart = first;
+            prefetcher->bufferLength = last - first + 1;
+            prefetcher->bufferTime_us = esp_timer_get_time();
+            prefetcher->bufferUnread = prefetcher->bufferLength == 32 ? 0xFFFFFFFFu : (1u << prefetcher->bufferLength) - 1;
+            prefetcher->prefetches++;
+            prefetcher->bytesPrefetched += prefetcher->bufferLength;
+            if (!sensitive) {                                       //The trigger came with the burst.
+                *value = prefetcher->buffer[registerAddress - first];
+                prefetcher->bufferUnread &= ~(1u << (registerAddress - first));
+            }
+        }
+    }
+    xSemaphoreGive(prefetcher->lock);
+    return true;
+}
+
+/**SUS_I2C_PrefetchForget: Called by the library before every transaction (from SUS_I2C_BudgetCharge) and for every combined write: something else
+ * happens on the device, so what was read ahead may be out of date, and the sequence being read is over. You never need to call it yourself.
+*/
+void SUS_I2C_IRAM SUS_I2C_PrefetchForget(uint8_t I2CportNumber, uint8_t I2CdeviceAddress)
+{
+    for (struct SUS_I2C_Prefetcher *prefetcher = SUS_I2C_PrefetchList; prefetcher != NULL; prefetcher = prefetcher->next)
+    {
+        if (prefetcher->I2CportNumber != I2CportNumber || (I2CdeviceAddress != 0 && prefetcher->I2CdeviceAddress != I2CdeviceAddress)) continue;
+        if (prefetcher->fetchingTask == NULL && prefetcher->bufferLength == 0 && prefetcher->runTime_us == 0) continue;    //Nothing to forget.
+        xSemaphoreTake(prefetcher->lock, portMAX_DELAY);
+        SUS_I2C_PrefetchDrop(prefetcher);
+        SUS_I2C_PrefetchEndRun(prefetcher);
+        xSemaphoreGive(prefetcher->lock);
+    }
+}
+
+/**SUS_I2C_PrefetchInit: Puts a prefetcher in front of a device. Fill in port, address (and burstAddressFlag, window_us if needed) first,
+ * then protect its read-sensitive registers with SUS_I2C_PrefetchProtect BEFORE the driver starts reading.
+ * Does NOT print anything on success, errors are still printed.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_STATE if the device already has a prefetcher, ESP_ERR_NO_MEM if the lock can't be created.
+ * EXAMPLE USE: see the MPU6050 example above.
+*/
+esp_err_t SUS_I2C_PrefetchInit(struct SUS_I2C_Prefetcher *prefetcher)
+{
+    const char *I2C_PREFETCH_TAG = "I2C PREFETCH";
+
+    for (struct SUS_I2C_Prefetcher *other = SUS_I2C_PrefetchList; other != NULL; other = other->next)
+        if (other == prefetcher || (other->I2CportNumber == prefetcher->I2CportNumber && other->I2CdeviceAddress == prefetcher->I2CdeviceAddress)) {
+            ESP_LOGE(I2C_PREFETCH_TAG,"[I2C PORT %d], [Device %#04x] : already has a prefetcher.",prefetcher->I2CportNumber,prefetcher->I2CdeviceAddress);
+            return ESP_ERR_INVALID_STATE;
+        }
+    memset(prefetcher->sensitive, 0, sizeof(prefetcher->sensitive));
+    memset(prefetcher->sequence, 0, sizeof(prefetcher->sequence));
+    prefetcher->runTime_us = 0;
+    prefetcher->bufferLength = 0;
+    prefetcher->bufferUnread = 0;
+    prefetcher->fetchingTask = NULL;
+    prefetcher->lock = xSemaphoreCreateMutex();
+    if (prefetcher->lock == NULL) {
+        ESP_LOGE(I2C_PREFETCH_TAG,"[I2C PORT %d], [Device %#04x] : not enough memory for the prefetcher.",prefetcher->I2CportNumber,prefetcher->I2CdeviceAddress);
+        return ESP_ERR_NO_MEM;
+    }
+    portENTER_CRITICAL(&SUS_I2C_PrefetchListLock);
+    prefetcher->next = SUS_I2C_PrefetchList;
+    SUS_I2C_PrefetchList = prefetcher;      //Published only now, fully set up.
+    portEXIT_CRITICAL(&SUS_I2C_PrefetchListLock);
+    return ESP_OK;
+}
+
+/**SUS_I2C_PrefetchProtect: Marks registers that must NEVER be read ahead: reading them has a side effect (FIFO data, clear-on-read status and interrupt flags...).
+ * PARAMETER "firstRegister" and "amountOfRegisters" give the range, e.g. 0x3A, 1.
+ * EXAMPLE USE: SUS_I2C_PrefetchProtect(&imuPrefetch, 0x3A, 1);
+*/
+void SUS_I2C_PrefetchProtect(struct SUS_I2C_Prefetcher *prefetcher, uint8_t firstRegister, uint16_t amountOfRegisters)
+{
+    xSemaphoreTake(prefetcher->lock, portMAX_DELAY);
+    for (uint16_t r = firstRegister; r < firstRegister + amountOfRegisters && r < 256; r++) prefetcher->sensitive[r >> 3] |= 1 << (r & 7);
+    SUS_I2C_PrefetchDrop(prefetcher);       //Just in case the buffer holds one of them.
+    xSemaphoreGive(prefetcher->lock);
+}
+
+/**SUS_I2C_PrefetchRemove: Takes the prefetcher away from its device. Don't use it from another task at the same time.
+ * RETURNS ESP_OK, or ESP_ERR_NOT_FOUND if it wasn't set up.
+ * EXAMPLE USE: SUS_I2C_PrefetchRemove(&imuPrefetch);
+*/
+esp_err_t SUS_I2C_PrefetchRemove(struct SUS_I2C_Prefetcher *prefetcher)
+{
+    struct SUS_I2C_Prefetcher **link = &SUS_I2C_PrefetchList;
+    while (*link != NULL && *link != prefetcher) link = &(*link)->next;
+    if (*link == NULL) return ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&SUS_I2C_PrefetchListLock);
+    *link = prefetcher->next;
+    portEXIT_CRITICAL(&SUS_I2C_PrefetchListLock);
+    xSemaphoreTake(prefetcher->lock, portMAX_DELAY);
+    SUS_I2C_PrefetchDrop(prefetcher);
+    xSemaphoreGive(prefetcher->lock);
+    vSemaphoreDelete(prefetcher->lock);
+    prefetcher->lock = NULL;
+    return ESP_OK;
+}
+
+/**SUS_I2C_PrefetchPrintReport: Prints the hit rate, the wasted bytes, and the sequences the prefetcher learned.
+ * EXAMPLE USE: SUS_I2C_PrefetchPrintReport(&imuPrefetch);
+*/
+void SUS_I2C_PrefetchPrintReport(struct SUS_I2C_Prefetcher *prefetcher)
+{
+    const char *I2C_PREFETCH_TAG = "I2C PREFETCH";
+    ESP_LOGI(I2C_PREFETCH_TAG,"[I2C PORT %d], [Device %#04x] : %lu reads, %lu answered from prefetched data = %.1f%% hit rate.",prefetcher->I2CportNumber,
+             prefetcher->I2CdeviceAddress,(unsigned long)prefetcher->reads,(unsigned long)prefetcher->hits,prefetcher->reads ? 100.0 * prefetcher->hits / prefetcher->reads : 0.0);
+    ESP_LOGI(I2C_PREFETCH_TAG,"    %lu bursts read ahead, %lu bytes: %lu bytes wasted (%.1f%%). Transactions saved: %ld.",(unsigned long)prefetcher->prefetches,
+             (unsigned long)prefetcher->bytesPrefetched,(unsigned long)prefetcher->bytesWasted,
+             prefetcher->bytesPrefetched ? 100.0 * prefetcher->bytesWasted / prefetcher->bytesPrefetched : 0.0,(long)prefetcher->hits - (long)prefetcher->prefetches);
+    for (int s = 0; s < SUS_I2C_PREFETCH_MAX_SEQUENCES; s++)
+    {
+        struct SUS_I2C_PrefetchSequence *sequence = &prefetcher->sequence[s];
+        if (sequence->confidence == 0) continue;
+        ESP_LOGI(I2C_PREFETCH_TAG,"    Sequence from [Register %#04x]: registers %#04x - %#04x, seen %d%s times in a row%s.",sequence->trigger,sequence->first,sequence->last,
+                 sequence->confidence,sequence->confidence == 255 ? "+" : "",sequence->confidence >= SUS_I2C_PREFETCH_CONFIDENCE ? " - prefetched" : "");
+    }
+}
+#endif //SUS_I2C_FEATURE_PREFETCH
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄        ▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌      ▐░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌ ▀▀▀▀█░█▀▀▀▀  ▀▀▀▀█░█▀▀▀▀ ▐░▌░▌     ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌▐░▌    ▐░▌▐░▌
+▐░▌          ▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌ ▐░▌   ▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░▌          ▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌
+▐░▌          ▐░▌       ▐░▌▐░█▀▀▀▀█░█▀▀ ▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌   ▐░▌ ▐░▌▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌       ▐░▌▐░▌     ▐░▌  ▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌          ▐░▌     ▐░▌    ▐░▌▐░▌▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░▌      ▐░▌ ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌      ▄▄▄▄█░█▄▄▄▄ ▐░▌     ▐░▐░▌▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌     ▐░░░░░░░░░░░▌▐░▌      ▐░░▌▐░░░░░░░░░░░▌
+ ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀       ▀▀▀▀▀▀▀▀▀▀▀  ▀        ▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* COROUTINES: dozens of multi-step device drivers on ONE task, instead of a task (and a 2-4 KB stack) each.
+ * A typical driver: trigger a conversion, wait 5 ms, read the status until it says "done", read the result, again and again. Written with the
+ * blocking functions (SUS_I2C_ReadRegister, vTaskDelay...) it needs a task of its own, just to have somewhere to wait - and every task costs
+ * its stack plus its task control block, most of it sitting idle.
+ * Here the driver is written as a COROUTINE: a function that looks just like the blocking version, but every wait is an "await" that hands the
+ * CPU back to the EXECUTOR of its I2C port. The executor (one task per port) does the I2C operation the coroutine asked for, counts down its delays,
+ * and continues the coroutine where it left off - while the others carry on in between. A coroutine needs no stack of its own, only a small
+ * FRAME (struct SUS_I2C_Coroutine, ~100 bytes) taken from a pool you give to the executor.
+ * Writing one:
+ *      int MySensor(struct SUS_I2C_Coroutine *co)
+ *      {
+ *          struct MySensorLocals *my = SUS_I2C_CO_LOCALS(co, struct MySensorLocals);     //Variables that must survive an await live HERE.
+ *          SUS_I2C_CO_BEGIN(co);
+ *          for (my->round = 0; my->round < 100; my->round++) {
+ *              SUS_I2C_AWAIT_WRITE_REGISTER(co, 0x01, 0x81);                           //Start a conversion...
+ *              SUS_I2C_AWAIT_DELAY_US(co, 5000);                                       //...give it 5 ms (the other coroutines run meanwhile)...
+ *              SUS_I2C_AWAIT_READ(co, 0x02, my->raw, 2);                               //...and read it.
+ *              if (co->outcome != ESP_OK) SUS_I2C_CO_RETURN(co, co->outcome);
+ *          }
+ *          SUS_I2C_CO_END(co);
+ *      }
+ * The rules (they are C coroutines - a switch statement jumping back to the last await - so the compiler won't tell you):
+ *      - Local variables of the function are NOT kept across an await. Put what must survive into the locals (SUS_I2C_COROUTINE_LOCALS bytes,
+ *        filled with a copy of what you pass to SUS_I2C_CoroutineStart), and buffers you await into too.
+ *      - Awaits only directly in the coroutine function, between SUS_I2C_CO_BEGIN and SUS_I2C_CO_END, one per line, not inside another switch.
+ *      - co->outcome holds the result of the last I2C await. The operations are SUS_I2C_ReadRegisters, SUS_I2C_WriteRegisters and
+ *        SUS_I2C_WriteByteArrayToSlave_STATUS, done by the executor: same budgets, traces, error messages.
+ *      - Never block in a coroutine (vTaskDelay, blocking reads of other devices, waiting for a semaphore): the whole port would wait with it.
+ *      - Delays are in microseconds, not rounded to RTOS ticks: the executor sleeps on a timer until the first coroutine is due.
+ *      - co->I2CdeviceAddress can be changed in the body, for drivers that talk to more than one device.
+ * SUS_I2C_ExecutorPrintReport() prints what ran, and the RAM the frames take against a task per coroutine.
+ */
+#define SUS_I2C_COROUTINE_LOCALS        48      // Bytes of locals per coroutine.
+#define SUS_I2C_COROUTINE_TASK_STACK    3072    // RAM comparison in the report: the stack of a task per device...
+#define SUS_I2C_COROUTINE_TASK_TCB      360     // ...plus its task control block (ESP32, FreeRTOS).
+#define SUS_I2C_EXECUTOR_STACK          4096    // Stack of the executor task.
+
+#define SUS_I2C_CO_WAITING              0       // Coroutine function return values (the macros return them for you): not finished yet,
+#define SUS_I2C_CO_DONE                 1       // finished.
+
+#define SUS_I2C_CO_NONE                 0       // I2C operation a coroutine waits for:
+#define SUS_I2C_CO_READ                 1       // SUS_I2C_ReadRegisters,
+#define SUS_I2C_CO_WRITE                2       // SUS_I2C_WriteRegisters,
+#define SUS_I2C_CO_COMMAND              3       // SUS_I2C_WriteByteArrayToSlave_STATUS.
+
+struct SUS_I2C_Coroutine
+{
+    /*----- Set by SUS_I2C_CoroutineStart, yours to use in the body -----*/
+    uint8_t   I2CportNumber;
+    uint8_t   I2CdeviceAddress;
+    esp_err_t outcome;                          // Result of the last I2C await. When finished: what SUS_I2C_CO_RETURN gave, ESP_OK at SUS_I2C_CO_END.
+    void      *user;                            // Your pointer, e.g. where the results go.
+    void      (*onDone)(struct SUS_I2C_Coroutine *co);     // Called from the executor task when the coroutine finished. The frame is reused right after.
+    /*----- Internal -----*/
+    int       (*body)(struct SUS_I2C_Coroutine *co);
+    uint32_t  resumePoint;                      // Line of the await to continue from, 0 = from the start.
+    uint8_t   operation;                        // SUS_I2C_CO_... the executor must do before continuing it.
+    uint8_t   registerAddress;
+    uint8_t   value;                            // SUS_I2C_AWAIT_WRITE_REGISTER: the byte to write.
+    uint8_t   *data;
+    size_t    length;
+    int64_t   wake_us;                          // Not continued before this time.
+    uint32_t  resumes;
+    struct SUS_I2C_Coroutine *next;
+    uint64_t  locals[(SUS_I2C_COROUTINE_LOCALS + 7) / 8];
+};
+
+#define SUS_I2C_CO_LOCALS(co, type)     ((type *)(void *)(co)->locals)
+#define SUS_I2C_CO_BEGIN(co)            switch ((co)->resumePoint) { case 0:
+#define SUS_I2C_CO_END(co)              } (co)->outcome = ESP_OK; (co)->resumePoint = 0; return SUS_I2C_CO_DONE;
+#define SUS_I2C_CO_RETURN(co, result)   do { (co)->outcome = (result); (co)->resumePoint = 0; return SUS_I2C_CO_DONE; } while (0)
+#define SUS_I2C_CO_SUSPEND(co)          (co)->resumePoint = __LINE__; return SUS_I2C_CO_WAITING; case __LINE__:;
+#define SUS_I2C_AWAIT_YIELD(co)         do { SUS_I2C_CO_SUSPEND(co); } while (0)       //Lets the other coroutines run, continues on the executor's next round.
+#define SUS_I2C_AWAIT_DELAY_US(co, microseconds)    do { (co)->wake_us = esp_timer_get_time() + (microseconds); SUS_I2C_CO_SUSPEND(co); } while (0)
+#define SUS_I2C_AWAIT_READ(co, register, buffer, amountOfBytes)     do { (co)->operation = SUS_I2C_CO_READ; (co)->registerAddress = (register); \
+                                                                         (co)->data = (uint8_t *)(buffer); (co)->length = (amountOfBytes); SUS_I2C_CO_SUSPEND(co); } while (0)
+#define SUS_I2C_AWAIT_WRITE(co, register, buffer, amountOfBytes)    do { (co)->operation = SUS_I2C_CO_WRITE; (co)->registerAddress = (register); \
+                                                                         (co)->data = (uint8_t *)(buffer); (co)->length = (amountOfBytes); SUS_I2C_CO_SUSPEND(co); } while (0)
+#define SUS_I2C_AWAIT_WRITE_REGISTER(co, register, byte)            do { (co)->operation = SUS_I2C_CO_WRITE; (co)->registerAddress = (register); (co)->value = (byte); \
+                                                                         (co)->data = &(co)->value; (co)->length = 1; SUS_I2C_CO_SUSPEND(co); } while (0)
+#define SUS_I2C_AWAIT_COMMAND(co, buffer, amountOfBytes)            do { (co)->operation = SUS_I2C_CO_COMMAND; (co)->data = (uint8_t *)(buffer); \
+                                                                         (co)->length = (amountOfBytes); SUS_I2C_CO_SUSPEND(co); } while (0)
+
+struct SUS_I2C_Executor
+{
+    struct SUS_I2C_Coroutine *frame;            // The frame pool, given to SUS_I2C_ExecutorStart.
+    uint16_t  frameCount;
+    struct SUS_I2C_Coroutine *free;             // Frames not in use.
+    struct SUS_I2C_Coroutine *live;             // Running coroutines, continued in this order. Only the executor task touches it...
+    struct SUS_I2C_Coroutine *incoming;         // ...new ones wait here until it takes them over.
+    portMUX_TYPE lock;                          // Guards free and incoming.
+    TaskHandle_t task;
+    esp_timer_handle_t wakeTimer;
+    volatile bool running;
+    volatile bool taskFinished;
+    /*----- Statistics -----*/
+    uint32_t  started, finished, failed, refused;   // failed = finished with an outcome other than ESP_OK, refused = no free frame.
+    uint16_t  liveCount, peakLive;
+    uint32_t  resumes, operations, operationErrors;
+    int64_t   busy_us, start_us;
+};
+
+#if SUS_I2C_FEATURE_COROUTINE
+static struct SUS_I2C_Executor SUS_I2C_ExecutorPort[2] = {{.lock = portMUX_INITIALIZER_UNLOCKED}, {.lock = portMUX_INITIALIZER_UNLOCKED}};
+
+//Wake-up timer callback: the first delay is over.
+static void SUS_I2C_ExecutorWake(void *parameter)
+{
+    struct SUS_I2C_Executor *executor = (struct SUS_I2C_Executor *)parameter;
+    xTaskNotifyGive(executor->task);
+}
+
+//The I2C operation the coroutine awaits.
+static esp_err_t SUS_I2C_ExecutorOperation(struct SUS_I2C_Coroutine *co)
+{
+    switch (co->operation)
+    {
+    case SUS_I2C_CO_READ:
+        return SUS_I2C_ReadRegisters(co->I2CportNumber, co->I2CdeviceAddress, co->registerAddress, co->data, co->length);
+    case SUS_I2C_CO_WRITE:
+        return SUS_I2C_WriteRegisters(co->I2CportNumber, co->I2CdeviceAddress, co->registerAddress, co->data, co->length);
+    case SUS_I2C_CO_COMMAND:
+        return SUS_I2C_WriteByteArrayToSlave_STATUS(co->I2CportNumber, co->I2CdeviceAddress, co->data, co->length);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+//The executor task: one per I2C port. Every round continues each coroutine that is due (after doing the I2C operation it awaits), then sleeps until the first delay is over.
+static void SUS_I2C_ExecutorTask(void *parameter)
+{
+    struct SUS_I2C_Executor *executor = &SUS_I2C_ExecutorPort[(uintptr_t)parameter];
+    struct SUS_I2C_Coroutine **tail = &executor->live;
+
+    while (executor->running)
+    {
+        portENTER_CRITICAL(&executor->lock);        //Take the new ones over, at the end: started first, continued first.
+        struct SUS_I2C_Coroutine *incoming = executor->incoming;
+        executor->incoming = NULL;
+        portEXIT_CRITICAL(&executor->lock);
+        while (incoming != NULL) {
+            struct SUS_I2C_Coroutine *co = incoming;
+            incoming = co->next;
+            co->next = NULL;
+            *tail = co;
+            tail = &co->next;
+        }
+
+        int64_t now = esp_timer_get_time();
+        int64_t nextWake = INT64_MAX;
+        bool ran = false;
+        for (struct SUS_I2C_Coroutine **link = &executor->live; *link != NULL; )
+        {
+            struct SUS_I2C_Coroutine *co = *link;
+            if (co->wake_us > now) {
+                if (co->wake_us < nextWake) nextWake = co->wake_us;
+                link = &co->next;
+                continue;
+            }
+            int64_t startTime = esp_timer_get_time();
+            if (co->operation != SUS_I2C_CO_NONE) {
+                co->outcome = SUS_I2C_ExecutorOperation(co);
+                co->operation = SUS_I2C_CO_NONE;
+                executor->operations++;
+                if (co->outcome != ESP_OK) executor->operationErrors++;
+            }
+            co->wake_us = 0;
+            int result = co->body(co);
+            co->resumes++;
+            executor->resumes++;
+            executor->busy_us += esp_timer_get_time() - startTime;
+            ran = true;
+            if (result != SUS_I2C_CO_DONE) {
+                link = &co->next;
+                continue;
+            }
+            *link = co->next;                       //Finished: out of the list, frame back to the pool.
+            if (*link == NULL) tail = link;
+            executor->finished++;
+            if (co->outcome != ESP_OK) executor->failed++;
+            if (co->onDone) co->onDone(co);
+            portENTER_CRITICAL(&executor->lock);
+            executor->liveCount--;
+            co->next = executor->free;
+            executor->free = co;
+            portEXIT_CRITICAL(&executor->lock);
+        }
+        if (ran || executor->incoming != NULL) continue;    //Operations were just asked for: next round right away.
+        esp_timer_stop(executor->wakeTimer);
+        if (nextWake != INT64_MAX) esp_timer_start_once(executor->wakeTimer, (uint64_t)(nextWake - now));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);    //Sleep until the timer, a new coroutine (or SUS_I2C_ExecutorStop) wakes us up.
+    }
+    esp_timer_stop(executor->wakeTimer);
+    executor->taskFinished = true;
+    vTaskDelete(NULL);
+}
+
+/**SUS_I2C_ExecutorStart: Starts the executor task of the given I2C port, which runs the coroutines of that port (see COROUTINES above).
+ * PARAMETER "frames" and "frameCount": the frame pool, an array that stays valid as long as the executor runs. One frame per coroutine running at the same time.
+ * PARAMETER "coreNumber" is the CPU core to run the executor on: 0 or 1 (or tskNO_AFFINITY to let FreeRTOS decide).
+ * PARAMETER "taskPriority" is the FreeRTOS priority of the executor task.
+ * RETURNS ESP_OK, ESP_ERR_INVALID_STATE if it is already running, ESP_ERR_INVALID_ARG without frames, ESP_ERR_NO_MEM if the task/timer could not be created.
+ * EXAMPLE USE: static struct SUS_I2C_Coroutine frames[24];
+ *              SUS_I2C_ExecutorStart(0, frames, 24, 1, 5);     //Executor of I2C port 0, up to 24 coroutines, CPU core 1, priority 5.
+*/
+esp_err_t SUS_I2C_ExecutorStart(uint8_t I2CportNumber, struct SUS_I2C_Coroutine *frames, uint16_t frameCount, int coreNumber, int taskPriority)
+{
+    const char *I2C_COROUTINE_TAG = "I2C COROUTINE";
+    struct SUS_I2C_Executor *executor = &SUS_I2C_ExecutorPort[I2CportNumber & 1];
+    esp_timer_create_args_t timerConfig = { .callback = SUS_I2C_ExecutorWake, .arg = executor, .name = "sus_i2c_exec" };
+
+    if (executor->running) return ESP_ERR_INVALID_STATE;
+    if (frames == NULL || frameCount == 0) return ESP_ERR_INVALID_ARG;
+    if (executor->wakeTimer == NULL && esp_timer_create(&timerConfig, &executor->wakeTimer) != ESP_OK) return ESP_ERR_NO_MEM;
+
+    executor->frame = frames;
+    executor->frameCount = frameCount;
+    executor->free = executor->live = executor->incoming = NULL;
+    for (int i = frameCount - 1; i >= 0; i--) {
+        frames[i].next = executor->free;
+        executor->free = &frames[i];
+    }
+    executor->started = executor->finished = executor->failed = executor->refused = 0;
+    executor->liveCount = executor->peakLive = 0;
+    executor->resumes = executor->operations = executor->operationErrors = 0;
+    executor->busy_us = 0;
+    executor->start_us = esp_timer_get_time();
+    executor->running = true;
+    executor->taskFinished = false;
+    if (xTaskCreatePinnedToCore(SUS_I2C_ExecutorTask, "sus_i2c_exec", SUS_I2C_EXECUTOR_STACK, (void *)(uintptr_t)(I2CportNumber & 1), taskPriority, &executor->task, coreNumber) != pdPASS) {
+        executor->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(I2C_COROUTINE_TAG,"[I2C PORT %d] : executor started, %d frames.",I2CportNumber,frameCount);
+    return ESP_OK;
+}
+
+/**SUS_I2C_CoroutineStart: Starts a coroutine on the executor of its I2C port. Can be called from any task, and from a coroutine.
+ * PARAMETER "body" is the coroutine function.
+ * PARAMETER "locals" and "localsSize": copied into the frame's locals before it starts (its arguments, so to speak). NULL/0 = all zero. At most SUS_I2C_COROUTINE_LOCALS bytes.
+ * PARAMETER "user" ends up in co->user, "onDone" (can be NULL) is called from the executor task when it finished - read co->outcome there.
+ * RETURNS the frame, or NULL if the executor doesn't run, all frames are in use or the locals don't fit (the error is printed).
+ * EXAMPLE USE: struct MySensorLocals start = {0};
+ *              SUS_I2C_CoroutineStart(0, 0x48, MySensor, &start, sizeof(start), &reading, MySensorDone);
+*/
+struct SUS_I2C_Coroutine *SUS_I2C_CoroutineStart(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, int (*body)(struct SUS_I2C_Coroutine *co),
+                                                 const void *locals, size_t localsSize, void *user, void (*onDone)(struct SUS_I2C_Coroutine *co))
+{
+    const char *I2C_COROUTINE_TAG = "I2C COROUTINE";
+    struct SUS_I2C_Executor *executor = &SUS_I2C_ExecutorPort[I2CportNumber & 1];
+
+    if (body == NULL || localsSize > SUS_I2C_COROUTINE_LOCALS || !executor->running) {
+        ESP_LOGE(I2C_COROUTINE_TAG,"[I2C PORT %d], [Device %#04x] : coroutine NOT started: %s.",I2CportNumber,I2CdeviceAddress,
+                 !executor->running ? "the executor doesn't run" : body == NULL ? "no function" : "locals too big");
+        return NULL;
+    }
+    portENTER_CRITICAL(&executor->lock);
+    struct SUS_I2C_Coroutine *co = executor->free;
+    if (co != NULL) executor->free = co->next;
+    else executor->refused++;
+    portEXIT_CRITICAL(&executor->lock);
+    if (co == NULL) {
+        ESP_LOGE(I2C_COROUTINE_TAG,"[I2C PORT %d], [Device %#04x] : coroutine NOT started, all %d frames in use.",I2CportNumber,I2CdeviceAddress,executor->frameCount);
+        return NULL;
+    }
+
+    memset(co, 0, sizeof(*co));
+    co->I2CportNumber = I2CportNumber;
+    co->I2CdeviceAddress = I2CdeviceAddress;
+    co->body = body;
+    co->user = user;
+    co->onDone = onDone;
+    if (locals != NULL) memcpy(co->locals, locals, localsSize);
+    portENTER_CRITICAL(&executor->lock);
+    co->next = executor->incoming;              //The executor puts them back in starting order.
+    executor->incoming = co;
+    executor->started++;
+    if (++executor->liveCount > executor->peakLive) executor->peakLive = executor->liveCount;
+    portEXIT_CRITICAL(&executor->lock);
+    xTaskNotifyGive(executor->task);
+    return co;
+}
+
+/**SUS_I2C_ExecutorStop: Stops the executor task of the given I2C port and waits until it's really gone. Coroutines that did not finish are
+ * dropped without their onDone call. Statistics are kept.
+ * EXAMPLE USE: SUS_I2C_ExecutorStop(0);
+*/
+void SUS_I2C_ExecutorStop(uint8_t I2CportNumber)
+{
+    struct SUS_I2C_Executor *executor = &SUS_I2C_ExecutorPort[I2CportNumber & 1];
+    if (!executor->running) return;
+    executor->running = false;
+    xTaskNotifyGive(executor->task);
+    while (!executor->taskFinished) vTaskDelay(1);
+}
+
+/**SUS_I2C_ExecutorPrintReport: Prints what the executor of the given port ran, and the RAM of its frames and task against a task per coroutine.
+ * EXAMPLE USE: SUS_I2C_ExecutorPrintReport(0);
+*/
+void SUS_I2C_ExecutorPrintReport(uint8_t I2CportNumber)
+{
+    const char *I2C_COROUTINE_TAG = "I2C COROUTINE";
+    struct SUS_I2C_Executor *executor = &SUS_I2C_ExecutorPort[I2CportNumber & 1];
+    int64_t elapsed = esp_timer_get_time() - executor->start_us;
+    uint32_t executorRam = executor->frameCount * sizeof(struct SUS_I2C_Coroutine) + SUS_I2C_EXECUTOR_STACK + SUS_I2C_COROUTINE_TASK_TCB;
+    uint32_t taskRam = executor->peakLive * (SUS_I2C_COROUTINE_TASK_STACK + SUS_I2C_COROUTINE_TASK_TCB);
+
+    ESP_LOGI(I2C_COROUTINE_TAG,"[I2C PORT %d] : %lu coroutines started, %lu finished (%lu with an error), %d running, %d at most at once, %lu refused (no free frame).",
+             I2CportNumber,(unsigned long)executor->started,(unsigned long)executor->finished,(unsigned long)executor->failed,executor->liveCount,executor->peakLive,
+             (unsigned long)executor->refused);
+    ESP_LOGI(I2C_COROUTINE_TAG,"    %lu resumes, %lu I2C operations (%lu failed), executor busy %.1f%% of %.1f s.",(unsigned long)executor->resumes,
+             (unsigned long)executor->operations,(unsigned long)executor->operationErrors,elapsed > 0 ? 100.0 * executor->busy_us / elapsed : 0.0,elapsed / 1e6);
+    ESP_LOGI(I2C_COROUTINE_TAG,"    RAM: %d frames x %d bytes + executor task = %lu bytes. A task per coroutine (%d): %lu bytes. Saved: %ld bytes.",executor->frameCount,
+             (int)sizeof(struct SUS_I2C_Coroutine),(unsigned long)executorRam,executor->peakLive,(unsigned long)taskRam,(long)taskRam - (long)executorRam);
+}
+#endif //SUS_I2C_FEATURE_COROUTINE
+
+
+/*==========================================================================================================================
+ ▄         ▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄       ▄▄     ▄▄▄▄▄▄▄▄▄▄   ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌     ▐░░▌   ▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░▌       ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌░▌   ▐░▐░▌   ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌ ▀▀▀▀█░█▀▀▀▀
+▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌▐░▌ ▐░▌▐░▌   ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌   ▄   ▐░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌ ▐░▐░▌ ▐░▌   ▐░█▄▄▄▄▄▄▄█░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌  ▐░▌  ▐░▌   ▐░░░░░░░░░░▌ ▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌ ▐░▌░▌ ▐░▌▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀█░█▀▀ ▐░▌   ▀   ▐░▌   ▐░█▀▀▀▀▀▀▀█░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌▐░▌ ▐░▌▐░▌▐░▌       ▐░▌▐░▌     ▐░▌  ▐░▌       ▐░▌   ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌     ▐░▌
+▐░▌░▌   ▐░▐░▌▐░▌       ▐░▌▐░▌      ▐░▌ ▐░▌       ▐░▌   ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌     ▐░▌
+▐░░▌     ▐░░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌   ▐░░░░░░░░░░▌ ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌     ▐░▌
+ ▀▀       ▀▀  ▀         ▀  ▀         ▀  ▀         ▀     ▀▀▀▀▀▀▀▀▀▀   ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀       ▀
+*/
+
+/* WARM BOOT: skip the scan and the device set-up when nothing changed since the last boot.
+ * Every boot the same story: scan the bus, probe every device, calibrate the bus speed, reset and configure every device, wait for all of it -
+ * although the board is the same as yesterday, and after a watchdog reset or a deep sleep wake-up the devices even still hold their configuration.
+ * SUS_I2C_WarmBoot() does the full bring-up ONCE (a COLD boot) and keeps what it found in a TOPOLOGY SNAPSHOT: which addresses answered on each port
+ * and behind each mux channel, the bus speed the calibration chose, every device's signature (ID registers) and a hash of the configuration written to it.
+ * The snapshot goes into a key-value store you choose (struct SUS_I2C_Store): NVS on the ESP32, a file on Linux, anything with a load and a save.
+ * Next boot (WARM): the snapshot is loaded, the stored bus speed is set again, and every device only gets a verification probe:
+ *      - its signature is read and compared. Another chip (or none) at that address -> full set-up of THAT device.
+ *      - the configuration it needs now is compared with the one written last time (hash). Firmware update changed it -> full set-up of that device.
+ *      - configReadable devices: the configuration registers are read back. A device that lost power in between has its reset defaults -> full set-up.
+ *        The others can't tell, so their configuration pairs are simply written again (cheap) - but their init function is skipped.
+ * No scan, no calibration, no resets, no start-up delays for the devices that passed. A changed device list (firmware update), a damaged or missing
+ * snapshot, or "forceCold" make it a cold boot again. The snapshot is saved after every cold boot and whenever a device had to be set up again.
+ * Devices behind a TCA9548A-style mux: give muxAddress and muxChannel, the channel is selected before the device and deselected after it.
+ * SUS_I2C_WarmBootPrintReport() prints what happened to every device, and the warm boot against the last cold one.
+ * NVS: call nvs_flash_init() before. If you include SUS_I2Cmaster_FULL.h yourself on the ESP32, include "nvs.h" before it.
+ */
+#define SUS_I2C_WARMBOOT_MAX_DEVICES    32
+#define SUS_I2C_WARMBOOT_MAX_CHANNELS   8       // Mux channels scanned (and kept in the snapshot) in a cold boot.
+#define SUS_I2C_WARMBOOT_MAX_SIGNATURE  4       // Longest signature (ID registers), bytes.
+#define SUS_I2C_WARMBOOT_VERSION        1       // Snapshots of another layout version are ignored (= cold boot).
+#define SUS_I2C_WARMBOOT_DEFAULT_KEY    "sus_i2c_topo"
+
+#define SUS_I2C_WARMBOOT_VERIFIED       0       // What happened to a device: passed the verification probe,
+#define SUS_I2C_WARMBOOT_INITIALIZED    1       // got the full set-up (cold boot, or it failed the probe),
+#define SUS_I2C_WARMBOOT_FAILED         2       // its set-up failed.
+
+struct SUS_I2C_Store
+{
+    esp_err_t (*load)(void *context, const char *key, void *data, size_t length);      // ESP_OK with exactly "length" bytes in data, else any error (ESP_ERR_NOT_FOUND...).
+    esp_err_t (*save)(void *context, const char *key, const void *data, size_t length);
+    void      *context;                         // SUS_I2C_StoreNvs...: the NVS namespace. SUS_I2C_StoreFile...: the directory.
+};
+
+struct SUS_I2C_WarmDevice
+{
+    /*----- Filled in by YOU -----*/
+    const char *name;                           // For the report. Can be NULL.
+    uint8_t   I2CportNumber;
+    uint8_t   I2CdeviceAddress;
+    uint8_t   muxAddress;                       // Address of the mux in front of it, 0 = straight on the bus.
+    uint8_t   muxChannel;                       // 0 - 7.
+    uint8_t   signatureRegister;                // First ID register (WHO_AM_I, chip ID...).
+    uint8_t   signatureLength;                  // 0 - SUS_I2C_WARMBOOT_MAX_SIGNATURE. 0 = it only has to ACK its address.
+    const uint8_t (*config)[2];                 // Configuration: {register, value} pairs, written in this order. NULL = none.
+    uint8_t   configCount;
+    bool      configReadable;                   // true = the registers read back what was written (most sensors), the warm check reads them back.
+    esp_err_t (*init)(struct SUS_I2C_WarmDevice *device);     // Your set-up before the configuration pairs (reset, wait...), cold path only. NULL = none.
+    void      *argument;                        // For your init function.
+    /*----- Filled in by SUS_I2C_WarmBoot -----*/
+    uint8_t   path;                             // SUS_I2C_WARMBOOT_VERIFIED, _INITIALIZED or _FAILED.
+    const char *reason;                         // Why it got the full set-up ("cold boot", "signature changed"...), NULL if verified.
+    esp_err_t outcome;
+    uint32_t  time_us;                          // Its probe and/or set-up.
+};
+
+struct SUS_I2C_TopologyChannel
+{
+    uint8_t   I2CportNumber, muxAddress, muxChannel;
+    uint32_t  present[4];                       // Bit per address: answered behind this channel (and not on the port itself).
+};
+
+struct SUS_I2C_TopologyDevice
+{
+    uint8_t   signature[SUS_I2C_WARMBOOT_MAX_SIGNATURE];
+    uint8_t   configured;                       // 1 = its set-up worked, the signature and hash below are good.
+    uint32_t  configHash;                       // Hash of the configuration pairs written.
+};
+
+struct SUS_I2C_Topology
+{
+    uint32_t  version;
+    uint32_t  length;                           // sizeof(struct SUS_I2C_Topology) - a build with other limits doesn't take it.
+    uint32_t  layoutHash;                       // The device list it was made for.
+    int32_t   busSpeed[2];                      // Hz, 0 = port not used.
+    uint32_t  present[2][4];                    // Bit per address: answered on the port itself.
+    uint8_t   channelCount;
+    struct SUS_I2C_TopologyChannel channel[SUS_I2C_WARMBOOT_MAX_CHANNELS];
+    struct SUS_I2C_TopologyDevice device[SUS_I2C_WARMBOOT_MAX_DEVICES];
+    uint32_t  cold_us;                          // How long the cold boot that made it took.
+    uint32_t  checksum;                         // Over everything above.
+};
+
+struct SUS_I2C_WarmBoot
+{
+    /*----- Filled in by YOU -----*/
+    uint8_t   deviceCount;
+    struct SUS_I2C_WarmDevice *device;
+    const struct SUS_I2C_Store *store;
+    const char *key;                            // Key of the snapshot in the store. NULL = SUS_I2C_WARMBOOT_DEFAULT_KEY.
+    const struct SUS_I2C_CalibrationConfig *calibration[2];  // Cold boot: calibrate the bus speed of this port (SPEED section). NULL = keep the speed.
+    bool      forceCold;                        // true = ignore the snapshot, do everything.
+    /*----- Filled in by SUS_I2C_WarmBoot -----*/
+    bool      warm;
+    uint32_t  total_us;
+    uint32_t  lastCold_us;                      // Warm boot: how long the cold boot took.
+    uint8_t   verified, initialized, failed;
+    struct SUS_I2C_Topology topology;           // What is stored now: addresses found, bus speeds, signatures.
+};
+
+#if SUS_I2C_FEATURE_WARMBOOT
+//FNV-1a: small, no table, good enough to notice a changed configuration or a damaged snapshot.
+static uint32_t SUS_I2C_WarmHash(uint32_t hash, const void *data, size_t length)
+{
+    const uint8_t *byte = (const uint8_t *)data;
+    while (length--) hash = (hash ^ *byte++) * 16777619u;
+    return hash;
+}
+#define SUS_I2C_WARMHASH_START          2166136261u
+
+//Selects the mux channel of a device (if it has one). "select" false = all channels off again.
+static esp_err_t SUS_I2C_WarmMux(const struct SUS_I2C_WarmDevice *device, bool select)
+{
+    if (device->muxAddress == 0) return ESP_OK;
+    return SUS_I2C_WriteByteToSlave_STATUS(device->I2CportNumber, device->muxAddress, select ? (uint8_t)(1 << (device->muxChannel & 7)) : 0x00);
+}
+
+//Which addresses answer (0x08 - 0x77, the ones devices may use).
+static void SUS_I2C_WarmScan(uint8_t I2CportNumber, uint32_t present[4])
+{
+    memset(present, 0, 4 * sizeof(uint32_t));
+    for (uint8_t address = 0x08; address <= 0x77; address++)
+        if (SUS_I2C_PingAddress_STATUS(I2CportNumber, address) == ESP_OK) present[address >> 5] |= 1u << (address & 31);
+}
+
+static esp_err_t SUS_I2C_WarmSignature(const struct SUS_I2C_WarmDevice *device, uint8_t signature[SUS_I2C_WARMBOOT_MAX_SIGNATURE])
+{
+    memset(signature, 0, SUS_I2C_WARMBOOT_MAX_SIGNATURE);
+    if (device->signatureLength == 0) return SUS_I2C_PingAddress_STATUS(device->I2CportNumber, device->I2CdeviceAddress);
+    return SUS_I2C_ReadRegisters(device->I2CportNumber, device->I2CdeviceAddress, device->signatureRegister, signature, device->signatureLength);
+}
+
+static esp_err_t SUS_I2C_WarmWriteConfig(const struct SUS_I2C_WarmDevice *device)
+{
+    esp_err_t outcome = ESP_OK;
+    for (int c = 0; c < device->configCount && outcome == ESP_OK; c++)
+        outcome = SUS_I2C_WriteRegisters(device->I2CportNumber, device->I2CdeviceAddress, device->config[c][0], &device->config[c][1], 1);
+    return outcome;
+}
+
+//The full set-up of one device: your init function, the configuration pairs, then its signature for the snapshot.
+static esp_err_t SUS_I2C_WarmSetUp(struct SUS_I2C_WarmDevice *device, struct SUS_I2C_TopologyDevice *record, uint32_t configHash)
+{
+    esp_err_t outcome = ESP_OK;
+    record->configured = 0;
+    if (device->init != NULL) outcome = device->init(device);
+    if (outcome == ESP_OK) outcome = SUS_I2C_WarmWriteConfig(device);
+    if (outcome == ESP_OK) outcome = SUS_I2C_WarmSignature(device, record->signature);
+    if (outcome == ESP_OK) {
+        record->configured = 1;
+        record->configHash = configHash;
+    }
+    return outcome;
+}
+
+//The verification probe. RETURNS NULL if the device passed, or why it did not.
+static const char *SUS_I2C_WarmVerify(const struct SUS_I2C_WarmDevice *device, const struct SUS_I2C_TopologyDevice *record, uint32_t configHash)
+{
+    uint8_t signature[SUS_I2C_WARMBOOT_MAX_SIGNATURE], value;
+    if (!record->configured) return "not set up last time";
+    if (record->configHash != configHash) return "configuration changed";
+    if (SUS_I2C_WarmSignature(device, signature) != ESP_OK) return "no answer";
+    if (memcmp(signature, record->signature, SUS_I2C_WARMBOOT_MAX_SIGNATURE) != 0) return "signature changed";
+    for (int c = 0; c < device->configCount && device->configReadable; c++)
+        if (SUS_I2C_ReadRegisters(device->I2CportNumber, device->I2CdeviceAddress, device->config[c][0], &value, 1) != ESP_OK || value != device->config[c][1])
+            return "configuration lost";
+    return NULL;
+}
+
+static uint32_t SUS_I2C_WarmChecksum(const struct SUS_I2C_Topology *topology)
+{
+    return SUS_I2C_WarmHash(SUS_I2C_WARMHASH_START, topology, sizeof(*topology) - sizeof(topology->checksum));
+}
+
+/**SUS_I2C_WarmBoot: Brings the devices of a warm boot description up - the full way the first time, with a verification probe per device when
+ * the snapshot from the last boot still fits (see WARM BOOT above). Does NOT print anything on success, errors are still printed.
+ * PARAMETER "boot" lists the devices and the store - see struct SUS_I2C_WarmBoot. Whether it was warm, the times and the topology are written back into it.
+ * RETURNS ESP_OK if every device is up, ESP_ERR_INVALID_ARG if the description makes no sense (nothing was done), otherwise the outcome of the first
+ * device that failed. A snapshot that can't be saved is only printed: the devices are up anyway, the next boot will just be cold.
+ * EXAMPLE USE: static const uint8_t imuConfig[][2] = {{0x6B, 0x01}, {0x1A, 0x03}, {0x1B, 0x18}};
+ *              static struct SUS_I2C_WarmDevice device[1] = {{.name="IMU", .I2CportNumber=0, .I2CdeviceAddress=0x68, .signatureRegister=0x75, .signatureLength=1,
+ *                                                             .config=imuConfig, .configCount=3, .configReadable=true, .init=ImuReset}};
+ *              struct SUS_I2C_Store nvs = {SUS_I2C_StoreNvsLoad, SUS_I2C_StoreNvsSave, "sus_i2c"};
+ *              static struct SUS_I2C_WarmBoot boot = {.deviceCount=1, .device=device, .store=&nvs};
+ *              SUS_I2C_WarmBoot(&boot);
+ *              SUS_I2C_WarmBootPrintReport(&boot);
+*/
+esp_err_t SUS_I2C_WarmBoot(struct SUS_I2C_WarmBoot *boot)
+{
+    const char *I2C_WARMBOOT_TAG = "I2C WARM BOOT";
+    const char *key = boot->key ? boot->key : SUS_I2C_WARMBOOT_DEFAULT_KEY;
+    struct SUS_I2C_Topology *topology = &boot->topology;
+    esp_err_t outcome = ESP_OK;
+    bool changed = false;
+
+    if (boot->device == NULL || boot->deviceCount == 0 || boot->deviceCount > SUS_I2C_WARMBOOT_MAX_DEVICES || boot->store == NULL ||
+        boot->store->load == NULL || boot->store->save == NULL) return ESP_ERR_INVALID_ARG;
+    uint32_t layoutHash = SUS_I2C_WARMHASH_START;
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        const struct SUS_I2C_WarmDevice *device = &boot->device[i];
+        if (device->signatureLength > SUS_I2C_WARMBOOT_MAX_SIGNATURE || (device->configCount > 0 && device->config == NULL)) return ESP_ERR_INVALID_ARG;
+        uint8_t layout[6] = {device->I2CportNumber, device->I2CdeviceAddress, device->muxAddress, device->muxChannel, device->signatureRegister, device->signatureLength};
+        layoutHash = SUS_I2C_WarmHash(layoutHash, layout, sizeof(layout));
+    }
+
+    int64_t bootStart = esp_timer_get_time();
+    boot->warm = !boot->forceCold && boot->store->load(boot->store->context, key, topology, sizeof(*topology)) == ESP_OK &&
+                 topology->version == SUS_I2C_WARMBOOT_VERSION && topology->length == sizeof(*topology) && topology->layoutHash == layoutHash &&
+                 topology->checksum == SUS_I2C_WarmChecksum(topology);
+    boot->verified = boot->initialized = boot->failed = 0;
+    boot->lastCold_us = boot->warm ? topology->cold_us : 0;
+
+    if (boot->warm)
+    {
+#if SUS_I2C_FEATURE_SPEED
+        for (int port = 0; port < 2; port++)        //The speed the calibration chose last time, without calibrating.
+            if (topology->busSpeed[port] > 0 && topology->busSpeed[port] != SUS_I2C_PortSpeedHz[port]) SUS_I2C_SetSpeed(port, topology->busSpeed[port]);
+#endif
+    }
+    else
+    {
+        memset(topology, 0, sizeof(*topology));
+        topology->version = SUS_I2C_WARMBOOT_VERSION;
+        topology->length = sizeof(*topology);
+        topology->layoutHash = layoutHash;
+        for (int port = 0; port < 2; port++)
+        {
+            bool used = false;
+            for (int i = 0; i < boot->deviceCount; i++) used |= (boot->device[i].I2CportNumber == port);
+            if (!used) continue;
+#if SUS_I2C_FEATURE_SPEED
+            if (boot->calibration[port] != NULL && SUS_I2C_CalibrateSpeed(port, boot->calibration[port], NULL) != ESP_OK)
+                ESP_LOGE(I2C_WARMBOOT_TAG,"[I2C PORT %d] : bus speed calibration FAILED, staying at %d Hz.",port,SUS_I2C_PortSpeedHz[port]);
+#endif
+            topology->busSpeed[port] = SUS_I2C_PortSpeedHz[port];
+            SUS_I2C_WarmScan(port, topology->present[port]);
+        }
+        for (int i = 0; i < boot->deviceCount; i++)     //Every mux channel in use, once.
+        {
+            struct SUS_I2C_WarmDevice *device = &boot->device[i];
+            bool known = device->muxAddress == 0;
+            for (int c = 0; c < topology->channelCount && !known; c++)
+                known = topology->channel[c].I2CportNumber == device->I2CportNumber && topology->channel[c].muxAddress == device->muxAddress &&
+                        topology->channel[c].muxChannel == device->muxChannel;
+            if (known || topology->channelCount == SUS_I2C_WARMBOOT_MAX_CHANNELS) continue;
+            struct SUS_I2C_TopologyChannel *channel = &topology->channel[topology->channelCount++];
+            channel->I2CportNumber = device->I2CportNumber;
+            channel->muxAddress = device->muxAddress;
+            channel->muxChannel = device->muxChannel;
+            if (SUS_I2C_WarmMux(device, true) == ESP_OK) SUS_I2C_WarmScan(device->I2CportNumber, channel->present);
+            SUS_I2C_WarmMux(device, false);
+            for (int w = 0; w < 4; w++) channel->present[w] &= ~topology->present[device->I2CportNumber & 1][w];     //Only what appeared behind the channel.
+        }
+        changed = true;
+    }
+
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        struct SUS_I2C_WarmDevice *device = &boot->device[i];
+        struct SUS_I2C_TopologyDevice *record = &topology->device[i];
+        uint32_t configHash = device->configCount > 0 ? SUS_I2C_WarmHash(SUS_I2C_WARMHASH_START, device->config, device->configCount * 2) : 0;
+        int64_t startTime = esp_timer_get_time();
+
+        device->outcome = SUS_I2C_WarmMux(device, true);
+        device->reason = boot->warm ? NULL : "cold boot";
+        if (device->outcome == ESP_OK && boot->warm) {
+            device->reason = SUS_I2C_WarmVerify(device, record, configHash);
+            if (device->reason == NULL && !device->configReadable) device->outcome = SUS_I2C_WarmWriteConfig(device);     //Can't be checked: written again.
+        }
+        if (device->outcome == ESP_OK && device->reason != NULL) {
+            device->outcome = SUS_I2C_WarmSetUp(device, record, configHash);
+            changed = true;
+        }
+        SUS_I2C_WarmMux(device, false);
+        device->time_us = (uint32_t)(esp_timer_get_time() - startTime);
+
+        if (device->outcome != ESP_OK) {
+            device->path = SUS_I2C_WARMBOOT_FAILED;
+            boot->failed++;
+            if (record->configured) changed = true;
+            record->configured = 0;
+            if (outcome == ESP_OK) outcome = device->outcome;
+            ESP_LOGE(I2C_WARMBOOT_TAG,"[I2C PORT %d], [Device %#04x] %s : set-up FAILED (%s). Code %#04x.",device->I2CportNumber,device->I2CdeviceAddress,
+                     device->name ? device->name : "",device->reason ? device->reason : "verified, configuration write",device->outcome);
+        }
+        else if (device->reason != NULL) {
+            device->path = SUS_I2C_WARMBOOT_INITIALIZED;
+            boot->initialized++;
+        }
+        else {
+            device->path = SUS_I2C_WARMBOOT_VERIFIED;
+            boot->verified++;
+        }
+    }
+
+    boot->total_us = (uint32_t)(esp_timer_get_time() - bootStart);
+    if (!boot->warm) topology->cold_us = boot->total_us;
+    if (changed) {
+        topology->checksum = SUS_I2C_WarmChecksum(topology);
+        esp_err_t saved = boot->store->save(boot->store->context, key, topology, sizeof(*topology));
+        if (saved != ESP_OK) ESP_LOGE(I2C_WARMBOOT_TAG,"Topology snapshot \"%s\" NOT saved, the next boot will be cold. Code %#04x.",key,saved);
+    }
+    return outcome;
+}
+
+/**SUS_I2C_WarmBootForget: Throws the snapshot away: the next SUS_I2C_WarmBoot with this store and key is a cold boot.
+ * For when you KNOW the hardware changed (service menu, "factory reset"...).
+ * RETURNS what the store's save returned.
+ * EXAMPLE USE: SUS_I2C_WarmBootForget(&nvs, NULL);
+*/
+esp_err_t SUS_I2C_WarmBootForget(const struct SUS_I2C_Store *store, const char *key)
+{
+    struct SUS_I2C_Topology empty;
+    memset(&empty, 0, sizeof(empty));       //Version 0: never taken.
+    return store->save(store->context, key ? key : SUS_I2C_WARMBOOT_DEFAULT_KEY, &empty, sizeof(empty));
+}
+
+/**SUS_I2C_WarmBootPrintReport: Prints whether the boot was warm or cold, what happened to every device and why, the addresses found, and the warm boot
+ * time against the last cold one.
+ * EXAMPLE USE: SUS_I2C_WarmBootPrintReport(&boot);
+*/
+void SUS_I2C_WarmBootPrintReport(struct SUS_I2C_WarmBoot *boot)
+{
+    const char *I2C_WARMBOOT_TAG = "I2C WARM BOOT";
+    static const char *pathName[3] = {"verified", "SET UP", "FAILED"};
+    const struct SUS_I2C_Topology *topology = &boot->topology;
+
+    if (boot->warm)
+        ESP_LOGI(I2C_WARMBOOT_TAG,"WARM boot: %lu us, the last cold boot took %lu us (%.1fx longer). %d devices verified, %d set up again, %d failed.",
+                 (unsigned long)boot->total_us,(unsigned long)boot->lastCold_us,boot->total_us ? (double)boot->lastCold_us / boot->total_us : 0.0,
+                 boot->verified,boot->initialized,boot->failed);
+    else
+        ESP_LOGI(I2C_WARMBOOT_TAG,"COLD boot: %lu us. %d devices set up, %d failed.",(unsigned long)boot->total_us,boot->initialized,boot->failed);
+    for (int i = 0; i < boot->deviceCount; i++)
+    {
+        const struct SUS_I2C_WarmDevice *device = &boot->device[i];
+        ESP_LOGI(I2C_WARMBOOT_TAG,"[I2C PORT %d], [Device %#04x] %-12s: %-8s %7lu us%s%s%s",device->I2CportNumber,device->I2CdeviceAddress,device->name ? device->name : "",
+                 pathName[device->path],(unsigned long)device->time_us,device->reason ? " (" : "",device->reason ? device->reason : "",device->reason ? ")" : "");
+    }
+    for (int port = 0; port < 2; port++)
+    {
+        if (topology->busSpeed[port] == 0) continue;
+        char list[128 * 5 + 1] = "";
+        for (int address = 0; address < 128; address++)
+            if ((topology->present[port][address >> 5] >> (address & 31)) & 1) snprintf(list + strlen(list), sizeof(list) - strlen(list), " %#04x", address);
+        ESP_LOGI(I2C_WARMBOOT_TAG,"[I2C PORT %d] : %ld Hz, found at the last cold boot:%s",port,(long)topology->busSpeed[port],list[0] ? list : " nothing");
+    }
+    for (int c = 0; c < topology->channelCount; c++)
+    {
+        const struct SUS_I2C_TopologyChannel *channel = &topology->channel[c];
+        char list[128 * 5 + 1] = "";
+        for (int address = 0; address < 128; address++)
+            if ((channel->present[address >> 5] >> (address & 31)) & 1) snprintf(list + strlen(list), sizeof(list) - strlen(list), " %#04x", address);
+        ESP_LOGI(I2C_WARMBOOT_TAG,"[I2C PORT %d], [Mux %#04x channel %d] :%s",channel->I2CportNumber,channel->muxAddress,channel->muxChannel,list[0] ? list : " nothing");
+    }
+}
+
+/**SUS_I2C_StoreFileLoad / SUS_I2C_StoreFileSave: Key-value store in files - for Linux, or a mounted SPIFFS/FAT/LittleFS file system on the ESP32.
+ * The context is the directory (const char *), each key is one file in it. Saving writes a temporary file first and renames it over the old one,
+ * so a reset in the middle never leaves half a snapshot.
+ * EXAMPLE USE: struct SUS_I2C_Store files = {SUS_I2C_StoreFileLoad, SUS_I2C_StoreFileSave, "/spiffs"};
+*/
+esp_err_t SUS_I2C_StoreFileLoad(void *context, const char *key, void *data, size_t length)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", (const char *)context, key);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return ESP_ERR_NOT_FOUND;
+    size_t got = fread(data, 1, length, file);
+    bool exact = (got == length && fgetc(file) == EOF);
+    fclose(file);
+    return exact ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t SUS_I2C_StoreFileSave(void *context, const char *key, const void *data, size_t length)
+{
+    char path[128], temporary[136];
+    snprintf(path, sizeof(path), "%s/%s", (const char *)context, key);
+    snprintf(temporary, sizeof(temporary), "%s.new", path);
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL) return ESP_FAIL;
+    bool written = (fwrite(data, 1, length, file) == length);
+    if (fclose(file) != 0) written = false;
+    if (!written || rename(temporary, path) != 0) {
+        remove(temporary);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+#if defined(ESP_PLATFORM)
+/**SUS_I2C_StoreNvsLoad / SUS_I2C_StoreNvsSave: Key-value store in NVS (ESP32 only). The context is the NVS namespace (const char *, up to 15 characters),
+ * keys up to 15 characters too. Call nvs_flash_init() first.
+ * EXAMPLE USE: struct SUS_I2C_Store nvs = {SUS_I2C_StoreNvsLoad, SUS_I2C_StoreNvsSave, "sus_i2c"};
+*/
+esp_err_t SUS_I2C_StoreNvsLoad(void *context, const char *key, void *data, size_t length)
+{
+    nvs_handle_t handle;
+    size_t stored = length;
+    esp_err_t outcome = nvs_open((const char *)context, NVS_READONLY, &handle);
+    if (outcome != ESP_OK) return outcome;
+    outcome = nvs_get_blob(handle, key, data, &stored);
+    nvs_close(handle);
+    if (outcome == ESP_OK && stored != length) outcome = ESP_ERR_INVALID_SIZE;
+    return outcome;
+}
+
+esp_err_t SUS_I2C_StoreNvsSave(void *context, const char *key, const void *data, size_t length)
+{
+    nvs_handle_t handle;
+    esp_err_t outcome = nvs_open((const char *)context, NVS_READWRITE, &handle);
+    if (outcome != ESP_OK) return outcome;
+    outcome = nvs_set_blob(handle, key, data, length);
+    if (outcome == ESP_OK) outcome = nvs_commit(handle);
+    nvs_close(handle);
+    return outcome;
+}
+#endif //ESP_PLATFORM
+#endif //SUS_I2C_FEATURE_WARMBOOT
+
+
+/*==========================================================================================================================
+ ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄       ▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░▌     ▐░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░█▀▀▀▀▀▀▀█░▌▐░▌░▌   ▐░▐░▌▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀▀▀▀▀▀
+▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌▐░▌ ▐░▌▐░▌▐░▌          ▐░▌
+▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄█░▌▐░█▄▄▄▄▄▄▄█░▌▐░▌ ▐░▐░▌ ▐░▌▐░█▄▄▄▄▄▄▄▄▄ ▐░█▄▄▄▄▄▄▄▄▄
+▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░▌  ▐░▌  ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+▐░█▀▀▀▀▀▀▀▀▀ ▐░█▀▀▀▀█░█▀▀ ▐░█▀▀▀▀▀▀▀█░▌▐░▌   ▀   ▐░▌▐░█▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀█░▌
+▐░▌          ▐░▌     ▐░▌  ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌                    ▐░▌
+▐░▌          ▐░▌      ▐░▌ ▐░▌       ▐░▌▐░▌       ▐░▌▐░█▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄█░▌
+▐░▌          ▐░▌       ▐░▌▐░▌       ▐░▌▐░▌       ▐░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
+ ▀            ▀         ▀  ▀         ▀  ▀         ▀  ▀▀▀▀▀▀▀▀▀▀▀  ▀▀▀▀▀▀▀▀▀▀▀
+*/
+
+/* FRAMES: timestamped sample frames from a fixed pool, handed from task to task by pointer.
+ * The usual way data travels: a read into a local buffer, copied into a struct, the struct copied into a queue, out of the queue into the next
+ * task, copied again into the queue of the logger, and again into the one of the display... every hop copies every byte, and the queues have to
+ * be as wide as the biggest sample.
+ * A frame is read ONCE, straight into its payload, and from then on only its pointer moves:
+ *      - frames come from a pool YOU give the memory for (struct SUS_I2C_Frame array). No malloc, no fragmentation, a known worst case.
+ *        Pool empty = the read is refused (ESP_ERR_NO_MEM) and counted, never a wait: size the pool with the report (peak use, failures).
+ *      - SUS_I2C_FrameRead() takes a frame, notes the time and the device, reads the registers into the payload and keeps the outcome in the frame.
+ *      - SUS_I2C_FramePublish() sends it to any number of consumer queues (SUS_I2C_FrameQueueCreate). Every queue that takes it holds its
+ *        own REFERENCE; a full queue is skipped and counted, never waited for (unless you say so).
+ *      - a consumer SUS_I2C_FrameReceive()s the pointer, uses the frame, and SUS_I2C_FrameRelease()s it. The last release puts the frame back
+ *        into its pool - whichever consumer is the last one, nobody has to know about the others.
+ *      - need to keep a frame longer, or pass it on yourself? SUS_I2C_FrameRetain() it, and release it once more later.
+ * A frame you hold is READ-ONLY once published: other consumers read the same payload at the same time.
+ * SUS_I2C_FramePoolPrintReport() prints the pool occupancy (now and peak), allocation failures and frames consumers could not take.
+ */
+#ifndef SUS_I2C_FRAME_PAYLOAD
+#define SUS_I2C_FRAME_PAYLOAD           32      // Payload bytes per frame (the longest read). Define it before including the library to change it (compiled component: menuconfig or -DSUS_I2C_FRAME_PAYLOAD).
+#endif
+#if SUS_I2C_FRAME_PAYLOAD < 1 || SUS_I2C_FRAME_PAYLOAD > 255
+#error "SUS_I2C_FRAME_PAYLOAD must be 1 - 255 (a frame's length is one byte)."
+#endif
+#define SUS_I2C_FRAME_MAX_CONSUMERS     8       // Queues one SUS_I2C_FramePublish can send a frame to.
+
+struct SUS_I2C_FramePool;
+
+struct SUS_I2C_Frame
+{
+    int64_t   timestamp_us;                     // When the read started (esp_timer_get_time(), same clock on both cores).
+    uint32_t  sequence;                         // Counts 0,1,2... per pool, in the order the frames were taken.
+    esp_err_t outcome;                          // Status of the read: ESP_OK, or its error (then "payload" is garbage).
+    uint16_t  deviceId;                         // Yours: whatever tells your consumers what this is. SUS_I2C_FrameRead doesn't touch it.
+    uint8_t   I2CportNumber;
+    uint8_t   I2CdeviceAddress;
+    uint8_t   startRegisterAddress;
+    uint8_t   length;                           // Valid bytes in "payload".
+    /*----- Internal -----*/
+    uint32_t  references;                       // 0 = in the pool.
+    struct SUS_I2C_FramePool *pool;
+    struct SUS_I2C_Frame *next;                 // Free list.
+    uint8_t   payload[SUS_I2C_FRAME_PAYLOAD];
+};
+
+struct SUS_I2C_FramePool
+{
+    /*----- Statistics, read them, don't write them -----*/
+    uint16_t  frameCount;
+    uint16_t  inUse;                            // Frames out of the pool right now.
+    uint16_t  peakInUse;                        // Most frames ever out at once. Close to frameCount = make the pool bigger.
+    uint32_t  taken;                            // Frames handed out.
+    uint32_t  failures;                         // Times the pool was empty (SUS_I2C_FrameTake returned NULL, SUS_I2C_FrameRead refused).
+    uint32_t  delivered;                        // Frames put into consumer queues.
+    uint32_t  dropped;                          // Frames a consumer queue had no room for.
+    /*----- Internal -----*/
+    uint32_t  sequence;
+    struct SUS_I2C_Frame *free;
+};
+
+#if SUS_I2C_FEATURE_FRAMES
+static portMUX_TYPE SUS_I2C_FrameLock = portMUX_INITIALIZER_UNLOCKED;     // Free lists of all pools. Held for a few instructions. Reference counts are atomic.
+
+/**SUS_I2C_FramePoolInit: Makes a pool out of your frames. The pool and the frames must stay alive as long as frames are in use (global or static).
+ * RETURNS ESP_OK, ESP_ERR_INVALID_ARG if there are no frames (or more than 65535).
+ * EXAMPLE USE: static struct SUS_I2C_Frame frames[32];
+ *              static struct SUS_I2C_FramePool pool;
+ *              SUS_I2C_FramePoolInit(&pool, frames, 32);
+*/
+esp_err_t SUS_I2C_FramePoolInit(struct SUS_I2C_FramePool *pool, struct SUS_I2C_Frame *frames, size_t frameCount)
+{
+    if (pool == NULL || frames == NULL || frameCount == 0 || frameCount > 0xFFFF) return ESP_ERR_INVALID_ARG;
+    memset(pool, 0, sizeof(*pool));
+    memset(frames, 0, frameCount * sizeof(*frames));
+    pool->frameCount = (uint16_t)frameCount;
+    for (size_t f = 0; f < frameCount; f++) {
+        frames[f].pool = pool;
+        frames[f].next = (f + 1 < frameCount) ? &frames[f + 1] : NULL;
+    }
+    pool->free = &frames[0];
+    return ESP_OK;
+}
+
+/**SUS_I2C_FrameTake: Takes an empty frame out of the pool, with one reference (yours). Fill it yourself - for frames that don't come from
+ * a register read (computed values, SMBus blocks...). Never waits.
+ * RETURNS the frame, or NULL if the pool is empty (counted in pool->failures).
+ * EXAMPLE USE: struct SUS_I2C_Frame *frame = SUS_I2C_FrameTake(&pool);
+*/
+struct SUS_I2C_Frame *SUS_I2C_FrameTake(struct SUS_I2C_FramePool *pool)
+{
+    portENTER_CRITICAL(&SUS_I2C_FrameLock);
+    struct SUS_I2C_Frame *frame = pool->free;
+    if (frame == NULL) pool->failures++;
+    else {
+        pool->free = frame->next;
+        frame->next = NULL;
+        frame->references = 1;
+        frame->sequence = pool->sequence++;
+        pool->taken++;
+        if (++pool->inUse > pool->peakInUse) pool->peakInUse = pool->inUse;
+    }
+    portEXIT_CRITICAL(&SUS_I2C_FrameLock);
+    if (frame != NULL) {        //Nothing left over from its last use.
+        frame->timestamp_us = 0;
+        frame->outcome = ESP_OK;
+        frame->deviceId = 0;
+        frame->I2CportNumber = frame->I2CdeviceAddress = frame->startRegisterAddress = frame->length = 0;
+    }
+    return frame;
+}
+
+/**SUS_I2C_FrameRetain: Adds references to a frame you hold - one per extra owner you are going to hand it to. Each of them releases once.
+ * EXAMPLE USE: SUS_I2C_FrameRetain(frame, 1); xQueueSend(myOwnQueue, &frame, 0);
+*/
+void SUS_I2C_FrameRetain(struct SUS_I2C_Frame *frame, uint8_t extraReferences)
+{
+    __atomic_fetch_add(&frame->references, extraReferences, __ATOMIC_RELAXED);     //The caller holds one already, so it can't go back meanwhile.
+}
+
+/**SUS_I2C_FrameRelease: Gives up your reference to a frame. The last reference puts the frame back into its pool. Don't touch the frame afterwards.
+ * EXAMPLE USE: SUS_I2C_FrameRelease(frame);
+*/
+void SUS_I2C_FrameRelease(struct SUS_I2C_Frame *frame)
+{
+    if (frame == NULL) return;
+    struct SUS_I2C_FramePool *pool = frame->pool;
+    if (__atomic_sub_fetch(&frame->references, 1, __ATOMIC_ACQ_REL) != 0) return;     //ACQ_REL: every consumer is done reading before it's reused.
+    portENTER_CRITICAL(&SUS_I2C_FrameLock);
+    frame->next = pool->free;
+    pool->free = frame;
+    pool->inUse--;
+    portEXIT_CRITICAL(&SUS_I2C_FrameLock);
+}
+
+/**SUS_I2C_FrameRead: Takes a frame from the pool and burst reads registers straight into its payload: time stamp, port, device, registers and the
+ * outcome of the read are in the frame. Does NOT print anything on success, errors are still printed.
+ * PARAMETER "frame" gets the frame - also when the read failed (its outcome says so, your consumers may want to know). You hold one reference.
+ * RETURNS the outcome of the read, ESP_ERR_NO_MEM if the pool was empty (*frame = NULL, nothing read), ESP_ERR_INVALID_ARG if the read doesn't
+ * fit into a frame (0 or more than SUS_I2C_FRAME_PAYLOAD bytes).
+ * EXAMPLE USE: struct SUS_I2C_Frame *frame;
+ *              if (SUS_I2C_FrameRead(&pool, 0, 0x68, 0x3B, 14, &frame) != ESP_ERR_NO_MEM) SUS_I2C_FramePublish(frame, consumers, 2, 0);
+*/
+esp_err_t SUS_I2C_FrameRead(struct SUS_I2C_FramePool *pool, uint8_t I2CportNumber, uint8_t I2CdeviceAddress, uint8_t startRegisterAddress,
+                            size_t amountOfBytesToRead, struct SUS_I2C_Frame **frame)
+{
+    *frame = NULL;
+    if (amountOfBytesToRead == 0 || amountOfBytesToRead > SUS_I2C_FRAME_PAYLOAD) return ESP_ERR_INVALID_ARG;
+    struct SUS_I2C_Frame *taken = SUS_I2C_FrameTake(pool);
+    if (taken == NULL) return ESP_ERR_NO_MEM;
+    taken->I2CportNumber = I2CportNumber;
+    taken->I2CdeviceAddress = I2CdeviceAddress;
+    taken->startRegisterAddress = startRegisterAddress;
+    taken->length = (uint8_t)amountOfBytesToRead;
+    taken->timestamp_us = esp_timer_get_time();
+    taken->outcome = SUS_I2C_ReadRegisters(I2CportNumber, I2CdeviceAddress, startRegisterAddress, taken->payload, amountOfBytesToRead);
+    *frame = taken;
+    return taken->outcome;
+}
+
+/**SUS_I2C_FrameQueueCreate: Creates a consumer queue for frames. It holds POINTERS, so it is equally small for any payload size.
+ * RETURNS the queue, or NULL if there is not enough RAM.
+ * EXAMPLE USE: QueueHandle_t logger = SUS_I2C_FrameQueueCreate(16);
+*/
+QueueHandle_t SUS_I2C_FrameQueueCreate(size_t length)
+{
+    return xQueueCreate(length, sizeof(struct SUS_I2C_Frame *));
+}
+
+/**SUS_I2C_FramePublish: Hands a frame to every queue in the list. Each queue that takes it gets its own reference - YOURS goes to the last one,
+ * so don't touch the frame afterwards (SUS_I2C_FrameRetain it before if you want to keep it). No queue took it = back into the pool.
+ * PARAMETER "ticksToWait" is how long to wait for room in EACH full queue. 0 = don't: a full queue just misses the frame (counted in pool->dropped).
+ * RETURNS how many queues took the frame.
+ * EXAMPLE USE: QueueHandle_t consumers[2] = {processing, logger};
+ *              SUS_I2C_FramePublish(frame, consumers, 2, 0);
+*/
+uint8_t SUS_I2C_FramePublish(struct SUS_I2C_Frame *frame, const QueueHandle_t *queue, uint8_t queueCount, TickType_t ticksToWait)
+{
+    struct SUS_I2C_FramePool *pool = frame->pool;
+    uint8_t delivered = 0;
+
+    if (queueCount > SUS_I2C_FRAME_MAX_CONSUMERS) queueCount = SUS_I2C_FRAME_MAX_CONSUMERS;
+    if (queueCount == 0) {
+        SUS_I2C_FrameRelease(frame);
+        return 0;
+    }
+    SUS_I2C_FrameRetain(frame, queueCount - 1);         //References first: a fast consumer may release before the next queue got it.
+    for (uint8_t q = 0; q < queueCount; q++)
+    {
+        if (queue[q] != NULL && xQueueSend(queue[q], &frame, ticksToWait) == pdTRUE) delivered++;
+        else SUS_I2C_FrameRelease(frame);               //That queue's reference.
+    }
+    __atomic_fetch_add(&pool->delivered, delivered, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool->dropped, queueCount - delivered, __ATOMIC_RELAXED);
+    return delivered;
+}
+
+/**SUS_I2C_FrameReceive: Takes the next frame out of a consumer queue. You hold one reference: SUS_I2C_FrameRelease it when you are done.
+ * PARAMETER "ticksToWait": 0 = don't wait, portMAX_DELAY = wait forever.
+ * RETURNS ESP_OK and fills in "frame", or ESP_ERR_TIMEOUT if no frame came in time.
+ * EXAMPLE USE: struct SUS_I2C_Frame *frame;
+ *              while (SUS_I2C_FrameReceive(logger, &frame, portMAX_DELAY) == ESP_OK) { ...use frame... SUS_I2C_FrameRelease(frame); }
+*/
+esp_err_t SUS_I2C_FrameReceive(QueueHandle_t queue, struct SUS_I2C_Frame **frame, TickType_t ticksToWait)
+{
+    if (xQueueReceive(queue, frame, ticksToWait) != pdTRUE) return ESP_ERR_TIMEOUT;
+    return ESP_OK;
+}
+
+/**SUS_I2C_FramePoolPrintReport: Prints how full the pool is (now and at its peak), how often it was empty, and how many frames consumers missed.
+ * EXAMPLE USE: SUS_I2C_FramePoolPrintReport(&pool);
+*/
+void SUS_I2C_FramePoolPrintReport(struct SUS_I2C_FramePool *pool)
+{
+    const char *I2C_FRAMES_TAG = "I2C FRAMES";
+    ESP_LOGI(I2C_FRAMES_TAG,"pool: %d frames of %d bytes (%d bytes of RAM), %d in use now, peak %d (%.0f%%).",pool->frameCount,SUS_I2C_FRAME_PAYLOAD,
+             (int)(pool->frameCount * sizeof(struct SUS_I2C_Frame)),pool->inUse,pool->peakInUse,pool->frameCount ? 100.0 * pool->peakInUse / pool->frameCount : 0.0);
+    ESP_LOGI(I2C_FRAMES_TAG,"%lu frames taken, %lu times the pool was empty, %lu delivered to consumers, %lu dropped by full consumer queues.",
+             (unsigned long)pool->taken,(unsigned long)pool->failures,(unsigned long)pool->delivered,(unsigned long)pool->dropped);
+    if (pool->failures > 0) ESP_LOGW(I2C_FRAMES_TAG,"the pool ran empty - more frames, or consumers that release them sooner.");
+}
+#endif //SUS_I2C_FEATURE_FRAMES
+
+
 /*
  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄  ▄▄▄▄▄▄▄▄▄▄▄ 
 ▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌▐░░░░░░░░░░░▌
@@ -722,3 +6700,4 @@ __________________________________
 |    Bits from SDA are processed on the falling edge of the clock by both master and slave.
 */
 
+#endif //SUS_I2CMASTER_FULL_H
@@ -0,0 +1,249 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_BootBenchmark.c
+ *
+ *    Brief:    Measures how much faster a board comes up with the boot orchestrator (SUS_I2C_Boot) than with one device after another.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h) with a typical board on both ports:
+ *                  port 0: PMIC (switches the sensor rails on), IMU, barometer
+ *                  port 1: ambient light sensor (always powered), magnetometer, OLED display, touch controller (part of the display module)
+ *              The simulated devices NACK until their rail is on and count every access that comes sooner than their datasheet allows
+ *              (during a reset, before the charge pump is up...), so a boot that ignores a dependency or cuts a delay short shows up as an error.
+ *              The same board description is booted three ways:
+ *                  1. one device after another (every device "after" the previous one) - the classic boot sequence,
+ *                  2. orchestrated: every device only after what it really depends on,
+ *                  3. orchestrated, with the display unplugged: the touch controller behind it must be skipped, everything else must come up.
+ *              Waits are real (the simulator's RTOS tick is 1 ms), so the whole run takes a few seconds.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_BootBenchmark SUS_I2C_BootBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_BootBenchmark
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+/*----- The simulated board. Every chip knows when it is ready for the next access, and complains if it gets one sooner. -----*/
+struct BenchChip
+{
+    uint8_t  port, address;
+    bool     powered;               // Powered by the PMIC rail (false = always on).
+    bool     unplugged;
+    int64_t  busyUntil_us;          // Accesses before this are too early (reset, power-up, charge pump...).
+    int64_t  readyAt_us;            // POLL target: status says "ready" from here on.
+    uint32_t tooEarly;
+};
+
+#define BENCH_PMIC      0
+#define BENCH_IMU       1
+#define BENCH_BARO      2
+#define BENCH_LIGHT     3
+#define BENCH_MAG       4
+#define BENCH_DISPLAY   5
+#define BENCH_TOUCH     6
+#define BENCH_CHIPS     7
+
+static struct BenchChip benchChip[BENCH_CHIPS] = {
+    [BENCH_PMIC]    = {0, 0x34, false},
+    [BENCH_IMU]     = {0, 0x68, true},
+    [BENCH_BARO]    = {0, 0x76, true},
+    [BENCH_LIGHT]   = {1, 0x29, false},
+    [BENCH_MAG]     = {1, 0x1E, true},
+    [BENCH_DISPLAY] = {1, 0x3C, true},
+    [BENCH_TOUCH]   = {1, 0x38, true},
+};
+
+static struct BenchChip *BenchChipOf(struct SUS_SimDevice *device)
+{
+    return (struct BenchChip *)device->context;
+}
+
+static void BenchAccess(struct BenchChip *chip)
+{
+    if (esp_timer_get_time() < chip->busyUntil_us) chip->tooEarly++;
+}
+
+static void BenchPowerRails(bool on)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < BENCH_CHIPS; i++)
+    {
+        struct BenchChip *chip = &benchChip[i];
+        if (!chip->powered) continue;
+        SUS_SimBus_Port[chip->port].device[chip->address].present = on && !chip->unplugged;
+        chip->busyUntil_us = now + 5000;        //Rails need 5 ms to settle.
+    }
+}
+
+static void BenchWrite(struct SUS_SimDevice *device, uint8_t registerAddress, uint8_t value)
+{
+    struct BenchChip *chip = BenchChipOf(device);
+    int64_t now = esp_timer_get_time();
+    BenchAccess(chip);
+    device->registers[registerAddress] = value;
+    if (chip == &benchChip[BENCH_PMIC] && registerAddress == 0x10) BenchPowerRails(value != 0);
+    if (chip == &benchChip[BENCH_IMU] && registerAddress == 0x6B && (value & 0x80)) chip->busyUntil_us = now + 100000;     //Reset: 100 ms.
+    if (chip == &benchChip[BENCH_BARO] && registerAddress == 0xE0 && value == 0xB6) {                                      //Reset: 2 ms, then it loads its calibration.
+        chip->busyUntil_us = now + 2000;
+        chip->readyAt_us = now + 8000;
+    }
+    if (chip == &benchChip[BENCH_LIGHT] && registerAddress == 0x80) {
+        if (value == 0x01) chip->busyUntil_us = now + 3000;                                                                  //Power on: 3 ms.
+        if (value & 0x02) chip->readyAt_us = now + 100000;                                                                   //First integration: 100 ms.
+    }
+    if (chip == &benchChip[BENCH_MAG] && registerAddress == 0x21 && (value & 0x0C)) chip->busyUntil_us = now + 50000;       //Soft reset: 50 ms.
+    if (chip == &benchChip[BENCH_DISPLAY] && value == 0x14) chip->busyUntil_us = now + 100000;   //Charge pump: 100 ms.
+}
+
+static uint8_t BenchRead(struct SUS_SimDevice *device, uint8_t registerAddress)
+{
+    struct BenchChip *chip = BenchChipOf(device);
+    bool ready = esp_timer_get_time() >= chip->readyAt_us;
+    BenchAccess(chip);
+    if (chip == &benchChip[BENCH_BARO] && registerAddress == 0xF3) return ready ? 0x00 : 0x01;      //im_update bit.
+    if (chip == &benchChip[BENCH_LIGHT] && registerAddress == 0x93) return ready ? 0x01 : 0x00;     //AVALID bit.
+    if (chip == &benchChip[BENCH_TOUCH] && registerAddress == 0xA8) return 0x11;                    //Vendor ID.
+    return device->registers[registerAddress];
+}
+
+//CALL steps: the reset pins. On the ESP32 these would be gpio_set_level() pulses.
+static esp_err_t BenchResetPin(void *argument)
+{
+    struct BenchChip *chip = argument;
+    int64_t now = esp_timer_get_time();
+    BenchAccess(chip);
+    chip->busyUntil_us = now + (chip == &benchChip[BENCH_TOUCH] ? 300000 : 1000);       //FT6x06 touch: 300 ms after reset. SSD1306: 1 ms... then its charge pump.
+    return ESP_OK;
+}
+
+static void BenchBoardOff(void)
+{
+    for (int i = 0; i < BENCH_CHIPS; i++)
+    {
+        struct BenchChip *chip = &benchChip[i];
+        struct SUS_SimDevice *device = SUS_SimBus_AddDevice(chip->port, chip->address);
+        device->onWrite = BenchWrite;
+        device->onRead = BenchRead;
+        device->context = chip;
+        device->present = !chip->powered && !chip->unplugged;
+        chip->busyUntil_us = chip->readyAt_us = 0;
+        chip->tooEarly = 0;
+    }
+}
+
+/*----- The board description: what every device needs. -----*/
+static const struct SUS_I2C_BootStep benchPmicSteps[] = {
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x10, 0x0F}, .delay_us=5000},              //Sensor rails on, 5 ms to settle.
+};
+static const struct SUS_I2C_BootStep benchImuSteps[] = {
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x6B, 0x80}, .delay_us=100000},            //Reset.
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x6B, 0x01}},                              //Wake up, PLL clock.
+    {.action=SUS_I2C_BOOT_WRITE, .length=3, .data={0x1A, 0x03, 0x18}},                        //Filter, gyro range.
+};
+static const struct SUS_I2C_BootStep benchBaroSteps[] = {
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0xE0, 0xB6}, .delay_us=2000},              //Reset.
+    {.action=SUS_I2C_BOOT_POLL,  .data={0xF3, 0x01, 0x00}, .delay_us=20000},                  //Calibration loaded.
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0xF4, 0x27}},                              //Normal mode.
+};
+static const struct SUS_I2C_BootStep benchLightSteps[] = {
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x80, 0x01}, .delay_us=3000},              //Power on.
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x80, 0x03}},                              //Start measuring.
+    {.action=SUS_I2C_BOOT_POLL,  .data={0x93, 0x01, 0x01}, .delay_us=300000},                 //First result valid.
+};
+static const struct SUS_I2C_BootStep benchMagSteps[] = {
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x21, 0x0C}, .delay_us=50000},             //Soft reset.
+    {.action=SUS_I2C_BOOT_WRITE, .length=4, .data={0x20, 0x70, 0x00, 0x00}},                  //Ultra-high performance, continuous.
+};
+static const struct SUS_I2C_BootStep benchDisplaySteps[] = {
+    {.action=SUS_I2C_BOOT_CALL, .function=BenchResetPin, .argument=&benchChip[BENCH_DISPLAY], .delay_us=1000},
+    {.action=SUS_I2C_BOOT_WRITE, .length=3, .data={0x00, 0x8D, 0x14}, .delay_us=100000},      //Charge pump on.
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x00, 0xAF}},                              //Display on.
+};
+static const struct SUS_I2C_BootStep benchTouchSteps[] = {
+    {.action=SUS_I2C_BOOT_CALL, .function=BenchResetPin, .argument=&benchChip[BENCH_TOUCH], .delay_us=300000},
+    {.action=SUS_I2C_BOOT_POLL,  .data={0xA8, 0xFF, 0x11}, .delay_us=50000},                  //Vendor ID answers.
+    {.action=SUS_I2C_BOOT_WRITE, .length=2, .data={0x80, 0x28}},                              //Touch threshold.
+};
+
+static struct SUS_I2C_BootDevice benchDevice[BENCH_CHIPS];
+
+//serial = every device after the previous one (the classic boot), otherwise only after what it really depends on.
+static void BenchDescribe(bool serial)
+{
+    static const struct { const char *name; const struct SUS_I2C_BootStep *step; uint8_t stepCount; int after; } describe[BENCH_CHIPS] = {
+        [BENCH_PMIC]    = {"PMIC",          benchPmicSteps,     1, -1},
+        [BENCH_IMU]     = {"IMU",           benchImuSteps,      3, BENCH_PMIC},
+        [BENCH_BARO]    = {"barometer",     benchBaroSteps,     3, BENCH_PMIC},
+        [BENCH_LIGHT]   = {"light",         benchLightSteps,    3, -1},
+        [BENCH_MAG]     = {"magnetometer",  benchMagSteps,      2, BENCH_PMIC},
+        [BENCH_DISPLAY] = {"display",       benchDisplaySteps,  3, BENCH_PMIC},
+        [BENCH_TOUCH]   = {"touch",         benchTouchSteps,    3, BENCH_DISPLAY},
+    };
+    for (int i = 0; i < BENCH_CHIPS; i++)
+    {
+        int after = serial ? i - 1 : describe[i].after;
+        benchDevice[i] = (struct SUS_I2C_BootDevice){.name = describe[i].name, .I2CportNumber = benchChip[i].port, .I2CdeviceAddress = benchChip[i].address,
+                                                     .step = describe[i].step, .stepCount = describe[i].stepCount};
+        if (after >= 0) benchDevice[i].after[0] = &benchDevice[after];
+    }
+}
+
+static int BenchRun(const char *title, bool serial, int unplugged, esp_err_t expected, struct SUS_I2C_Boot *boot)
+{
+    int problems = 0;
+
+    for (int i = 0; i < BENCH_CHIPS; i++) benchChip[i].unplugged = (i == unplugged);
+    BenchBoardOff();
+    BenchDescribe(serial);
+    *boot = (struct SUS_I2C_Boot){.deviceCount = BENCH_CHIPS, .device = benchDevice};
+
+    printf("\n===== %s =====\n", title);
+    SUS_Sim_LogLevel = 1;
+    esp_err_t outcome = SUS_I2C_Boot(boot);
+    SUS_Sim_LogLevel = 3;
+    SUS_I2C_BootPrintReport(boot);
+
+    if (outcome != expected) { printf("!! SUS_I2C_Boot returned %#x, expected %#x\n", outcome, expected); problems++; }
+    for (int i = 0; i < BENCH_CHIPS; i++)
+    {
+        esp_err_t should = i == unplugged ? ESP_FAIL : (unplugged >= 0 && benchDevice[i].after[0] == &benchDevice[unplugged]) ? ESP_ERR_INVALID_STATE : ESP_OK;
+        if (benchChip[i].tooEarly) { printf("!! %s was accessed %lu times too early\n", benchDevice[i].name, (unsigned long)benchChip[i].tooEarly); problems++; }
+        if (benchDevice[i].outcome != should) { printf("!! %s: outcome %#x, expected %#x\n", benchDevice[i].name, benchDevice[i].outcome, should); problems++; }
+    }
+    return problems;
+}
+
+int main(void)
+{
+    struct SUS_I2C_Boot serial, parallel, unplugged;
+    int problems = 0;
+
+    SUS_Sim_LogLevel = 1;
+    SUS_SimBus_Init(0, 400000, true);
+    SUS_SimBus_Init(1, 400000, true);
+    SUS_I2C_Master_Init(0, 22, 21, 400000);
+    SUS_I2C_Master_Init(1, 18, 19, 400000);
+
+    problems += BenchRun("One device after another", true, -1, ESP_OK, &serial);
+    problems += BenchRun("Orchestrated", false, -1, ESP_OK, &parallel);
+    problems += BenchRun("Orchestrated, display unplugged", false, BENCH_DISPLAY, ESP_FAIL, &unplugged);
+
+    printf("\nBring-up: %lu us one after another, %lu us orchestrated (%.1fx faster). Critical path of the orchestrated boot: %lu us.\n",
+           (unsigned long)serial.total_us, (unsigned long)parallel.total_us, (double)serial.total_us / parallel.total_us, (unsigned long)parallel.criticalPath_us);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    printf("RESULT: %s\n", (problems == 0 && SUS_Sim_LinksOutstanding == 0) ? "PASS" : "FAIL");
+    return (problems == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
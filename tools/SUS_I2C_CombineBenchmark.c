@@ -0,0 +1,305 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_CombineBenchmark.c
+ *
+ *    Brief:    Measures what write combining (SUS_I2C_Combine...) saves on typical streams of small writes, and checks that nothing gets reordered.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h). Four workloads, each run
+ *              twice: one transaction per write (SUS_I2C_WriteByteArrayToSlave_STATUS), and through a combiner:
+ *                  1. LED driver (PCA9685-like, auto-increment): 16 channels x 4 registers per frame, a read-back in the middle of every frame,
+ *                  2. OLED commands (SSD1306, control byte 0x00 = command stream): the init sequence, then contrast/offset updates, with a barrier after each,
+ *                  3. DAC stream (one fast-write register): 2000 samples, size threshold, the rest left to the timeout,
+ *                  4. scattered config registers (no merging possible): repeated STARTs only, with plain writes to the same device in between.
+ *              Then two tasks on one device: one flushes its combined writes while its bandwidth budget makes the flush wait, the other reads
+ *              the device meanwhile - the read has to wait for the flush and see the new values.
+ *              Every run is checked against a model of what the device must have seen, in program order: final registers, the values read back
+ *              in between, the command/sample logs. Any difference fails the run.
+ *              Bus time = simulated wire time + SUS_I2C_TRANSACTION_OVERHEAD_US per transaction (the ESP32 driver's time), like the display benchmark.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_CombineBenchmark SUS_I2C_CombineBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_CombineBenchmark [bus speed in Hz (default 400000)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_LEDS      0x40
+#define BENCH_OLED      0x3C
+#define BENCH_DAC       0x60
+#define BENCH_CONFIG    0x48
+#define BENCH_SHARED    0x50
+#define BENCH_SHARED_REGISTERS  16
+#define BENCH_LOG_SIZE  8192
+
+/*----- Stream devices: the first byte of every write selects the stream, everything after it goes into a log. -----*/
+struct BenchStream
+{
+    uint8_t  index;                 // Bytes written since the address (the simulator moves the register pointer on every byte).
+    uint8_t  log[BENCH_LOG_SIZE];
+    size_t   length;
+};
+
+static struct BenchStream benchOled, benchDac;
+
+static void BenchStreamAddressed(struct SUS_SimDevice *device, bool read)
+{
+    (void)read;
+    ((struct BenchStream *)device->context)->index = 0;
+}
+
+static void BenchStreamWrite(struct SUS_SimDevice *device, uint8_t registerAddress, uint8_t value)
+{
+    struct BenchStream *stream = (struct BenchStream *)device->context;
+    uint8_t control = registerAddress - stream->index++;
+    if (stream->length < BENCH_LOG_SIZE && (control == 0x00 || control == 0x40)) stream->log[stream->length++] = value;
+}
+
+/*----- The workloads. "combiner" NULL = one transaction per write. -----*/
+static uint32_t benchWrong;                 // Failed checks: what the devices saw versus what they should have seen.
+static uint8_t  benchShadow[256];           // Register devices: what the registers must hold, in program order.
+static uint8_t  benchExpected[BENCH_LOG_SIZE];
+static size_t   benchExpectedLength;
+
+static void BenchWrite(struct SUS_I2C_Combiner *combiner, uint8_t address, const uint8_t *bytes, size_t length)
+{
+    esp_err_t outcome = combiner ? SUS_I2C_CombineWrite(combiner, bytes, length) : SUS_I2C_WriteByteArrayToSlave_STATUS(0, address, bytes, length);
+    if (outcome != ESP_OK) benchWrong++;
+}
+
+static void BenchLeds(struct SUS_I2C_Combiner *combiner)
+{
+    for (int frame = 0; frame < 200; frame++)
+    {
+        for (int channel = 0; channel < 16; channel++)
+        {
+            uint16_t off = (uint16_t)((frame * 37 + channel * 256) & 0x0FFF);
+            uint8_t registers[4][2] = {{0x06 + 4 * channel, 0}, {0x07 + 4 * channel, 0}, {0x08 + 4 * channel, off & 0xFF}, {0x09 + 4 * channel, off >> 8}};
+            for (int r = 0; r < 4; r++) {
+                BenchWrite(combiner, BENCH_LEDS, registers[r], 2);
+                benchShadow[registers[r][0]] = registers[r][1];
+            }
+            if (channel == 8) {             //Read-back in the middle of the frame: must see the writes that are still waiting in the combiner.
+                uint8_t value;
+                if (SUS_I2C_ReadRegister_STATUS(0, BENCH_LEDS, 0x08, &value) != ESP_OK || value != benchShadow[0x08]) benchWrong++;
+            }
+        }
+        if (combiner) SUS_I2C_CombineFlush(combiner);
+    }
+}
+
+static void BenchOled(struct SUS_I2C_Combiner *combiner)
+{
+    static const uint8_t init[] = {0xAE, 0xD5, 0x80, 0xA8, 0x3F, 0xD3, 0x00, 0x40, 0x8D, 0x14, 0x20, 0x00, 0xA1, 0xC8, 0xDA, 0x12,
+                                   0x81, 0xCF, 0xD9, 0xF1, 0xDB, 0x40, 0xA4, 0xA6, 0x2E, 0xAF};
+    benchExpectedLength = 0;
+    for (size_t i = 0; i < sizeof(init); i++) {
+        uint8_t command[2] = {0x00, init[i]};
+        BenchWrite(combiner, BENCH_OLED, command, 2);
+        benchExpected[benchExpectedLength++] = init[i];
+    }
+    for (int update = 0; update < 200; update++)
+    {
+        uint8_t commands[4] = {0x81, (uint8_t)(update * 5), 0xD3, (uint8_t)(update & 0x3F)};     //Contrast, display offset.
+        for (int i = 0; i < 4; i++) {
+            uint8_t command[2] = {0x00, commands[i]};
+            BenchWrite(combiner, BENCH_OLED, command, 2);
+            benchExpected[benchExpectedLength++] = commands[i];
+        }
+        if (combiner) SUS_I2C_CombineBarrier();
+    }
+}
+
+static void BenchDac(struct SUS_I2C_Combiner *combiner)
+{
+    benchExpectedLength = 0;
+    for (int sample = 0; sample < 2000; sample++)
+    {
+        uint16_t value = (uint16_t)((sample * 41) & 0x0FFF);
+        uint8_t write[3] = {0x40, value >> 8, value & 0xFF};
+        BenchWrite(combiner, BENCH_DAC, write, 3);
+        benchExpected[benchExpectedLength++] = write[1];
+        benchExpected[benchExpectedLength++] = write[2];
+    }
+    vTaskDelay(10 / portTICK_PERIOD_MS);        //No flush: the timeout sends the rest.
+}
+
+static void BenchConfig(struct SUS_I2C_Combiner *combiner)
+{
+    for (int round = 0; round < 300; round++)
+    {
+        static const uint8_t registers[] = {0x01, 0x05, 0x09, 0x0D, 0x11, 0x15};
+        for (size_t r = 0; r < sizeof(registers); r++) {
+            uint8_t write[2] = {registers[r], (uint8_t)(round + r)};
+            BenchWrite(combiner, BENCH_CONFIG, write, 2);
+            benchShadow[registers[r]] = write[1];
+        }
+        if (round % 10 == 0) {              //A plain write to the same device: must land AFTER the combined ones, so it wins.
+            if (SUS_I2C_WriteToRegister_STATUS(0, BENCH_CONFIG, 0x05, 0xEE) != ESP_OK) benchWrong++;
+            benchShadow[0x05] = 0xEE;
+        }
+        if (combiner) SUS_I2C_CombineFlush(combiner);
+        if (memcmp(SUS_SimBus_Port[0].device[BENCH_CONFIG].registers, benchShadow, sizeof(benchShadow)) != 0) benchWrong++;
+    }
+}
+
+/*----- Two tasks, one device: a read while the other task's flush waits for its budget. -----*/
+struct BenchShared
+{
+    struct SUS_I2C_Combiner combiner;
+    uint8_t  round;
+    volatile bool done;
+    esp_err_t outcome;
+};
+
+static void BenchSharedWriter(void *argument)
+{
+    struct BenchShared *shared = (struct BenchShared *)argument;
+    for (int r = 0; r < BENCH_SHARED_REGISTERS; r++) {
+        uint8_t write[2] = {(uint8_t)r, (uint8_t)(shared->round * 16 + r)};
+        SUS_I2C_CombineWrite(&shared->combiner, write, 2);
+    }
+    shared->outcome = SUS_I2C_CombineFlush(&shared->combiner);     //The bucket is nearly empty: this waits for the budget.
+    shared->done = true;
+    vTaskDelete(NULL);
+}
+
+static void BenchSharedDevice(void)
+{
+    struct BenchShared shared = {.combiner = {.I2CportNumber = 0, .I2CdeviceAddress = BENCH_SHARED, .flags = SUS_I2C_COMBINE_AUTO_INCREMENT}};
+    uint8_t drain[32], value;
+    uint32_t stale = 0;
+
+    SUS_I2C_CombineInit(&shared.combiner);
+    SUS_I2C_BudgetSetShare(0, 0.02f);
+    SUS_I2C_BudgetSetClient(0, BENCH_SHARED, 1, 1000, SUS_I2C_BUDGET_DEFER);
+    for (int round = 1; round <= 10; round++)
+    {
+        vTaskDelay(60 / portTICK_PERIOD_MS);            //Bucket full again...
+        SUS_I2C_ReadRegisters(0, BENCH_SHARED, 0x80, drain, sizeof(drain));    //...and nearly empty: enough left for a one-byte read, not for the flush.
+        shared.round = (uint8_t)round;
+        shared.done = false;
+        xTaskCreate(BenchSharedWriter, "writer", 4096, &shared, 5, NULL);
+        while (shared.combiner.flushingTask == NULL && !shared.done) vTaskDelay(0);
+        if (shared.done) printf("   round %d: the flush did not wait for the budget, nothing tested\n", round);
+        if (SUS_I2C_ReadRegister_STATUS(0, BENCH_SHARED, 0x05, &value) != ESP_OK || value != (uint8_t)(round * 16 + 5)) stale++;
+        while (!shared.done) vTaskDelay(1);
+        if (shared.outcome != ESP_OK) benchWrong++;
+    }
+    SUS_I2C_BudgetSetClient(0, BENCH_SHARED, 0, 0, SUS_I2C_BUDGET_DEFER);
+    SUS_I2C_BudgetSetShare(0, 0.0f);
+    SUS_I2C_CombineRemove(&shared.combiner);
+    printf("\nTwo tasks, one device: 10 reads during a flush held up by the bandwidth budget, %lu saw the old values%s\n", (unsigned long)stale,
+           stale ? "   WRONG" : "");
+    benchWrong += stale;
+}
+
+struct BenchWorkload
+{
+    const char *name;
+    uint8_t  address;
+    uint8_t  flags, threshold;
+    uint32_t timeout_us;
+    void     (*run)(struct SUS_I2C_Combiner *combiner);
+    struct BenchStream *stream;     // NULL = register device, checked against benchShadow.
+};
+
+static const struct BenchWorkload benchWorkload[] = {
+    {"LED driver, 16 ch x 4 reg", BENCH_LEDS,   SUS_I2C_COMBINE_AUTO_INCREMENT, 0,  0,    BenchLeds,   NULL},
+    {"OLED command stream",       BENCH_OLED,   SUS_I2C_COMBINE_STREAM,         32, 0,    BenchOled,   &benchOled},
+    {"DAC sample stream",         BENCH_DAC,    SUS_I2C_COMBINE_STREAM,         48, 1000, BenchDac,    &benchDac},
+    {"Scattered config regs",     BENCH_CONFIG, 0,                              0,  0,    BenchConfig, NULL},
+};
+
+struct BenchResult { uint64_t transactions, bus_us; };
+
+static struct BenchResult BenchRun(const struct BenchWorkload *workload, struct SUS_I2C_Combiner *combiner)
+{
+    struct SUS_SimDevice *device = &SUS_SimBus_Port[0].device[workload->address];
+    uint64_t transactions = SUS_SimBus_Port[0].transactions, busTime_ns = SUS_SimBus_Port[0].busTime_ns;
+
+    memset(device->registers, 0, sizeof(device->registers));
+    memset(benchShadow, 0, sizeof(benchShadow));
+    if (workload->stream) workload->stream->length = 0;
+    workload->run(combiner);
+    if (combiner) SUS_I2C_CombineRemove(combiner);      //Sends what's left: the workloads that rely on the timeout must have nothing left by now.
+
+    if (workload->stream) {
+        if (workload->stream->length != benchExpectedLength || memcmp(workload->stream->log, benchExpected, benchExpectedLength) != 0) benchWrong++;
+    }
+    else if (memcmp(device->registers, benchShadow, sizeof(benchShadow)) != 0) benchWrong++;
+
+    struct BenchResult result = {SUS_SimBus_Port[0].transactions - transactions, 0};
+    result.bus_us = (SUS_SimBus_Port[0].busTime_ns - busTime_ns) / 1000 + result.transactions * SUS_I2C_TRANSACTION_OVERHEAD_US;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int speed = argc > 1 ? atoi(argv[1]) : 400000;
+
+    if (speed <= 0) {
+        printf("Usage: %s [bus speed in Hz]\n", argv[0]);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only.
+    SUS_SimBus_Init(0, speed, false);
+    SUS_SimBus_AddDevice(0, BENCH_LEDS);
+    SUS_SimBus_AddDevice(0, BENCH_CONFIG);
+    SUS_SimBus_AddDevice(0, BENCH_SHARED);
+    struct BenchStream *streams[2] = {&benchOled, &benchDac};
+    uint8_t streamAddress[2] = {BENCH_OLED, BENCH_DAC};
+    for (int s = 0; s < 2; s++) {
+        struct SUS_SimDevice *device = SUS_SimBus_AddDevice(0, streamAddress[s]);
+        device->onWrite = BenchStreamWrite;
+        device->onAddressed = BenchStreamAddressed;
+        device->context = streams[s];
+    }
+    SUS_I2C_Master_Init(0, 22, 21, speed);
+
+    printf("\n%d Hz. Bus time = wire time + %d us driver time per transaction.\n\n", speed, SUS_I2C_TRANSACTION_OVERHEAD_US);
+    printf("%-28s %7s %10s %10s %9s %12s %12s %8s %8s\n", "workload", "writes", "tx single", "tx comb.", "writes/tx", "single us", "combined us", "saved", "timeout");
+    for (size_t w = 0; w < sizeof(benchWorkload) / sizeof(benchWorkload[0]); w++)
+    {
+        const struct BenchWorkload *workload = &benchWorkload[w];
+        struct SUS_I2C_Combiner combiner = {.I2CportNumber = 0, .I2CdeviceAddress = workload->address, .flags = workload->flags,
+                                            .threshold = workload->threshold, .timeout_us = workload->timeout_us};
+        uint32_t wrongBefore = benchWrong;
+
+        struct BenchResult single = BenchRun(workload, NULL);
+        if (SUS_I2C_CombineInit(&combiner) != ESP_OK) {
+            printf("Combiner setup failed.\n");
+            return 1;
+        }
+        struct BenchResult combined = BenchRun(workload, &combiner);
+        printf("%-28s %7lu %10llu %10llu %9.2f %12llu %12llu %7.1f%% %8lu%s\n", workload->name, (unsigned long)combiner.writes,
+               (unsigned long long)single.transactions, (unsigned long long)combined.transactions, (double)combiner.writes / combiner.transactions,
+               (unsigned long long)single.bus_us, (unsigned long long)combined.bus_us, 100.0 * (1.0 - (double)combined.bus_us / single.bus_us),
+               (unsigned long)combiner.flushes[SUS_I2C_COMBINE_BY_TIMEOUT], benchWrong != wrongBefore ? "   WRONG" : "");
+        if (w == sizeof(benchWorkload) / sizeof(benchWorkload[0]) - 1) {
+            printf("\nThe library's own report for the last one (estimates from SUS_I2C_BusTime_us):\n");
+            SUS_Sim_LogLevel = 3;
+            SUS_I2C_CombinePrintReport(&combiner);
+            SUS_Sim_LogLevel = 1;
+        }
+    }
+
+    BenchSharedDevice();
+
+    printf("\nChecks where a device saw something else than it should have (order, values): %lu\n", (unsigned long)benchWrong);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    return (benchWrong == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
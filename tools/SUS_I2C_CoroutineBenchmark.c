@@ -0,0 +1,229 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_CoroutineBenchmark.c
+ *
+ *    Brief:    Runs the same multi-step driver for 48 sensors twice - as a task per sensor, and as coroutines on one executor per port
+ *              (SUS_I2C_Executor.../SUS_I2C_Coroutine...) - checks every reading, and compares the RAM both need.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h). 24 simulated "conversion"
+ *              sensors on each port: writing 0x01 to register 0x01 starts a conversion that takes 2-6 ms (depends on the sensor), register 0x00
+ *              reads 0x80 while it's busy, registers 0x02-0x03 hold the result once it's done (0xFFFF before - a driver that doesn't wait is caught).
+ *              The driver: trigger, wait the conversion time, poll the status until done, read the result - 20 times per sensor.
+ *                  1. A task per sensor with the blocking functions and vTaskDelay (waits rounded up to RTOS ticks, like on the ESP32),
+ *                  2. the same driver as a coroutine, all 48 of them on the two executors.
+ *              Every result is checked against what the sensor converted. Any difference fails the run.
+ *              RAM: the simulator's tasks are pthreads, so task stacks are the ESP32 figures (SUS_I2C_COROUTINE_TASK_STACK + _TCB), coroutines are
+ *              their frames plus the executor tasks. Wall time is real time on this host.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_CoroutineBenchmark SUS_I2C_CoroutineBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_CoroutineBenchmark [bus speed in Hz (default 400000)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_SENSORS_PER_PORT  24
+#define BENCH_FIRST_ADDRESS     0x20
+#define BENCH_ROUNDS            20
+#define BENCH_POLL_US           250     // Status poll interval of the coroutines.
+
+/*----- The sensor: a conversion started by a write, a busy flag, a result that only exists when it's done. -----*/
+struct BenchSensor
+{
+    uint8_t  I2CportNumber, I2CdeviceAddress;
+    uint32_t conversion_us;
+    int64_t  readyAt_us;            // 0 = no conversion started.
+    uint16_t conversions;
+    uint16_t result;
+};
+
+static struct BenchSensor benchSensor[2][BENCH_SENSORS_PER_PORT];
+
+static uint16_t BenchExpected(const struct BenchSensor *sensor, uint16_t conversion)
+{
+    return (uint16_t)(sensor->I2CdeviceAddress * 1000 + sensor->I2CportNumber * 500 + conversion);
+}
+
+static void BenchSensorWrite(struct SUS_SimDevice *device, uint8_t registerAddress, uint8_t value)
+{
+    struct BenchSensor *sensor = (struct BenchSensor *)device->context;
+    if (registerAddress == 0x01 && value == 0x01) {
+        sensor->readyAt_us = esp_timer_get_time() + sensor->conversion_us;
+        sensor->result = BenchExpected(sensor, ++sensor->conversions);
+    }
+}
+
+static uint8_t BenchSensorRead(struct SUS_SimDevice *device, uint8_t registerAddress)
+{
+    struct BenchSensor *sensor = (struct BenchSensor *)device->context;
+    bool done = sensor->readyAt_us != 0 && esp_timer_get_time() >= sensor->readyAt_us;
+    if (registerAddress == 0x00) return done ? 0x00 : 0x80;
+    if (registerAddress == 0x02) return done ? sensor->result >> 8 : 0xFF;
+    if (registerAddress == 0x03) return done ? sensor->result & 0xFF : 0xFF;
+    return 0;
+}
+
+static uint32_t benchWrong;                 // Failed checks: results that are not what the sensor converted, failed operations.
+static uint32_t benchDone;                  // Sensors finished with their rounds.
+
+static void BenchCheck(const struct BenchSensor *sensor, int round, const uint8_t raw[2])
+{
+    if (((raw[0] << 8) | raw[1]) != BenchExpected(sensor, (uint16_t)(round + 1))) __atomic_add_fetch(&benchWrong, 1, __ATOMIC_RELAXED);
+}
+
+/*----- 1. A task per sensor. -----*/
+static void BenchSensorTask(void *parameter)
+{
+    struct BenchSensor *sensor = (struct BenchSensor *)parameter;
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        uint8_t status = 0x80, raw[2] = {0};
+        if (SUS_I2C_WriteToRegister_STATUS(sensor->I2CportNumber, sensor->I2CdeviceAddress, 0x01, 0x01) != ESP_OK) __atomic_add_fetch(&benchWrong, 1, __ATOMIC_RELAXED);
+        vTaskDelay((sensor->conversion_us + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+        while (SUS_I2C_ReadRegister_STATUS(sensor->I2CportNumber, sensor->I2CdeviceAddress, 0x00, &status) == ESP_OK && (status & 0x80)) vTaskDelay(1);
+        if (SUS_I2C_ReadRegisters(sensor->I2CportNumber, sensor->I2CdeviceAddress, 0x02, raw, 2) != ESP_OK) __atomic_add_fetch(&benchWrong, 1, __ATOMIC_RELAXED);
+        BenchCheck(sensor, round, raw);
+    }
+    __atomic_add_fetch(&benchDone, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+/*----- 2. The same driver as a coroutine. -----*/
+struct BenchLocals
+{
+    int      round;
+    uint8_t  status;
+    uint8_t  raw[2];
+};
+
+static int BenchSensorCoroutine(struct SUS_I2C_Coroutine *co)
+{
+    struct BenchLocals *my = SUS_I2C_CO_LOCALS(co, struct BenchLocals);
+    struct BenchSensor *sensor = (struct BenchSensor *)co->user;
+
+    SUS_I2C_CO_BEGIN(co);
+    for (my->round = 0; my->round < BENCH_ROUNDS; my->round++)
+    {
+        SUS_I2C_AWAIT_WRITE_REGISTER(co, 0x01, 0x01);
+        if (co->outcome != ESP_OK) SUS_I2C_CO_RETURN(co, co->outcome);
+        SUS_I2C_AWAIT_DELAY_US(co, sensor->conversion_us);
+        do {
+            SUS_I2C_AWAIT_READ(co, 0x00, &my->status, 1);
+            if (co->outcome != ESP_OK) SUS_I2C_CO_RETURN(co, co->outcome);
+            if (my->status & 0x80) SUS_I2C_AWAIT_DELAY_US(co, BENCH_POLL_US);
+        } while (my->status & 0x80);
+        SUS_I2C_AWAIT_READ(co, 0x02, my->raw, 2);
+        if (co->outcome != ESP_OK) SUS_I2C_CO_RETURN(co, co->outcome);
+        BenchCheck(sensor, my->round, my->raw);
+    }
+    SUS_I2C_CO_END(co);
+}
+
+static void BenchSensorDone(struct SUS_I2C_Coroutine *co)
+{
+    if (co->outcome != ESP_OK) __atomic_add_fetch(&benchWrong, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&benchDone, 1, __ATOMIC_RELEASE);
+}
+
+static void BenchReset(void)
+{
+    for (int p = 0; p < 2; p++)
+        for (int s = 0; s < BENCH_SENSORS_PER_PORT; s++) {
+            benchSensor[p][s].readyAt_us = 0;
+            benchSensor[p][s].conversions = 0;
+        }
+    benchDone = 0;
+}
+
+static void BenchWaitDone(void)
+{
+    while (__atomic_load_n(&benchDone, __ATOMIC_ACQUIRE) < 2 * BENCH_SENSORS_PER_PORT) vTaskDelay(1);
+}
+
+int main(int argc, char **argv)
+{
+    int speed = argc > 1 ? atoi(argv[1]) : 400000;
+    static struct SUS_I2C_Coroutine frames[2][BENCH_SENSORS_PER_PORT];
+
+    if (speed <= 0) {
+        printf("Usage: %s [bus speed in Hz]\n", argv[0]);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only.
+    for (int p = 0; p < 2; p++)
+    {
+        SUS_SimBus_Init(p, speed, false);
+        for (int s = 0; s < BENCH_SENSORS_PER_PORT; s++) {
+            struct BenchSensor *sensor = &benchSensor[p][s];
+            sensor->I2CportNumber = p;
+            sensor->I2CdeviceAddress = BENCH_FIRST_ADDRESS + s;
+            sensor->conversion_us = 2000 + (s % 5) * 1000;
+            struct SUS_SimDevice *device = SUS_SimBus_AddDevice(p, sensor->I2CdeviceAddress);
+            device->onWrite = BenchSensorWrite;
+            device->onRead = BenchSensorRead;
+            device->context = sensor;
+        }
+        SUS_I2C_Master_Init(p, p ? 18 : 22, p ? 19 : 21, speed);
+    }
+    int sensors = 2 * BENCH_SENSORS_PER_PORT;
+    printf("\n%d sensors on 2 ports, %d conversions each (2-6 ms), %d Hz.\n\n", sensors, BENCH_ROUNDS, speed);
+
+    BenchReset();
+    int64_t start = esp_timer_get_time();
+    for (int p = 0; p < 2; p++)
+        for (int s = 0; s < BENCH_SENSORS_PER_PORT; s++)
+            if (xTaskCreate(BenchSensorTask, "sensor", SUS_I2C_COROUTINE_TASK_STACK, &benchSensor[p][s], 5, NULL) != pdPASS) {
+                printf("Task creation failed.\n");
+                return 1;
+            }
+    BenchWaitDone();
+    int64_t tasks_us = esp_timer_get_time() - start;
+    uint32_t wrongTasks = benchWrong;
+
+    BenchReset();
+    for (int p = 0; p < 2; p++)
+        if (SUS_I2C_ExecutorStart(p, frames[p], BENCH_SENSORS_PER_PORT, p, 5) != ESP_OK) {
+            printf("Executor start failed.\n");
+            return 1;
+        }
+    start = esp_timer_get_time();
+    for (int p = 0; p < 2; p++)
+        for (int s = 0; s < BENCH_SENSORS_PER_PORT; s++)
+            if (SUS_I2C_CoroutineStart(p, benchSensor[p][s].I2CdeviceAddress, BenchSensorCoroutine, NULL, 0, &benchSensor[p][s], BenchSensorDone) == NULL) benchWrong++;
+    BenchWaitDone();
+    int64_t coroutines_us = esp_timer_get_time() - start;
+    uint32_t wrongCoroutines = benchWrong - wrongTasks;
+
+    uint32_t taskRam = sensors * (SUS_I2C_COROUTINE_TASK_STACK + SUS_I2C_COROUTINE_TASK_TCB);
+    uint32_t coroutineRam = sensors * sizeof(struct SUS_I2C_Coroutine) + 2 * (SUS_I2C_EXECUTOR_STACK + SUS_I2C_COROUTINE_TASK_TCB);
+    printf("%-22s %8s %12s %10s %7s\n", "model", "tasks", "RAM (bytes)", "wall ms", "wrong");
+    printf("%-22s %8d %12lu %10.1f %7lu\n", "task per sensor", sensors, (unsigned long)taskRam, tasks_us / 1000.0, (unsigned long)wrongTasks);
+    printf("%-22s %8d %12lu %10.1f %7lu\n", "coroutines", 2, (unsigned long)coroutineRam, coroutines_us / 1000.0, (unsigned long)wrongCoroutines);
+    printf("\nRAM saved: %lu bytes (%.1f%%). Frame: %d bytes (%d of them locals), ESP32 task: %d stack + %d TCB.\n", (unsigned long)(taskRam - coroutineRam),
+           100.0 * (taskRam - coroutineRam) / taskRam, (int)sizeof(struct SUS_I2C_Coroutine), SUS_I2C_COROUTINE_LOCALS, SUS_I2C_COROUTINE_TASK_STACK, SUS_I2C_COROUTINE_TASK_TCB);
+    printf("(Simulator frame sizes are for this host's pointer size; on the ESP32 (32-bit) a frame is smaller.)\n");
+
+    printf("\nThe library's own report:\n");
+    SUS_Sim_LogLevel = 3;
+    for (int p = 0; p < 2; p++) SUS_I2C_ExecutorPrintReport(p);
+    SUS_Sim_LogLevel = 1;
+    for (int p = 0; p < 2; p++) SUS_I2C_ExecutorStop(p);
+
+    printf("\nChecks where a result was not what the sensor converted, or an operation failed: %lu\n", (unsigned long)benchWrong);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    return (benchWrong == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_DecodeBenchmark.c
+ *
+ *    Brief:    Measures how many samples per second the block decoders (SUS_I2C_DecodeFixed, SUS_I2C_DecodeFloat) convert, compared to one value at a time.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Fills a block with random raw frames of three typical layouts and converts it three ways:
+ *                  1. "one at a time": a function call per value that checks the byte order and the sign, like most drivers do it,
+ *                  2. SUS_I2C_DecodeFixed: fixed-point, branch-free (the kernel meant for the ESP32),
+ *                  3. SUS_I2C_DecodeFloat: 8 values per step with SSE2 / NEON vectors (the kernel meant for decoding recordings on a PC).
+ *              Every result is checked: DecodeFloat must match the one-at-a-time floats, DecodeFixed must be within 1 unit of the exact value.
+ *              A "sample" in the numbers is ONE value (one axis of one frame). The numbers are this PC's, not the ESP32's:
+ *              on the ESP32 there are no vectors, and DecodeFixed is the one to use.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_DecodeBenchmark SUS_I2C_DecodeBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_DecodeBenchmark [frames per block (default 100000)] [passes (default 20)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+static struct SUS_I2C_DecodeFormat benchFormat[] = {
+    {.name = "MPU6050 accel/temp/gyro", .frameLength = 14, .firstByte = 0, .channelCount = 7,       //Big-endian, signed, dense: mg, 0.01 degC, mdps.
+     .flags = SUS_I2C_DECODE_BIG_ENDIAN | SUS_I2C_DECODE_SIGNED,
+     .scale = {1000/16384.0f, 1000/16384.0f, 1000/16384.0f, 100/340.0f, 1000/131.0f, 1000/131.0f, 1000/131.0f}, .offset = {0, 0, 0, 3653, 0, 0, 0}},
+    {.name = "LIS3DH accel (LE, 12 bit)", .frameLength = 6, .firstByte = 0, .channelCount = 3,      //Little-endian, signed, left-justified 12 bit: mg.
+     .flags = SUS_I2C_DECODE_SIGNED, .scale = {1/16.0f, 1/16.0f, 1/16.0f}},
+    {.name = "FIFO, header + 3x uint16", .frameLength = 10, .firstByte = 2, .channelCount = 3,      //Header and status bytes around the values: the gather path.
+     .flags = SUS_I2C_DECODE_BIG_ENDIAN, .scale = {0.5f, 0.25f, 3.0f}, .offset = {-100, 0, 40000}},
+};
+
+//The classic way: one call per value, byte order and sign decided every time.
+static float __attribute__((noinline)) BenchDecodeOne(const uint8_t *bytes, bool bigEndian, bool isSigned, float scale, float offset)
+{
+    uint16_t word;
+    if (bigEndian) word = (uint16_t)(bytes[0] << 8 | bytes[1]);
+    else word = (uint16_t)(bytes[1] << 8 | bytes[0]);
+    if (isSigned) return (float)(int16_t)word * scale + offset;
+    return (float)word * scale + offset;
+}
+
+static void BenchDecodeOneByOne(const struct SUS_I2C_DecodeFormat *format, const uint8_t *raw, size_t frames, float *value)
+{
+    for (size_t f = 0; f < frames; f++)
+        for (int c = 0; c < format->channelCount; c++)
+            *value++ = BenchDecodeOne(raw + f * format->frameLength + format->firstByte + 2 * c, format->flags & SUS_I2C_DECODE_BIG_ENDIAN,
+                                      format->flags & SUS_I2C_DECODE_SIGNED, format->scale[c], format->offset[c]);
+}
+
+int main(int argc, char **argv)
+{
+    long frames = argc > 1 ? atol(argv[1]) : 100000;
+    int passes = argc > 2 ? atoi(argv[2]) : 20;
+    unsigned long wrongValues = 0;
+
+    if (frames <= 0 || passes <= 0) {
+        printf("Usage: %s [frames per block] [passes]\n", argv[0]);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only.
+    printf("%ld frames per block, %d passes. Msamples/s = million values (one axis of one frame) per second on THIS machine, %s.\n\n",
+           frames, passes, SUS_I2C_DECODE_SIMD ? "DecodeFloat with SIMD vectors" : "DecodeFloat WITHOUT SIMD (no SSE2/NEON)");
+    printf("%-26s %6s %14s %14s %14s %9s %9s\n", "format", "values", "one-at-a-time", "DecodeFixed", "DecodeFloat", "fixed x", "float x");
+
+    for (size_t n = 0; n < sizeof(benchFormat) / sizeof(benchFormat[0]); n++)
+    {
+        struct SUS_I2C_DecodeFormat *format = &benchFormat[n];
+        size_t values = (size_t)frames * format->channelCount;
+        uint8_t *raw = malloc((size_t)frames * format->frameLength);
+        float *reference = malloc(values * sizeof(float)), *decodedFloat = malloc(values * sizeof(float));
+        int32_t *decodedFixed = malloc(values * sizeof(int32_t));
+        double time_s[3] = {0};
+
+        if (!raw || !reference || !decodedFloat || !decodedFixed || SUS_I2C_DecodePrepare(format) != ESP_OK) {
+            printf("Setup of %s failed.\n", format->name);
+            return 1;
+        }
+        srand(42 + n);
+        for (size_t i = 0; i < (size_t)frames * format->frameLength; i++) raw[i] = (uint8_t)rand();
+
+        for (int p = 0; p < passes; p++)
+        {
+            int64_t start = esp_timer_get_time();
+            BenchDecodeOneByOne(format, raw, frames, reference);
+            int64_t one = esp_timer_get_time();
+            SUS_I2C_DecodeFixed(format, raw, frames, decodedFixed);
+            int64_t fixed = esp_timer_get_time();
+            SUS_I2C_DecodeFloat(format, raw, frames, decodedFloat);
+            int64_t end = esp_timer_get_time();
+            time_s[0] += (one - start) / 1e6;
+            time_s[1] += (fixed - one) / 1e6;
+            time_s[2] += (end - fixed) / 1e6;
+        }
+
+        for (size_t i = 0; i < values; i++)
+        {
+            const uint8_t *word = raw + (i / format->channelCount) * format->frameLength + format->firstByte + 2 * (i % format->channelCount);
+            int c = i % format->channelCount;
+            uint16_t bits = (format->flags & SUS_I2C_DECODE_BIG_ENDIAN) ? (uint16_t)(word[0] << 8 | word[1]) : (uint16_t)(word[1] << 8 | word[0]);
+            double exact = ((format->flags & SUS_I2C_DECODE_SIGNED) ? (double)(int16_t)bits : (double)bits) * format->scale[c] + format->offset[c];
+            if (decodedFloat[i] != reference[i] || fabs(decodedFixed[i] - exact) > 1.0) wrongValues++;
+        }
+
+        double total = (double)values * passes / 1e6;
+        printf("%-26s %6d %14.1f %14.1f %14.1f %8.1fx %8.1fx\n", format->name, format->channelCount, total / time_s[0], total / time_s[1], total / time_s[2],
+               time_s[0] / time_s[1], time_s[0] / time_s[2]);
+        free(raw);
+        free(reference);
+        free(decodedFloat);
+        free(decodedFixed);
+    }
+
+    printf("\nValues that differed from the one-at-a-time result (float) or from the exact value by more than 1 unit (fixed): %lu\n", wrongValues);
+    return wrongValues == 0 ? 0 : 1;
+}
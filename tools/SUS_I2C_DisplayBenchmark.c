@@ -0,0 +1,276 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_DisplayBenchmark.c
+ *
+ *    Brief:    Measures what dirty-region flushing (SUS_I2C_DisplayFlush) saves on typical OLED screens compared to sending every frame whole.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h) with a model of an SSD1306
+ *              (and SH1106) controller on it: control bytes, page/column addressing and display memory. Every screen is drawn frame by frame and flushed
+ *                  1. "full":  SUS_I2C_DisplayInvalidate before every flush - every frame goes out whole, like pushing the framebuffer each time.
+ *                  2. "dirty": plain SUS_I2C_DisplayFlush - only the changed regions.
+ *              After every flush the model's display memory is compared with the framebuffer: any difference is a bug and fails the run.
+ *
+ *              Printed per screen: bytes on the wire per frame (full / dirty), bytes saved per frame, transactions per frame, and the frame rate the bus allows.
+ *              Frame rate = frames / (wire time + SUS_I2C_TRANSACTION_OVERHEAD_US per transaction): the simulated wire time plus the ESP32 driver's
+ *              time per transaction, so more, smaller transactions are not free. The host's own speed does not enter the numbers.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_DisplayBenchmark SUS_I2C_DisplayBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_DisplayBenchmark [frames per screen (default 300)] [bus speed in Hz (default 400000)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_OLED_ADDRESS      0x3C
+
+/*----- Model of the controller: parses control bytes and commands, keeps the display memory. -----*/
+struct BenchOled
+{
+    uint8_t  ram[SUS_I2C_DISPLAY_MAX_PAGES][SUS_I2C_DISPLAY_MAX_WIDTH];
+    uint8_t  page, column;
+    bool     firstByte;                         // Next byte is the first after the address: the control byte (the simulator hands it over as the "register").
+    bool     expectControl;                     // Co=1 was set: the byte after the next one is a control byte again.
+    bool     continuation;                      // Co bit of the current control byte.
+    bool     data;                              // D/C bit of the current control byte.
+    int      parametersLeft;                    // Parameter bytes of the last command still to come.
+};
+static struct BenchOled benchOled;
+static struct SUS_I2C_Display benchDisplay;
+
+static void BenchOledControl(uint8_t control)
+{
+    benchOled.continuation = control & 0x80;
+    benchOled.data = control & 0x40;
+}
+
+static void BenchOledCommand(uint8_t command)
+{
+    if (benchOled.parametersLeft > 0) { benchOled.parametersLeft--; return; }
+    if (command >= 0xB0 && command <= 0xB7) benchOled.page = command & 0x07;
+    else if (command <= 0x0F) benchOled.column = (uint8_t)((benchOled.column & 0xF0) | command);
+    else if (command <= 0x1F) benchOled.column = (uint8_t)((benchOled.column & 0x0F) | ((command & 0x0F) << 4));
+    else switch (command)
+    {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xAD: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        benchOled.parametersLeft = 1;
+        break;
+    case 0x21: case 0x22:
+        benchOled.parametersLeft = 2;
+        break;
+    }
+}
+
+static void BenchOledAddressed(struct SUS_SimDevice *device, bool read)
+{
+    (void)device; (void)read;
+    benchOled.firstByte = true;
+    benchOled.expectControl = false;
+}
+
+static void BenchOledWrite(struct SUS_SimDevice *device, uint8_t registerAddress, uint8_t value)
+{
+    (void)device;
+    if (benchOled.firstByte) { benchOled.firstByte = false; BenchOledControl(registerAddress); }
+    if (benchOled.expectControl) { benchOled.expectControl = false; BenchOledControl(value); return; }
+    if (benchOled.data) {
+        benchOled.ram[benchOled.page][benchOled.column] = value;
+        benchOled.column = (uint8_t)((benchOled.column + 1) % SUS_I2C_DISPLAY_MAX_WIDTH);
+    }
+    else BenchOledCommand(value);
+    if (benchOled.continuation) benchOled.expectControl = true;
+}
+
+//Pixels that differ between the framebuffer and what the model displays.
+static uint32_t BenchOledDifferences(void)
+{
+    uint32_t differences = 0;
+    for (int page = 0; page < benchDisplay.height / 8; page++)
+        for (int x = 0; x < benchDisplay.width; x++)
+            differences += __builtin_popcount(benchDisplay.framebuffer[page][x] ^ benchOled.ram[page][x + benchDisplay.columnOffset]);
+    return differences;
+}
+
+/*----- Screens. Each draws frame "frame" into the framebuffer. -----*/
+static uint32_t benchRandomState = 1;
+static uint32_t BenchRandom(void)
+{
+    benchRandomState ^= benchRandomState << 13;
+    benchRandomState ^= benchRandomState >> 17;
+    benchRandomState ^= benchRandomState << 5;
+    return benchRandomState;
+}
+
+//A stand-in for an 8x16 font: every digit is a distinct 8 columns x 2 pages block.
+static void BenchDigit(int x, int page, int digit)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        benchDisplay.framebuffer[page][x + i] = (uint8_t)(digit * 37 + i * 11 + 1);
+        benchDisplay.framebuffer[page + 1][x + i] = (uint8_t)(digit * 53 + i * 7 + 3);
+    }
+}
+
+static void BenchScreenStatic(int frame)
+{
+    if (frame > 0) return;
+    for (int page = 0; page < 8; page++)
+        for (int x = 0; x < 128; x++) benchDisplay.framebuffer[page][x] = (uint8_t)(page * 31 + x * 5);
+}
+
+static void BenchScreenClock(int frame)        //HH:MM:SS, one frame per second.
+{
+    int seconds = frame % 60, minutes = (frame / 60) % 60, hours = (frame / 3600) % 24;
+    int digits[6] = {hours / 10, hours % 10, minutes / 10, minutes % 10, seconds / 10, seconds % 10};
+    if (frame == 0) BenchScreenStatic(0);
+    for (int i = 0; i < 6; i++) BenchDigit(16 + i * 16, 3, digits[i]);
+}
+
+static void BenchScreenProgress(int frame)     //Bar along the bottom grows one column per frame, percentage above it.
+{
+    int filled = frame % 129, percent = filled * 100 / 128;
+    if (frame % 129 == 0) SUS_I2C_DisplayClear(&benchDisplay);
+    for (int x = 0; x < filled; x++) benchDisplay.framebuffer[7][x] = 0x7E;
+    BenchDigit(52, 4, percent / 100);
+    BenchDigit(60, 4, (percent / 10) % 10);
+    BenchDigit(68, 4, percent % 10);
+}
+
+static void BenchScreenPlot(int frame)         //Scrolling chart: everything moves one column left, a new sample on the right.
+{
+    if (frame == 0) SUS_I2C_DisplayClear(&benchDisplay);
+    for (int page = 0; page < 8; page++) memmove(&benchDisplay.framebuffer[page][0], &benchDisplay.framebuffer[page][1], 127);
+    int y = 4 + abs(frame % 112 - 56);          //Triangle wave, 4..60.
+    for (int page = 0; page < 8; page++) benchDisplay.framebuffer[page][127] = 0;
+    SUS_I2C_DisplaySetPixel(&benchDisplay, 127, y, true);
+}
+
+static void BenchScreenSparkles(int frame)     //A few random pixels toggle all over the screen: the worst case for merging runs.
+{
+    (void)frame;
+    for (int i = 0; i < 6; i++)
+    {
+        int x = BenchRandom() % 128, y = BenchRandom() % 64;
+        benchDisplay.framebuffer[y / 8][x] ^= (uint8_t)(1u << (y % 8));
+    }
+}
+
+static void BenchScreenNoise(int frame)        //Every pixel changes every frame: dirty tracking can't save anything here.
+{
+    (void)frame;
+    for (int page = 0; page < 8; page++)
+        for (int x = 0; x < 128; x++) benchDisplay.framebuffer[page][x] = (uint8_t)BenchRandom();
+}
+
+struct BenchScreen
+{
+    const char *name;
+    void (*draw)(int frame);
+};
+
+static const struct BenchScreen benchScreen[] = {
+    {"static screen",           BenchScreenStatic},
+    {"clock HH:MM:SS (1 fps)",  BenchScreenClock},
+    {"progress bar + percent",  BenchScreenProgress},
+    {"sparkles (6 px/frame)",   BenchScreenSparkles},
+    {"scrolling plot",          BenchScreenPlot},
+    {"noise (all pixels)",      BenchScreenNoise},
+};
+
+struct BenchResult
+{
+    double bytesPerFrame, savedPerFrame, runsPerFrame, framesPerSecond;
+    uint32_t wrongPixels;
+};
+
+static struct BenchResult BenchRun(const struct BenchScreen *screen, bool full, int frames)
+{
+    struct BenchResult result = {0};
+    uint64_t wireBefore = SUS_SimBus_Port[0].busTime_ns, runs = 0;
+
+    benchRandomState = 1;
+    SUS_I2C_DisplayClear(&benchDisplay);
+    SUS_I2C_DisplayInvalidate(&benchDisplay);
+    SUS_I2C_DisplayFlush(&benchDisplay);            //Same starting point for both ways: blank screen, known to the library.
+    SUS_I2C_DisplayResetStats(&benchDisplay);
+    wireBefore = SUS_SimBus_Port[0].busTime_ns;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        screen->draw(frame);
+        if (full) SUS_I2C_DisplayInvalidate(&benchDisplay);
+        if (SUS_I2C_DisplayFlush(&benchDisplay) != ESP_OK) printf("Flush failed!\n");
+        runs += benchDisplay.lastRuns;
+        result.wrongPixels += BenchOledDifferences();
+    }
+    double time_us = (SUS_SimBus_Port[0].busTime_ns - wireBefore) / 1000.0 + (double)runs * SUS_I2C_TRANSACTION_OVERHEAD_US;
+    result.bytesPerFrame = (double)benchDisplay.totalBytes / frames;
+    result.savedPerFrame = (double)benchDisplay.totalSaved / frames;
+    result.runsPerFrame = (double)runs / frames;
+    result.framesPerSecond = frames * 1e6 / time_us;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    int speed = argc > 2 ? atoi(argv[2]) : 400000;
+    uint32_t wrongPixels = 0;
+
+    if (frames <= 0 || speed <= 0) {
+        printf("Usage: %s [frames per screen] [bus speed in Hz]\n", argv[0]);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only.
+    SUS_SimBus_Init(0, speed, false);
+    struct SUS_SimDevice *oled = SUS_SimBus_AddDevice(0, BENCH_OLED_ADDRESS);
+    oled->onWrite = BenchOledWrite;
+    oled->onAddressed = BenchOledAddressed;
+    SUS_I2C_Master_Init(0, 22, 21, speed);
+
+    for (int controller = SUS_I2C_DISPLAY_SSD1306; controller <= SUS_I2C_DISPLAY_SH1106; controller++)
+    {
+        benchDisplay = (struct SUS_I2C_Display){.I2CportNumber = 0, .I2CdeviceAddress = BENCH_OLED_ADDRESS, .controller = (uint8_t)controller,
+                                                .width = 128, .height = 64, .columnOffset = controller == SUS_I2C_DISPLAY_SH1106 ? 2 : 0};
+        memset(benchOled.ram, 0xA5, sizeof(benchOled.ram));        //Power-up garbage.
+        if (SUS_I2C_DisplayInit(&benchDisplay) != ESP_OK) {
+            printf("Display init failed.\n");
+            return 1;
+        }
+        wrongPixels += BenchOledDifferences();
+        if (controller == SUS_I2C_DISPLAY_SH1106) {                //The SH1106 only runs the checks: its numbers are the same but for the column offset.
+            for (size_t s = 0; s < sizeof(benchScreen) / sizeof(benchScreen[0]); s++)
+                wrongPixels += BenchRun(&benchScreen[s], false, frames / 10 + 1).wrongPixels;
+            break;
+        }
+
+        printf("128x64 SSD1306, %d Hz, %d frames per screen. Full frame = %d bytes. Frame rate = frames / (wire time + %d us driver time per transaction).\n\n",
+               speed, frames, 8 * (SUS_I2C_DISPLAY_RUN_OVERHEAD + 128), SUS_I2C_TRANSACTION_OVERHEAD_US);
+        printf("%-24s %12s %12s %12s %12s %10s %10s %8s\n", "screen", "full B/frm", "dirty B/frm", "saved B/frm", "dirty tx/frm", "full fps", "dirty fps", "speedup");
+        for (size_t s = 0; s < sizeof(benchScreen) / sizeof(benchScreen[0]); s++)
+        {
+            struct BenchResult full = BenchRun(&benchScreen[s], true, frames);
+            struct BenchResult dirty = BenchRun(&benchScreen[s], false, frames);
+            wrongPixels += full.wrongPixels + dirty.wrongPixels;
+            printf("%-24s %12.0f %12.1f %12.1f %12.2f %10.1f %10.1f %7.1fx\n", benchScreen[s].name, full.bytesPerFrame, dirty.bytesPerFrame,
+                   dirty.savedPerFrame, dirty.runsPerFrame, full.framesPerSecond, dirty.framesPerSecond, dirty.framesPerSecond / full.framesPerSecond);
+        }
+    }
+
+    printf("\nPixels that differed between the framebuffer and the display after a flush (SSD1306 and SH1106): %lu\n", (unsigned long)wrongPixels);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    return (wrongPixels == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
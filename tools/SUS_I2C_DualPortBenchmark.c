@@ -0,0 +1,173 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_DualPortBenchmark.c
+ *
+ *    Brief:    Shows how much faster the dual port engine of SUS_I2Cmaster_FULL.h gets data off the sensors when it uses both I2C ports instead of one.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against two simulated I2C buses (sim/SUS_I2C_SimBus.h) that take real time per transaction,
+ *              like the two I2C controllers of the ESP32 do. The same set of sensors is read continuously (as fast as possible) in two setups:
+ *                  1. all sensors wired to I2C port 0 - one bus does all the work, the other one idles (what a single-task program gets)
+ *                  2. half of the sensors moved to I2C port 1 - both buses work at the same time
+ *              Every job is added with SUS_I2C_ANY_PORT, so the engine has to find out by itself where each sensor is.
+ *              A third run wires every sensor to BOTH buses to show the automatic load balancing.
+ *
+ *              Printed report per setup: samples/s and bytes/s of the merged stream, bus load of each port, drops, and
+ *              the worst "out of order" step of the merged stream (how far back in time a sample can be compared to the one before it).
+ *              At the end: throughput of the two port setups relative to the one port setup. Anything near 2.0x means both buses are fully used.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_DualPortBenchmark SUS_I2C_DualPortBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_DualPortBenchmark [seconds per setup (default 2)] [bus speed in Hz (default 400000)] [sensors (default 8)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_MAX_SENSORS       32
+#define BENCH_FIRST_ADDRESS     0x40
+#define BENCH_START_REGISTER    0x3B            // MPU6050-like: accelerometer + temperature + gyro, 14 bytes from 0x3B.
+#define BENCH_BURST_LENGTH      14
+
+enum BenchWiring { BENCH_ALL_ON_PORT0, BENCH_SPLIT, BENCH_ON_BOTH };
+
+struct BenchResult
+{
+    double samplesPerSecond;
+    double bytesPerSecond;
+    double busLoad[2];
+    uint64_t samples, dropped, errors;
+    int64_t worstBackstep_us;                   // Largest (previous timestamp - this timestamp) in the merged stream.
+    int jobsOnPort[2];
+};
+
+static struct SUS_I2C_AcquisitionJob benchJob[BENCH_MAX_SENSORS];
+
+static void BenchWire(enum BenchWiring wiring, int sensors)
+{
+    for (int port = 0; port < 2; port++)
+        for (int i = 0; i < sensors; i++) SUS_SimBus_Port[port].device[BENCH_FIRST_ADDRESS + i].present = false;
+
+    for (int i = 0; i < sensors; i++)
+    {
+        bool onPort0 = (wiring != BENCH_SPLIT) || (i < sensors / 2);
+        bool onPort1 = (wiring == BENCH_ON_BOTH) || (wiring == BENCH_SPLIT && i >= sensors / 2);
+        for (int port = 0; port < 2; port++)
+        {
+            if ((port == 0 && !onPort0) || (port == 1 && !onPort1)) continue;
+            struct SUS_SimDevice *device = SUS_SimBus_AddDevice(port, BENCH_FIRST_ADDRESS + i);
+            for (int r = 0; r < BENCH_BURST_LENGTH; r++) device->registers[BENCH_START_REGISTER + r] = (uint8_t)(i * 16 + r);
+        }
+    }
+}
+
+static struct BenchResult BenchRun(enum BenchWiring wiring, int sensors, double seconds)
+{
+    struct BenchResult result;
+    struct SUS_I2C_Sample sample;
+    uint64_t busTimeBefore[2];
+    int64_t lastTimestamp = 0, start, end;
+
+    memset(&result, 0, sizeof(result));
+    BenchWire(wiring, sensors);
+    busTimeBefore[0] = SUS_SimBus_Port[0].busTime_ns;
+    busTimeBefore[1] = SUS_SimBus_Port[1].busTime_ns;
+
+    if (SUS_I2C_DualPortStart(0, 1, 10, 256) != ESP_OK) {
+        printf("Could not start the dual port engine.\n");
+        exit(1);
+    }
+    start = esp_timer_get_time();
+    end = start + (int64_t)(seconds * 1e6);
+    while (esp_timer_get_time() < end)
+    {
+        if (SUS_I2C_DualPortGetSample(&sample, 10/portTICK_PERIOD_MS) != ESP_OK) continue;
+        if (sample.outcome == ESP_OK && sample.data[0] != (uint8_t)((sample.I2CdeviceAddress - BENCH_FIRST_ADDRESS) * 16)) {
+            printf("Wrong data from device %#04x!\n", sample.I2CdeviceAddress);
+            exit(1);
+        }
+        if (lastTimestamp - sample.timestamp_us > result.worstBackstep_us) result.worstBackstep_us = lastTimestamp - sample.timestamp_us;
+        if (sample.timestamp_us > lastTimestamp) lastTimestamp = sample.timestamp_us;
+    }
+    SUS_I2C_DualPortStop();
+    end = esp_timer_get_time();
+
+    for (int i = 0; i < sensors; i++)
+    {
+        if (benchJob[i].assignedPort == SUS_I2C_ANY_PORT) continue;
+        result.jobsOnPort[benchJob[i].assignedPort]++;
+        result.samples += benchJob[i].samples;
+        result.dropped += benchJob[i].dropped;
+        result.errors += benchJob[i].periodic.errors;
+    }
+    result.samplesPerSecond = result.samples / ((end - start) / 1e6);
+    result.bytesPerSecond = result.samplesPerSecond * BENCH_BURST_LENGTH;
+    for (int port = 0; port < 2; port++)
+        result.busLoad[port] = (SUS_SimBus_Port[port].busTime_ns - busTimeBefore[port]) / 1e3 / (double)(end - start);
+    while (SUS_I2C_DualPortGetSample(&sample, 0) == ESP_OK) {}     //Empty the queue before the next setup.
+    return result;
+}
+
+static void BenchPrint(const char *name, struct BenchResult *result)
+{
+    printf("%-34s %3d+%-3d %10.0f %11.0f %7.1f%% %7.1f%% %8llu %7llu %9lld\n", name, result->jobsOnPort[0], result->jobsOnPort[1],
+           result->samplesPerSecond, result->bytesPerSecond, 100.0 * result->busLoad[0], 100.0 * result->busLoad[1],
+           (unsigned long long)result->dropped, (unsigned long long)result->errors, (long long)result->worstBackstep_us);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    int speed = (argc > 2) ? atoi(argv[2]) : 400000;
+    int sensors = (argc > 3) ? atoi(argv[3]) : 8;
+    struct BenchResult single, split, both;
+
+    if (sensors < 2 || sensors > BENCH_MAX_SENSORS || seconds <= 0 || speed <= 0) {
+        printf("Usage: %s [seconds per setup] [bus speed in Hz] [sensors 2-%d]\n", argv[0], BENCH_MAX_SENSORS);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only - the engine is chatty on start.
+    SUS_SimBus_Init(0, speed, true);
+    SUS_SimBus_Init(1, speed, true);
+    SUS_I2C_Master_Init(0, 22, 21, speed);
+    SUS_I2C_Master_Init(1, 19, 18, speed);
+
+    for (int i = 0; i < sensors; i++)
+    {
+        benchJob[i].I2CportNumber = SUS_I2C_ANY_PORT;
+        benchJob[i].I2CdeviceAddress = BENCH_FIRST_ADDRESS + i;
+        benchJob[i].startRegisterAddress = BENCH_START_REGISTER;
+        benchJob[i].amountOfBytesToRead = BENCH_BURST_LENGTH;
+        benchJob[i].period_us = 0;     //Continuous: as fast as the bus allows.
+        SUS_I2C_DualPortAddJob(&benchJob[i]);
+    }
+
+    printf("%d sensors, %d-byte burst reads, continuous, %d Hz buses, %.1f s per setup. One read = %lu us on the wire.\n\n",
+           sensors, BENCH_BURST_LENGTH, speed, seconds, (unsigned long)SUS_I2C_BusTime_us(0, 3 + BENCH_BURST_LENGTH, 2));
+    printf("%-34s %7s %10s %11s %8s %8s %8s %7s %9s\n", "setup", "jobs", "samples/s", "bytes/s", "port0", "port1", "dropped", "errors", "backstep");
+    single = BenchRun(BENCH_ALL_ON_PORT0, sensors, seconds);
+    BenchPrint("1 port  (all sensors on port 0)", &single);
+    split = BenchRun(BENCH_SPLIT, sensors, seconds);
+    BenchPrint("2 ports (half the sensors moved)", &split);
+    both = BenchRun(BENCH_ON_BOTH, sensors, seconds);
+    BenchPrint("2 ports (sensors on both, balanced)", &both);
+
+    printf("\nScaling from one port to two: %.2fx (split wiring), %.2fx (balanced). Ideal is 2.00x.\n",
+           split.samplesPerSecond / single.samplesPerSecond, both.samplesPerSecond / single.samplesPerSecond);
+    printf("backstep = worst time step backwards between consecutive samples of the merged stream, in us. On the ESP32 this is at most one read;\n");
+    printf("           here it also contains the sleep/wake-up jitter of the host (the simulated buses sleep in chunks of up to 2 ms).\n");
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    return 0;
+}
@@ -0,0 +1,366 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_FrameBenchmark.c
+ *
+ *    Brief:    Moves the same sensor reads to two consumer tasks twice - as copied sample structs through a dispatcher, and as pooled frames
+ *              passed by pointer (SUS_I2C_Frame...) - checks every payload, and compares bytes copied, RAM and hand-off cost. Then runs the frames
+ *              with a pool that is too small for a slow consumer, to show what the occupancy and failure counters say.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h), bus time only counted.
+ *              4 simulated FIFO sensors: every read transaction returns a new
+ *              block where byte i = first byte + i, so a payload that got mixed up, overwritten or reused too early is caught.
+ *                  1. Copies: producer task reads into a buffer and fills a sample struct, sends it to a dispatcher task, which sends it on to
+ *                     the processing and the logging task. Every hop copies the whole struct (the usual pattern).
+ *                  2. Frames: producer SUS_I2C_FrameRead()s into a pooled frame and SUS_I2C_FramePublish()es it to both consumers, who check
+ *                     and SUS_I2C_FrameRelease() it. Only pointers move.
+ *                  3. Frames, pool too small, the logger slow: processing still gets every frame that was read, the logger misses some, the
+ *                     pool counts its failures, and every frame is back in the pool at the end.
+ *              Times: the simulator's tasks are threads and its queues mutexes, so the whole pipelines mostly measure thread wake-ups.
+ *              The hand-off alone (both pipelines in one thread, without the I2C reads) shows what the queue operations and copies cost.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_FrameBenchmark SUS_I2C_FrameBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_FrameBenchmark [samples (default 50000)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#define SUS_I2C_FRAME_PAYLOAD   128     // FIFO blocks: more than the default.
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_SENSORS           4
+#define BENCH_FIRST_ADDRESS     0x68
+#define BENCH_FIFO_REGISTER     0x74
+#define BENCH_BLOCK             SUS_I2C_FRAME_PAYLOAD   // Bytes per read.
+#define BENCH_QUEUE_LENGTH      32
+#define BENCH_POOL_FRAMES       64
+#define BENCH_SMALL_POOL        12
+#define BENCH_SLOW_SAMPLES      400
+
+/*----- The sensor: every read transaction delivers the next block. -----*/
+static uint8_t benchBlock[BENCH_SENSORS];
+
+static void BenchSensorAddressed(struct SUS_SimDevice *device, bool read)
+{
+    if (read) benchBlock[(uintptr_t)device->context]++;
+}
+
+static uint8_t BenchSensorRead(struct SUS_SimDevice *device, uint8_t registerAddress)
+{
+    return (uint8_t)(benchBlock[(uintptr_t)device->context] * 37 + (uint8_t)(registerAddress - BENCH_FIFO_REGISTER));
+}
+
+static bool BenchPayloadGood(const uint8_t *payload, size_t length)
+{
+    for (size_t i = 1; i < length; i++) if (payload[i] != (uint8_t)(payload[0] + i)) return false;
+    return true;
+}
+
+/*----- Shared by both pipelines. -----*/
+struct BenchConsumer
+{
+    const char *name;
+    QueueHandle_t queue;
+    uint32_t holdEvery;         // Slow consumer: sleeps 1 ms after every "holdEvery" items. 0 = never.
+    uint32_t received, bad, outOfOrder;
+    int64_t  lastSequence;
+};
+
+static uint32_t benchSamples;
+static volatile bool benchProducerDone;
+static volatile int benchTasksRunning;
+static uint64_t benchBytesCopied;                   // Copy pipeline: bytes moved through queues and buffers.
+
+static void BenchTaskEnd(void)
+{
+    __atomic_sub_fetch(&benchTasksRunning, 1, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+static void BenchWait(void)
+{
+    while (__atomic_load_n(&benchTasksRunning, __ATOMIC_SEQ_CST) > 0) vTaskDelay(1);
+}
+
+static void BenchStart(TaskFunction_t task, const char *name, void *argument)
+{
+    __atomic_add_fetch(&benchTasksRunning, 1, __ATOMIC_SEQ_CST);
+    xTaskCreate(task, name, 4096, argument, 5, NULL);
+}
+
+/*----- 1. Copies. -----*/
+struct BenchSample
+{
+    int64_t   timestamp_us;
+    uint32_t  sequence;
+    esp_err_t outcome;
+    uint8_t   I2CportNumber, I2CdeviceAddress, startRegisterAddress, length;
+    uint8_t   data[BENCH_BLOCK];
+};
+
+static QueueHandle_t benchDispatchQueue;
+static struct BenchConsumer benchCopyConsumer[2];
+
+static void BenchCopyProducer(void *argument)
+{
+    (void)argument;
+    uint8_t buffer[BENCH_BLOCK];
+    struct BenchSample sample;
+    for (uint32_t s = 0; s < benchSamples; s++)
+    {
+        uint8_t address = BENCH_FIRST_ADDRESS + s % BENCH_SENSORS;
+        sample.timestamp_us = esp_timer_get_time();
+        sample.outcome = SUS_I2C_ReadRegisters(0, address, BENCH_FIFO_REGISTER, buffer, BENCH_BLOCK);
+        sample.sequence = s;
+        sample.I2CportNumber = 0;
+        sample.I2CdeviceAddress = address;
+        sample.startRegisterAddress = BENCH_FIFO_REGISTER;
+        sample.length = BENCH_BLOCK;
+        memcpy(sample.data, buffer, BENCH_BLOCK);
+        xQueueSend(benchDispatchQueue, &sample, portMAX_DELAY);
+        __atomic_add_fetch(&benchBytesCopied, BENCH_BLOCK + sizeof(sample), __ATOMIC_RELAXED);
+    }
+    benchProducerDone = true;
+    BenchTaskEnd();
+}
+
+static void BenchCopyDispatcher(void *argument)
+{
+    (void)argument;
+    struct BenchSample sample;
+    for (;;)
+    {
+        if (xQueueReceive(benchDispatchQueue, &sample, 10 / portTICK_PERIOD_MS) != pdTRUE) {
+            if (benchProducerDone) break;
+            continue;
+        }
+        for (int c = 0; c < 2; c++) xQueueSend(benchCopyConsumer[c].queue, &sample, portMAX_DELAY);
+        __atomic_add_fetch(&benchBytesCopied, 3 * sizeof(sample), __ATOMIC_RELAXED);
+    }
+    BenchTaskEnd();
+}
+
+static void BenchCopyConsumerTask(void *argument)
+{
+    struct BenchConsumer *consumer = (struct BenchConsumer *)argument;
+    struct BenchSample sample;
+    while (consumer->received < benchSamples)
+    {
+        if (xQueueReceive(consumer->queue, &sample, 100 / portTICK_PERIOD_MS) != pdTRUE) break;
+        consumer->received++;
+        __atomic_add_fetch(&benchBytesCopied, sizeof(sample), __ATOMIC_RELAXED);
+        if (sample.outcome != ESP_OK || !BenchPayloadGood(sample.data, sample.length)) consumer->bad++;
+        if ((int64_t)sample.sequence <= consumer->lastSequence) consumer->outOfOrder++;
+        consumer->lastSequence = sample.sequence;
+    }
+    BenchTaskEnd();
+}
+
+/*----- 2. and 3. Frames. -----*/
+static struct SUS_I2C_Frame benchFrames[BENCH_POOL_FRAMES];
+static struct SUS_I2C_FramePool benchPool;
+static struct BenchConsumer benchFrameConsumer[2];
+static uint32_t benchReadAttempts;
+
+static void BenchFrameProducer(void *argument)
+{
+    (void)argument;
+    QueueHandle_t consumers[2] = {benchFrameConsumer[0].queue, benchFrameConsumer[1].queue};
+    bool lossless = benchFrameConsumer[1].holdEvery == 0;
+    for (uint32_t s = 0; s < benchSamples; s++)
+    {
+        struct SUS_I2C_Frame *frame;
+        benchReadAttempts++;
+        if (SUS_I2C_FrameRead(&benchPool, 0, BENCH_FIRST_ADDRESS + s % BENCH_SENSORS, BENCH_FIFO_REGISTER, BENCH_BLOCK, &frame) == ESP_ERR_NO_MEM) {
+            vTaskDelay(1);          //Pool empty: this sample is lost, try the next one a bit later.
+            continue;
+        }
+        frame->deviceId = (uint16_t)(s % BENCH_SENSORS);
+        SUS_I2C_FramePublish(frame, consumers, 2, lossless ? portMAX_DELAY : 0);
+    }
+    benchProducerDone = true;
+    BenchTaskEnd();
+}
+
+static void BenchFrameConsumerTask(void *argument)
+{
+    struct BenchConsumer *consumer = (struct BenchConsumer *)argument;
+    struct SUS_I2C_Frame *frame;
+    for (;;)
+    {
+        if (SUS_I2C_FrameReceive(consumer->queue, &frame, 10 / portTICK_PERIOD_MS) != ESP_OK) {
+            if (benchProducerDone) break;
+            continue;
+        }
+        consumer->received++;
+        if (frame->outcome != ESP_OK || frame->length != BENCH_BLOCK || !BenchPayloadGood(frame->payload, frame->length) ||
+            frame->I2CdeviceAddress != BENCH_FIRST_ADDRESS + frame->deviceId) consumer->bad++;
+        if ((int64_t)frame->sequence <= consumer->lastSequence) consumer->outOfOrder++;
+        consumer->lastSequence = frame->sequence;
+        if (consumer->holdEvery && consumer->received % consumer->holdEvery == 0) vTaskDelay(1);
+        SUS_I2C_FrameRelease(frame);
+    }
+    BenchTaskEnd();
+}
+
+/*----- The hand-off alone: one thread, no I2C, no task switches - what each pipeline costs per sample in queue operations and copies. -----*/
+static void BenchHandOffOnly(uint32_t samples, double *copy_ns, double *frame_ns)
+{
+    QueueHandle_t dispatch = xQueueCreate(1, sizeof(struct BenchSample));
+    QueueHandle_t copyQueue[2] = {xQueueCreate(1, sizeof(struct BenchSample)), xQueueCreate(1, sizeof(struct BenchSample))};
+    QueueHandle_t frameQueue[2] = {SUS_I2C_FrameQueueCreate(1), SUS_I2C_FrameQueueCreate(1)};
+    uint8_t buffer[BENCH_BLOCK] = {0};
+    struct BenchSample sample, received;
+    struct SUS_I2C_Frame *frame;
+    uint32_t checksum = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t s = 0; s < samples; s++)
+    {
+        buffer[0] = (uint8_t)s;
+        sample.timestamp_us = s;
+        sample.sequence = s;
+        memcpy(sample.data, buffer, BENCH_BLOCK);
+        xQueueSend(dispatch, &sample, 0);
+        xQueueReceive(dispatch, &received, 0);
+        for (int c = 0; c < 2; c++) xQueueSend(copyQueue[c], &received, 0);
+        for (int c = 0; c < 2; c++) { xQueueReceive(copyQueue[c], &sample, 0); checksum += sample.data[0]; }
+    }
+    *copy_ns = 1000.0 * (esp_timer_get_time() - start) / samples;
+
+    SUS_I2C_FramePoolInit(&benchPool, benchFrames, BENCH_POOL_FRAMES);
+    start = esp_timer_get_time();
+    for (uint32_t s = 0; s < samples; s++)
+    {
+        frame = SUS_I2C_FrameTake(&benchPool);
+        frame->timestamp_us = s;
+        frame->payload[0] = (uint8_t)s;
+        SUS_I2C_FramePublish(frame, frameQueue, 2, 0);
+        for (int c = 0; c < 2; c++) { SUS_I2C_FrameReceive(frameQueue[c], &frame, 0); checksum -= frame->payload[0]; SUS_I2C_FrameRelease(frame); }
+    }
+    *frame_ns = 1000.0 * (esp_timer_get_time() - start) / samples;
+    if (checksum != 0 || benchPool.inUse != 0) printf("!! hand-off only: payloads or pool wrong\n");
+    vQueueDelete(dispatch);
+    for (int c = 0; c < 2; c++) { vQueueDelete(copyQueue[c]); vQueueDelete(frameQueue[c]); }
+}
+
+/*----- Runs. -----*/
+static void BenchConsumersReset(struct BenchConsumer consumer[2], size_t itemSize, uint32_t slowHoldEvery)
+{
+    for (int c = 0; c < 2; c++)
+    {
+        if (consumer[c].queue == NULL) consumer[c].queue = xQueueCreate(BENCH_QUEUE_LENGTH, itemSize);
+        consumer[c].name = c ? "logging" : "processing";
+        consumer[c].holdEvery = c ? slowHoldEvery : 0;
+        consumer[c].received = consumer[c].bad = consumer[c].outOfOrder = 0;
+        consumer[c].lastSequence = -1;
+    }
+    benchProducerDone = false;
+}
+
+static int BenchCheck(const struct BenchConsumer consumer[2], uint32_t expected[2])
+{
+    int problems = 0;
+    for (int c = 0; c < 2; c++)
+    {
+        printf("   %-10s: %lu received, %lu bad, %lu out of order\n", consumer[c].name, (unsigned long)consumer[c].received, (unsigned long)consumer[c].bad,
+               (unsigned long)consumer[c].outOfOrder);
+        if (consumer[c].bad || consumer[c].outOfOrder) problems++;
+        if (consumer[c].received != expected[c]) { printf("!! %s: %lu received, expected %lu\n", consumer[c].name, (unsigned long)consumer[c].received, (unsigned long)expected[c]); problems++; }
+    }
+    return problems;
+}
+
+int main(int argc, char **argv)
+{
+    int problems = 0;
+    uint32_t samples = argc > 1 ? (uint32_t)atoi(argv[1]) : 50000;
+
+    SUS_Sim_LogLevel = 1;
+    SUS_SimBus_Init(0, 1000000, false);
+    SUS_I2C_Master_Init(0, 22, 21, 1000000);
+    for (int s = 0; s < BENCH_SENSORS; s++)
+    {
+        struct SUS_SimDevice *device = SUS_SimBus_AddDevice(0, BENCH_FIRST_ADDRESS + s);
+        device->onRead = BenchSensorRead;
+        device->onAddressed = BenchSensorAddressed;
+        device->context = (void *)(uintptr_t)s;
+    }
+
+    printf("===== 1. Copies: producer -> dispatcher -> processing + logging, %lu samples of %d bytes =====\n", (unsigned long)samples, BENCH_BLOCK);
+    benchSamples = samples;
+    benchDispatchQueue = xQueueCreate(BENCH_QUEUE_LENGTH, sizeof(struct BenchSample));
+    BenchConsumersReset(benchCopyConsumer, sizeof(struct BenchSample), 0);
+    int64_t start = esp_timer_get_time();
+    BenchStart(BenchCopyConsumerTask, "processing", &benchCopyConsumer[0]);
+    BenchStart(BenchCopyConsumerTask, "logging", &benchCopyConsumer[1]);
+    BenchStart(BenchCopyDispatcher, "dispatcher", NULL);
+    BenchStart(BenchCopyProducer, "producer", NULL);
+    BenchWait();
+    int64_t copy_us = esp_timer_get_time() - start;
+    problems += BenchCheck(benchCopyConsumer, (uint32_t[2]){samples, samples});
+    size_t copyQueueRam = 3 * BENCH_QUEUE_LENGTH * sizeof(struct BenchSample);
+
+    printf("\n===== 2. Frames: producer -> processing + logging by pointer, %lu samples =====\n", (unsigned long)samples);
+    SUS_I2C_FramePoolInit(&benchPool, benchFrames, BENCH_POOL_FRAMES);
+    BenchConsumersReset(benchFrameConsumer, sizeof(struct SUS_I2C_Frame *), 0);
+    benchFrameConsumer[0].queue = SUS_I2C_FrameQueueCreate(BENCH_QUEUE_LENGTH);
+    benchFrameConsumer[1].queue = SUS_I2C_FrameQueueCreate(BENCH_QUEUE_LENGTH);
+    start = esp_timer_get_time();
+    BenchStart(BenchFrameConsumerTask, "processing", &benchFrameConsumer[0]);
+    BenchStart(BenchFrameConsumerTask, "logging", &benchFrameConsumer[1]);
+    BenchStart(BenchFrameProducer, "producer", NULL);
+    BenchWait();
+    int64_t frame_us = esp_timer_get_time() - start;
+    problems += BenchCheck(benchFrameConsumer, (uint32_t[2]){samples, samples});
+    SUS_Sim_LogLevel = 3;
+    SUS_I2C_FramePoolPrintReport(&benchPool);
+    SUS_Sim_LogLevel = 1;
+    if (benchPool.inUse != 0 || benchPool.failures != 0) { printf("!! %d frames not back in the pool, %lu failures\n", benchPool.inUse, (unsigned long)benchPool.failures); problems++; }
+    size_t frameRam = 2 * BENCH_QUEUE_LENGTH * sizeof(struct SUS_I2C_Frame *) + benchPool.peakInUse * sizeof(struct SUS_I2C_Frame);
+    uint64_t frameBytesCopied = (uint64_t)samples * 4 * sizeof(struct SUS_I2C_Frame *);     //2 sends + 2 receives of a pointer.
+
+    printf("\n===== 3. Frames, %d-frame pool, logger sleeps after every 4th frame, %d samples =====\n", BENCH_SMALL_POOL, BENCH_SLOW_SAMPLES);
+    benchSamples = BENCH_SLOW_SAMPLES;
+    benchReadAttempts = 0;
+    SUS_I2C_FramePoolInit(&benchPool, benchFrames, BENCH_SMALL_POOL);
+    BenchConsumersReset(benchFrameConsumer, sizeof(struct SUS_I2C_Frame *), 4);
+    BenchStart(BenchFrameConsumerTask, "processing", &benchFrameConsumer[0]);
+    BenchStart(BenchFrameConsumerTask, "logging", &benchFrameConsumer[1]);
+    BenchStart(BenchFrameProducer, "producer", NULL);
+    BenchWait();
+    problems += BenchCheck(benchFrameConsumer, (uint32_t[2]){benchPool.taken, benchPool.delivered - benchPool.taken});
+    SUS_Sim_LogLevel = 3;
+    SUS_I2C_FramePoolPrintReport(&benchPool);
+    SUS_Sim_LogLevel = 1;
+    if (benchPool.inUse != 0) { printf("!! %d frames not back in the pool\n", benchPool.inUse); problems++; }
+    if (benchPool.failures == 0 || benchPool.taken + benchPool.failures != benchReadAttempts || benchPool.peakInUse != BENCH_SMALL_POOL) {
+        printf("!! pool counters: %lu taken + %lu failures, %lu reads tried, peak %d\n", (unsigned long)benchPool.taken, (unsigned long)benchPool.failures,
+               (unsigned long)benchReadAttempts, benchPool.peakInUse);
+        problems++;
+    }
+
+    double copyHandOff_ns, frameHandOff_ns;
+    BenchHandOffOnly(samples, &copyHandOff_ns, &frameHandOff_ns);
+    printf("\nHand-off alone (one thread, no I2C): %.0f ns/sample with copies, %.0f ns/sample with frames (%.1fx).\n",
+           copyHandOff_ns, frameHandOff_ns, copyHandOff_ns / frameHandOff_ns);
+    printf("Whole pipeline with tasks: copies %.2f us/sample, frames %.2f us/sample (host thread wake-ups dominate these, they vary from run to run).\n",
+           (double)copy_us / samples, (double)frame_us / samples);
+    printf("Bytes copied per sample: %llu with copies, %llu with frames. Queue + buffer RAM: %u bytes with copies, %u bytes with frames (queues + peak pool use).\n",
+           (unsigned long long)(benchBytesCopied / samples), (unsigned long long)(frameBytesCopied / samples), (unsigned)copyQueueRam, (unsigned)frameRam);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    printf("RESULT: %s\n", (problems == 0 && SUS_Sim_LinksOutstanding == 0) ? "PASS" : "FAIL");
+    return (problems == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
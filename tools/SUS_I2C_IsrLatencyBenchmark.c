@@ -0,0 +1,189 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_IsrLatencyBenchmark.c
+ *
+ *    Brief:    Measures how long it takes from an interrupt until the I2C read it asked for is done, for the two ways of doing it with SUS_I2Cmaster_FULL.h.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h) that takes real time per transaction.
+ *              A periodic timer plays the part of the interrupt (a "data ready" GPIO ISR of an IMU, say) and asks for a 6-byte burst read every period:
+ *                  1. "wake a task": the ISR notifies a reader task, the task calls SUS_I2C_ReadRegisters. The classic way.
+ *                  2. "submit":      the ISR calls SUS_I2C_SubmitFromISR with a preallocated request, the worker task of the port runs it.
+ *              Both are measured on an idle bus and on a bus that also carries a bulk transfer (SUS_I2C_TransferChunked, 16-byte chunks at SUS_I2C_PRIORITY_BULK).
+ *              On the busy bus the submitted reads go through the bus arbiter at SUS_I2C_PRIORITY_HIGH, the classic ones just queue on the driver.
+ *
+ *              Printed per setup: amount of reads, average / median / 99th percentile / worst latency from the interrupt to the END of the read, in microseconds.
+ *              (The end, because that's the only moment both paths can see: a plain SUS_I2C_ReadRegisters can't tell when it really got onto the bus.
+ *              The ISR-to-bus-START latency of the submit path alone is in the SUS_I2C_IsrPrintReport line at the bottom.)
+ *              The numbers of the host are NOT ESP32 numbers (Linux thread wake-ups are much slower and noisier than FreeRTOS ones) -
+ *              compare the rows with each other, and run the same code on the ESP32 for absolute values.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_IsrLatencyBenchmark SUS_I2C_IsrLatencyBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_IsrLatencyBenchmark [seconds per setup (default 2)] [interrupt period in us (default 1000)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_IMU_ADDRESS       0x68
+#define BENCH_EEPROM_ADDRESS    0x50
+#define BENCH_MAX_SAMPLES       100000
+
+enum BenchPath { BENCH_WAKE_TASK, BENCH_SUBMIT };
+
+static uint32_t benchLatency[BENCH_MAX_SAMPLES];
+static volatile uint32_t benchCount;
+static volatile int64_t benchInterruptTime;         //Wake-task path: when the "ISR" fired.
+static volatile bool benchRunning, benchBulkRunning, benchBulkFinished;
+static TaskHandle_t benchReader;
+static uint8_t benchImuData[6];
+static struct SUS_I2C_IsrRequest benchRequest;
+
+static void BenchRecord(uint32_t latency)
+{
+    if (benchCount < BENCH_MAX_SAMPLES) benchLatency[benchCount++] = latency;
+}
+
+//The "interrupt" of the classic path: remember when, wake the reader task.
+static void BenchInterruptWake(void *argument)
+{
+    BaseType_t woken = pdFALSE;
+    (void)argument;
+    benchInterruptTime = esp_timer_get_time();
+    vTaskNotifyGiveFromISR(benchReader, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void BenchReaderTask(void *argument)
+{
+    (void)argument;
+    while (benchRunning)
+    {
+        if (ulTaskNotifyTake(pdTRUE, 10/portTICK_PERIOD_MS) == 0) continue;
+        int64_t interruptTime = benchInterruptTime;
+        SUS_I2C_ReadRegisters(0, BENCH_IMU_ADDRESS, 0x3B, benchImuData, sizeof(benchImuData));
+        BenchRecord((uint32_t)(esp_timer_get_time() - interruptTime));
+    }
+    vTaskDelete(NULL);
+}
+
+//The "interrupt" of the submit path.
+static void BenchInterruptSubmit(void *argument)
+{
+    BaseType_t woken = pdFALSE;
+    (void)argument;
+    SUS_I2C_SubmitFromISR(&benchRequest, &woken);     //Still busy with the previous one? Then this interrupt is simply lost, like a real missed one.
+    portYIELD_FROM_ISR(woken);
+}
+
+static void BenchRequestDone(struct SUS_I2C_IsrRequest *request)
+{
+    BenchRecord((uint32_t)(request->finished_us - request->submitted_us));
+}
+
+//Background traffic: writes a 1 KB block over and over in 16-byte chunks.
+static void BenchBulkTask(void *argument)
+{
+    static uint8_t block[1024];
+    struct SUS_I2C_ChunkedTransfer transfer = {.I2CportNumber = 0, .I2CdeviceAddress = BENCH_EEPROM_ADDRESS, .priority = SUS_I2C_PRIORITY_BULK,
+                                               .data = block, .length = sizeof(block), .chunkSize = 16, .addressBytes = 1};
+    (void)argument;
+    while (benchBulkRunning) SUS_I2C_TransferChunked(&transfer);
+    benchBulkFinished = true;
+    vTaskDelete(NULL);
+}
+
+static int BenchCompare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void BenchRun(const char *name, enum BenchPath path, bool busyBus, double seconds, uint32_t period_us)
+{
+    esp_timer_handle_t timer = NULL;
+    esp_timer_create_args_t timerConfig = { .callback = (path == BENCH_SUBMIT) ? BenchInterruptSubmit : BenchInterruptWake, .name = "bench_isr" };
+    uint64_t total = 0;
+
+    benchCount = 0;
+    benchRunning = true;
+    if (busyBus) {
+        benchBulkRunning = true;
+        benchBulkFinished = false;
+        xTaskCreate(BenchBulkTask, "bench_bulk", 4096, NULL, 5, NULL);
+    }
+    if (path == BENCH_SUBMIT) SUS_I2C_IsrWorkerStart(0, 1, 20);
+    else xTaskCreate(BenchReaderTask, "bench_reader", 4096, NULL, 20, &benchReader);
+
+    esp_timer_create(&timerConfig, &timer);
+    esp_timer_start_periodic(timer, period_us);
+    vTaskDelay((TickType_t)(seconds * 1000) / portTICK_PERIOD_MS);
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+
+    if (path == BENCH_SUBMIT) SUS_I2C_IsrWorkerStop(0);
+    benchRunning = false;
+    benchBulkRunning = false;
+    if (busyBus) while (!benchBulkFinished) vTaskDelay(1);
+    vTaskDelay(20 / portTICK_PERIOD_MS);        //Let the reader task see benchRunning == false.
+
+    if (benchCount == 0) {
+        printf("%-40s no samples\n", name);
+        return;
+    }
+    qsort(benchLatency, benchCount, sizeof(benchLatency[0]), BenchCompare);
+    for (uint32_t i = 0; i < benchCount; i++) total += benchLatency[i];
+    printf("%-40s %9lu %9lu %9lu %9lu %9lu\n", name, (unsigned long)benchCount, (unsigned long)(total / benchCount), (unsigned long)benchLatency[benchCount / 2],
+           (unsigned long)benchLatency[(uint64_t)benchCount * 99 / 100], (unsigned long)benchLatency[benchCount - 1]);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    uint32_t period_us = (argc > 2) ? (uint32_t)atoi(argv[2]) : 1000;
+
+    if (seconds <= 0 || period_us < 100) {
+        printf("Usage: %s [seconds per setup] [interrupt period in us, at least 100]\n", argv[0]);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only.
+    SUS_SimBus_Init(0, 400000, true);
+    SUS_SimBus_Port[0].pacingSlack_ns = 50000;     //Transactions end close to when they would on a wire - we're measuring latency, not throughput.
+    SUS_I2C_Master_Init(0, 22, 21, 400000);
+    SUS_SimBus_AddDevice(0, BENCH_IMU_ADDRESS);
+    SUS_SimBus_AddDevice(0, BENCH_EEPROM_ADDRESS);
+
+    benchRequest.I2CportNumber = 0;
+    benchRequest.I2CdeviceAddress = BENCH_IMU_ADDRESS;
+    benchRequest.type = SUS_I2C_ISR_READ;
+    benchRequest.startRegisterAddress = 0x3B;
+    benchRequest.data = benchImuData;
+    benchRequest.length = sizeof(benchImuData);
+    benchRequest.priority = SUS_I2C_PRIORITY_HIGH;
+    benchRequest.onComplete = BenchRequestDone;
+
+    printf("6-byte burst read every %lu us, 400 kHz bus, %.1f s per setup. Latency = interrupt to end of the read, in us.\n\n", (unsigned long)period_us, seconds);
+    printf("%-40s %9s %9s %9s %9s %9s\n", "setup", "samples", "avg", "median", "99%", "worst");
+    BenchRun("wake a task, idle bus", BENCH_WAKE_TASK, false, seconds, period_us);
+    BenchRun("submit from ISR, idle bus", BENCH_SUBMIT, false, seconds, period_us);
+    BenchRun("wake a task, bulk transfer running", BENCH_WAKE_TASK, true, seconds, period_us);
+    BenchRun("submit from ISR, bulk transfer running", BENCH_SUBMIT, true, seconds, period_us);
+    SUS_Sim_LogLevel = 3;
+    SUS_I2C_IsrPrintReport(0);
+    SUS_I2C_BusPrintPriorityReport(0);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    return 0;
+}
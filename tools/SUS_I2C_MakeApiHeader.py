@@ -0,0 +1,91 @@
+# ==========================================================================================================================
+#
+#    Filename: SUS_I2C_MakeApiHeader.py
+#
+#    Brief:    Turns SUS_I2Cmaster_FULL.h into SUS_I2Cmaster.h - the same file with declarations only - for the compiled component.
+#              Part of "Simple Universal Solutions" (SUS) library pack.
+#
+#    Description:
+#              SUS_I2Cmaster_FULL.h defines every function right where it is documented, so it can only be included from ONE .c file.
+#              The compiled component builds it once (main/SUS_I2Cmaster_FULL.c) and gives everyone else this generated header instead:
+#                  - every function definition becomes a prototype (the doc comment above it stays)
+#                  - static helper functions and static variables (the library's internal state) are left out
+#                  - everything else - #defines, structs, macros, static inline functions, the docs - is copied as it is
+#              Relies on the layout rules of the library: a function's "{" and "}" stand alone at the start of their own lines, the line before the "{" ends with ")",
+#              a static variable is one line (or ends with a "};" line).
+#              Settings given as NAME=VALUE are pinned: the library was compiled with VALUE, so its "#ifndef NAME / #define NAME default" becomes
+#              "#define NAME VALUE", and code that defines NAME to something else before including the header gets an #error (a struct of another
+#              size than the library's = memory corruption, not a warning).
+#              Runs automatically during the CMake/ESP-IDF configure step. No need to call it by hand.
+#
+#    Usage:    python3 SUS_I2C_MakeApiHeader.py ../main/SUS_I2Cmaster_FULL.h SUS_I2Cmaster.h [NAME=VALUE ...]
+#
+import re
+import sys
+
+
+def make_api_header(source):
+    lines = source.replace('\r\n', '\n').split('\n')
+    output = []
+    i = 0
+    while i < len(lines):
+        line = lines[i]
+        # Function definition: signature (maybe several lines) ending with ")", then "{" alone on the next line.
+        if i + 1 < len(lines) and lines[i + 1] == '{' and line.rstrip().endswith(')'):
+            signature = []
+            while output and output[-1] and not output[-1].startswith(('/', ' *', '*', '#')) and output[-1] != '}' and not output[-1].endswith(';'):
+                signature.insert(0, output.pop())          # Continuation lines of a multi-line signature.
+            signature.append(line)
+            end = lines.index('}', i + 1)
+            if signature[0].startswith('static '):
+                while output and output[-1] == '':
+                    output.pop()
+                if output and output[-1] == '*/':           # Drop the doc comment of an internal helper too.
+                    while output and not output[-1].startswith('/*'):
+                        output.pop()
+                    output.pop()
+            else:
+                signature[-1] += ';'
+                output.extend(signature)
+            i = end + 1
+            continue
+        # Static variable: internal state lives in the compiled library only.
+        if line.startswith('static ') and '(' not in line.split('=')[0]:
+            if line.rstrip().endswith('{'):
+                while lines[i] != '};':
+                    i += 1
+            i += 1
+            continue
+        output.append(line)
+        i += 1
+    return '\r\n'.join(output)
+
+
+def pin_setting(api, name, value):
+    default = re.compile(r'#ifndef ' + name + r'\r\n(#define ' + name + r'\s+)(\S+)(.*)\r\n#endif\r\n')
+    match = default.search(api)
+    if match is None:
+        sys.exit('SUS_I2C_MakeApiHeader.py: no "#ifndef ' + name + '" default to pin')
+    pinned = ('#if defined(' + name + ') && ' + name + ' != ' + value + '\r\n'
+              '#error "' + name + ' differs from the ' + value + ' the library was compiled with. Set it in the library build (menuconfig, -D' + name + '), not here."\r\n'
+              '#endif\r\n'
+              '#ifndef ' + name + '\r\n' + match.group(1) + value + ' ' * max(0, len(match.group(2)) - len(value)) + match.group(3) + '\r\n#endif\r\n')
+    return api[:match.start()] + pinned + api[match.end():]
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3 or not all('=' in setting for setting in sys.argv[3:]):
+        sys.exit('Usage: SUS_I2C_MakeApiHeader.py SUS_I2Cmaster_FULL.h SUS_I2Cmaster.h [NAME=VALUE ...]')
+    with open(sys.argv[1], encoding='utf-8', newline='') as source:
+        api = make_api_header(source.read())
+    for setting in sys.argv[3:]:
+        api = pin_setting(api, *setting.split('=', 1))
+    api = api.replace('Filename: SUS_I2Cmaster_FULL.h', 'Filename: SUS_I2Cmaster.h (GENERATED from SUS_I2Cmaster_FULL.h - do not edit)', 1)
+    try:
+        with open(sys.argv[2], encoding='utf-8', newline='') as old:
+            if old.read() == api:
+                sys.exit(0)                                 # Unchanged: keep the timestamp, no needless rebuild of everything that includes it.
+    except OSError:
+        pass
+    with open(sys.argv[2], 'w', encoding='utf-8', newline='') as result:
+        result.write(api)
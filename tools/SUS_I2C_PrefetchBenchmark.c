@@ -0,0 +1,311 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_PrefetchBenchmark.c
+ *
+ *    Brief:    Measures what read-ahead prefetching (SUS_I2C_Prefetch...) saves for drivers that read registers one by one, and checks that
+ *              read-sensitive registers are never read ahead and no stale value is ever returned.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h) with an MPU6050-like device:
+ *              INT_STATUS (0x3A) clears when read, FIFO_R_W (0x74) pops a byte from the FIFO when read, the data registers change every sample.
+ *              Four "legacy driver" workloads, each run twice: without a prefetcher, and with one:
+ *                  1. IMU sample: INT_STATUS, then ACCEL/TEMP/GYRO 0x3B-0x48 one by one (SUS_I2C_ReadRegister),
+ *                  2. FIFO drain: FIFO_COUNT 0x72-0x73, then FIFO_R_W as many times as it says (SUS_I2C_ReadRegister_STATUS),
+ *                  3. Irregular: the driver reads 6, 14 or 2 data registers depending on the sample - the prefetcher guesses wrong some of the time,
+ *                  4. Read-modify-write: config registers 0x19-0x1C read, one written, read back (the write must not be hidden by a prefetched value).
+ *              Every value the driver gets is compared with what the device held at that moment, and INT_STATUS/FIFO_R_W must be read exactly as
+ *              often as the driver asks. Any difference fails the run.
+ *              Then two special cases: another task writes a data register while the burst is on the wire (the next read must see the write),
+ *              and the burst after a protected INT_STATUS read fails (INT_STATUS is cleared already: its value must still come back, with ESP_OK).
+ *              Bus time = simulated wire time + SUS_I2C_TRANSACTION_OVERHEAD_US per transaction (the ESP32 driver's time), like the other benchmarks.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_PrefetchBenchmark SUS_I2C_PrefetchBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_PrefetchBenchmark [bus speed in Hz (default 400000)]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_IMU           0x68
+#define BENCH_INT_STATUS    0x3A
+#define BENCH_DATA          0x3B        // 14 data registers: 0x3B - 0x48.
+#define BENCH_FIFO_COUNT    0x72
+#define BENCH_FIFO_R_W      0x74
+
+/*----- The device: INT_STATUS clears when read, FIFO_R_W pops. Counts how often the sensitive registers were really read. -----*/
+static uint8_t  benchFifo[1024];
+static size_t   benchFifoHead, benchFifoTail;
+static uint32_t benchStatusReads, benchFifoReads;      // Reads the device saw.
+static uint32_t benchStatusAsked, benchFifoAsked;      // Reads the driver asked for.
+static uint8_t  benchHookRegister;
+static void   (*benchHook)(struct SUS_SimDevice *device);      // Called once (then cleared) when benchHookRegister is read: the special cases hook in here.
+
+static uint8_t BenchImuRead(struct SUS_SimDevice *device, uint8_t registerAddress)
+{
+    if (benchHook && registerAddress == benchHookRegister) {
+        void (*hook)(struct SUS_SimDevice *device) = benchHook;
+        benchHook = NULL;
+        hook(device);
+    }
+    if (registerAddress == BENCH_INT_STATUS) {
+        uint8_t status = device->registers[BENCH_INT_STATUS];
+        device->registers[BENCH_INT_STATUS] = 0;
+        benchStatusReads++;
+        return status;
+    }
+    if (registerAddress == BENCH_FIFO_R_W) {
+        benchFifoReads++;
+        return benchFifoHead != benchFifoTail ? benchFifo[benchFifoTail++ % sizeof(benchFifo)] : 0xFF;
+    }
+    return device->registers[registerAddress];
+}
+
+static struct SUS_SimDevice *benchDevice;
+static uint32_t benchWrong;                 // Failed checks: values the driver got versus what the device held.
+static uint32_t benchReads;                 // Register reads the driver did.
+
+//The driver's sample period: 1 ms, longer than the prefetch window, like a real driver polling at 1 kHz.
+static void BenchWaitForSample(void)
+{
+    vTaskDelay(1);
+}
+
+//A new sample: new data, INT_STATUS set, and (for the FIFO workload) a few bytes more in the FIFO.
+static void BenchSample(int sample)
+{
+    for (int r = 0; r < 14; r++) benchDevice->registers[BENCH_DATA + r] = (uint8_t)(sample * 7 + r * 31);
+    benchDevice->registers[BENCH_INT_STATUS] = 0x01;
+    for (int b = 0; b < 1 + sample % 12; b++) benchFifo[benchFifoHead++ % sizeof(benchFifo)] = (uint8_t)(sample + b);
+    size_t count = benchFifoHead - benchFifoTail;
+    benchDevice->registers[BENCH_FIFO_COUNT] = count >> 8;
+    benchDevice->registers[BENCH_FIFO_COUNT + 1] = count & 0xFF;
+}
+
+//The legacy driver's read, checked against what the device holds right now (INT_STATUS and FIFO_R_W against what they must return).
+static uint8_t BenchRead(uint8_t registerAddress, bool statusApi)
+{
+    uint8_t expected = benchDevice->registers[registerAddress], value = 0;
+    if (registerAddress == BENCH_INT_STATUS) benchStatusAsked++;
+    if (registerAddress == BENCH_FIFO_R_W) {
+        expected = benchFifoHead != benchFifoTail ? benchFifo[benchFifoTail % sizeof(benchFifo)] : 0xFF;
+        benchFifoAsked++;
+    }
+    if (statusApi) { if (SUS_I2C_ReadRegister_STATUS(0, BENCH_IMU, registerAddress, &value) != ESP_OK) benchWrong++; }
+    else value = SUS_I2C_ReadRegister(0, BENCH_IMU, registerAddress);
+    if (value != expected) benchWrong++;
+    benchReads++;
+    return value;
+}
+
+/*----- The workloads. -----*/
+static void BenchImu(void)
+{
+    for (int sample = 0; sample < 300; sample++)
+    {
+        BenchWaitForSample();
+        BenchSample(sample);
+        if (BenchRead(BENCH_INT_STATUS, false) & 0x01)
+            for (int r = 0; r < 14; r++) BenchRead(BENCH_DATA + r, false);
+    }
+}
+
+static void BenchFifoDrain(void)
+{
+    for (int sample = 0; sample < 300; sample++)
+    {
+        BenchWaitForSample();
+        BenchSample(sample);
+        uint16_t count = (BenchRead(BENCH_FIFO_COUNT, true) << 8) | BenchRead(BENCH_FIFO_COUNT + 1, true);
+        for (uint16_t b = 0; b < count; b++) BenchRead(BENCH_FIFO_R_W, true);
+    }
+}
+
+static void BenchIrregular(void)
+{
+    static const int lengths[] = {6, 14, 6, 6, 2, 14, 6, 6};
+    for (int sample = 0; sample < 300; sample++)
+    {
+        BenchWaitForSample();
+        BenchSample(sample);
+        for (int r = 0; r < lengths[sample % 8]; r++) BenchRead(BENCH_DATA + r, false);
+    }
+}
+
+static void BenchReadModifyWrite(void)
+{
+    for (int round = 0; round < 300; round++)
+    {
+        BenchWaitForSample();
+        for (uint8_t r = 0x19; r <= 0x1C; r++) BenchRead(r, false);
+        if (SUS_I2C_WriteToRegister_STATUS(0, BENCH_IMU, 0x1B, (uint8_t)round) != ESP_OK) benchWrong++;
+        if (BenchRead(0x1B, false) != (uint8_t)round) benchWrong++;
+    }
+}
+
+/*----- Special cases: another task writes while the burst is on the wire, and a burst that fails after a protected trigger was read. -----*/
+static volatile bool benchWriterDone;
+static volatile uint8_t benchWriterValue;
+
+static void BenchWriter(void *argument)
+{
+    (void)argument;
+    if (SUS_I2C_WriteToRegister_STATUS(0, BENCH_IMU, BENCH_DATA + 5, benchWriterValue) != ESP_OK) benchWrong++;
+    benchWriterDone = true;
+    vTaskDelete(NULL);
+}
+
+//Inside the burst's transaction: start the writer and give it time to get as far as it can (the bus is taken until the burst ends).
+static void BenchStartWriter(struct SUS_SimDevice *device)
+{
+    (void)device;
+    xTaskCreate(BenchWriter, "writer", 4096, NULL, 5, NULL);
+    vTaskDelay(5);
+}
+
+//Inside the trigger's transaction: the next one (the burst) is not ACKed.
+static void BenchFailBurst(struct SUS_SimDevice *device)
+{
+    device->present = false;
+}
+
+static void BenchSpecialCases(void)
+{
+    struct SUS_I2C_Prefetcher prefetcher = {.I2CportNumber = 0, .I2CdeviceAddress = BENCH_IMU, .window_us = 2000};
+    uint32_t stale = 0, failed = 0, tested = 0, failTested = 0;
+
+    memset(benchDevice->registers, 0, sizeof(benchDevice->registers));
+    SUS_I2C_PrefetchInit(&prefetcher);
+    SUS_I2C_PrefetchProtect(&prefetcher, BENCH_INT_STATUS, 1);
+    for (int round = 0; round < 60; round++)
+    {
+        uint8_t value = 0;
+        vTaskDelay(5);                                              //Longer than the window: every round is a run of its own.
+        BenchSample(round);
+        if (round % 6 == 3) {                                   //Another task writes a data register while the burst is being read.
+            uint32_t prefetches = prefetcher.prefetches;
+            benchWriterDone = false;
+            benchWriterValue = (uint8_t)(0xA0 + round);
+            benchHookRegister = BENCH_DATA;
+            benchHook = BenchStartWriter;
+            SUS_I2C_ReadRegister_STATUS(0, BENCH_IMU, BENCH_INT_STATUS, &value);
+            if (benchHook == NULL) {                                //There was a burst and the writer ran.
+                while (!benchWriterDone) vTaskDelay(0);
+                if (prefetcher.prefetches != prefetches) tested++;
+                if (SUS_I2C_ReadRegister(0, BENCH_IMU, BENCH_DATA + 5) != benchWriterValue) stale++;
+            }
+            benchHook = NULL;
+        }
+        else if (round % 6 == 0 && round > 0) {                                  //The burst after the protected trigger fails: the trigger is still answered.
+            uint8_t expected = benchDevice->registers[BENCH_INT_STATUS];
+            benchHookRegister = BENCH_INT_STATUS;
+            benchHook = BenchFailBurst;
+            uint64_t transactions = SUS_SimBus_Port[0].transactions;
+            esp_err_t outcome = SUS_I2C_ReadRegister_STATUS(0, BENCH_IMU, BENCH_INT_STATUS, &value);
+            benchDevice->present = true;
+            if (SUS_SimBus_Port[0].transactions - transactions > 1) failTested++;     //The burst was tried.
+            if (outcome != ESP_OK || value != expected) failed++;
+        }
+        else SUS_I2C_ReadRegister_STATUS(0, BENCH_IMU, BENCH_INT_STATUS, &value);
+        for (int r = 0; r < 14; r++) SUS_I2C_ReadRegister(0, BENCH_IMU, BENCH_DATA + r);
+    }
+    SUS_I2C_PrefetchRemove(&prefetcher);
+    printf("\nTwo tasks: %lu writes while the burst was on the wire, %lu later reads saw the old value%s\n", (unsigned long)tested, (unsigned long)stale,
+           stale || tested == 0 ? "   WRONG" : "");
+    printf("Protected trigger read, then the burst failed: %lu times, %lu trigger reads lost their value%s\n", (unsigned long)failTested, (unsigned long)failed,
+           failed || failTested == 0 ? "   WRONG" : "");
+    benchWrong += stale + failed + (tested == 0) + (failTested == 0);
+}
+
+struct BenchWorkload
+{
+    const char *name;
+    void     (*run)(void);
+};
+
+static const struct BenchWorkload benchWorkload[] = {
+    {"IMU: status + 14 data regs", BenchImu},
+    {"FIFO count + drain",         BenchFifoDrain},
+    {"Irregular lengths",          BenchIrregular},
+    {"Config read-modify-write",   BenchReadModifyWrite},
+};
+
+struct BenchResult { uint64_t transactions, bus_us; };
+
+static struct BenchResult BenchRun(const struct BenchWorkload *workload)
+{
+    uint64_t transactions = SUS_SimBus_Port[0].transactions, busTime_ns = SUS_SimBus_Port[0].busTime_ns;
+
+    memset(benchDevice->registers, 0, sizeof(benchDevice->registers));
+    benchFifoHead = benchFifoTail = 0;
+    benchStatusReads = benchFifoReads = benchStatusAsked = benchFifoAsked = benchReads = 0;
+    workload->run();
+    if (benchStatusReads != benchStatusAsked || benchFifoReads != benchFifoAsked) benchWrong++;    //A read-sensitive register was read ahead.
+
+    struct BenchResult result = {SUS_SimBus_Port[0].transactions - transactions, 0};
+    result.bus_us = (SUS_SimBus_Port[0].busTime_ns - busTime_ns) / 1000 + result.transactions * SUS_I2C_TRANSACTION_OVERHEAD_US;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int speed = argc > 1 ? atoi(argv[1]) : 400000;
+
+    if (speed <= 0) {
+        printf("Usage: %s [bus speed in Hz]\n", argv[0]);
+        return 1;
+    }
+    SUS_Sim_LogLevel = 1;       //Errors only.
+    SUS_SimBus_Init(0, speed, false);
+    benchDevice = SUS_SimBus_AddDevice(0, BENCH_IMU);
+    benchDevice->onRead = BenchImuRead;
+    SUS_I2C_Master_Init(0, 22, 21, speed);
+
+    printf("\n%d Hz. Bus time = wire time + %d us driver time per transaction.\n\n", speed, SUS_I2C_TRANSACTION_OVERHEAD_US);
+    printf("%-28s %7s %9s %9s %10s %10s %8s %9s %9s %7s\n", "workload", "reads", "tx plain", "tx pref.", "plain us", "pref. us", "saved", "hit rate", "fetched", "wasted");
+    for (size_t w = 0; w < sizeof(benchWorkload) / sizeof(benchWorkload[0]); w++)
+    {
+        const struct BenchWorkload *workload = &benchWorkload[w];
+        struct SUS_I2C_Prefetcher prefetcher = {.I2CportNumber = 0, .I2CdeviceAddress = BENCH_IMU, .window_us = 500};
+        uint32_t wrongBefore = benchWrong;
+
+        struct BenchResult plain = BenchRun(workload);
+        if (SUS_I2C_PrefetchInit(&prefetcher) != ESP_OK) {
+            printf("Prefetcher setup failed.\n");
+            return 1;
+        }
+        SUS_I2C_PrefetchProtect(&prefetcher, BENCH_INT_STATUS, 1);
+        SUS_I2C_PrefetchProtect(&prefetcher, BENCH_FIFO_R_W, 1);
+        struct BenchResult prefetched = BenchRun(workload);
+        printf("%-28s %7lu %9llu %9llu %10llu %10llu %7.1f%% %8.1f%% %9lu %7lu%s\n", workload->name, (unsigned long)benchReads,
+               (unsigned long long)plain.transactions, (unsigned long long)prefetched.transactions, (unsigned long long)plain.bus_us,
+               (unsigned long long)prefetched.bus_us, 100.0 * (1.0 - (double)prefetched.bus_us / plain.bus_us), 100.0 * prefetcher.hits / prefetcher.reads,
+               (unsigned long)prefetcher.bytesPrefetched, (unsigned long)prefetcher.bytesWasted, benchWrong != wrongBefore ? "   WRONG" : "");
+        if (w == 0) {
+            printf("\nThe library's own report for the first one:\n");
+            SUS_Sim_LogLevel = 3;
+            SUS_I2C_PrefetchPrintReport(&prefetcher);
+            SUS_Sim_LogLevel = 1;
+            printf("\n");
+        }
+        SUS_I2C_PrefetchRemove(&prefetcher);
+    }
+
+    BenchSpecialCases();
+
+    printf("\nChecks where the driver got something else than the device held, or a read-sensitive register was read ahead: %lu\n", (unsigned long)benchWrong);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    return (benchWrong == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
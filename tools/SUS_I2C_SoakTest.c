@@ -0,0 +1,1063 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_SoakTest.c
+ *
+ *    Brief:    Fault-injection soak test: drives SUS_I2Cmaster_FULL.h through millions of operations on a misbehaving bus and reports how it copes.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against two simulated I2C buses (sim/SUS_I2C_SimBus.h) that NACK, time out
+ *              and get SDA stuck LOW with the given probabilities per transaction. Workloads, all at the same time:
+ *                  - port 0, foreground: a random mix of the core read/write/_STATUS/batch/ping/scan functions, every SMBus command, the register map,
+ *                    chunked transfers, snapshots, SetSpeed/CalibrateSpeed, a budgeted device (with BudgetGetUsage) and the trace recorder
+ *                    (dump, stop, clear), called like an application would. After two timeouts in a row the "application" resets the bus (SUS_I2C_ResetBus).
+ *                  - port 1, background: periodic scheduler jobs, the presence monitor and the ISR worker (fed by a task that submits every ms).
+ *                    All of them are stopped and started again every "restart" operations, to catch leaks in start/stop.
+ *                  - at the end: every Print/Report function while the background engines still run, then dual port engine start/stop cycles on both ports,
+ *                    then two tasks sharing one device that has a combiner AND a prefetcher (combined writes vs. prefetched reads - their locks must not deadlock).
+ *              NOT in the soak beyond that: the display, boot, decode, combine, prefetch, coroutine, warm-boot and frame APIs. Each of them has its own
+ *              benchmark in this folder that checks it on the simulated bus.
+ *              The foreground bus does not wait for the wire (simulated time only), so millions of operations take seconds, not hours.
+ *              Latency of an operation = its simulated wire time (timeouts count as 10 ms, like the library's 10 tick timeout) + the CPU time it took on the host.
+ *              The same workload runs twice: fault-free first (the baseline, also the warm-up), then with faults.
+ *
+ *              Printed report:
+ *                  - per function: calls, success rate, p50/p99/max latency
+ *                  - effective throughput (successful operations per second of simulated time), relative to the fault-free baseline
+ *                  - recovery: time and operations from the first failure to the next success, per kind of fault; bus resets needed
+ *                  - background engines: samples, errors, ISR requests, presence changes
+ *                  - heap: high-water mark and what is still allocated after everything was stopped (malloc/calloc/realloc/free are wrapped)
+ *                  - command links created but never deleted, reads that "succeeded" with wrong data
+ *              Exit code 0 = PASS (no leaks, no wrong data), 1 = FAIL. Gate upgrades on it.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free -o SUS_I2C_SoakTest SUS_I2C_SoakTest.c -lpthread
+ *              (or the SUS_I2C_SoakTest target of the CMake build)
+ *    Usage:    ./SUS_I2C_SoakTest [--ops 1000000] [--nack 0.01] [--timeout 0.01] [--stuck 0.01] [--speed 400000] [--restart 100000] [--seed 1]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+/*----- Heap accounting: every allocation of the library and of the simulated FreeRTOS/driver goes through here (linker --wrap). -----*/
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void __real_free(void *pointer);
+
+#define SOAK_HEAP_HEADER 16                     // Size of the block is kept in front of it. 16 keeps the alignment malloc promises.
+static long soakHeapInUse, soakHeapPeak, soakHeapAllocations;
+
+static void SoakHeapAdd(long bytes)
+{
+    long now = __atomic_add_fetch(&soakHeapInUse, bytes, __ATOMIC_RELAXED);
+    long peak = __atomic_load_n(&soakHeapPeak, __ATOMIC_RELAXED);
+    while (now > peak && !__atomic_compare_exchange_n(&soakHeapPeak, &peak, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+void *__wrap_malloc(size_t size)
+{
+    uint8_t *block = __real_malloc(size + SOAK_HEAP_HEADER);
+    if (block == NULL) return NULL;
+    *(size_t *)block = size;
+    SoakHeapAdd((long)size);
+    __atomic_add_fetch(&soakHeapAllocations, 1, __ATOMIC_RELAXED);
+    return block + SOAK_HEAP_HEADER;
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    void *pointer = __wrap_malloc(count * size);
+    if (pointer) memset(pointer, 0, count * size);
+    return pointer;
+}
+
+void __wrap_free(void *pointer)
+{
+    if (pointer == NULL) return;
+    uint8_t *block = (uint8_t *)pointer - SOAK_HEAP_HEADER;
+    SoakHeapAdd(-(long)*(size_t *)block);
+    __real_free(block);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    if (pointer == NULL) return __wrap_malloc(size);
+    uint8_t *block = (uint8_t *)pointer - SOAK_HEAP_HEADER;
+    size_t oldSize = *(size_t *)block;
+    block = __real_realloc(block, size + SOAK_HEAP_HEADER);
+    if (block == NULL) return NULL;
+    *(size_t *)block = size;
+    SoakHeapAdd((long)size - (long)oldSize);
+    return block + SOAK_HEAP_HEADER;
+}
+
+/*----- The simulated devices. Registers 0x00-0x7F hold a fixed pattern (checked on every successful read), 0x80-0xFF are scratch for writes.
+ * Register 0x00 holds 0: SUS_I2C_PingAddress() and SUS_I2C_ScanForDevices() write 0 into it. -----*/
+#define SOAK_IMU            0x68                // Register burst reads, register map.
+#define SOAK_EEPROM         0x50                // Chunked transfers.
+#define SOAK_SMBUS          0x0B                // SMBus commands.
+#define SOAK_BUDGETED       0x3C                // Has a bandwidth budget with the REJECT policy.
+#define SOAK_SNAP_A         0x2A                // Snapshot pair.
+#define SOAK_SNAP_B         0x2B
+#define SOAK_BLOCK_REGISTER 0x70                // SMBus block read: count byte here, data after it.
+#define SOAK_BLOCK_LENGTH   5
+static const uint8_t soakDevices[] = {SOAK_IMU, SOAK_EEPROM, SOAK_SMBUS, SOAK_BUDGETED, SOAK_SNAP_A, SOAK_SNAP_B};
+
+static uint8_t SoakPattern(uint8_t address, uint8_t registerAddress)
+{
+    if (registerAddress == 0x00) return 0;
+    if (registerAddress == SOAK_BLOCK_REGISTER) return SOAK_BLOCK_LENGTH;
+    return (uint8_t)(address * 7 + registerAddress * 13 + 1);
+}
+
+static bool SoakPatternMatches(uint8_t address, uint8_t startRegister, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        if (data[i] != SoakPattern(address, (uint8_t)(startRegister + i))) return false;
+    return true;
+}
+
+static void SoakWireDevices(int port)
+{
+    for (size_t d = 0; d < sizeof(soakDevices); d++)
+    {
+        struct SUS_SimDevice *device = SUS_SimBus_AddDevice(port, soakDevices[d]);
+        for (int r = 0; r < 0x80; r++) device->registers[r] = SoakPattern(soakDevices[d], (uint8_t)r);
+    }
+}
+
+#if SUS_I2C_FEATURE_REGISTER_MAP
+#define SOAK_REGISTERS(REG) \
+    REG(SOAKDEV, ID,      0x00, uint8_t,  SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE) \
+    REG(SOAKDEV, VALUE16, 0x10, int16_t,  SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE | SUS_I2C_REG_BIG_ENDIAN) \
+    REG(SOAKDEV, VALUE32, 0x12, uint32_t, SUS_I2C_REG_RO | SUS_I2C_REG_VOLATILE) \
+    REG(SOAKDEV, CONTROL, 0x90, uint8_t,  SUS_I2C_REG_RW)
+#define SOAK_FIELDS(FIELD) \
+    FIELD(SOAKDEV, MODE, CONTROL, 4, 3)
+SUS_I2C_DEFINE_DEVICE_MAP(SOAKDEV, SOAK_REGISTERS, SOAK_FIELDS, 0x00)
+#endif
+
+/*----- Foreground operations -----*/
+struct SoakLatencies
+{
+    uint32_t *value_ns;
+    size_t count, capacity;
+};
+
+struct SoakOperation
+{
+    const char *name;
+    uint32_t weight;                            // Relative frequency in the mix.
+    esp_err_t (*run)(void);
+    uint64_t calls, failures, refused;
+    struct SoakLatencies latency;
+};
+
+static FILE *soakOut;                           // The report. stdout itself is sent to /dev/null: the library printf()s on every ping, scan and array write.
+static uint32_t soakRandomState = 1;
+static uint64_t soakWrongData;                  // "Successful" reads that returned something else than the device holds.
+static struct SUS_I2C_Device soakImu;
+static uint8_t soakScratch[64];
+
+static uint32_t SoakRandom(void)
+{
+    soakRandomState ^= soakRandomState << 13;
+    soakRandomState ^= soakRandomState >> 17;
+    soakRandomState ^= soakRandomState << 5;
+    return soakRandomState;
+}
+
+//For the functions that return nothing: what happened on the wire during the call.
+static esp_err_t SoakWireOutcome(uint64_t errorsBefore)
+{
+    if (SUS_SimBus_Port[0].errors == errorsBefore) return ESP_OK;
+    return SUS_SimBus_Port[0].lastResult == SUS_SIMBUS_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+}
+
+static void SoakCheck(bool correct) { if (!correct) soakWrongData++; }
+
+static esp_err_t SoakReadRegister(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = SoakRandom() & 0x3F;
+    uint8_t value = SUS_I2C_ReadRegister(0, SOAK_IMU, reg);
+    esp_err_t outcome = SoakWireOutcome(errors);
+    if (outcome == ESP_OK) SoakCheck(value == SoakPattern(SOAK_IMU, reg));
+    return outcome;
+}
+
+static esp_err_t SoakReadRegisterEZ(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = SoakRandom() & 0x3F;
+    uint8_t value = SUS_I2C_ReadRegister_EZ(0, SOAK_IMU, reg);
+    esp_err_t outcome = SoakWireOutcome(errors);
+    if (outcome == ESP_OK) SoakCheck(value == SoakPattern(SOAK_IMU, reg));
+    return outcome;
+}
+
+static esp_err_t SoakReadByte(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_I2C_ReadByteFromSlave(0, SOAK_IMU);
+    return SoakWireOutcome(errors);
+}
+
+static esp_err_t SoakReadByteEZ(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_I2C_ReadByteFromSlave_EZ(0, SOAK_IMU);
+    return SoakWireOutcome(errors);
+}
+
+static esp_err_t SoakReadRegisters(void)
+{
+    uint8_t data[14];
+    uint8_t reg = SoakRandom() & 0x3F;
+    esp_err_t outcome = SUS_I2C_ReadRegisters(0, SOAK_IMU, reg, data, sizeof(data));
+    if (outcome == ESP_OK) SoakCheck(SoakPatternMatches(SOAK_IMU, reg, data, sizeof(data)));
+    return outcome;
+}
+
+static esp_err_t SoakWriteToRegister(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = 0x80 | (SoakRandom() & 0x3F), value = (uint8_t)SoakRandom();
+    SUS_I2C_WriteToRegister(0, SOAK_IMU, reg, value);
+    esp_err_t outcome = SoakWireOutcome(errors);
+    if (outcome == ESP_OK) SoakCheck(SUS_SimBus_Port[0].device[SOAK_IMU].registers[reg] == value);
+    return outcome;
+}
+
+static esp_err_t SoakWriteToRegisterEX(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = 0x80 | (SoakRandom() & 0x3F), value = (uint8_t)SoakRandom();
+    SUS_I2C_WriteToRegister_EX(0, SOAK_IMU, reg, value);
+    esp_err_t outcome = SoakWireOutcome(errors);
+    if (outcome == ESP_OK) SoakCheck(SUS_SimBus_Port[0].device[SOAK_IMU].registers[reg] == value);
+    return outcome;
+}
+
+static esp_err_t SoakWriteToRegisterEZ(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = 0x80 | (SoakRandom() & 0x3F), value = (uint8_t)SoakRandom();
+    SUS_I2C_WriteToRegister_EZ(0, SOAK_IMU, reg, value);
+    esp_err_t outcome = SoakWireOutcome(errors);
+    if (outcome == ESP_OK) SoakCheck(SUS_SimBus_Port[0].device[SOAK_IMU].registers[reg] == value);
+    return outcome;
+}
+
+static esp_err_t SoakWriteByte(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_I2C_WriteByteToSlave(0, SOAK_IMU, 0x80 | (SoakRandom() & 0x3F));
+    return SoakWireOutcome(errors);
+}
+
+static esp_err_t SoakWriteByteEZ(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_I2C_WriteByteToSlave_EZ(0, SOAK_IMU, 0x80 | (SoakRandom() & 0x3F));
+    return SoakWireOutcome(errors);
+}
+
+static esp_err_t SoakWriteByteArray(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t values[5] = {0x80 | (SoakRandom() & 0x3F), 1, 2, 3, 4};     //First byte = register pointer, the rest land there.
+    SUS_I2C_WriteByteArrayToSlave_EZ(0, SOAK_IMU, values, sizeof(values));
+    esp_err_t outcome = SoakWireOutcome(errors);
+    if (outcome == ESP_OK) SoakCheck(memcmp(&SUS_SimBus_Port[0].device[SOAK_IMU].registers[values[0]], &values[1], 4) == 0);
+    return outcome;
+}
+
+static esp_err_t SoakWriteRegisters(void)
+{
+    uint8_t values[8];
+    uint8_t reg = 0x80 | (SoakRandom() & 0x3F);
+    for (size_t i = 0; i < sizeof(values); i++) values[i] = (uint8_t)SoakRandom();
+    esp_err_t outcome = SUS_I2C_WriteRegisters(0, SOAK_IMU, reg, values, sizeof(values));
+    if (outcome == ESP_OK) SoakCheck(memcmp(&SUS_SimBus_Port[0].device[SOAK_IMU].registers[reg], values, sizeof(values)) == 0);
+    return outcome;
+}
+
+//_STATUS functions: the returned outcome has to match what happened on the wire, and a failed read must leave the caller's variable alone.
+static esp_err_t SoakReadRegisterSTATUS(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = SoakRandom() & 0x3F;
+    uint8_t untouched = (uint8_t)~SoakPattern(SOAK_IMU, reg), value = untouched;
+    esp_err_t outcome = SUS_I2C_ReadRegister_STATUS(0, SOAK_IMU, reg, &value);
+    SoakCheck(outcome == SoakWireOutcome(errors));
+    SoakCheck(outcome == ESP_OK ? value == SoakPattern(SOAK_IMU, reg) : value == untouched);
+    return outcome;
+}
+
+static esp_err_t SoakWriteToRegisterEXSTATUS(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t reg = 0x80 | (SoakRandom() & 0x3F), value = (uint8_t)SoakRandom(), readBack;
+    esp_err_t outcome = SUS_I2C_WriteToRegister_EX_STATUS(0, SOAK_IMU, reg, value, &readBack);
+    SoakCheck(outcome == SoakWireOutcome(errors));
+    if (outcome == ESP_OK) SoakCheck(readBack == value && SUS_SimBus_Port[0].device[SOAK_IMU].registers[reg] == value);
+    return outcome;
+}
+
+static esp_err_t SoakWriteByteArraySTATUS(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    uint8_t values[5] = {0x80 | (SoakRandom() & 0x3F), 5, 6, 7, 8};     //First byte = register pointer, the rest land there.
+    esp_err_t outcome = SUS_I2C_WriteByteArrayToSlave_STATUS(0, SOAK_IMU, values, sizeof(values));
+    SoakCheck(outcome == SoakWireOutcome(errors));
+    if (outcome == ESP_OK) SoakCheck(memcmp(&SUS_SimBus_Port[0].device[SOAK_IMU].registers[values[0]], &values[1], 4) == 0);
+    return outcome;
+}
+
+static esp_err_t SoakPingSTATUS(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    esp_err_t outcome = SUS_I2C_PingAddress_STATUS(0, SOAK_IMU);
+    SoakCheck(outcome == SoakWireOutcome(errors));
+    return outcome;
+}
+
+static esp_err_t SoakBatchSTATUS(void)
+{
+    uint8_t readA[4], readB[2], written[3];
+    uint8_t regA = SoakRandom() & 0x3F, regB = SoakRandom() & 0x3F, regW = 0x80 | (SoakRandom() & 0x3F);
+    for (size_t i = 0; i < sizeof(written); i++) written[i] = (uint8_t)SoakRandom();
+    struct SUS_I2C_BatchItem batch[3] = {{.I2CdeviceAddress = SOAK_IMU, .direction = SUS_I2C_BATCH_READ,  .registerAddress = regA, .data = readA,   .length = sizeof(readA)},
+                                         {.I2CdeviceAddress = SOAK_IMU, .direction = SUS_I2C_BATCH_WRITE, .registerAddress = regW, .data = written, .length = sizeof(written)},
+                                         {.I2CdeviceAddress = SOAK_IMU, .direction = SUS_I2C_BATCH_READ,  .registerAddress = regB, .data = readB,   .length = sizeof(readB)}};
+    size_t failed = 0, counted = 0;
+    esp_err_t outcome = SUS_I2C_Batch_STATUS(0, batch, 3, &failed);
+    for (size_t i = 0; i < 3; i++) if (batch[i].outcome != ESP_OK) counted++;
+    SoakCheck(failed == counted && (outcome == ESP_OK) == (counted == 0));
+    if (batch[0].outcome == ESP_OK) SoakCheck(SoakPatternMatches(SOAK_IMU, regA, readA, sizeof(readA)));
+    if (batch[1].outcome == ESP_OK) SoakCheck(memcmp(&SUS_SimBus_Port[0].device[SOAK_IMU].registers[regW], written, sizeof(written)) == 0);
+    if (batch[2].outcome == ESP_OK) SoakCheck(SoakPatternMatches(SOAK_IMU, regB, readB, sizeof(readB)));
+    return outcome;
+}
+
+static esp_err_t SoakRawWrite(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_I2C_WriteByteToBus_RAW(0, SOAK_IMU << 1);       //Address byte only: the device ACKs, nothing else happens.
+    return SoakWireOutcome(errors);
+}
+
+static esp_err_t SoakPing(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_I2C_PingAddress(0, SOAK_IMU);
+    return SoakWireOutcome(errors);
+}
+
+static esp_err_t SoakScan(void)
+{
+    uint64_t errors = SUS_SimBus_Port[0].errors;
+    SUS_SimBus_Port[0].lastResult = SUS_SIMBUS_OK;
+    SUS_I2C_ScanForDevices(0);
+    //Empty addresses NACK by design - only timeouts count as a failed scan.
+    return (SUS_SimBus_Port[0].errors != errors && SUS_SimBus_Port[0].stuck) ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+#if SUS_I2C_FEATURE_SMBUS
+static esp_err_t SoakSMBus(void)
+{
+    uint8_t command = SoakRandom() & 0x3F, byte, block[32], length;
+    uint16_t word;
+    esp_err_t outcome;
+    switch (SoakRandom() % 10)
+    {
+    case 0:
+        outcome = SUS_I2C_SMBusReadWord(0, SOAK_SMBUS, command, &word, false);
+        if (outcome == ESP_OK) SoakCheck(word == (SoakPattern(SOAK_SMBUS, command) | (SoakPattern(SOAK_SMBUS, command + 1) << 8)));
+        return outcome;
+    case 1:
+        outcome = SUS_I2C_SMBusReadByte(0, SOAK_SMBUS, command, &byte, false);
+        if (outcome == ESP_OK) SoakCheck(byte == SoakPattern(SOAK_SMBUS, command));
+        return outcome;
+    case 2:
+        return SUS_I2C_SMBusWriteWord(0, SOAK_SMBUS, 0x80 | command, (uint16_t)SoakRandom(), true);
+    case 3:
+        return SUS_I2C_SMBusQuick(0, SOAK_SMBUS, false);
+    case 4:
+        return SUS_I2C_SMBusProcessCall(0, SOAK_SMBUS, 0x80 | command, (uint16_t)SoakRandom(), &word, false);
+    case 5:                                                     //Send Byte sets the register pointer, Receive Byte reads from there.
+        outcome = SUS_I2C_SMBusSendByte(0, SOAK_SMBUS, command, false);
+        if (outcome == ESP_OK) outcome = SUS_I2C_SMBusReceiveByte(0, SOAK_SMBUS, &byte, false);
+        if (outcome == ESP_OK) SoakCheck(byte == SoakPattern(SOAK_SMBUS, command));
+        return outcome;
+    case 6:
+        byte = (uint8_t)SoakRandom();
+        outcome = SUS_I2C_SMBusWriteByte(0, SOAK_SMBUS, 0x80 | command, byte, false);
+        if (outcome == ESP_OK) SoakCheck(SUS_SimBus_Port[0].device[SOAK_SMBUS].registers[0x80 | command] == byte);
+        return outcome;
+    case 7:                                                     //The device sees the count byte at "command", the data after it.
+        for (int i = 0; i < 4; i++) block[i] = (uint8_t)SoakRandom();
+        outcome = SUS_I2C_SMBusBlockWrite(0, SOAK_SMBUS, 0x80 | command, block, 4, false);
+        if (outcome == ESP_OK) SoakCheck(SUS_SimBus_Port[0].device[SOAK_SMBUS].registers[0x80 | command] == 4 &&
+                                         memcmp(&SUS_SimBus_Port[0].device[SOAK_SMBUS].registers[(0x80 | command) + 1], block, 4) == 0);
+        return outcome;
+    default:
+        outcome = SUS_I2C_SMBusBlockRead(0, SOAK_SMBUS, SOAK_BLOCK_REGISTER, block, sizeof(block), &length, false);
+        if (outcome == ESP_OK) SoakCheck(length == SOAK_BLOCK_LENGTH && SoakPatternMatches(SOAK_SMBUS, SOAK_BLOCK_REGISTER + 1, block, length));
+        return outcome;
+    }
+}
+#endif
+
+#if SUS_I2C_FEATURE_REGISTER_MAP
+static esp_err_t SoakMap(void)
+{
+    static const uint8_t ids[] = {SOAKDEV_ID, SOAKDEV_VALUE16, SOAKDEV_VALUE32};
+    uint32_t values[3], mode;
+    esp_err_t outcome;
+    if (SoakRandom() & 1) return SOAKDEV_Set_MODE(&soakImu, SoakRandom() & 7);
+    outcome = SUS_I2C_MapReadMany(&soakImu, ids, 3, values);
+    if (outcome == ESP_OK)
+    {
+        uint8_t raw[6];
+        for (int i = 0; i < 6; i++) raw[i] = SoakPattern(SOAK_IMU, 0x10 + i);
+        SoakCheck(values[0] == SoakPattern(SOAK_IMU, 0x00) && values[1] == (uint32_t)((raw[0] << 8) | raw[1]) &&
+                  values[2] == (uint32_t)(raw[2] | (raw[3] << 8) | (raw[4] << 16) | ((uint32_t)raw[5] << 24)));
+    }
+    if (outcome == ESP_OK) outcome = SOAKDEV_Get_MODE(&soakImu, &mode);
+    return outcome;
+}
+#endif
+
+#if SUS_I2C_FEATURE_PRIORITY
+static esp_err_t SoakChunked(void)
+{
+    uint8_t readBack[sizeof(soakScratch)];
+    struct SUS_I2C_ChunkedTransfer transfer = {.I2CportNumber = 0, .I2CdeviceAddress = SOAK_EEPROM, .priority = SUS_I2C_PRIORITY_BULK,
+                                               .data = soakScratch, .length = sizeof(soakScratch), .chunkSize = 16, .pageSize = 32,
+                                               .addressBytes = 1, .memoryAddress = 0x80};
+    for (size_t i = 0; i < sizeof(soakScratch); i++) soakScratch[i] = (uint8_t)SoakRandom();
+    esp_err_t outcome = SUS_I2C_TransferChunked(&transfer);
+    if (outcome != ESP_OK) return outcome;
+    transfer.read = true;
+    transfer.data = readBack;
+    outcome = SUS_I2C_TransferChunked(&transfer);
+    if (outcome == ESP_OK) SoakCheck(memcmp(readBack, soakScratch, sizeof(readBack)) == 0);
+    return outcome;
+}
+#endif
+
+#if SUS_I2C_FEATURE_SNAPSHOT
+static esp_err_t SoakSnapshot(void)
+{
+    uint8_t data[2][6];
+    struct SUS_I2C_SnapshotDevice device[2] = {
+        {.I2CdeviceAddress = SOAK_SNAP_A, .trigger = {0x90, 0x01}, .triggerLength = 2, .startRegisterAddress = 0x20, .readBuffer = data[0], .amountOfBytesToRead = 6},
+        {.I2CdeviceAddress = SOAK_SNAP_B, .trigger = {0x90, 0x01}, .triggerLength = 2, .startRegisterAddress = 0x20, .readBuffer = data[1], .amountOfBytesToRead = 6}};
+    struct SUS_I2C_Snapshot snapshot = {.I2CportNumber = 0, .priority = SUS_I2C_PRIORITY_HIGH, .deviceCount = 2, .device = device};
+    esp_err_t outcome = SUS_I2C_Snapshot(&snapshot);
+    if (outcome == ESP_OK) SoakCheck(SoakPatternMatches(SOAK_SNAP_A, 0x20, data[0], 6) && SoakPatternMatches(SOAK_SNAP_B, 0x20, data[1], 6));
+    return outcome;
+}
+#endif
+
+#if SUS_I2C_FEATURE_SPEED
+//Also the edges: one Hz below SUS_I2C_MIN_SPEED (timing fields would overflow) and above SUS_I2C_MAX_SPEED are refused without touching the port,
+//SUS_I2C_MIN_SPEED itself goes through (the simulated driver refuses values that don't fit their fields, like ESP-IDF).
+static esp_err_t SoakSetSpeed(void)
+{
+    static bool fast;
+    int speed = SUS_I2C_PortSpeedHz[0], clockHz = SUS_SimBus_Port[0].clockHz;
+    SoakCheck(SUS_I2C_SetSpeed(0, SUS_I2C_MIN_SPEED - 1) == ESP_ERR_INVALID_ARG && SUS_I2C_SetSpeed(0, SUS_I2C_MAX_SPEED + 1) == ESP_ERR_INVALID_ARG);
+    SoakCheck(SUS_I2C_PortSpeedHz[0] == speed && SUS_SimBus_Port[0].clockHz == clockHz);
+    SoakCheck(SUS_I2C_SetSpeed(0, SUS_I2C_MIN_SPEED) == ESP_OK && SUS_I2C_PortSpeedHz[0] == SUS_I2C_MIN_SPEED);
+    fast = !fast;
+    return SUS_I2C_SetSpeed(0, fast ? 1000000 : SUS_SimBus_Port[1].clockHz);    //Port 1 keeps the speed given on the command line.
+}
+
+//Measure only (apply = false): whatever the faults do to the steps, the port must come back at the speed it had.
+static esp_err_t SoakCalibrateSpeed(void)
+{
+    static const struct SUS_I2C_CalibrationTarget target[2] = {{SOAK_IMU, 0x20, 8}, {SOAK_EEPROM, 0x00, 8}};
+    struct SUS_I2C_CalibrationConfig config = {.target = target, .targetCount = 2, .startSpeed = 100000, .maxSpeed = 400000, .stepSpeed = 150000,
+                                               .transactionsPerStep = 30, .maxErrorRate = 0.2f, .safetyMargin = 0.25f, .apply = false};
+    int speed = SUS_I2C_PortSpeedHz[0];
+    esp_err_t outcome = SUS_I2C_CalibrateSpeed(0, &config, NULL);
+    SoakCheck(SUS_I2C_PortSpeedHz[0] == speed);
+    return outcome;
+}
+#endif
+
+#if SUS_I2C_FEATURE_BUDGET
+static esp_err_t SoakBudgeted(void)
+{
+    uint8_t data[4];
+    struct SUS_I2C_BudgetUsage usage;
+    esp_err_t outcome = SUS_I2C_ReadRegisters(0, SOAK_BUDGETED, 0x00, data, sizeof(data));
+    if (outcome == ESP_OK) SoakCheck(SoakPatternMatches(SOAK_BUDGETED, 0x00, data, sizeof(data)));
+    SoakCheck(SUS_I2C_BudgetGetUsage(0, SOAK_BUDGETED, &usage) == ESP_OK && usage.budgeted);
+    return outcome;
+}
+#endif
+
+#if SUS_I2C_FEATURE_TRACE
+static esp_err_t SoakTraceDump(void)
+{
+    if (SoakRandom() % 4 == 0) {                                //Now and then: stop, empty the ring and start again, like an application taking a fresh trace.
+        SUS_I2C_TraceStop();
+        SUS_I2C_TraceClear();
+        SUS_I2C_TraceStart();
+    }
+    size_t size = SUS_I2C_TraceDumpSize();
+    uint8_t *blob = malloc(size);
+    if (blob == NULL) return ESP_ERR_NO_MEM;
+    size_t written = SUS_I2C_TraceDump(blob, size);
+    free(blob);
+    return written ? ESP_OK : ESP_FAIL;
+}
+#endif
+
+static struct SoakOperation soakOperation[] = {
+    {.name = "ReadRegister",              .weight =  60, .run = SoakReadRegister},
+    {.name = "ReadRegister_EZ",           .weight =  60, .run = SoakReadRegisterEZ},
+    {.name = "ReadByteFromSlave",         .weight =  20, .run = SoakReadByte},
+    {.name = "ReadByteFromSlave_EZ",      .weight =  20, .run = SoakReadByteEZ},
+    {.name = "ReadRegisters",             .weight = 120, .run = SoakReadRegisters},
+    {.name = "WriteToRegister",           .weight =  40, .run = SoakWriteToRegister},
+    {.name = "WriteToRegister_EX",        .weight =  20, .run = SoakWriteToRegisterEX},
+    {.name = "WriteToRegister_EZ",        .weight =  40, .run = SoakWriteToRegisterEZ},
+    {.name = "WriteByteToSlave",          .weight =  20, .run = SoakWriteByte},
+    {.name = "WriteByteToSlave_EZ",       .weight =  20, .run = SoakWriteByteEZ},
+    {.name = "WriteByteArrayToSlave_EZ",  .weight =  20, .run = SoakWriteByteArray},
+    {.name = "WriteRegisters",            .weight =  60, .run = SoakWriteRegisters},
+    {.name = "ReadRegister_STATUS",       .weight =  40, .run = SoakReadRegisterSTATUS},
+    {.name = "WriteToRegister_EX_STATUS", .weight =  20, .run = SoakWriteToRegisterEXSTATUS},
+    {.name = "WriteByteArray_STATUS",     .weight =  20, .run = SoakWriteByteArraySTATUS},
+    {.name = "PingAddress_STATUS",        .weight =  10, .run = SoakPingSTATUS},
+    {.name = "Batch_STATUS",              .weight =  20, .run = SoakBatchSTATUS},
+    {.name = "WriteByteToBus_RAW",        .weight =   5, .run = SoakRawWrite},
+    {.name = "PingAddress",               .weight =  10, .run = SoakPing},
+    {.name = "ScanForDevices",            .weight =   1, .run = SoakScan},
+#if SUS_I2C_FEATURE_SMBUS
+    {.name = "SMBus*",                    .weight =  60, .run = SoakSMBus},
+#endif
+#if SUS_I2C_FEATURE_REGISTER_MAP
+    {.name = "Map*",                      .weight =  40, .run = SoakMap},
+#endif
+#if SUS_I2C_FEATURE_PRIORITY
+    {.name = "TransferChunked",           .weight =  10, .run = SoakChunked},
+#endif
+#if SUS_I2C_FEATURE_SNAPSHOT
+    {.name = "Snapshot",                  .weight =  20, .run = SoakSnapshot},
+#endif
+#if SUS_I2C_FEATURE_SPEED
+    {.name = "SetSpeed",                  .weight =   1, .run = SoakSetSpeed},
+    {.name = "CalibrateSpeed",            .weight =   1, .run = SoakCalibrateSpeed},
+#endif
+#if SUS_I2C_FEATURE_BUDGET
+    {.name = "ReadRegisters (budgeted)",  .weight =  20, .run = SoakBudgeted},
+#endif
+#if SUS_I2C_FEATURE_TRACE
+    {.name = "TraceDump",                 .weight =   1, .run = SoakTraceDump},
+#endif
+};
+#define SOAK_OPERATIONS (sizeof(soakOperation) / sizeof(soakOperation[0]))
+
+/*----- Background engines on port 1 -----*/
+static uint64_t soakSamples, soakSampleErrors, soakIsrDone, soakIsrErrors, soakIsrRefused, soakPresenceChanges, soakRestarts, soakBackgroundResets;
+static int soakBackgroundTimeoutsInARow;        // Port 1 has no foreground to notice a stuck bus: the callbacks count timeouts, the main loop resets the bus.
+
+static void SoakNoteBackground(esp_err_t outcome)
+{
+    if (outcome == ESP_ERR_TIMEOUT) __atomic_add_fetch(&soakBackgroundTimeoutsInARow, 1, __ATOMIC_RELAXED);
+    else if (outcome == ESP_OK) __atomic_store_n(&soakBackgroundTimeoutsInARow, 0, __ATOMIC_RELAXED);
+}
+static volatile bool soakSubmitterRunning, soakSubmitterFinished;
+
+#if SUS_I2C_FEATURE_SCHEDULER
+static struct SUS_I2C_PeriodicJob soakJob[2];
+
+static void SoakOnSample(struct SUS_I2C_PeriodicJob *job, const uint8_t *data, esp_err_t outcome, int64_t timestamp_us)
+{
+    (void)timestamp_us;
+    SoakNoteBackground(outcome);
+    __atomic_add_fetch(outcome == ESP_OK ? &soakSamples : &soakSampleErrors, 1, __ATOMIC_RELAXED);
+    if (outcome == ESP_OK && !SoakPatternMatches(job->I2CdeviceAddress, job->startRegisterAddress, data, job->amountOfBytesToRead))
+        __atomic_add_fetch(&soakWrongData, 1, __ATOMIC_RELAXED);
+}
+#endif
+
+#if SUS_I2C_FEATURE_PRESENCE
+static void SoakOnPresenceChange(uint8_t I2CportNumber, uint8_t I2CdeviceAddress, bool present)
+{
+    (void)I2CportNumber; (void)I2CdeviceAddress; (void)present;
+    __atomic_add_fetch(&soakPresenceChanges, 1, __ATOMIC_RELAXED);
+}
+#endif
+
+#if SUS_I2C_FEATURE_ISR
+static struct SUS_I2C_IsrRequest soakRequest[4];
+static uint8_t soakRequestData[4][6];
+
+static void SoakOnIsrDone(struct SUS_I2C_IsrRequest *request)
+{
+    SoakNoteBackground(request->outcome);
+    if (request->outcome != ESP_OK) { __atomic_add_fetch(&soakIsrErrors, 1, __ATOMIC_RELAXED); return; }
+    __atomic_add_fetch(&soakIsrDone, 1, __ATOMIC_RELAXED);
+    if (request->type == SUS_I2C_ISR_READ && !SoakPatternMatches(request->I2CdeviceAddress, request->startRegisterAddress, request->data, request->length))
+        __atomic_add_fetch(&soakWrongData, 1, __ATOMIC_RELAXED);
+}
+
+//Plays the interrupt: submits one of the requests every millisecond.
+static void SoakSubmitterTask(void *argument)
+{
+    (void)argument;
+    for (uint32_t i = 0; soakSubmitterRunning; i++)
+    {
+        if (SUS_I2C_SubmitFromISR(&soakRequest[i % 4], NULL) != ESP_OK) __atomic_add_fetch(&soakIsrRefused, 1, __ATOMIC_RELAXED);
+        vTaskDelay(1);
+    }
+    soakSubmitterFinished = true;
+    vTaskDelete(NULL);
+}
+#endif
+
+static void SoakBackgroundStart(void)
+{
+#if SUS_I2C_FEATURE_SCHEDULER
+    soakJob[0] = (struct SUS_I2C_PeriodicJob){.I2CdeviceAddress = SOAK_IMU, .startRegisterAddress = 0x00, .amountOfBytesToRead = 14, .period_us = 1000, .onSample = SoakOnSample};
+    soakJob[1] = (struct SUS_I2C_PeriodicJob){.I2CdeviceAddress = SOAK_SMBUS, .startRegisterAddress = 0x08, .amountOfBytesToRead = 4, .period_us = 5000, .offset_us = 500, .onSample = SoakOnSample};
+    SUS_I2C_SchedulerAddJob(1, &soakJob[0]);
+    SUS_I2C_SchedulerAddJob(1, &soakJob[1]);
+    SUS_I2C_SchedulerStart(1, 1, 5);
+#endif
+#if SUS_I2C_FEATURE_PRESENCE
+    struct SUS_I2C_PresenceConfig presence = {.busShare = 0.02f, .idleTime_us = 50000, .onChange = SoakOnPresenceChange};
+    for (size_t d = 0; d < sizeof(soakDevices); d++) SUS_I2C_PresenceWatch(1, soakDevices[d]);
+    SUS_I2C_PresenceStart(1, &presence, 1, 2);
+#endif
+#if SUS_I2C_FEATURE_ISR
+    for (int i = 0; i < 4; i++)
+        soakRequest[i] = (struct SUS_I2C_IsrRequest){.I2CportNumber = 1, .I2CdeviceAddress = SOAK_IMU, .type = (i == 3) ? SUS_I2C_ISR_WRITE : SUS_I2C_ISR_READ,
+                                                     .startRegisterAddress = (i == 3) ? 0xA0 : (uint8_t)(0x30 + i), .data = soakRequestData[i], .length = 6,
+                                                     .priority = SUS_I2C_PRIORITY_HIGH, .onComplete = SoakOnIsrDone};
+    SUS_I2C_IsrWorkerStart(1, 1, 10);
+    soakSubmitterRunning = true;
+    soakSubmitterFinished = false;
+    xTaskCreatePinnedToCore(SoakSubmitterTask, "soak_isr", 2048, NULL, 11, NULL, 1);
+#endif
+}
+
+static void SoakBackgroundStop(void)
+{
+#if SUS_I2C_FEATURE_ISR
+    soakSubmitterRunning = false;
+    while (!soakSubmitterFinished) vTaskDelay(1);
+    SUS_I2C_IsrWorkerStop(1);
+#endif
+#if SUS_I2C_FEATURE_PRESENCE
+    SUS_I2C_PresenceStop(1);
+#endif
+#if SUS_I2C_FEATURE_SCHEDULER
+    SUS_I2C_SchedulerStop(1);
+    SUS_I2C_SchedulerRemoveJob(1, &soakJob[0]);
+    SUS_I2C_SchedulerRemoveJob(1, &soakJob[1]);
+#endif
+}
+
+//Every report printer, while the background engines still run and change what they print. Their output goes to /dev/null with the rest.
+static void SoakReports(void)
+{
+#if SUS_I2C_FEATURE_TRACE
+    SUS_I2C_TracePrint();
+#endif
+#if SUS_I2C_FEATURE_PRESENCE
+    SUS_I2C_PresencePrintTable(1);
+#endif
+#if SUS_I2C_FEATURE_BUDGET
+    SUS_I2C_BudgetPrintReport(0);
+#endif
+#if SUS_I2C_FEATURE_PRIORITY
+    SUS_I2C_BusPrintPriorityReport(0);
+    SUS_I2C_BusPrintPriorityReport(1);
+#endif
+#if SUS_I2C_FEATURE_SCHEDULER
+    SUS_I2C_SchedulerPrintReport(1);
+#endif
+#if SUS_I2C_FEATURE_ISR
+    SUS_I2C_IsrPrintReport(1);
+#endif
+#if SUS_I2C_FEATURE_REGISTER_MAP
+    static const uint8_t ids[] = {SOAKDEV_ID, SOAKDEV_VALUE16, SOAKDEV_VALUE32};
+    SUS_I2C_MapPrintPlan(&soakImu, ids, 3);
+#endif
+}
+
+//Dual port engine start/stop cycles. Port 1's own scheduler must be stopped and empty (SoakBackgroundStop) - the engine brings its own jobs.
+static void SoakDualPortCycles(int cycles)
+{
+#if SUS_I2C_FEATURE_DUAL_PORT
+    static struct SUS_I2C_AcquisitionJob job[2];
+    static bool added;
+    struct SUS_I2C_Sample sample;
+    if (!added)
+    {
+        job[0] = (struct SUS_I2C_AcquisitionJob){.I2CportNumber = SUS_I2C_ANY_PORT, .I2CdeviceAddress = SOAK_SNAP_A, .startRegisterAddress = 0x00, .amountOfBytesToRead = 8, .period_us = 2000};
+        job[1] = (struct SUS_I2C_AcquisitionJob){.I2CportNumber = SUS_I2C_ANY_PORT, .I2CdeviceAddress = SOAK_SNAP_B, .startRegisterAddress = 0x00, .amountOfBytesToRead = 8, .period_us = 2000};
+        SUS_I2C_DualPortAddJob(&job[0]);
+        SUS_I2C_DualPortAddJob(&job[1]);
+        added = true;
+    }
+    for (int c = 0; c < cycles; c++)
+    {
+        if (SUS_I2C_DualPortStart(0, 1, 5, 32) != ESP_OK) continue;
+        int64_t end = esp_timer_get_time() + 50000;
+        while (esp_timer_get_time() < end)
+        {
+            if (SUS_I2C_DualPortGetSample(&sample, 5/portTICK_PERIOD_MS) != ESP_OK) continue;
+            soakSamples += (sample.outcome == ESP_OK);
+            soakSampleErrors += (sample.outcome != ESP_OK);
+            if (sample.outcome == ESP_OK && !SoakPatternMatches(sample.I2CdeviceAddress, sample.startRegisterAddress, sample.data, sample.length)) soakWrongData++;
+        }
+        if (c == 0) SUS_I2C_DualPortPrintReport();
+        SUS_I2C_DualPortStop();
+        while (SUS_I2C_DualPortGetSample(&sample, 0) == ESP_OK) {}
+    }
+#else
+    (void)cycles;
+#endif
+}
+
+/*----- Two tasks on one device with a combiner and a prefetcher. The writer's flushes drop the prefetched data, the reader's reads send the combined
+ * writes first: both lock both, so a wrong lock order hangs them for good. A run that doesn't end in time is reported as a deadlock. -----*/
+#define SOAK_SHARED_ROUNDS      20000
+#define SOAK_SHARED_DEADLINE_US 20000000        // Takes well under a second: 20 s means stuck, not slow.
+
+#if SUS_I2C_FEATURE_COMBINE && SUS_I2C_FEATURE_PREFETCH
+static struct SUS_I2C_Combiner soakCombiner;
+static struct SUS_I2C_Prefetcher soakPrefetcher;
+static int soakSharedRunning;
+
+//The same register sequence again and again: the prefetcher learns it and reads it in bursts.
+static void SoakSharedReader(void *argument)
+{
+    (void)argument;
+    for (int round = 0; round < SOAK_SHARED_ROUNDS; round++)
+        for (uint8_t reg = 0x01; reg <= 0x06; reg++)
+        {
+            uint8_t value;
+            if (SUS_I2C_ReadRegister_STATUS(0, SOAK_SNAP_A, reg, &value) == ESP_OK && value != SoakPattern(SOAK_SNAP_A, reg))
+                __atomic_add_fetch(&soakWrongData, 1, __ATOMIC_RELAXED);
+        }
+    __atomic_sub_fetch(&soakSharedRunning, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+//Combined writes to the scratch registers, sent by the threshold, now and then a plain write that has to send them first,
+//and now and then half a run left to the timeout (the combiner's flush task races the reader for it).
+static void SoakSharedWriter(void *argument)
+{
+    (void)argument;
+    for (int round = 0; round < SOAK_SHARED_ROUNDS; round++)
+    {
+        uint8_t end = (round % 64 == 63) ? 0x83 : 0x86;
+        for (uint8_t reg = 0x80; reg < end; reg++) SUS_I2C_CombineWriteRegister(&soakCombiner, reg, (uint8_t)round);
+        if (end != 0x86) vTaskDelay(1);
+        if (round % 8 == 0) SUS_I2C_WriteToRegister(0, SOAK_SNAP_A, 0x90, (uint8_t)round);
+    }
+    __atomic_sub_fetch(&soakSharedRunning, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+#endif
+
+static void SoakSharedDevice(void)
+{
+#if SUS_I2C_FEATURE_COMBINE && SUS_I2C_FEATURE_PREFETCH
+    soakCombiner = (struct SUS_I2C_Combiner){.I2CportNumber = 0, .I2CdeviceAddress = SOAK_SNAP_A, .flags = SUS_I2C_COMBINE_AUTO_INCREMENT, .threshold = 6, .timeout_us = 200};
+    soakPrefetcher = (struct SUS_I2C_Prefetcher){.I2CportNumber = 0, .I2CdeviceAddress = SOAK_SNAP_A};
+    if (SUS_I2C_CombineInit(&soakCombiner) != ESP_OK) return;
+    if (SUS_I2C_PrefetchInit(&soakPrefetcher) != ESP_OK) { SUS_I2C_CombineRemove(&soakCombiner); return; }
+    SUS_I2C_ResetBus(0);        //Nobody resets a stuck bus in here.
+    soakSharedRunning = 2;
+    xTaskCreate(SoakSharedReader, "soak_reader", 2048, NULL, 5, NULL);
+    xTaskCreate(SoakSharedWriter, "soak_writer", 2048, NULL, 5, NULL);
+    int64_t deadline = esp_timer_get_time() + SOAK_SHARED_DEADLINE_US;
+    while (__atomic_load_n(&soakSharedRunning, __ATOMIC_ACQUIRE) > 0 && esp_timer_get_time() < deadline) vTaskDelay(10/portTICK_PERIOD_MS);
+    if (__atomic_load_n(&soakSharedRunning, __ATOMIC_ACQUIRE) > 0) {        //Both tasks hang on the locks for good - nothing to clean up or report after this.
+        fprintf(soakOut, "\nCombiner + prefetcher, two tasks on one device: still not done after %d s - DEADLOCK.\n\nRESULT: FAIL\n", SOAK_SHARED_DEADLINE_US / 1000000);
+        exit(1);
+    }
+    SUS_I2C_CombineRemove(&soakCombiner);
+    SUS_I2C_PrefetchRemove(&soakPrefetcher);
+#endif
+}
+
+/*----- One run of the whole workload -----*/
+struct SoakEpisodes
+{
+    struct SoakLatencies time;                  // Simulated time from the first failure to the next success.
+    uint64_t operations;                        // Operations spent failing, all episodes together.
+};
+
+struct SoakRun
+{
+    uint64_t operations, successes, refused, resets;
+    double simulated_s, wall_s;
+    struct SoakLatencies all;
+    struct SoakEpisodes episode[3];             // By the fault that started it: NACK, timeout, stuck SDA.
+    long heapBaseline, heapPeak, heapEnd;
+    long linksPeak, linksLeaked;
+};
+static const char *soakFaultName[3] = {"NACK", "timeout", "stuck SDA"};
+
+static void SoakRecord(struct SoakLatencies *latencies, uint64_t value_ns)
+{
+    if (latencies->count == latencies->capacity)
+    {
+        latencies->capacity = latencies->capacity ? latencies->capacity * 2 : 4096;
+        latencies->value_ns = __real_realloc(latencies->value_ns, latencies->capacity * sizeof(uint32_t));     //Bookkeeping of the harness: not counted as heap.
+        if (latencies->value_ns == NULL) { fprintf(soakOut, "Out of memory.\n"); exit(1); }
+    }
+    latencies->value_ns[latencies->count++] = value_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)value_ns;
+}
+
+static int SoakCompare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double SoakPercentile_us(struct SoakLatencies *latencies, double percentile)     //Sorts the values - call after the run.
+{
+    if (latencies->count == 0) return 0;
+    qsort(latencies->value_ns, latencies->count, sizeof(uint32_t), SoakCompare);
+    size_t index = (size_t)(percentile / 100.0 * (latencies->count - 1) + 0.5);
+    return latencies->value_ns[index] / 1000.0;
+}
+
+static uint64_t SoakNow_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void SoakReset(struct SoakRun *run)
+{
+    for (size_t i = 0; i < SOAK_OPERATIONS; i++)
+    {
+        soakOperation[i].calls = soakOperation[i].failures = soakOperation[i].refused = 0;
+        soakOperation[i].latency.count = 0;
+    }
+    memset(run, 0, sizeof(*run));
+    soakWrongData = soakSamples = soakSampleErrors = soakIsrDone = soakIsrErrors = soakIsrRefused = soakPresenceChanges = soakRestarts = soakBackgroundResets = 0;
+}
+
+static void SoakRunWorkload(struct SoakRun *run, uint64_t operations, uint64_t restartEvery, uint32_t seed)
+{
+    uint32_t totalWeight = 0;
+    uint64_t episodeStart_ns = 0, episodeOperations = 0, wallStart = SoakNow_ns();
+    int episodeFault = -1, timeoutsInARow = 0;
+
+    for (size_t i = 0; i < SOAK_OPERATIONS; i++) totalWeight += soakOperation[i].weight;
+    soakRandomState = seed;
+    run->heapBaseline = __atomic_load_n(&soakHeapInUse, __ATOMIC_RELAXED);
+    soakHeapPeak = run->heapBaseline;
+    SUS_Sim_LinksOutstandingPeak = SUS_Sim_LinksOutstanding;
+    SoakBackgroundStart();
+
+    for (uint64_t n = 0; n < operations; n++)
+    {
+        uint32_t pick = SoakRandom() % totalWeight;
+        size_t i = 0;
+        while (pick >= soakOperation[i].weight) pick -= soakOperation[i++].weight;
+        struct SoakOperation *operation = &soakOperation[i];
+
+        uint64_t wireBefore = SUS_SimBus_Port[0].busTime_ns, cpuBefore = SoakNow_ns();
+        esp_err_t outcome = operation->run();
+        uint64_t latency_ns = (SoakNow_ns() - cpuBefore) + (SUS_SimBus_Port[0].busTime_ns - wireBefore);
+        run->simulated_s += latency_ns / 1e9;
+        operation->calls++;
+        SoakRecord(&operation->latency, latency_ns);
+        SoakRecord(&run->all, latency_ns);
+
+#if SUS_I2C_FEATURE_BUDGET
+        if (outcome == SUS_I2C_ERR_OVER_BUDGET) { operation->refused++; run->refused++; continue; }    //Budget did its job - not a bus fault.
+#endif
+        if (outcome == ESP_OK)
+        {
+            run->successes++;
+            timeoutsInARow = 0;
+            if (episodeFault >= 0)
+            {
+                SoakRecord(&run->episode[episodeFault].time, (uint64_t)(run->simulated_s * 1e9) - episodeStart_ns);
+                run->episode[episodeFault].operations += episodeOperations;
+                episodeFault = -1;
+            }
+        }
+        else
+        {
+            operation->failures++;
+            if (episodeFault < 0)
+            {
+                episodeFault = (outcome != ESP_ERR_TIMEOUT) ? 0 : SUS_SimBus_Port[0].stuck ? 2 : 1;
+                episodeStart_ns = (uint64_t)((run->simulated_s * 1e9) - latency_ns);
+                episodeOperations = 0;
+            }
+            episodeOperations++;
+            if (outcome == ESP_ERR_TIMEOUT && ++timeoutsInARow >= 2)       //What an application should do: two timeouts in a row = reset the bus.
+            {
+                wireBefore = SUS_SimBus_Port[0].busTime_ns;
+                cpuBefore = SoakNow_ns();
+                SUS_I2C_ResetBus(0);
+                run->simulated_s += ((SoakNow_ns() - cpuBefore) + (SUS_SimBus_Port[0].busTime_ns - wireBefore)) / 1e9;
+                run->resets++;
+                timeoutsInARow = 0;
+            }
+        }
+        if (__atomic_load_n(&soakBackgroundTimeoutsInARow, __ATOMIC_RELAXED) >= 2)
+        {
+            SUS_I2C_ResetBus(1);
+            __atomic_store_n(&soakBackgroundTimeoutsInARow, 0, __ATOMIC_RELAXED);
+            soakBackgroundResets++;
+        }
+        if (restartEvery && (n + 1) % restartEvery == 0 && n + 1 < operations)
+        {
+            SoakBackgroundStop();
+            SoakBackgroundStart();
+            soakRestarts++;
+        }
+    }
+    SoakReports();
+    SoakBackgroundStop();
+    SoakDualPortCycles(5);
+    SoakSharedDevice();
+    run->operations = operations;
+    run->wall_s = (SoakNow_ns() - wallStart) / 1e9;
+    run->heapPeak = soakHeapPeak;
+    run->heapEnd = __atomic_load_n(&soakHeapInUse, __ATOMIC_RELAXED);
+    run->linksPeak = SUS_Sim_LinksOutstandingPeak;
+    run->linksLeaked = SUS_Sim_LinksOutstanding;
+}
+
+static void SoakSetFaults(double nack, double timeout, double stuck)
+{
+    for (int port = 0; port < 2; port++)
+    {
+        SUS_SimBus_SetFaults(port, nack, timeout, stuck);
+        SUS_SimBus_Port[port].stuck = false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t operations = 1000000, restartEvery = 100000;
+    double nack = 0.01, timeout = 0.01, stuck = 0.01;
+    int speed = 400000;
+    uint32_t seed = 1;
+    struct SoakRun baseline, soak;
+
+    soakOut = fdopen(dup(STDOUT_FILENO), "w");
+    if (soakOut == NULL || freopen("/dev/null", "w", stdout) == NULL) return 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "--ops") == 0) operations = strtoull(argv[++i], NULL, 10);
+        else if (i + 1 < argc && strcmp(argv[i], "--nack") == 0) nack = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--timeout") == 0) timeout = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--stuck") == 0) stuck = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--speed") == 0) speed = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--restart") == 0) restartEvery = strtoull(argv[++i], NULL, 10);
+        else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else {
+            fprintf(soakOut, "Usage: %s [--ops N] [--nack P] [--timeout P] [--stuck P] [--speed Hz] [--restart N] [--seed N]\n", argv[0]);
+            fprintf(soakOut, "       Probabilities are per transaction, 0.0 - 1.0. --restart: restart the background engines every N operations (0 = never).\n");
+            return 1;
+        }
+    }
+    if (operations == 0 || speed <= 0 || nack < 0 || timeout < 0 || stuck < 0 || nack + timeout + stuck >= 1.0 || seed == 0) {
+        fprintf(soakOut, "Nonsense arguments. Probabilities must add up to less than 1, the seed must not be 0.\n");
+        return 1;
+    }
+
+    SUS_Sim_LogLevel = 0;       //Millions of operations, a good part of them failing: the log would be the bottleneck.
+    SUS_SimBus_Init(0, speed, false);
+    SUS_SimBus_Init(1, speed, true);
+    SUS_SimBus_Port[1].pacingSlack_ns = 500000;
+    SoakWireDevices(0);
+    SoakWireDevices(1);
+    SUS_I2C_Master_Init(0, 22, 21, speed);
+    SUS_I2C_Master_Init(1, 19, 18, speed);
+#if SUS_I2C_FEATURE_REGISTER_MAP
+    SOAKDEV_Init(&soakImu, 0, SOAK_IMU);
+#endif
+#if SUS_I2C_FEATURE_BUDGET
+    SUS_I2C_BudgetSetShare(0, 0.5f);
+    SUS_I2C_BudgetSetClient(0, SOAK_BUDGETED, 1, 2000, SUS_I2C_BUDGET_REJECT);
+#endif
+#if SUS_I2C_FEATURE_TRACE
+    SUS_I2C_TraceStart();
+#endif
+
+    fprintf(soakOut, "SUS I2C soak: %llu operations, faults per transaction: NACK %.2f%%, timeout %.2f%%, stuck SDA %.2f%%, %d Hz, seed %u.\n",
+           (unsigned long long)operations, 100 * nack, 100 * timeout, 100 * stuck, speed, seed);
+    SoakReset(&baseline);
+    SoakSetFaults(0, 0, 0);
+    SoakRunWorkload(&baseline, operations, restartEvery, seed);     //Same operations in the same order. Also the warm-up: everything created once is there from now on.
+    double baselineThroughput = baseline.successes / baseline.simulated_s;
+    SoakReset(&soak);
+    SoakSetFaults(nack, timeout, stuck);
+    SoakRunWorkload(&soak, operations, restartEvery, seed);
+    SoakSetFaults(0, 0, 0);
+
+    fprintf(soakOut, "\n%-26s %10s %8s %8s %9s %9s %10s\n", "operation", "calls", "ok %", "refused", "p50 us", "p99 us", "max us");
+    for (size_t i = 0; i < SOAK_OPERATIONS; i++)
+    {
+        struct SoakOperation *operation = &soakOperation[i];
+        if (operation->calls == 0) continue;
+        fprintf(soakOut, "%-26s %10llu %8.2f %8llu %9.1f %9.1f %10.1f\n", operation->name, (unsigned long long)operation->calls,
+               100.0 * (operation->calls - operation->failures - operation->refused) / operation->calls, (unsigned long long)operation->refused,
+               SoakPercentile_us(&operation->latency, 50), SoakPercentile_us(&operation->latency, 99), SoakPercentile_us(&operation->latency, 100));
+    }
+    fprintf(soakOut, "%-26s %10llu %8.2f %8llu %9.1f %9.1f %10.1f\n", "ALL", (unsigned long long)soak.operations, 100.0 * soak.successes / soak.operations,
+           (unsigned long long)soak.refused, SoakPercentile_us(&soak.all, 50), SoakPercentile_us(&soak.all, 99), SoakPercentile_us(&soak.all, 100));
+    fprintf(soakOut, "Fault-free baseline: p50 %.1f us, p99 %.1f us.\n", SoakPercentile_us(&baseline.all, 50), SoakPercentile_us(&baseline.all, 99));
+
+    fprintf(soakOut, "\nThroughput: %.0f successful operations per simulated second = %.1f%% of the fault-free %.0f/s. Host: %.0f operations/s (%.1f s).\n",
+           soak.successes / soak.simulated_s, 100.0 * (soak.successes / soak.simulated_s) / baselineThroughput, baselineThroughput,
+           soak.operations / soak.wall_s, soak.wall_s);
+    fprintf(soakOut, "\nRecovery (first failure -> next success, simulated time). Bus resets: %llu.\n", (unsigned long long)soak.resets);
+    fprintf(soakOut, "%-12s %9s %12s %9s %9s %10s\n", "first fault", "episodes", "ops/episode", "p50 us", "p99 us", "max us");
+    for (int f = 0; f < 3; f++)
+    {
+        struct SoakEpisodes *episode = &soak.episode[f];
+        if (episode->time.count == 0) continue;
+        fprintf(soakOut, "%-12s %9zu %12.2f %9.1f %9.1f %10.1f\n", soakFaultName[f], episode->time.count, (double)episode->operations / episode->time.count,
+               SoakPercentile_us(&episode->time, 50), SoakPercentile_us(&episode->time, 99), SoakPercentile_us(&episode->time, 100));
+    }
+    fprintf(soakOut, "\nBackground (port 1, restarted %llu times, %llu bus resets): %llu samples (%llu failed), %llu ISR requests done (%llu failed, %llu refused), %llu presence changes.\n",
+           (unsigned long long)soakRestarts, (unsigned long long)soakBackgroundResets, (unsigned long long)soakSamples, (unsigned long long)soakSampleErrors, (unsigned long long)soakIsrDone,
+           (unsigned long long)soakIsrErrors, (unsigned long long)soakIsrRefused, (unsigned long long)soakPresenceChanges);
+    fprintf(soakOut, "Heap: %ld bytes after warm-up, high-water mark %ld bytes (+%ld), %ld bytes after everything stopped (%+ld). %ld allocations in total.\n",
+           soak.heapBaseline, soak.heapPeak, soak.heapPeak - soak.heapBaseline, soak.heapEnd, soak.heapEnd - soak.heapBaseline, soakHeapAllocations);
+    fprintf(soakOut, "Command links: at most %ld at once, %ld never deleted.\n", soak.linksPeak, soak.linksLeaked);
+    fprintf(soakOut, "Successful reads with wrong data: %llu.\n", (unsigned long long)soakWrongData);
+
+    bool pass = soak.heapEnd <= soak.heapBaseline && soak.linksLeaked == 0 && soakWrongData == 0;
+    fprintf(soakOut, "\nRESULT: %s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_TraceReplay.c
+ *
+ *    Brief:    Replays an I2C transaction trace recorded by SUS_I2Cmaster_FULL.h on a simulated bus and prints throughput and latency breakdowns.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              When a field unit misbehaves, have it dump its trace ring (SUS_I2C_TraceDump or SUS_I2C_TracePrint) and feed the dump to this tool.
+ *              Accepted inputs:
+ *                  - the binary blob produced by SUS_I2C_TraceDump
+ *                  - a console log containing the "SUSTRACE:" hex lines printed by SUS_I2C_TracePrint (everything else in the log is ignored)
+ *
+ *              Every recorded transaction is executed again on the simulated bus from sim/SUS_I2C_SimBus.h, with the same devices,
+ *              the same payload lengths and the same errors (a recorded NACK is NACKed again, a recorded timeout times out again).
+ *              With --realtime the replay also keeps the recorded gaps between transactions, so it takes as long as the original.
+ *              With --speed the same traffic is re-simulated at a different bus clock to see what a faster/slower bus would do.
+ *
+ *              Printed report:
+ *                  - trace span, bus utilization, throughput (transactions/s and bytes/s)
+ *                  - per device and per direction: count, errors, bytes, latency min/avg/p50/p99/max,
+ *                    and how much of that latency is time on the wire vs driver/software overhead
+ *                  - error codes and the longest run of back-to-back errors per device (error bursts usually mean wiring, isolated errors mean noise)
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -o SUS_I2C_TraceReplay SUS_I2C_TraceReplay.c -lpthread
+ *    Usage:    ./SUS_I2C_TraceReplay trace.bin [--speed 400000] [--realtime] [--verbose]
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "SUS_I2C_SimBus.h"
+
+/* Must match struct SUS_I2C_TraceRecord / SUS_I2C_TraceHeader in SUS_I2Cmaster_FULL.h - this IS the file format. */
+#define SUS_I2C_TRACE_PAYLOAD_SIZE      12
+#define SUS_I2C_TRACE_WRITE             0
+#define SUS_I2C_TRACE_READ              1
+#define SUS_I2C_TRACE_WRITE_READ        2
+#define SUS_I2C_TRACE_NO_ADDRESS        0xFF
+
+struct __attribute__((packed)) SUS_I2C_TraceRecord
+{
+    int64_t  timestamp_us;
+    uint32_t duration_us;
+    int32_t  result;
+    uint8_t  port;
+    uint8_t  address;
+    uint8_t  direction;
+    uint8_t  payloadStored;
+    uint16_t writeLength;
+    uint16_t readLength;
+    uint8_t  payload[SUS_I2C_TRACE_PAYLOAD_SIZE];
+};
+
+struct __attribute__((packed)) SUS_I2C_TraceHeader
+{
+    char     magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t recordCount;
+    uint32_t overwrittenCount;
+    uint32_t busClockHz[2];
+};
+
+/* Statistics of one group of transactions (one device, one direction...). */
+struct ReplayGroup
+{
+    uint64_t count, errors, bytes;
+    uint64_t wire_ns;                   // Simulated time on the wire.
+    uint64_t recordedTotal_us;          // Recorded duration (wire + driver + task switches).
+    uint32_t *durations;                // Recorded durations, for percentiles.
+    size_t   durationCount;
+    uint32_t errorRun, longestErrorRun; // Error burst tracking.
+};
+
+static void GroupAdd(struct ReplayGroup *group, const struct SUS_I2C_TraceRecord *record, uint64_t wire_ns)
+{
+    group->count++;
+    group->bytes += record->writeLength + record->readLength;
+    group->wire_ns += wire_ns;
+    group->recordedTotal_us += record->duration_us;
+    uint32_t *durations = realloc(group->durations, (group->durationCount + 1) * sizeof(uint32_t));
+    if (durations == NULL) { fprintf(stderr, "Out of memory after %llu records.\n", (unsigned long long)group->count); exit(1); }
+    group->durations = durations;
+    group->durations[group->durationCount++] = record->duration_us;
+    if (record->result != 0) {
+        group->errors++;
+        if (++group->errorRun > group->longestErrorRun) group->longestErrorRun = group->errorRun;
+    } else {
+        group->errorRun = 0;
+    }
+}
+
+static int CompareU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t Percentile(uint32_t *sorted, size_t count, double fraction)
+{
+    if (count == 0) return 0;
+    size_t index = (size_t)(fraction * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+static void GroupPrint(const char *label, struct ReplayGroup *group)
+{
+    if (group->count == 0) return;
+    qsort(group->durations, group->durationCount, sizeof(uint32_t), CompareU32);
+    double averageRecorded = (double)group->recordedTotal_us / (double)group->count;
+    double averageWire = (double)group->wire_ns / 1000.0 / (double)group->count;
+    printf("  %-16s %8llu %7llu %9llu  %6u %8.1f %6u %6u %7u   %8.1f %8.1f\n",
+           label, (unsigned long long)group->count, (unsigned long long)group->errors, (unsigned long long)group->bytes,
+           group->durations[0], averageRecorded,
+           Percentile(group->durations, group->durationCount, 0.50),
+           Percentile(group->durations, group->durationCount, 0.99),
+           group->durations[group->durationCount - 1],
+           averageWire, averageRecorded - averageWire);
+}
+
+static void GroupPrintHeader(const char *title)
+{
+    printf("\n%s\n", title);
+    printf("  %-16s %8s %7s %9s  %6s %8s %6s %6s %7s   %8s %8s\n", "", "count", "errors", "bytes", "min_us", "avg_us", "p50", "p99", "max_us", "wire_us", "sw_us");
+}
+
+/* Reads the whole input file. If it is a console log, extracts the hex from the SUSTRACE: lines and converts it back to binary. */
+static uint8_t *LoadTrace(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) { perror(path); return NULL; }
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc((size_t)fileSize + 1);
+    if (data == NULL) { fprintf(stderr, "%s: out of memory (%ld bytes).\n", path, fileSize + 1); exit(1); }
+    if (fread(data, 1, (size_t)fileSize, file) != (size_t)fileSize) { fclose(file); free(data); return NULL; }
+    fclose(file);
+    data[fileSize] = 0;
+
+    if (fileSize >= 4 && memcmp(data, "SUSt", 4) == 0) { *size = (size_t)fileSize; return data; }
+
+    //Console log: every "SUSTRACE:" line carries a piece of the blob in hex.
+    uint8_t *blob = malloc((size_t)fileSize / 2 + 1);
+    if (blob == NULL) { fprintf(stderr, "%s: out of memory (%ld bytes).\n", path, fileSize / 2 + 1); exit(1); }
+    size_t blobSize = 0;
+    char *line = (char *)data;
+    while ((line = strstr(line, "SUSTRACE:")) != NULL)
+    {
+        line += 9;
+        while (isxdigit((unsigned char)line[0]) && isxdigit((unsigned char)line[1]))
+        {
+            char hex[3] = { line[0], line[1], 0 };
+            blob[blobSize++] = (uint8_t)strtoul(hex, NULL, 16);
+            line += 2;
+        }
+    }
+    free(data);
+    *size = blobSize;
+    return blob;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int speedOverride = 0;
+    bool realTime = false, verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speedOverride = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--realtime") == 0) realTime = true;
+        else if (strcmp(argv[i], "--verbose") == 0) verbose = true;
+        else path = argv[i];
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s <trace.bin | console.log> [--speed Hz] [--realtime] [--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    size_t size = 0;
+    uint8_t *blob = LoadTrace(path, &size);
+    struct SUS_I2C_TraceHeader header;
+    if (blob == NULL || size < sizeof(header)) { fprintf(stderr, "%s: no trace found.\n", path); return 1; }
+    memcpy(&header, blob, sizeof(header));
+    if (memcmp(header.magic, "SUSt", 4) != 0 || header.version != 1 || header.recordSize != sizeof(struct SUS_I2C_TraceRecord)) {
+        fprintf(stderr, "%s: unsupported trace format (version %u, record size %u).\n", path, header.version, header.recordSize);
+        return 1;
+    }
+    size_t count = (size - sizeof(header)) / sizeof(struct SUS_I2C_TraceRecord);
+    if (count > header.recordCount) count = header.recordCount;
+    struct SUS_I2C_TraceRecord *records = (struct SUS_I2C_TraceRecord *)(blob + sizeof(header));
+    if (count == 0) { printf("Trace is empty.\n"); return 0; }
+
+    //Rebuild the buses: recorded clock (or the override), and every address that ever answered is a present device.
+    int recordedClock[SUS_SIMBUS_PORTS];
+    for (int port = 0; port < SUS_SIMBUS_PORTS; port++)
+    {
+        recordedClock[port] = header.busClockHz[port] ? (int)header.busClockHz[port] : 100000;
+        SUS_SimBus_Init(port, speedOverride ? speedOverride : recordedClock[port], realTime);
+    }
+    for (size_t i = 0; i < count; i++)
+        if (records[i].result == 0 && records[i].address != SUS_I2C_TRACE_NO_ADDRESS)
+            SUS_SimBus_AddDevice(records[i].port & 1, records[i].address);
+
+    struct ReplayGroup total = {0}, byDirection[3] = {{0}}, byDevice[SUS_SIMBUS_PORTS][256] = {{{0}}};
+    uint64_t resultCount[4] = {0};      // OK, NACK/fail, timeout, other
+    uint64_t originalWire_ns = 0, replayWire_ns = 0, mismatches = 0;
+    int64_t replayStart = SUS_SimBus_Now_us();
+    uint8_t scratch[65536 + 2];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        struct SUS_I2C_TraceRecord *record = &records[i];
+        int port = record->port & 1;
+        struct SUS_SimBus *bus = &SUS_SimBus_Port[port];
+
+        //Keep the recorded pacing: wait until this transaction's moment comes.
+        if (realTime) {
+            int64_t due = replayStart + (record->timestamp_us - records[0].timestamp_us);
+            while (SUS_SimBus_Now_us() < due) { }
+        }
+
+        //Rebuild the transaction: known payload bytes first, zeros for whatever did not fit into the trace record.
+        memset(scratch, 0, sizeof(scratch));
+        uint8_t addressWrite = (uint8_t)(record->address << 1), addressRead = (uint8_t)((record->address << 1) | 1);
+        size_t writeStored = record->payloadStored < record->writeLength ? record->payloadStored : record->writeLength;
+        memcpy(scratch, record->payload, writeStored);
+        uint8_t readBuffer[65536];
+        struct SUS_SimOp ops[8];
+        size_t opCount = 0;
+        ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_START, NULL, 0, false };
+        if (record->address == SUS_I2C_TRACE_NO_ADDRESS) {
+            ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_WRITE, scratch, record->writeLength, true };
+        } else if (record->direction == SUS_I2C_TRACE_READ) {
+            ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_WRITE, &addressRead, 1, true };
+            ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_READ, readBuffer, record->readLength, false };
+        } else {
+            ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_WRITE, &addressWrite, 1, true };
+            ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_WRITE, scratch, record->writeLength, true };
+            if (record->direction == SUS_I2C_TRACE_WRITE_READ) {
+                ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_START, NULL, 0, false };
+                ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_WRITE, &addressRead, 1, true };
+                ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_READ, readBuffer, record->readLength, false };
+            }
+        }
+        ops[opCount++] = (struct SUS_SimOp){ SUS_SIMOP_STOP, NULL, 0, false };
+
+        //Re-inject the recorded error, so the error pattern is the same as in the field.
+        bus->nackProbability = (record->result == SUS_SIMBUS_NACK) ? 1.0 : 0.0;
+        bus->timeoutProbability = (record->result == SUS_SIMBUS_TIMEOUT) ? 1.0 : 0.0;
+        bus->timeout_us = record->duration_us;
+        if (record->result == SUS_SIMBUS_NACK) bus->device[record->address & 0x7F].present = false;
+
+        uint64_t busTimeBefore = bus->busTime_ns;
+        int result = SUS_SimBus_Execute(port, ops, opCount);
+        uint64_t wire_ns = bus->busTime_ns - busTimeBefore;
+        if (record->result == SUS_SIMBUS_NACK) bus->device[record->address & 0x7F].present = true;
+
+        size_t starts = (record->direction == SUS_I2C_TRACE_WRITE_READ) ? 2 : 1;
+        size_t wireBytes = record->writeLength + record->readLength + (record->address == SUS_I2C_TRACE_NO_ADDRESS ? 0 : starts);
+        uint64_t originalWire = SUS_SimBus_WireTime_ns(recordedClock[port], wireBytes, starts);
+        originalWire_ns += (record->result == 0) ? originalWire : (uint64_t)record->duration_us * 1000;
+        replayWire_ns += wire_ns;
+        if ((result == 0) != (record->result == 0)) mismatches++;
+
+        GroupAdd(&total, record, wire_ns);
+        GroupAdd(&byDirection[record->direction % 3], record, wire_ns);
+        GroupAdd(&byDevice[port][record->address], record, wire_ns);
+        if (record->result == 0) resultCount[0]++;
+        else if (record->result == SUS_SIMBUS_NACK) resultCount[1]++;
+        else if (record->result == SUS_SIMBUS_TIMEOUT) resultCount[2]++;
+        else resultCount[3]++;
+
+        if (verbose)
+            printf("%12lld us  port %d  dev %#04x  %-10s w%-4u r%-4u  %6u us (wire %6.1f us)  code %#x\n",
+                   (long long)(record->timestamp_us - records[0].timestamp_us), port, record->address,
+                   record->direction == SUS_I2C_TRACE_WRITE ? "WRITE" : record->direction == SUS_I2C_TRACE_READ ? "READ" : "WRITE+READ",
+                   record->writeLength, record->readLength, record->duration_us, wire_ns / 1000.0, (unsigned)record->result);
+    }
+    int64_t replayDuration = SUS_SimBus_Now_us() - replayStart;
+
+    //Report
+    const struct SUS_I2C_TraceRecord *last = &records[count - 1];
+    double span_s = (double)(last->timestamp_us + last->duration_us - records[0].timestamp_us) / 1e6;
+    if (span_s <= 0) span_s = 1e-6;
+
+    printf("SUS I2C trace replay: %s\n", path);
+    printf("  records: %zu (older records overwritten in the ring: %u)\n", count, header.overwrittenCount);
+    printf("  bus clock: port 0 %d Hz, port 1 %d Hz (recorded)", recordedClock[0], recordedClock[1]);
+    if (speedOverride) printf(", replayed at %d Hz", speedOverride);
+    printf("\n  trace span: %.3f s, replay took %.3f s%s\n", span_s, replayDuration / 1e6, realTime ? " (real-time pacing)" : "");
+    printf("  throughput: %.1f transactions/s, %.1f bytes/s of payload\n", total.count / span_s, total.bytes / span_s);
+    printf("  bus utilization: %.2f %% recorded, %.2f %% at replay clock\n", 100.0 * originalWire_ns / 1e9 / span_s, 100.0 * replayWire_ns / 1e9 / span_s);
+    if (speedOverride) {
+        double saved_s = ((double)originalWire_ns - (double)replayWire_ns) / 1e9;
+        printf("  projected: %.3f s of wire time %s at %d Hz (%.1f %% of the span)\n", (saved_s >= 0 ? saved_s : -saved_s), saved_s >= 0 ? "saved" : "added", speedOverride, 100.0 * (saved_s >= 0 ? saved_s : -saved_s) / span_s);
+    }
+    printf("  results: %llu OK, %llu NACK/fail, %llu timeout, %llu other; replay mismatches: %llu\n",
+           (unsigned long long)resultCount[0], (unsigned long long)resultCount[1], (unsigned long long)resultCount[2], (unsigned long long)resultCount[3], (unsigned long long)mismatches);
+
+    GroupPrintHeader("Latency by direction (recorded durations; wire = simulated bus time, sw = the rest):");
+    GroupPrint("WRITE", &byDirection[SUS_I2C_TRACE_WRITE]);
+    GroupPrint("READ", &byDirection[SUS_I2C_TRACE_READ]);
+    GroupPrint("WRITE+READ", &byDirection[SUS_I2C_TRACE_WRITE_READ]);
+    GroupPrint("all", &total);
+
+    GroupPrintHeader("Latency by device:");
+    for (int port = 0; port < SUS_SIMBUS_PORTS; port++)
+        for (int address = 0; address < 256; address++)
+        {
+            char label[32];
+            if (address == SUS_I2C_TRACE_NO_ADDRESS) snprintf(label, sizeof(label), "port%d RAW", port);
+            else snprintf(label, sizeof(label), "port%d %#04x", port, address);
+            GroupPrint(label, &byDevice[port][address]);
+        }
+
+    printf("\nError bursts (longest run of consecutive failed transactions):\n");
+    bool anyErrors = false;
+    for (int port = 0; port < SUS_SIMBUS_PORTS; port++)
+        for (int address = 0; address < 256; address++)
+            if (byDevice[port][address].errors) {
+                anyErrors = true;
+                printf("  port%d %#04x: %llu errors of %llu, longest burst %u\n", port, address,
+                       (unsigned long long)byDevice[port][address].errors, (unsigned long long)byDevice[port][address].count, byDevice[port][address].longestErrorRun);
+            }
+    if (!anyErrors) printf("  none\n");
+
+    free(blob);
+    return 0;
+}
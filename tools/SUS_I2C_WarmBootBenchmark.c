@@ -0,0 +1,305 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_WarmBootBenchmark.c
+ *
+ *    Brief:    Boots the same board again and again with SUS_I2C_WarmBoot - first cold, then warm - changes one thing at a time in between
+ *              (a device lost power, a chip was swapped, the firmware's configuration or device list changed, the snapshot got damaged),
+ *              checks that exactly the right devices got the full set-up and that every device ends up configured, and compares the boot times.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              Runs the REAL library code (SUS_I2Cmaster_FULL.h) against a simulated I2C bus (sim/SUS_I2C_SimBus.h) in real time, the snapshot
+ *              is kept in a file (SUS_I2C_StoreFile..., directory /tmp). The board:
+ *                  Port 0: IMU 0x68 (reset + 100 ms start-up), barometer 0x76 (reset + 10 ms, reads its factory calibration), a TCA9548A-style mux 0x70
+ *                          with two identical temperature sensors at 0x48 on channels 0 and 1 (2 ms each). The wires are slow (600 ns rise time):
+ *                          the cold boot calibrates the bus speed, the warm boot just sets the speed it found.
+ *                  Port 1: LED driver 0x60 (1 ms), write-only - its configuration can't be read back, so every warm boot writes it again.
+ *              Between the boots the devices keep their registers (watchdog reset, wake-up from deep sleep), unless a scenario says otherwise.
+ *              Checked after every boot: the outcome, which devices got the full set-up (and that their init function ran), every configuration
+ *              register of every device, the bus speed, and the addresses the scans found on both ports and behind both mux channels.
+ *
+ *    Build:    gcc -O2 -std=gnu11 -I sim -I ../main -o SUS_I2C_WarmBootBenchmark SUS_I2C_WarmBootBenchmark.c -lpthread
+ *    Usage:    ./SUS_I2C_WarmBootBenchmark
+ *
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "SUS_I2Cmaster_FULL.h"
+
+#define BENCH_DIRECTORY         "/tmp"
+#define BENCH_KEY               "sus_i2c_warmboot_bench"
+#define BENCH_RISE_TIME_NS      600     // Clean up to ~416 kHz.
+#define BENCH_BOOT_SPEED        400000  // Every boot starts at this speed, like a freshly started firmware.
+
+enum {BENCH_IMU, BENCH_BARO, BENCH_TEMP_A, BENCH_TEMP_B, BENCH_LED, BENCH_EXTRA, BENCH_DEVICES};
+
+/*----- The two temperature sensors behind the mux: same address, a register file per channel. -----*/
+static uint8_t  benchMuxSelect;                     // Channel bits the mux has switched on.
+static uint8_t  benchTempRegisters[2][256];
+static struct SUS_SimDevice *benchTemp;
+
+static void BenchMuxPointer(struct SUS_SimDevice *device, uint8_t value)
+{
+    (void)device;
+    benchMuxSelect = value;
+    benchTemp->present = (value & 0x03) != 0;
+}
+
+static uint8_t *BenchTempFile(void)
+{
+    return benchTempRegisters[(benchMuxSelect & 0x01) ? 0 : 1];
+}
+
+static uint8_t BenchTempRead(struct SUS_SimDevice *device, uint8_t registerAddress)
+{
+    (void)device;
+    return BenchTempFile()[registerAddress];
+}
+
+static void BenchTempWrite(struct SUS_SimDevice *device, uint8_t registerAddress, uint8_t value)
+{
+    (void)device;
+    BenchTempFile()[registerAddress] = value;
+}
+
+/*----- The LED driver: write-only, reads return 0xFF. -----*/
+static uint8_t BenchLedRead(struct SUS_SimDevice *device, uint8_t registerAddress)
+{
+    (void)device; (void)registerAddress;
+    return 0xFF;
+}
+
+/*----- Configuration tables and init functions. -----*/
+static const uint8_t benchImuConfig[][2]   = {{0x6B, 0x01}, {0x1A, 0x03}, {0x1B, 0x18}, {0x1C, 0x10}, {0x19, 0x04}};
+static const uint8_t benchBaroConfig[][2]  = {{0xF2, 0x01}, {0xF4, 0x27}, {0xF5, 0xA0}};
+static const uint8_t benchTempConfig[][2]  = {{0x01, 0x02}, {0x02, 0x20}};
+static const uint8_t benchTempConfigV2[][2] = {{0x01, 0x02}, {0x02, 0x60}};     // "Firmware update": averaging changed for sensor B.
+static const uint8_t benchLedConfig[][2]   = {{0x00, 0x01}, {0x01, 0x10}, {0x14, 0xAA}, {0x15, 0xAA}};
+static const uint8_t benchExtraConfig[][2] = {{0x10, 0x07}};
+
+static uint32_t benchInitCalls[BENCH_DEVICES];
+
+static esp_err_t BenchInit(struct SUS_I2C_WarmDevice *device)
+{
+    int index = (int)(intptr_t)device->argument;
+    static const uint32_t startUp_ms[BENCH_DEVICES] = {100, 10, 2, 2, 1, 5};
+    uint8_t calibration[24];
+
+    benchInitCalls[index]++;
+    if (index == BENCH_IMU)  SUS_I2C_WriteRegisters(device->I2CportNumber, device->I2CdeviceAddress, 0x6B, (const uint8_t[]){0x80}, 1);   //Reset.
+    if (index == BENCH_BARO) SUS_I2C_WriteRegisters(device->I2CportNumber, device->I2CdeviceAddress, 0xE0, (const uint8_t[]){0xB6}, 1);
+    vTaskDelay(startUp_ms[index] / portTICK_PERIOD_MS);
+    if (index == BENCH_BARO) return SUS_I2C_ReadRegisters(device->I2CportNumber, device->I2CdeviceAddress, 0x88, calibration, sizeof(calibration));
+    return ESP_OK;
+}
+
+static struct SUS_I2C_WarmDevice benchDevice[BENCH_DEVICES];
+
+static void BenchDescribe(bool configV2)
+{
+    benchDevice[BENCH_IMU]    = (struct SUS_I2C_WarmDevice){.name="IMU", .I2CportNumber=0, .I2CdeviceAddress=0x68, .signatureRegister=0x75, .signatureLength=1,
+                                .config=benchImuConfig, .configCount=5, .configReadable=true};
+    benchDevice[BENCH_BARO]   = (struct SUS_I2C_WarmDevice){.name="barometer", .I2CportNumber=0, .I2CdeviceAddress=0x76, .signatureRegister=0xD0, .signatureLength=1,
+                                .config=benchBaroConfig, .configCount=3, .configReadable=true};
+    benchDevice[BENCH_TEMP_A] = (struct SUS_I2C_WarmDevice){.name="temp A", .I2CportNumber=0, .I2CdeviceAddress=0x48, .muxAddress=0x70, .muxChannel=0,
+                                .signatureRegister=0x0F, .signatureLength=2, .config=benchTempConfig, .configCount=2, .configReadable=true};
+    benchDevice[BENCH_TEMP_B] = (struct SUS_I2C_WarmDevice){.name="temp B", .I2CportNumber=0, .I2CdeviceAddress=0x48, .muxAddress=0x70, .muxChannel=1,
+                                .signatureRegister=0x0F, .signatureLength=2, .config=configV2 ? benchTempConfigV2 : benchTempConfig, .configCount=2, .configReadable=true};
+    benchDevice[BENCH_LED]    = (struct SUS_I2C_WarmDevice){.name="LED driver", .I2CportNumber=1, .I2CdeviceAddress=0x60, .signatureLength=0,
+                                .config=benchLedConfig, .configCount=4, .configReadable=false};
+    benchDevice[BENCH_EXTRA]  = (struct SUS_I2C_WarmDevice){.name="new sensor", .I2CportNumber=1, .I2CdeviceAddress=0x1E, .signatureRegister=0x0A, .signatureLength=3,
+                                .config=benchExtraConfig, .configCount=1, .configReadable=true};
+    for (int i = 0; i < BENCH_DEVICES; i++) {
+        benchDevice[i].init = BenchInit;
+        benchDevice[i].argument = (void *)(intptr_t)i;
+    }
+}
+
+/*----- The chips themselves: power-on state and checks. -----*/
+static void BenchPowerOn(int index)
+{
+    struct SUS_SimDevice *chip;
+    switch (index)
+    {
+        case BENCH_IMU:
+            chip = &SUS_SimBus_Port[0].device[0x68];
+            memset(chip->registers, 0, sizeof(chip->registers));
+            chip->registers[0x75] = 0x71;
+            chip->registers[0x6B] = 0x40;       //Sleep.
+            break;
+        case BENCH_BARO:
+            chip = &SUS_SimBus_Port[0].device[0x76];
+            memset(chip->registers, 0, sizeof(chip->registers));
+            chip->registers[0xD0] = 0x60;
+            for (int r = 0; r < 24; r++) chip->registers[0x88 + r] = (uint8_t)(0x30 + r);
+            break;
+        case BENCH_TEMP_A:
+        case BENCH_TEMP_B:
+            memset(benchTempRegisters[index - BENCH_TEMP_A], 0, 256);
+            benchTempRegisters[index - BENCH_TEMP_A][0x0F] = 0x01;
+            benchTempRegisters[index - BENCH_TEMP_A][0x10] = 0x17;
+            break;
+        case BENCH_LED:
+            memset(SUS_SimBus_Port[1].device[0x60].registers, 0, 256);
+            break;
+        case BENCH_EXTRA:
+            chip = &SUS_SimBus_Port[1].device[0x1E];
+            memset(chip->registers, 0, sizeof(chip->registers));
+            memcpy(&chip->registers[0x0A], "H43", 3);
+            break;
+    }
+}
+
+static uint8_t BenchRegister(int index, uint8_t registerAddress)
+{
+    if (index == BENCH_TEMP_A || index == BENCH_TEMP_B) return benchTempRegisters[index - BENCH_TEMP_A][registerAddress];
+    return SUS_SimBus_Port[benchDevice[index].I2CportNumber].device[benchDevice[index].I2CdeviceAddress].registers[registerAddress];
+}
+
+static void BenchBoardSetUp(void)
+{
+    struct SUS_SimDevice *mux = SUS_SimBus_AddDevice(0, 0x70);
+    mux->onPointer = BenchMuxPointer;
+    benchTemp = SUS_SimBus_AddDevice(0, 0x48);
+    benchTemp->onRead = BenchTempRead;
+    benchTemp->onWrite = BenchTempWrite;
+    benchTemp->present = false;
+    SUS_SimBus_AddDevice(0, 0x68);
+    SUS_SimBus_AddDevice(0, 0x76);
+    SUS_SimBus_AddDevice(1, 0x60)->onRead = BenchLedRead;
+    SUS_SimBus_AddDevice(1, 0x1E);
+    for (int i = 0; i < BENCH_DEVICES; i++) BenchPowerOn(i);
+}
+
+/*----- One boot. -----*/
+static const struct SUS_I2C_CalibrationTarget benchTarget[2] = {{0x68, 0x75, 1}, {0x76, 0x88, 16}};
+static const struct SUS_I2C_CalibrationConfig benchCalibration = {.target = benchTarget, .targetCount = 2, .startSpeed = 100000, .maxSpeed = 1000000,
+                                                                  .stepSpeed = 100000, .transactionsPerStep = 100, .safetyMargin = 0.1f, .apply = true};
+static const struct SUS_I2C_Store benchStore = {SUS_I2C_StoreFileLoad, SUS_I2C_StoreFileSave, BENCH_DIRECTORY};
+static int benchCalibratedSpeed;
+
+static void BenchAddress(uint32_t present[4], uint8_t address) { present[address >> 5] |= 1u << (address & 31); }
+
+//The scans must find the board. A ping that fails for every address leaves the topology empty, and the boots would still pass without this.
+static int BenchCheckTopology(const struct SUS_I2C_Topology *topology)
+{
+    uint32_t expected[2][4] = {{0}}, behindMux[4] = {0};
+    int problems = 0;
+    BenchAddress(expected[0], 0x68);
+    BenchAddress(expected[0], 0x70);
+    BenchAddress(expected[0], 0x76);
+    BenchAddress(expected[1], 0x1E);
+    BenchAddress(expected[1], 0x60);
+    BenchAddress(behindMux, 0x48);
+    for (int port = 0; port < 2; port++)
+        if (memcmp(topology->present[port], expected[port], sizeof(expected[port])) != 0) { printf("!! port %d: the scan did not find the devices on the board\n", port); problems++; }
+    if (topology->channelCount != 2) { printf("!! %d mux channels in the topology, expected 2\n", topology->channelCount); problems++; }
+    for (int c = 0; c < topology->channelCount; c++)
+        if (memcmp(topology->channel[c].present, behindMux, sizeof(behindMux)) != 0) { printf("!! mux channel %d: the scan did not find the sensor behind it\n", topology->channel[c].muxChannel); problems++; }
+    return problems;
+}
+
+static int BenchBoot(const char *title, bool configV2, bool extra, bool warm, uint32_t fullSetUp, struct SUS_I2C_WarmBoot *boot)
+{
+    int problems = 0;
+    int deviceCount = extra ? BENCH_DEVICES : BENCH_EXTRA;
+
+    SUS_I2C_SetSpeed(0, BENCH_BOOT_SPEED);          //Reboot: the firmware starts at its default speed again.
+    memset(benchInitCalls, 0, sizeof(benchInitCalls));
+    BenchDescribe(configV2);
+    *boot = (struct SUS_I2C_WarmBoot){.deviceCount = deviceCount, .device = benchDevice, .store = &benchStore, .key = BENCH_KEY,
+                                      .calibration = {&benchCalibration, NULL}};
+
+    printf("\n===== %s =====\n", title);
+    uint64_t transactionsBefore = SUS_SimBus_Port[0].transactions + SUS_SimBus_Port[1].transactions;
+    SUS_Sim_LogLevel = 1;
+    esp_err_t outcome = SUS_I2C_WarmBoot(boot);
+    SUS_Sim_LogLevel = 3;
+    SUS_I2C_WarmBootPrintReport(boot);
+    printf("Transactions: %llu\n", (unsigned long long)(SUS_SimBus_Port[0].transactions + SUS_SimBus_Port[1].transactions - transactionsBefore));
+
+    if (outcome != ESP_OK) { printf("!! SUS_I2C_WarmBoot returned %#x\n", outcome); problems++; }
+    if (boot->warm != warm) { printf("!! %s boot, expected %s\n", boot->warm ? "warm" : "cold", warm ? "warm" : "cold"); problems++; }
+    if (!warm) benchCalibratedSpeed = SUS_I2C_PortSpeedHz[0];
+    if (SUS_I2C_PortSpeedHz[0] != benchCalibratedSpeed || benchCalibratedSpeed >= BENCH_BOOT_SPEED + 100000) {
+        printf("!! port 0 runs at %d Hz, the calibration chose %d Hz\n", SUS_I2C_PortSpeedHz[0], benchCalibratedSpeed);
+        problems++;
+    }
+    for (int i = 0; i < deviceCount; i++)
+    {
+        bool expectSetUp = !warm || ((fullSetUp >> i) & 1);
+        const struct SUS_I2C_WarmDevice *device = &benchDevice[i];
+        if ((device->path == SUS_I2C_WARMBOOT_INITIALIZED) != expectSetUp || benchInitCalls[i] != (expectSetUp ? 1u : 0u)) {
+            printf("!! %s: path %d, init ran %lu times, expected %s\n", device->name, device->path, (unsigned long)benchInitCalls[i], expectSetUp ? "full set-up" : "verified");
+            problems++;
+        }
+        for (int c = 0; c < device->configCount; c++)
+            if (BenchRegister(i, device->config[c][0]) != device->config[c][1]) {
+                printf("!! %s: register %#04x = %#04x, should be %#04x\n", device->name, device->config[c][0], BenchRegister(i, device->config[c][0]), device->config[c][1]);
+                problems++;
+            }
+    }
+    if (benchMuxSelect != 0) { printf("!! mux left on channels %#04x\n", benchMuxSelect); problems++; }
+    problems += BenchCheckTopology(&boot->topology);
+    return problems;
+}
+
+int main(void)
+{
+    struct SUS_I2C_WarmBoot cold, warm, boot;
+    uint32_t warmTotal_us = 0;
+    int warmBoots = 0, problems = 0;
+
+    SUS_Sim_LogLevel = 1;
+    SUS_SimBus_Init(0, BENCH_BOOT_SPEED, true);
+    SUS_SimBus_Init(1, BENCH_BOOT_SPEED, true);
+    SUS_SimBus_Port[0].riseTime_ns = BENCH_RISE_TIME_NS;
+    SUS_SimBus_Port[0].pacingSlack_ns = SUS_SimBus_Port[1].pacingSlack_ns = 1;     //Every transaction takes its wire time before it returns, the boot times are real.
+    SUS_I2C_Master_Init(0, 22, 21, BENCH_BOOT_SPEED);
+    SUS_I2C_Master_Init(1, 18, 19, BENCH_BOOT_SPEED);
+    BenchBoardSetUp();
+    remove(BENCH_DIRECTORY "/" BENCH_KEY);          //Brand new board: no snapshot yet.
+
+    problems += BenchBoot("1. First boot: cold", false, false, false, 0, &cold);
+    problems += BenchBoot("2. Reboot, nothing changed: warm", false, false, true, 0, &warm);
+    warmTotal_us += warm.total_us; warmBoots++;
+
+    BenchPowerOn(BENCH_BARO);
+    BenchPowerOn(BENCH_LED);
+    problems += BenchBoot("3. Barometer and LED driver lost power: barometer set up again, LED driver only rewritten", false, false, true, 1u << BENCH_BARO, &boot);
+    warmTotal_us += boot.total_us; warmBoots++;
+
+    SUS_SimBus_Port[0].device[0x68].registers[0x75] = 0x70;     //Other IMU revision fitted - same configuration, kept.
+    problems += BenchBoot("4. IMU swapped for another revision: IMU set up again", false, false, true, 1u << BENCH_IMU, &boot);
+    warmTotal_us += boot.total_us; warmBoots++;
+
+    problems += BenchBoot("5. Firmware update changed temp B's configuration: temp B set up again", true, false, true, 1u << BENCH_TEMP_B, &boot);
+    warmTotal_us += boot.total_us; warmBoots++;
+
+    problems += BenchBoot("6. Firmware update added a device: cold", true, true, false, 0, &boot);
+
+    FILE *file = fopen(BENCH_DIRECTORY "/" BENCH_KEY, "r+b");    //Flip one bit in the stored snapshot.
+    if (file != NULL) { fseek(file, 20, SEEK_SET); int byte = fgetc(file); fseek(file, 20, SEEK_SET); fputc(byte ^ 0x10, file); fclose(file); }
+    problems += BenchBoot("7. Damaged snapshot: cold", true, true, false, 0, &boot);
+    problems += BenchBoot("8. Reboot after that: warm", true, true, true, 0, &boot);
+    warmTotal_us += boot.total_us; warmBoots++;
+    remove(BENCH_DIRECTORY "/" BENCH_KEY);
+
+    printf("\nBring-up: cold %lu us, warm %lu us on average over %d warm boots (%.1fx faster). Unchanged board: %lu us (%.1fx faster).\n",
+           (unsigned long)cold.total_us, (unsigned long)(warmTotal_us / warmBoots), warmBoots, (double)cold.total_us * warmBoots / warmTotal_us,
+           (unsigned long)warm.total_us, (double)cold.total_us / warm.total_us);
+    printf("Command links leaked: %ld\n", SUS_Sim_LinksOutstanding);
+    printf("RESULT: %s\n", (problems == 0 && SUS_Sim_LinksOutstanding == 0) ? "PASS" : "FAIL");
+    return (problems == 0 && SUS_Sim_LinksOutstanding == 0) ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+/*==========================================================================================================================
+ * ============================================================================
+ *
+ *    Filename: SUS_I2C_SimBus.h
+ *
+ *    Brief:    Simulated I2C bus for running and benchmarking the SUS I2C library on a Linux PC.
+ *              Part of "Simple Universal Solutions" (SUS) library pack.
+ *
+ *    Device:   Linux host (x86/ARM), NOT the ESP32
+ *    Language: C
+ *
+ *    Description:
+ *              A software model of up to two I2C buses with up to 127 register-based slave devices on each of them.
+ *              Every device is just an array of 256 registers and a "register pointer", which is how most I2C sensors behave:
+ *                  - First byte written after the address selects the register (sets the pointer).
+ *                  - Every following byte written goes into the register at the pointer, and the pointer moves to the next register.
+ *                  - Every byte read comes from the register at the pointer, and the pointer moves to the next register.
+ *              The bus model also counts how long every transaction would take on a real wire at the configured clock
+ *              (9 clock pulses per byte plus START/STOP overhead) and can inject faults (NACKs, timeouts, stuck SDA) with a given probability.
+ *              A bus can also be given a signal rise time (pull-up resistance x wire capacitance): clock it too fast and bits start getting lost,
+ *              like on a real board with long wires or weak pull-ups.
+ *
+ *              This file is used by the host tools in the "tools" folder. It has nothing to do with the ESP32 build.
+ *
+*/
+#ifndef SUS_I2C_SIMBUS_H
+#define SUS_I2C_SIMBUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "esp_attr.h"
+
+#define SUS_SIMBUS_PORTS            2       // ESP32 has two I2C controllers, so does the simulator.
+#define SUS_SIMBUS_ADDRESSES        128     // 7-bit addressing.
+
+/* Error codes returned by the simulator. Values match ESP-IDF's esp_err_t codes so results can be compared directly. */
+#define SUS_SIMBUS_OK               0       // ESP_OK
+#define SUS_SIMBUS_NACK             -1      // ESP_FAIL - slave did not ACKnowledge
+#define SUS_SIMBUS_TIMEOUT          0x107   // ESP_ERR_TIMEOUT - bus stuck or clock stretched for too long
+
+/* One simulated slave device. */
+struct SUS_SimDevice
+{
+    bool     present;                   // Whether the device ACKs its address.
+    uint8_t  registers[256];            // Register file.
+    uint8_t  pointer;                   // Register pointer (auto-increments on every access).
+    uint32_t clockStretch_us;           // Extra time the device holds SCL low on every transaction.
+    uint8_t  (*onRead)(struct SUS_SimDevice *device, uint8_t registerAddress);                    // Optional: custom read behaviour (FIFOs, clear-on-read...).
+    void     (*onWrite)(struct SUS_SimDevice *device, uint8_t registerAddress, uint8_t value);    // Optional: custom write behaviour.
+    void     (*onAddressed)(struct SUS_SimDevice *device, bool read);    // Optional: called when the device ACKs its address - a new transaction (or REPEATED START) begins.
+    void     (*onPointer)(struct SUS_SimDevice *device, uint8_t value);  // Optional: called with the first byte written (the register pointer) - chips without registers (muxes...) take their command here.
+    void     *context;                  // Optional: anything the custom callbacks need.
+    uint64_t bytesRead;                 // Statistics: how many data bytes the master read from this device.
+    uint64_t bytesWritten;              // Statistics: how many data bytes the master wrote to this device (register pointer bytes included).
+};
+
+/* One simulated bus. */
+struct SUS_SimBus
+{
+    int      clockHz;                   // Bus clock. Used to compute how long the transactions take.
+    bool     realTime;                  // true = transactions really take their bus time (the calling thread waits, see SUS_SimBus_Pace). false = time is only counted.
+    double   nackProbability;           // Fault injection: probability (0.0-1.0) that a transaction gets NACKed.
+    double   timeoutProbability;        // Fault injection: probability that a transaction times out.
+    double   stuckProbability;          // Fault injection: probability that SDA gets stuck LOW until the bus is reset.
+    bool     stuck;                     // Current state of the SDA line: true = stuck LOW, every transaction times out until reset.
+    uint32_t timeout_us;                // How long a timed-out transaction blocks for.
+    uint32_t riseTime_ns;               // Time the pull-ups need to lift SDA/SCL (~0.85 x R x C). 0 = ideal wires. See SUS_SimBus_ByteErrorProbability.
+    uint32_t randomState;               // Fault injection random generator state.
+    uint64_t busTime_ns;                // Statistics: total time the bus was occupied.
+    uint64_t transactions;              // Statistics: number of transactions executed.
+    uint64_t errors;                    // Statistics: number of failed transactions.
+    int      lastResult;                // Statistics: SUS_SIMBUS_ code of the latest transaction (for callers of functions that return nothing).
+    uint64_t busyUntil_ns;              // realTime buses: where the bus timeline is (CLOCK_MONOTONIC nanoseconds).
+    uint32_t pacingSlack_ns;            // realTime buses: how far the timeline may run ahead before the caller sleeps. 0 = SUS_SIMBUS_PACING_SLACK_NS.
+    pthread_mutex_t lock;               // Only one transaction on the wire at a time, like on a real bus.
+    struct SUS_SimDevice device[SUS_SIMBUS_ADDRESSES];
+};
+
+/* A single step of a transaction, same as the ESP-IDF "command link" steps. */
+enum SUS_SimOpType { SUS_SIMOP_START, SUS_SIMOP_WRITE, SUS_SIMOP_READ, SUS_SIMOP_STOP };
+
+struct SUS_SimOp
+{
+    enum SUS_SimOpType type;
+    uint8_t  *data;                     // WRITE: bytes to put on the bus. READ: where to store the bytes read.
+    size_t   length;                    // Amount of bytes.
+    bool     checkAck;                  // WRITE only: whether a missing ACK fails the transaction.
+};
+
+SUS_SIM_SHARED struct SUS_SimBus SUS_SimBus_Port[SUS_SIMBUS_PORTS];
+
+static inline int64_t SUS_SimBus_Now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Keeps a "realTime" bus from running ahead of the wall clock. The bus keeps its own timeline (busyUntil_ns): every transaction
+ * pushes it forward by its wire time, and the calling thread only sleeps once the timeline is more than SUS_SIMBUS_PACING_SLACK_NS ahead.
+ * Sleeping in bigger chunks keeps the host's sleep inaccuracy (often 100us+) out of the throughput numbers, and because the thread
+ * sleeps instead of spinning, two simulated buses really work in parallel even on a single-core machine - just like two I2C controllers do.
+ * Latency measurements want the opposite (a transaction should not return long before it would be over on a real wire): set pacingSlack_ns lower for those.
+ */
+#define SUS_SIMBUS_PACING_SLACK_NS  2000000
+
+static inline void SUS_SimBus_Pace(struct SUS_SimBus *bus, uint64_t wire_ns)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    if (bus->busyUntil_ns < now_ns) bus->busyUntil_ns = now_ns;
+    bus->busyUntil_ns += wire_ns;
+    if (bus->busyUntil_ns - now_ns > (bus->pacingSlack_ns ? bus->pacingSlack_ns : SUS_SIMBUS_PACING_SLACK_NS))
+    {
+        struct timespec until = { (time_t)(bus->busyUntil_ns / 1000000000ull), (long)(bus->busyUntil_ns % 1000000000ull) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+    }
+}
+
+static inline double SUS_SimBus_Random(struct SUS_SimBus *bus)
+{
+    bus->randomState ^= bus->randomState << 13;     // xorshift32 - fast, deterministic, good enough for fault injection.
+    bus->randomState ^= bus->randomState >> 17;
+    bus->randomState ^= bus->randomState << 5;
+    return (double)bus->randomState / 4294967296.0;
+}
+
+/** Returns how long (in nanoseconds) a transaction with the given amount of bytes and START conditions takes on the wire.
+ * Every byte is 8 data bits + 1 ACK bit = 9 clock pulses. Every START (or repeated START) and the final STOP costs roughly one more clock pulse each.
+ */
+static inline uint64_t SUS_SimBus_WireTime_ns(int clockHz, size_t bytes, size_t starts)
+{
+    if (clockHz <= 0) clockHz = 100000;
+    return ((uint64_t)bytes * 9 + starts + 1) * 1000000000ull / (uint64_t)clockHz;
+}
+
+/** Probability that a single byte gets garbled at the current clock, given the rise time of the bus.
+ * While the line rises in less than a quarter of the clock period nothing happens. Beyond that, the receiver samples the bit before
+ * the line has reached a solid HIGH more and more often, until at rise time = half a period (the whole HIGH phase) every byte is lost.
+ */
+static inline double SUS_SimBus_ByteErrorProbability(struct SUS_SimBus *bus)
+{
+    if (bus->riseTime_ns == 0 || bus->clockHz <= 0) return 0.0;
+    double ratio = (double)bus->riseTime_ns / (500000000.0 / bus->clockHz);     // Rise time relative to half a clock period.
+    if (ratio <= 0.5) return 0.0;
+    return ratio >= 1.0 ? 1.0 : (ratio - 0.5) * 2.0;
+}
+
+/** Resets the bus model to an empty bus running at the given clock. */
+static inline void SUS_SimBus_Init(int port, int clockHz, bool realTime)
+{
+    struct SUS_SimBus *bus = &SUS_SimBus_Port[port];
+    memset(bus, 0, sizeof(*bus));
+    bus->clockHz = clockHz;
+    bus->realTime = realTime;
+    bus->timeout_us = 10000;
+    bus->randomState = 0x5EED1234u + (uint32_t)port;
+    pthread_mutex_init(&bus->lock, NULL);
+}
+
+/** Connects a simulated register-based device to the bus and returns it, so its registers can be pre-loaded. */
+static inline struct SUS_SimDevice *SUS_SimBus_AddDevice(int port, uint8_t address)
+{
+    struct SUS_SimDevice *device = &SUS_SimBus_Port[port].device[address & 0x7F];
+    memset(device, 0, sizeof(*device));
+    device->present = true;
+    return device;
+}
+
+/** Sets fault injection probabilities (0.0 - 1.0) for the given bus. */
+static inline void SUS_SimBus_SetFaults(int port, double nackProbability, double timeoutProbability, double stuckProbability)
+{
+    SUS_SimBus_Port[port].nackProbability = nackProbability;
+    SUS_SimBus_Port[port].timeoutProbability = timeoutProbability;
+    SUS_SimBus_Port[port].stuckProbability = stuckProbability;
+}
+
+/** Executes a list of START/WRITE/READ/STOP steps on the simulated bus. Returns one of the SUS_SIMBUS_ codes.
+ * A sequence of STOP-START-STOP without any bytes (what SUS_I2C_ResetBus sends) un-sticks a stuck bus.
+ */
+static inline int SUS_SimBus_Execute(int port, struct SUS_SimOp *ops, size_t opCount)
+{
+    struct SUS_SimBus *bus = &SUS_SimBus_Port[port];
+    struct SUS_SimDevice *device = NULL;
+    bool expectAddress = false, readMode = false, pointerSet = false, generalCall = false;
+    size_t bytes = 0, starts = 0;
+    uint32_t stretch_us = 0;
+    int result = SUS_SIMBUS_OK;
+    double dice, byteError;
+
+    pthread_mutex_lock(&bus->lock);
+    byteError = SUS_SimBus_ByteErrorProbability(bus);
+
+    //Bus recovery sequence: no data bytes at all in the sequence.
+    bool recovery = true;
+    for (size_t i = 0; i < opCount; i++) if (ops[i].type == SUS_SIMOP_WRITE || ops[i].type == SUS_SIMOP_READ) recovery = false;
+    if (recovery) bus->stuck = false;
+
+    dice = SUS_SimBus_Random(bus);
+    if (!recovery && !bus->stuck && dice < bus->stuckProbability) bus->stuck = true;
+    if (bus->stuck) result = SUS_SIMBUS_TIMEOUT;
+    else if (!recovery && dice < bus->stuckProbability + bus->timeoutProbability) result = SUS_SIMBUS_TIMEOUT;
+
+    for (size_t i = 0; i < opCount && result == SUS_SIMBUS_OK; i++)
+    {
+        struct SUS_SimOp *op = &ops[i];
+        switch (op->type)
+        {
+        case SUS_SIMOP_START:
+            starts++;
+            expectAddress = true;
+            break;
+        case SUS_SIMOP_STOP:
+            device = NULL;
+            pointerSet = false;
+            generalCall = false;
+            break;
+        case SUS_SIMOP_WRITE:
+            for (size_t b = 0; b < op->length && result == SUS_SIMBUS_OK; b++)
+            {
+                uint8_t value = op->data[b];
+                bytes++;
+                if (byteError > 0.0 && SUS_SimBus_Random(bus) < byteError)      //Slow edges: the slave missed a bit and doesn't ACK.
+                {
+                    if (op->checkAck) result = SUS_SIMBUS_NACK;
+                    device = NULL;
+                    expectAddress = false;
+                    continue;
+                }
+                if (expectAddress)
+                {
+                    expectAddress = false;
+                    readMode = value & 1;
+                    generalCall = (value >> 1) == 0 && !readMode;
+                    device = &bus->device[value >> 1];
+                    if (generalCall) continue;                                  //General call (address 0): everybody listens, nobody has to ACK individually.
+                    if (!device->present || SUS_SimBus_Random(bus) < bus->nackProbability)
+                    {
+                        if (op->checkAck) result = SUS_SIMBUS_NACK;
+                        device = NULL;
+                    }
+                    if (!readMode) pointerSet = false;                          //Every write-mode address phase starts with a new register pointer byte.
+                    if (device) stretch_us += device->clockStretch_us;
+                    if (device && device->onAddressed) device->onAddressed(device, readMode);
+                    continue;
+                }
+                if (generalCall)
+                {
+                    for (int a = 1; a < SUS_SIMBUS_ADDRESSES; a++)              //Deliver the general call byte to every present device that has a custom write handler.
+                        if (bus->device[a].present && bus->device[a].onWrite) bus->device[a].onWrite(&bus->device[a], 0x00, value);
+                    continue;
+                }
+                if (device == NULL) continue;
+                if (!pointerSet) {
+                    device->pointer = value; pointerSet = true; device->bytesWritten++;
+                    if (device->onPointer) device->onPointer(device, value);
+                    continue;
+                }
+                if (device->onWrite) device->onWrite(device, device->pointer, value);
+                else device->registers[device->pointer] = value;
+                device->pointer++;
+                device->bytesWritten++;
+            }
+            break;
+        case SUS_SIMOP_READ:
+            for (size_t b = 0; b < op->length; b++)
+            {
+                bytes++;
+                if (device == NULL || !readMode) { op->data[b] = 0xFF; continue; } //Nobody drives SDA: pullups make it read as 0xFF.
+                op->data[b] = device->onRead ? device->onRead(device, device->pointer) : device->registers[device->pointer];
+                if (byteError > 0.0 && SUS_SimBus_Random(bus) < byteError) op->data[b] ^= (uint8_t)(1u << (bus->randomState & 7));   //Slow edges: one bit read wrong.
+                device->pointer++;
+                device->bytesRead++;
+            }
+            break;
+        }
+    }
+
+    uint64_t wire_ns = SUS_SimBus_WireTime_ns(bus->clockHz, bytes, starts);
+    wire_ns += (uint64_t)stretch_us * 1000;
+    if (result == SUS_SIMBUS_TIMEOUT) wire_ns = (uint64_t)bus->timeout_us * 1000;
+
+    bus->busTime_ns += wire_ns;
+    bus->transactions++;
+    if (result != SUS_SIMBUS_OK) bus->errors++;
+    bus->lastResult = result;
+    if (bus->realTime) SUS_SimBus_Pace(bus, wire_ns);
+
+    pthread_mutex_unlock(&bus->lock);
+    return result;
+}
+
+#endif /* SUS_I2C_SIMBUS_H */
@@ -0,0 +1,250 @@
+/* Host (Linux) stand-in for ESP-IDF's legacy "driver/i2c.h" master API. Used only by the SUS I2C simulator tools.
+ * Command links are recorded into a list of steps and executed on the simulated bus from SUS_I2C_SimBus.h.
+ * The shim also counts command links that were created but never deleted, so the tools can report leaks.
+ */
+#ifndef SUS_SIM_DRIVER_I2C_H
+#define SUS_SIM_DRIVER_I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "SUS_I2C_SimBus.h"
+
+typedef int i2c_port_t;
+typedef int i2c_mode_t;
+typedef int i2c_ack_type_t;
+
+#define I2C_NUM_0               0
+#define I2C_NUM_1               1
+#define I2C_NUM_MAX             2
+#define I2C_MODE_SLAVE          0
+#define I2C_MODE_MASTER         1
+#define I2C_MASTER_WRITE        0
+#define I2C_MASTER_READ         1
+#define I2C_MASTER_ACK          0
+#define I2C_MASTER_NACK         1
+#define I2C_MASTER_LAST_NACK    2
+#define GPIO_PULLUP_DISABLE     0
+#define GPIO_PULLUP_ENABLE      1
+#define I2C_SCLK_SRC_FLAG_FOR_NOMAL 0
+#define SUS_SIM_MAX_STEPS       32
+#define I2C_LINK_RECOMMENDED_SIZE(TRANSACTIONS) (sizeof(struct SUS_SimCommandLink))
+
+typedef struct
+{
+    i2c_mode_t mode;
+    int sda_io_num;
+    int scl_io_num;
+    bool sda_pullup_en;
+    bool scl_pullup_en;
+    struct { uint32_t clk_speed; } master;
+    uint32_t clk_flags;
+} i2c_config_t;
+
+struct SUS_SimCommandLink
+{
+    struct SUS_SimOp op[SUS_SIM_MAX_STEPS];
+    uint8_t byteStorage[SUS_SIM_MAX_STEPS];     // Single bytes from i2c_master_write_byte are copied here.
+    size_t count;
+    bool isStatic;
+};
+typedef struct SUS_SimCommandLink *i2c_cmd_handle_t;
+
+SUS_SIM_SHARED bool SUS_Sim_DriverInstalled[I2C_NUM_MAX];
+SUS_SIM_SHARED long SUS_Sim_LinksOutstanding;           // Command links created but not yet deleted. Anything above 0 at the end of a run is a leak.
+SUS_SIM_SHARED long SUS_Sim_LinksOutstandingPeak;
+SUS_SIM_SHARED pthread_mutex_t SUS_Sim_LinkLock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || config == NULL) return ESP_ERR_INVALID_ARG;
+    SUS_SimBus_Port[port].clockHz = (int)config->master.clk_speed;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slaveRxBuffer, size_t slaveTxBuffer, int interruptFlags)
+{
+    (void)mode; (void)slaveRxBuffer; (void)slaveTxBuffer; (void)interruptFlags;
+    if (port < 0 || port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    if (SUS_Sim_DriverInstalled[port]) return ESP_FAIL;
+    SUS_Sim_DriverInstalled[port] = true;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_driver_delete(i2c_port_t port)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || !SUS_Sim_DriverInstalled[port]) return ESP_ERR_INVALID_STATE;
+    SUS_Sim_DriverInstalled[port] = false;
+    return ESP_OK;
+}
+
+/* Bus timing. The ESP32 counts SCL HIGH/LOW phases in cycles of the 80MHz APB clock - the simulated bus clock follows the period.
+ * Values that don't fit their register fields are refused, like ESP-IDF does. */
+#define SUS_SIM_APB_CLOCK_HZ    80000000
+#define SUS_SIM_PERIOD_MAX      0x3FFF          // SCL HIGH/LOW period fields: 14 bits.
+#define SUS_SIM_TIMING_MAX      0x3FF           // START/STOP setup/hold, SDA sample/hold fields: 10 bits.
+#define SUS_SIM_TIMEOUT_MAX     0xFFFFF         // Timeout field: 20 bits.
+SUS_SIM_SHARED int SUS_Sim_Timing[I2C_NUM_MAX][7];      // high, low, start setup/hold, stop setup/hold, timeout - only kept so they can be read back.
+
+static inline esp_err_t i2c_set_period(i2c_port_t port, int highPeriod, int lowPeriod)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || highPeriod <= 0 || lowPeriod <= 0 || highPeriod > SUS_SIM_PERIOD_MAX || lowPeriod > SUS_SIM_PERIOD_MAX) return ESP_ERR_INVALID_ARG;
+    SUS_Sim_Timing[port][0] = highPeriod;
+    SUS_Sim_Timing[port][1] = lowPeriod;
+    pthread_mutex_lock(&SUS_SimBus_Port[port].lock);
+    SUS_SimBus_Port[port].clockHz = SUS_SIM_APB_CLOCK_HZ / (highPeriod + lowPeriod);
+    pthread_mutex_unlock(&SUS_SimBus_Port[port].lock);
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_get_period(i2c_port_t port, int *highPeriod, int *lowPeriod)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || highPeriod == NULL || lowPeriod == NULL) return ESP_ERR_INVALID_ARG;
+    *highPeriod = SUS_Sim_Timing[port][0];
+    *lowPeriod = SUS_Sim_Timing[port][1];
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_set_start_timing(i2c_port_t port, int setupTime, int holdTime)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || setupTime <= 0 || holdTime <= 0 || setupTime > SUS_SIM_TIMING_MAX || holdTime > SUS_SIM_TIMING_MAX) return ESP_ERR_INVALID_ARG;
+    SUS_Sim_Timing[port][2] = setupTime; SUS_Sim_Timing[port][3] = holdTime;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_set_stop_timing(i2c_port_t port, int setupTime, int holdTime)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || setupTime <= 0 || holdTime <= 0 || setupTime > SUS_SIM_TIMING_MAX || holdTime > SUS_SIM_TIMING_MAX) return ESP_ERR_INVALID_ARG;
+    SUS_Sim_Timing[port][4] = setupTime; SUS_Sim_Timing[port][5] = holdTime;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_set_data_timing(i2c_port_t port, int sampleTime, int holdTime)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || sampleTime <= 0 || holdTime <= 0 || sampleTime > SUS_SIM_TIMING_MAX || holdTime > SUS_SIM_TIMING_MAX) return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_set_timeout(i2c_port_t port, int timeout)
+{
+    if (port < 0 || port >= I2C_NUM_MAX || timeout <= 0 || timeout > SUS_SIM_TIMEOUT_MAX) return ESP_ERR_INVALID_ARG;
+    SUS_Sim_Timing[port][6] = timeout;
+    return ESP_OK;
+}
+
+static inline i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    struct SUS_SimCommandLink *link = (struct SUS_SimCommandLink *)calloc(1, sizeof(*link));
+    pthread_mutex_lock(&SUS_Sim_LinkLock);
+    if (++SUS_Sim_LinksOutstanding > SUS_Sim_LinksOutstandingPeak) SUS_Sim_LinksOutstandingPeak = SUS_Sim_LinksOutstanding;
+    pthread_mutex_unlock(&SUS_Sim_LinkLock);
+    return link;
+}
+
+static inline void i2c_cmd_link_delete(i2c_cmd_handle_t link)
+{
+    if (link == NULL) return;
+    pthread_mutex_lock(&SUS_Sim_LinkLock);
+    SUS_Sim_LinksOutstanding--;
+    pthread_mutex_unlock(&SUS_Sim_LinkLock);
+    free(link);
+}
+
+static inline i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size)
+{
+    if (buffer == NULL || size < sizeof(struct SUS_SimCommandLink)) return NULL;
+    struct SUS_SimCommandLink *link = (struct SUS_SimCommandLink *)buffer;
+    memset(link, 0, sizeof(*link));
+    link->isStatic = true;
+    return link;
+}
+
+static inline void i2c_cmd_link_delete_static(i2c_cmd_handle_t link) { (void)link; }
+
+static inline esp_err_t SUS_Sim_AddStep(i2c_cmd_handle_t link, enum SUS_SimOpType type, uint8_t *data, size_t length, bool checkAck)
+{
+    if (link == NULL) return ESP_ERR_INVALID_ARG;
+    if (link->count >= SUS_SIM_MAX_STEPS) return ESP_ERR_NO_MEM;
+    link->op[link->count].type = type;
+    link->op[link->count].data = data;
+    link->op[link->count].length = length;
+    link->op[link->count].checkAck = checkAck;
+    link->count++;
+    return ESP_OK;
+}
+
+static inline esp_err_t i2c_master_start(i2c_cmd_handle_t link) { return SUS_Sim_AddStep(link, SUS_SIMOP_START, NULL, 0, false); }
+static inline esp_err_t i2c_master_stop(i2c_cmd_handle_t link)  { return SUS_Sim_AddStep(link, SUS_SIMOP_STOP, NULL, 0, false); }
+
+static inline esp_err_t i2c_master_write_byte(i2c_cmd_handle_t link, uint8_t data, bool ackEnable)
+{
+    if (link == NULL || link->count >= SUS_SIM_MAX_STEPS) return ESP_ERR_NO_MEM;
+    link->byteStorage[link->count] = data;
+    return SUS_Sim_AddStep(link, SUS_SIMOP_WRITE, &link->byteStorage[link->count], 1, ackEnable);
+}
+
+static inline esp_err_t i2c_master_write(i2c_cmd_handle_t link, const uint8_t *data, size_t length, bool ackEnable)
+{
+    if (data == NULL) return ESP_ERR_INVALID_ARG;      //Like ESP-IDF: no buffer, no step - even for 0 bytes.
+    return SUS_Sim_AddStep(link, SUS_SIMOP_WRITE, (uint8_t *)data, length, ackEnable);
+}
+
+static inline esp_err_t i2c_master_read(i2c_cmd_handle_t link, uint8_t *data, size_t length, i2c_ack_type_t ack)
+{
+    (void)ack;
+    if (data == NULL || length == 0) return ESP_ERR_INVALID_ARG;      //Like ESP-IDF.
+    return SUS_Sim_AddStep(link, SUS_SIMOP_READ, data, length, false);
+}
+
+static inline esp_err_t i2c_master_read_byte(i2c_cmd_handle_t link, uint8_t *data, i2c_ack_type_t ack)
+{
+    return i2c_master_read(link, data, 1, ack);
+}
+
+static inline esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t link, TickType_t ticksToWait)
+{
+    (void)ticksToWait;
+    if (port < 0 || port >= I2C_NUM_MAX || link == NULL) return ESP_ERR_INVALID_ARG;
+    if (!SUS_Sim_DriverInstalled[port]) return ESP_ERR_INVALID_STATE;
+    return SUS_SimBus_Execute(port, link->op, link->count);
+}
+
+static inline esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t address, const uint8_t *writeBuffer, size_t writeSize, TickType_t ticksToWait)
+{
+    struct SUS_SimCommandLink link;
+    memset(&link, 0, sizeof(link));
+    esp_err_t outcome = i2c_master_start(&link);
+    if (outcome == ESP_OK) outcome = i2c_master_write_byte(&link, (uint8_t)(address << 1) | I2C_MASTER_WRITE, true);
+    if (outcome == ESP_OK) outcome = i2c_master_write(&link, writeBuffer, writeSize, true);
+    if (outcome == ESP_OK) outcome = i2c_master_stop(&link);
+    return outcome == ESP_OK ? i2c_master_cmd_begin(port, &link, ticksToWait) : outcome;     //Like ESP-IDF: a refused step (NULL buffer...) ends it before the bus.
+}
+
+static inline esp_err_t i2c_master_read_from_device(i2c_port_t port, uint8_t address, uint8_t *readBuffer, size_t readSize, TickType_t ticksToWait)
+{
+    struct SUS_SimCommandLink link;
+    memset(&link, 0, sizeof(link));
+    esp_err_t outcome = i2c_master_start(&link);
+    if (outcome == ESP_OK) outcome = i2c_master_write_byte(&link, (uint8_t)(address << 1) | I2C_MASTER_READ, true);
+    if (outcome == ESP_OK) outcome = i2c_master_read(&link, readBuffer, readSize, I2C_MASTER_LAST_NACK);
+    if (outcome == ESP_OK) outcome = i2c_master_stop(&link);
+    return outcome == ESP_OK ? i2c_master_cmd_begin(port, &link, ticksToWait) : outcome;
+}
+
+static inline esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t address, const uint8_t *writeBuffer, size_t writeSize, uint8_t *readBuffer, size_t readSize, TickType_t ticksToWait)
+{
+    struct SUS_SimCommandLink link;
+    memset(&link, 0, sizeof(link));
+    esp_err_t outcome = i2c_master_start(&link);
+    if (outcome == ESP_OK) outcome = i2c_master_write_byte(&link, (uint8_t)(address << 1) | I2C_MASTER_WRITE, true);
+    if (outcome == ESP_OK) outcome = i2c_master_write(&link, writeBuffer, writeSize, true);
+    if (outcome == ESP_OK) outcome = i2c_master_start(&link);
+    if (outcome == ESP_OK) outcome = i2c_master_write_byte(&link, (uint8_t)(address << 1) | I2C_MASTER_READ, true);
+    if (outcome == ESP_OK) outcome = i2c_master_read(&link, readBuffer, readSize, I2C_MASTER_LAST_NACK);
+    if (outcome == ESP_OK) outcome = i2c_master_stop(&link);
+    return outcome == ESP_OK ? i2c_master_cmd_begin(port, &link, ticksToWait) : outcome;
+}
+
+#endif
@@ -0,0 +1,21 @@
+/* Host (Linux) stand-in for ESP-IDF's esp_attr.h. Used only by the SUS I2C simulator tools. */
+#ifndef SUS_SIM_ESP_ATTR_H
+#define SUS_SIM_ESP_ATTR_H
+
+#ifdef SUS_SIM_SIZE_REPORT
+#define IRAM_ATTR       __attribute__((section(".iram1")))     // Size report: IRAM code gets counted as IRAM, like on the ESP32.
+#else
+#define IRAM_ATTR
+#endif
+#define DRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+/* Simulator state that must stay ONE variable when several .c files include the shims (compiled component build, see CMakeLists.txt).
+ * The size report moves it out of the way: it is not part of the library. */
+#ifdef SUS_SIM_SIZE_REPORT
+#define SUS_SIM_SHARED  __attribute__((weak, section(".sim_state")))
+#else
+#define SUS_SIM_SHARED  __attribute__((weak))
+#endif
+
+#endif
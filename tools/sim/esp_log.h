@@ -0,0 +1,28 @@
+/* Host (Linux) stand-in for ESP-IDF's esp_log.h. Used only by the SUS I2C simulator tools.
+ * Set SUS_Sim_LogLevel to 0 to silence the library (benchmarks), 3 to see everything.
+ * LOG_LOCAL_LEVEL works like in ESP-IDF: defined before the first #include, it removes the weaker messages at compile time.
+ */
+#ifndef SUS_SIM_ESP_LOG_H
+#define SUS_SIM_ESP_LOG_H
+#include <stdio.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#define ESP_LOG_NONE    0
+#define ESP_LOG_ERROR   1
+#define ESP_LOG_WARN    2
+#define ESP_LOG_INFO    3
+#define ESP_LOG_DEBUG   4
+#define ESP_LOG_VERBOSE 5
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ESP_LOG_INFO
+#endif
+
+SUS_SIM_SHARED int SUS_Sim_LogLevel = 3;   // 0 = silent, 1 = errors, 2 = +warnings, 3 = +info
+
+#define ESP_LOGE(tag, format, ...) do { if (LOG_LOCAL_LEVEL >= 1 && SUS_Sim_LogLevel >= 1) printf("E (%s) " format "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGW(tag, format, ...) do { if (LOG_LOCAL_LEVEL >= 2 && SUS_Sim_LogLevel >= 2) printf("W (%s) " format "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGI(tag, format, ...) do { if (LOG_LOCAL_LEVEL >= 3 && SUS_Sim_LogLevel >= 3) printf("I (%s) " format "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, format, ...) do { } while (0)
+
+#endif
@@ -0,0 +1,116 @@
+/* Host (Linux) stand-in for ESP-IDF's esp_timer.h. Used only by the SUS I2C simulator tools.
+ * One-shot and periodic timers run their callback from a helper thread, like ESP-IDF's "esp_timer" task does.
+ */
+#ifndef SUS_SIM_ESP_TIMER_H
+#define SUS_SIM_ESP_TIMER_H
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "SUS_I2C_SimBus.h"
+
+typedef void (*esp_timer_cb_t)(void *argument);
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    int dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct SUS_SimTimer
+{
+    esp_timer_cb_t callback;
+    void *argument;
+    int64_t due_us;
+    uint64_t period_us;
+    bool armed, quit;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+typedef struct SUS_SimTimer *esp_timer_handle_t;
+
+static inline int64_t esp_timer_get_time(void) { return SUS_SimBus_Now_us(); }
+
+static inline void *SUS_Sim_TimerThread(void *argument)
+{
+    struct SUS_SimTimer *timer = (struct SUS_SimTimer *)argument;
+    pthread_mutex_lock(&timer->lock);
+    while (!timer->quit)
+    {
+        if (!timer->armed) { pthread_cond_wait(&timer->changed, &timer->lock); continue; }
+        int64_t wait_us = timer->due_us - esp_timer_get_time();
+        if (wait_us > 0)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += wait_us / 1000000;
+            deadline.tv_nsec += (wait_us % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) { deadline.tv_sec++; deadline.tv_nsec -= 1000000000L; }
+            pthread_cond_timedwait(&timer->changed, &timer->lock, &deadline);
+            continue;
+        }
+        if (timer->period_us) timer->due_us += (int64_t)timer->period_us;
+        else timer->armed = false;
+        pthread_mutex_unlock(&timer->lock);
+        timer->callback(timer->argument);
+        pthread_mutex_lock(&timer->lock);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    return NULL;
+}
+
+static inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    if (args == NULL || args->callback == NULL || handle == NULL) return ESP_ERR_INVALID_ARG;
+    struct SUS_SimTimer *timer = (struct SUS_SimTimer *)calloc(1, sizeof(*timer));
+    if (timer == NULL) return ESP_ERR_NO_MEM;
+    timer->callback = args->callback;
+    timer->argument = args->arg;
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_cond_init(&timer->changed, NULL);
+    pthread_create(&timer->thread, NULL, SUS_Sim_TimerThread, timer);
+    *handle = timer;
+    return ESP_OK;
+}
+
+static inline esp_err_t SUS_Sim_TimerArm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    pthread_mutex_lock(&timer->lock);
+    timer->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->period_us = period_us;
+    timer->armed = true;
+    pthread_cond_signal(&timer->changed);
+    pthread_mutex_unlock(&timer->lock);
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) { return SUS_Sim_TimerArm(timer, timeout_us, 0); }
+static inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) { return SUS_Sim_TimerArm(timer, period_us, period_us); }
+
+static inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t result;
+    pthread_mutex_lock(&timer->lock);
+    result = timer->armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    pthread_cond_signal(&timer->changed);
+    pthread_mutex_unlock(&timer->lock);
+    return result;
+}
+
+static inline esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer->lock);
+    timer->quit = true;
+    pthread_cond_signal(&timer->changed);
+    pthread_mutex_unlock(&timer->lock);
+    pthread_join(timer->thread, NULL);
+    free(timer);
+    return ESP_OK;
+}
+
+#endif
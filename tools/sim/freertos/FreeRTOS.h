@@ -0,0 +1,64 @@
+/* Host (Linux) stand-in for FreeRTOS as shipped with ESP-IDF. Used only by the SUS I2C simulator tools.
+ * Tasks are pthreads, queues and semaphores are mutex + condition variable, one tick is one millisecond.
+ * "FromISR" variants behave exactly like the regular ones - there are no interrupts on the host.
+ */
+#ifndef SUS_SIM_FREERTOS_H
+#define SUS_SIM_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "esp_attr.h"                  /* ESP-IDF's FreeRTOS pulls in IRAM_ATTR & co. too. */
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  1
+#define pdFAIL                  0
+#define errQUEUE_FULL           0
+#define portMAX_DELAY           0xFFFFFFFFu
+#define portTICK_PERIOD_MS      1
+#define configTICK_RATE_HZ      1000
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+/* Critical sections ("spinlocks" on ESP32) */
+typedef struct { pthread_mutex_t mutex; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { PTHREAD_MUTEX_INITIALIZER }
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(&(mux)->mutex)
+#define portENTER_CRITICAL_ISR(mux)     pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL_ISR(mux)      pthread_mutex_unlock(&(mux)->mutex)
+#define portYIELD_FROM_ISR(woken)       do { (void)(woken); } while (0)
+
+static inline void *pvPortMalloc(size_t size) { return malloc(size); }
+static inline void vPortFree(void *pointer) { free(pointer); }
+
+/* Converts a tick timeout into an absolute deadline for pthread_cond_timedwait. */
+static inline struct timespec SUS_Sim_Deadline(TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) { deadline.tv_sec++; deadline.tv_nsec -= 1000000000L; }
+    return deadline;
+}
+
+/* Waits on a condition variable for at most "ticks". Returns false on timeout. */
+static inline bool SUS_Sim_Wait(pthread_cond_t *condition, pthread_mutex_t *mutex, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) { pthread_cond_wait(condition, mutex); return true; }
+    struct timespec deadline = SUS_Sim_Deadline(ticks);
+    return pthread_cond_timedwait(condition, mutex, &deadline) != ETIMEDOUT;
+}
+
+#endif
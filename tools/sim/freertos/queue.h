@@ -0,0 +1,76 @@
+/* Host (Linux) stand-in for FreeRTOS queue.h. Used only by the SUS I2C simulator tools. */
+#ifndef SUS_SIM_QUEUE_H
+#define SUS_SIM_QUEUE_H
+#include "FreeRTOS.h"
+
+struct SUS_SimQueue
+{
+    uint8_t *storage;
+    UBaseType_t length, itemSize, head, count;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+typedef struct SUS_SimQueue *QueueHandle_t;
+
+static inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    struct SUS_SimQueue *queue = (struct SUS_SimQueue *)calloc(1, sizeof(*queue));
+    if (queue == NULL) return NULL;
+    queue->storage = (uint8_t *)calloc(length ? length : 1, itemSize ? itemSize : 1);
+    queue->length = length;
+    queue->itemSize = itemSize;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+    return queue;
+}
+
+static inline void vQueueDelete(QueueHandle_t queue)
+{
+    if (queue == NULL) return;
+    free(queue->storage);
+    free(queue);
+}
+
+static inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length)
+        if (ticksToWait == 0 || !SUS_Sim_Wait(&queue->changed, &queue->lock, ticksToWait)) { pthread_mutex_unlock(&queue->lock); return errQUEUE_FULL; }
+    memcpy(queue->storage + ((queue->head + queue->count) % queue->length) * queue->itemSize, item, queue->itemSize);
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+#define xQueueSendToBack(queue, item, ticks) xQueueSend(queue, item, ticks)
+
+static inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken)
+{
+    BaseType_t result = xQueueSend(queue, item, 0);
+    if (higherPriorityTaskWoken && result == pdPASS) *higherPriorityTaskWoken = pdTRUE;
+    return result;
+}
+
+static inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0)
+        if (ticksToWait == 0 || !SUS_Sim_Wait(&queue->changed, &queue->lock, ticksToWait)) { pthread_mutex_unlock(&queue->lock); return pdFALSE; }
+    memcpy(item, queue->storage + queue->head * queue->itemSize, queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+static inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    UBaseType_t count;
+    pthread_mutex_lock(&queue->lock);
+    count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+#endif
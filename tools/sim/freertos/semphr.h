@@ -0,0 +1,56 @@
+/* Host (Linux) stand-in for FreeRTOS semphr.h. Used only by the SUS I2C simulator tools. */
+#ifndef SUS_SIM_SEMPHR_H
+#define SUS_SIM_SEMPHR_H
+#include "FreeRTOS.h"
+
+struct SUS_SimSemaphore
+{
+    UBaseType_t count, maximum;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+typedef struct SUS_SimSemaphore *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t SUS_Sim_SemaphoreCreate(UBaseType_t maximum, UBaseType_t initial)
+{
+    struct SUS_SimSemaphore *semaphore = (struct SUS_SimSemaphore *)calloc(1, sizeof(*semaphore));
+    if (semaphore == NULL) return NULL;
+    semaphore->count = initial;
+    semaphore->maximum = maximum;
+    pthread_mutex_init(&semaphore->lock, NULL);
+    pthread_cond_init(&semaphore->changed, NULL);
+    return semaphore;
+}
+#define xSemaphoreCreateMutex()                     SUS_Sim_SemaphoreCreate(1, 1)
+#define xSemaphoreCreateBinary()                    SUS_Sim_SemaphoreCreate(1, 0)
+#define xSemaphoreCreateCounting(maximum, initial)  SUS_Sim_SemaphoreCreate(maximum, initial)
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) { free(semaphore); }
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    pthread_mutex_lock(&semaphore->lock);
+    while (semaphore->count == 0)
+        if (ticksToWait == 0 || !SUS_Sim_Wait(&semaphore->changed, &semaphore->lock, ticksToWait)) { pthread_mutex_unlock(&semaphore->lock); return pdFALSE; }
+    semaphore->count--;
+    pthread_mutex_unlock(&semaphore->lock);
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    BaseType_t result = pdFALSE;
+    pthread_mutex_lock(&semaphore->lock);
+    if (semaphore->count < semaphore->maximum) { semaphore->count++; result = pdTRUE; pthread_cond_signal(&semaphore->changed); }
+    pthread_mutex_unlock(&semaphore->lock);
+    return result;
+}
+
+static inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *higherPriorityTaskWoken)
+{
+    BaseType_t result = xSemaphoreGive(semaphore);
+    if (higherPriorityTaskWoken && result == pdTRUE) *higherPriorityTaskWoken = pdTRUE;
+    return result;
+}
+
+#endif
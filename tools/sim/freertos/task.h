@@ -0,0 +1,124 @@
+/* Host (Linux) stand-in for FreeRTOS task.h. Used only by the SUS I2C simulator tools. */
+#ifndef SUS_SIM_TASK_H
+#define SUS_SIM_TASK_H
+#include "FreeRTOS.h"
+
+struct SUS_SimTask
+{
+    pthread_t thread;
+    TaskFunction_t function;
+    void *argument;
+    int core;
+    uint32_t notifications;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+};
+typedef struct SUS_SimTask *TaskHandle_t;
+
+__attribute__((weak)) __thread struct SUS_SimTask *SUS_Sim_CurrentTask;     // Shared like SUS_SIM_SHARED (esp_attr.h), but thread-local variables cannot be moved to another section.
+
+static inline void *SUS_Sim_TaskEntry(void *argument)
+{
+    struct SUS_SimTask *task = (struct SUS_SimTask *)argument;
+    SUS_Sim_CurrentTask = task;
+    task->function(task->argument);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *argument, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)name; (void)stackDepth; (void)priority;
+    struct SUS_SimTask *task = (struct SUS_SimTask *)calloc(1, sizeof(*task));
+    if (task == NULL) return pdFAIL;
+    task->function = function;
+    task->argument = argument;
+    task->core = core;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->notified, NULL);
+    if (handle) *handle = task;
+    if (pthread_create(&task->thread, NULL, SUS_Sim_TaskEntry, task) != 0) { free(task); return pdFAIL; }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+static inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *argument, UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(function, name, stackDepth, argument, priority, handle, tskNO_AFFINITY);
+}
+
+static inline void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == SUS_Sim_CurrentTask)
+    {
+        task = SUS_Sim_CurrentTask;         // Like the FreeRTOS idle task freeing the TCB: the handle is invalid from here on.
+        SUS_Sim_CurrentTask = NULL;
+        if (task) { pthread_mutex_destroy(&task->lock); pthread_cond_destroy(&task->notified); free(task); }
+        pthread_exit(NULL);
+    }
+}
+
+/* Threads xTaskCreate did not start (main, the timer threads) get a handle the first time they ask - on the ESP32 app_main and the
+ * esp_timer callbacks run in tasks too, so code comparing task handles never sees NULL there. */
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (SUS_Sim_CurrentTask == NULL)
+    {
+        struct SUS_SimTask *task = (struct SUS_SimTask *)calloc(1, sizeof(*task));
+        if (task == NULL) return NULL;
+        task->thread = pthread_self();
+        task->core = tskNO_AFFINITY;
+        pthread_mutex_init(&task->lock, NULL);
+        pthread_cond_init(&task->notified, NULL);
+        SUS_Sim_CurrentTask = task;
+    }
+    return SUS_Sim_CurrentTask;
+}
+
+static inline BaseType_t xPortGetCoreID(void)
+{
+    return (SUS_Sim_CurrentTask && SUS_Sim_CurrentTask->core != tskNO_AFFINITY) ? SUS_Sim_CurrentTask->core : 0;
+}
+
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    struct timespec duration = { (time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L };
+    nanosleep(&duration, NULL);
+}
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notifications++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    struct SUS_SimTask *task = SUS_Sim_CurrentTask;
+    uint32_t count;
+    if (task == NULL) { vTaskDelay(ticksToWait == portMAX_DELAY ? 1 : ticksToWait); return 0; }
+    pthread_mutex_lock(&task->lock);
+    while (task->notifications == 0)
+        if (!SUS_Sim_Wait(&task->notified, &task->lock, ticksToWait)) break;
+    count = task->notifications;
+    if (count) task->notifications = clearCountOnExit ? 0 : count - 1;
+    pthread_mutex_unlock(&task->lock);
+    return count;
+}
+
+#endif